@@ -0,0 +1,577 @@
+"""
+Dispatch and combine benchmark of DeepEP-Ascend.
+
+Sweeps the number of tokens per rank, the hidden size, top-k, the number of experts, the quantization and the
+normal / low-latency / fused modes, and reports for every case the algorithmic bandwidth, the p50/p99 latency of
+the slowest rank and, from a profiler trace, how the time splits between the notify and the payload kernels.
+
+Examples:
+    # All the modes on 16 ranks, results also written as JSON for regression tracking
+    python3 benchmark/bench_deepep.py --num-processes 16 --modes normal,low_latency,fused \\
+        --num-tokens 128,256 --json bench.json
+
+    # Host side cost (Python wrapper, tiling and launch) of the local kernels, in a single process
+    python3 benchmark/bench_deepep.py --host-overhead --num-tokens 128,4096
+"""
+
+import argparse
+import itertools
+import json
+import os
+import sys
+import tempfile
+import time
+import uuid
+from pathlib import Path
+
+import numpy as np
+import torch
+import torch.distributed as dist
+import torch_npu
+from deep_ep import Buffer
+
+# Kernels reported apart in the trace, by the part of the call they account for
+NOTIFY_KERNELS = ("NotifyDispatch", "NotifyDispatchA2")
+PAYLOAD_KERNELS = (
+    "CamMoeDispatchNormal",
+    "DispatchNormalA2",
+    "CamMoeCombineNormal",
+    "MoeDistributeCombineA2",
+    "MoeDistributeDispatchV2",
+    "MoeDistributeCombineV2",
+    "FusedDeepMoe",
+)
+
+GMM_TILE_N_DIM = 64
+MOE_INTERMEDIATE_SIZE = 4096
+
+
+def init_dist(local_rank: int, num_local_ranks: int):
+    ip = os.getenv("MASTER_ADDR", "127.0.0.1")
+    port = int(os.getenv("MASTER_PORT", "8361"))
+    num_nodes = int(os.getenv("WORLD_SIZE", 1))
+    node_rank = int(os.getenv("RANK", 0))
+
+    torch.npu.set_device(local_rank)
+    dist.init_process_group(
+        backend="hccl",
+        init_method=f"tcp://{ip}:{port}",
+        world_size=num_nodes * num_local_ranks,
+        rank=node_rank * num_local_ranks + local_rank,
+    )
+    torch.set_default_dtype(torch.bfloat16)
+    torch.set_default_device(torch.device(f"npu:{local_rank}"))
+    group = dist.new_group(list(range(dist.get_world_size())))
+    return dist.get_rank(), dist.get_world_size(), group
+
+
+def parse_list(value: str, cast=int):
+    return [cast(item) for item in value.split(",") if item]
+
+
+def time_iterations(fn, num_warmups: int, num_tests: int) -> np.ndarray:
+    """Device time of every call in seconds, each call on its own between two events."""
+    for _ in range(num_warmups):
+        fn()
+    torch.npu.synchronize()
+
+    times = []
+    for _ in range(num_tests):
+        start = torch.npu.Event(enable_timing=True)
+        end = torch.npu.Event(enable_timing=True)
+        start.record()
+        fn()
+        end.record()
+        torch.npu.synchronize()
+        times.append(start.elapsed_time(end) / 1e3)
+    return np.array(times)
+
+
+def profile_kernels(fn, num_tests: int) -> dict:
+    """Average duration in seconds of every known kernel `fn` launches, from a profiler trace."""
+    schedule = torch_npu.profiler.schedule(wait=1, warmup=0, active=1, repeat=1)
+    with torch_npu.profiler.profile(
+        activities=[torch_npu.profiler.ProfilerActivity.NPU], schedule=schedule
+    ) as prof:
+        for _ in range(2):
+            # Line the ranks up so that no kernel is timed while waiting for a late peer to launch
+            dist.barrier()
+            for _ in range(num_tests):
+                fn()
+            torch.npu.synchronize()
+            prof.step()
+
+    # `export_chrome_trace` appends to an existing file, so write to a fresh one
+    trace_path = Path(tempfile.gettempdir()) / f"trace_{uuid.uuid4().hex}.json"
+    prof.export_chrome_trace(str(trace_path))
+    events = json.loads(trace_path.read_text())
+    os.unlink(trace_path)
+    if isinstance(events, dict):
+        events = events.get("traceEvents", [])
+
+    durations = {}
+    for event in events:
+        name = event.get("name")
+        if name in NOTIFY_KERNELS or name in PAYLOAD_KERNELS:
+            durations.setdefault(name, []).append(event["dur"] / 1e6)
+    return {name: sum(durs) / num_tests for name, durs in durations.items()}
+
+
+def summarize(times: np.ndarray, num_bytes: int, group) -> dict:
+    """Latency percentiles of the slowest rank, the bandwidth is that of this rank's bytes over its median."""
+    stats = torch.tensor(
+        [np.percentile(times, 50), np.percentile(times, 99), times.mean()],
+        dtype=torch.float64,
+        device="npu",
+    )
+    dist.all_reduce(stats, op=dist.ReduceOp.MAX, group=group)
+    p50, p99, avg = stats.tolist()
+    bandwidth = torch.tensor(
+        [num_bytes / np.percentile(times, 50) / 1e9], dtype=torch.float64, device="npu"
+    )
+    dist.all_reduce(bandwidth, op=dist.ReduceOp.MIN, group=group)
+    return {
+        "p50_us": p50 * 1e6,
+        "p99_us": p99 * 1e6,
+        "avg_us": avg * 1e6,
+        "min_rank_bandwidth_gbps": bandwidth.item(),
+    }
+
+
+def split_notify(kernels: dict) -> dict:
+    notify = sum(t for name, t in kernels.items() if name in NOTIFY_KERNELS)
+    payload = sum(t for name, t in kernels.items() if name in PAYLOAD_KERNELS)
+    return {
+        "notify_us": notify * 1e6,
+        "payload_us": payload * 1e6,
+        "kernels_us": {name: t * 1e6 for name, t in sorted(kernels.items())},
+    }
+
+
+def make_inputs(num_tokens, hidden, num_topk, num_experts, rank):
+    torch.manual_seed(rank)
+    x = torch.randn((num_tokens, hidden), dtype=torch.bfloat16, device="npu")
+    scores = torch.randn((num_tokens, num_experts), dtype=torch.float32, device="npu")
+    topk_idx = torch.topk(scores.abs() + 1, num_topk, dim=-1, sorted=False)[1]
+    topk_weights = torch.softmax(
+        torch.randn((num_tokens, num_topk), dtype=torch.float32, device="npu"), dim=-1
+    )
+    return x, topk_idx, topk_weights
+
+
+def token_bytes(hidden: int, quant: str) -> int:
+    # Int8 tokens carry their per-token float scale
+    return hidden + 4 if quant == "int8" else hidden * 2
+
+
+def bench_normal(buffer, group, case, args):
+    num_tokens, hidden, num_topk, num_experts, quant = case
+    if quant == "int8":
+        os.environ["DEEP_NORMAL_MODE_USE_INT8_QUANT"] = "1"
+    else:
+        os.environ.pop("DEEP_NORMAL_MODE_USE_INT8_QUANT", None)
+
+    rank = group.rank()
+    x, topk_idx, topk_weights = make_inputs(
+        num_tokens, hidden, num_topk, num_experts, rank
+    )
+    config = Buffer.get_dispatch_config(group.size())
+
+    def dispatch():
+        num_tokens_per_rank, _, num_tokens_per_expert, is_token_in_rank, _, layout = (
+            buffer.get_dispatch_layout(
+                topk_idx,
+                num_experts,
+                num_max_tokens_per_rank=num_tokens,
+                hidden=hidden,
+                return_layout=True,
+            )
+        )
+        return buffer.dispatch(
+            x,
+            num_tokens_per_rank=num_tokens_per_rank,
+            is_token_in_rank=is_token_in_rank,
+            num_tokens_per_expert=num_tokens_per_expert,
+            layout=layout,
+            topk_idx=topk_idx,
+            topk_weights=topk_weights,
+            config=config,
+        )
+
+    recv_x, _, _, _, handle, _ = dispatch()
+    num_recv_tokens = (recv_x[0] if isinstance(recv_x, tuple) else recv_x).size(0)
+    combine_x = torch.randn((num_recv_tokens, hidden), dtype=torch.bfloat16)
+
+    def combine():
+        return buffer.combine(
+            combine_x, handle, config=Buffer.get_combine_config(group.size())
+        )
+
+    results = []
+    for op, fn, num_bytes in (
+        ("dispatch", dispatch, num_recv_tokens * token_bytes(hidden, quant)),
+        ("combine", combine, num_recv_tokens * hidden * 2),
+    ):
+        record = summarize(
+            time_iterations(fn, args.num_warmups, args.num_tests), num_bytes, group
+        )
+        if args.profile:
+            record.update(split_notify(profile_kernels(fn, args.num_tests)))
+        results.append(("normal", op, record))
+    os.environ.pop("DEEP_NORMAL_MODE_USE_INT8_QUANT", None)
+    return results
+
+
+def bench_low_latency(buffer, group, case, args):
+    num_tokens, hidden, num_topk, num_experts, quant = case
+    rank = group.rank()
+    x, topk_idx, topk_weights = make_inputs(
+        num_tokens, hidden, num_topk, num_experts, rank
+    )
+    use_fp8 = quant == "int8"
+
+    def dispatch():
+        return buffer.low_latency_dispatch(
+            x, topk_idx, num_tokens, num_experts, use_fp8=use_fp8
+        )
+
+    recv_x, _, handle, _, _ = dispatch()
+    recv_x = recv_x[0] if isinstance(recv_x, tuple) else recv_x
+    combine_x = torch.randn(recv_x.shape, dtype=torch.bfloat16)
+
+    def combine():
+        return buffer.low_latency_combine(combine_x, topk_idx, topk_weights, handle)
+
+    def dispatch_combine():
+        dispatch()
+        combine()
+
+    num_selections = (topk_idx != -1).sum().item()
+    dispatch_bytes = num_selections * token_bytes(hidden, quant)
+    combine_bytes = num_selections * hidden * 2
+
+    results = []
+    for op, fn, num_bytes in (
+        ("dispatch", dispatch, dispatch_bytes),
+        ("combine", combine, combine_bytes),
+        ("dispatch+combine", dispatch_combine, dispatch_bytes + combine_bytes),
+    ):
+        record = summarize(
+            time_iterations(fn, args.num_warmups, args.num_tests), num_bytes, group
+        )
+        if args.profile:
+            record.update(split_notify(profile_kernels(fn, args.num_tests)))
+        results.append(("low_latency", op, record))
+    return results
+
+
+def make_fused_weights(num_local_experts, hidden):
+    """Random int8 weights in the permuted NZ layout `fused_deep_moe` takes, see tests/python/deepep."""
+    hidden_out = MOE_INTERMEDIATE_SIZE // 2
+    w13 = torch.randint(
+        -16, 16, [num_local_experts, hidden, MOE_INTERMEDIATE_SIZE], dtype=torch.int8
+    )
+    w2 = torch.randint(
+        -16, 16, [num_local_experts, hidden, hidden_out], dtype=torch.int8
+    )
+    w13_scale = torch.rand([num_local_experts, MOE_INTERMEDIATE_SIZE]) * 0.0004 + 0.0015
+    w2_scale = torch.rand([num_local_experts, hidden]) * 0.0004 + 0.0015
+
+    # The two halves of the gate-up projection are interleaved by `GMM_TILE_N_DIM` columns
+    *dims, n = w13.shape
+    w13 = w13.cpu().view(*dims, 2, n // 2 // GMM_TILE_N_DIM, GMM_TILE_N_DIM)
+    w13 = w13.transpose(-3, -2).reshape(*dims, n).contiguous().npu()
+    w13 = torch_npu.npu_format_cast(w13, 29)
+    w2 = torch_npu.npu_format_cast(w2, 29)
+
+    *dims, n = w13_scale.shape
+    w13_scale = (
+        w13_scale.reshape(*dims, 2, n // 128, 64).permute(0, 2, 1, 3).reshape(*dims, n)
+    )
+    return w13, w13_scale.float().contiguous(), w2, w2_scale.float().contiguous()
+
+
+def bench_fused(buffer, group, case, args):
+    num_tokens, hidden, num_topk, num_experts, quant = case
+    rank = group.rank()
+    x, topk_idx, topk_weights = make_inputs(
+        num_tokens, hidden, num_topk, num_experts, rank
+    )
+    w13, w13_scale, w2, w2_scale = make_fused_weights(
+        num_experts // group.size(), hidden
+    )
+
+    def fused():
+        return buffer.fused_deep_moe(
+            x,
+            topk_idx,
+            topk_weights,
+            w13,
+            w13_scale,
+            w2,
+            w2_scale,
+            num_tokens,
+            num_experts,
+        )
+
+    num_selections = (topk_idx != -1).sum().item()
+    num_bytes = num_selections * (token_bytes(hidden, quant) + hidden * 2)
+    record = summarize(
+        time_iterations(fused, args.num_warmups, args.num_tests), num_bytes, group
+    )
+    if args.profile:
+        record.update(split_notify(profile_kernels(fused, args.num_tests)))
+    return [("fused", "dispatch+gmm+combine", record)]
+
+
+def cases(args, mode):
+    for num_tokens, hidden, num_topk, num_experts, quant in itertools.product(
+        args.num_tokens, args.hidden, args.num_topk, args.num_experts, args.quant
+    ):
+        # The fused kernel only runs the int8 weights of W8A8
+        if mode == "fused" and quant != "int8":
+            continue
+        yield num_tokens, hidden, num_topk, num_experts, quant
+
+
+def run_distributed(local_rank: int, num_local_ranks: int, args: argparse.Namespace):
+    rank, num_ranks, group = init_dist(local_rank, num_local_ranks)
+    records = []
+
+    def run_mode(mode, buffer, bench_fn):
+        for case in cases(args, mode):
+            if case[3] % num_ranks != 0:
+                continue
+            dist.barrier()
+            for mode_name, op, record in bench_fn(buffer, group, case, args):
+                num_tokens, hidden, num_topk, num_experts, quant = case
+                record = {
+                    "mode": mode_name,
+                    "op": op,
+                    "num_ranks": num_ranks,
+                    "num_tokens": num_tokens,
+                    "hidden": hidden,
+                    "num_topk": num_topk,
+                    "num_experts": num_experts,
+                    "quant": quant,
+                    **record,
+                }
+                records.append(record)
+                if rank == 0:
+                    print_record(record)
+
+    if "normal" in args.modes:
+        buffer = Buffer(group, int(2e9), 0)
+        run_mode("normal", buffer, bench_normal)
+        del buffer
+
+    low_latency_modes = [
+        mode for mode in ("low_latency", "fused") if mode in args.modes
+    ]
+    if low_latency_modes:
+        num_rdma_bytes = max(
+            Buffer.get_low_latency_rdma_size_hint(
+                num_tokens, hidden, num_ranks, num_experts, num_topk
+            )
+            for num_tokens, hidden, num_topk, num_experts in itertools.product(
+                args.num_tokens, args.hidden, args.num_topk, args.num_experts
+            )
+            if num_experts % num_ranks == 0
+        )
+        buffer = Buffer(
+            group,
+            num_rdma_bytes=num_rdma_bytes,
+            low_latency_mode=True,
+            num_qps_per_rank=max(args.num_experts) // num_ranks,
+        )
+        if "low_latency" in low_latency_modes:
+            run_mode("low_latency", buffer, bench_low_latency)
+        if "fused" in low_latency_modes:
+            run_mode("fused", buffer, bench_fused)
+
+    if rank == 0 and args.json:
+        write_json(args, records, num_ranks)
+    dist.barrier()
+    dist.destroy_process_group()
+
+
+def run_host_overhead(args: argparse.Namespace):
+    """
+    Host side cost of the calls that run on one rank: the Python wrapper, the aclnn tiling and the launch. The
+    communication kernels need their peers, so only the local layout kernel, with and without the replica mapping, is
+    timed. Launches do not wait for the device, so the wall time of a call is its host side, the device is only
+    synchronized between the timed loops.
+    """
+    _, num_ranks, group = init_dist(0, 1)
+    buffer = Buffer(group, int(2e9), 0)
+    records = []
+    for num_tokens, num_topk, num_experts in itertools.product(
+        args.num_tokens, args.num_topk, args.num_experts
+    ):
+        _, topk_idx, _ = make_inputs(num_tokens, 128, num_topk, num_experts, 0)
+        for replicas in (False, True):
+            if replicas:
+                # Two replicas of every expert, placed on the physical experts `e` and `e + num_experts`
+                phy = torch.stack(
+                    [
+                        torch.arange(num_experts),
+                        torch.arange(num_experts) + num_experts,
+                    ],
+                    dim=1,
+                )
+                buffer.set_expert_replicas(
+                    phy.int(), torch.full((num_experts,), 2, dtype=torch.int)
+                )
+                layout_experts = 2 * num_experts
+            else:
+                buffer.set_expert_replicas(None)
+                layout_experts = num_experts
+
+            def layout():
+                buffer.get_dispatch_layout(topk_idx, layout_experts)
+
+            for _ in range(args.num_warmups):
+                layout()
+            torch.npu.synchronize()
+
+            times = []
+            for _ in range(args.num_tests):
+                start = time.perf_counter()
+                layout()
+                times.append(time.perf_counter() - start)
+            torch.npu.synchronize()
+
+            times = np.array(times)
+            record = {
+                "mode": "host",
+                "op": "get_dispatch_layout" + (" (replicas)" if replicas else ""),
+                "num_ranks": num_ranks,
+                "num_tokens": num_tokens,
+                "num_topk": num_topk,
+                "num_experts": num_experts,
+                "p50_us": np.percentile(times, 50) * 1e6,
+                "p99_us": np.percentile(times, 99) * 1e6,
+                "avg_us": times.mean() * 1e6,
+            }
+            records.append(record)
+            print_record(record)
+    buffer.set_expert_replicas(None)
+
+    if args.json:
+        write_json(args, records, num_ranks)
+    dist.destroy_process_group()
+
+
+def print_record(record: dict):
+    shape = (
+        f"tokens={record['num_tokens']}, hidden={record.get('hidden', '-')}, "
+        f"topk={record['num_topk']}, experts={record['num_experts']}, quant={record.get('quant', '-')}"
+    )
+    line = (
+        f"[{record['mode']}] {record['op']:<20} {shape} | "
+        f"p50 {record['p50_us']:.2f} us, p99 {record['p99_us']:.2f} us"
+    )
+    if "min_rank_bandwidth_gbps" in record:
+        line += f", {record['min_rank_bandwidth_gbps']:.2f} GB/s"
+    if "notify_us" in record:
+        line += f" | notify {record['notify_us']:.2f} us, payload {record['payload_us']:.2f} us"
+    print(line, flush=True)
+
+
+def write_json(args: argparse.Namespace, records: list, num_ranks: int):
+    report = {
+        "device": torch.npu.get_device_name(),
+        "num_ranks": num_ranks,
+        "torch": torch.__version__,
+        "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "argv": sys.argv[1:],
+        "results": records,
+    }
+    Path(args.json).write_text(json.dumps(report, indent=2))
+    print(f"Results written to {args.json}", flush=True)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="Benchmark DeepEP dispatch and combine"
+    )
+    parser.add_argument(
+        "--num-processes",
+        type=int,
+        default=16,
+        help="Number of processes to spawn (default: 16)",
+    )
+    parser.add_argument(
+        "--modes",
+        type=lambda value: parse_list(value, str),
+        default=["normal", "low_latency"],
+        help="Comma-separated modes among normal, low_latency and fused (default: normal,low_latency)",
+    )
+    parser.add_argument(
+        "--num-tokens",
+        type=parse_list,
+        default=[128],
+        help="Comma-separated tokens per rank (default: 128)",
+    )
+    parser.add_argument(
+        "--hidden",
+        type=parse_list,
+        default=[7168],
+        help="Comma-separated hidden sizes (default: 7168)",
+    )
+    parser.add_argument(
+        "--num-topk",
+        type=parse_list,
+        default=[8],
+        help="Comma-separated top-k values (default: 8)",
+    )
+    parser.add_argument(
+        "--num-experts",
+        type=parse_list,
+        default=[256],
+        help="Comma-separated expert counts (default: 256)",
+    )
+    parser.add_argument(
+        "--quant",
+        type=lambda value: parse_list(value, str),
+        default=["none", "int8"],
+        help="Comma-separated dispatch quantizations among none and int8 (default: none,int8)",
+    )
+    parser.add_argument(
+        "--num-warmups",
+        type=int,
+        default=10,
+        help="Warmup calls per case (default: 10)",
+    )
+    parser.add_argument(
+        "--num-tests", type=int, default=50, help="Timed calls per case (default: 50)"
+    )
+    parser.add_argument(
+        "--no-profile",
+        dest="profile",
+        action="store_false",
+        help="Skip the profiler pass that splits notify and payload time",
+    )
+    parser.add_argument(
+        "--host-overhead",
+        action="store_true",
+        help="Only time the host side of the local kernels, in a single process",
+    )
+    parser.add_argument(
+        "--json", type=str, default="", help="Write the results to this JSON file"
+    )
+    args = parser.parse_args()
+
+    for mode in args.modes:
+        assert mode in ("normal", "low_latency", "fused"), f"Unknown mode {mode}"
+    for quant in args.quant:
+        assert quant in ("none", "int8"), f"Unknown quantization {quant}"
+
+    if args.host_overhead:
+        run_host_overhead(args)
+    else:
+        torch.multiprocessing.spawn(
+            run_distributed,
+            args=(args.num_processes, args),
+            nprocs=args.num_processes,
+        )
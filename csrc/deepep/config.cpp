@@ -1,9 +1,251 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
 #include "config.hpp"
+#include "exception.hpp"
 
 namespace deep_ep {
-size_t get_low_latency_rdma_size_hint(int num_max_dispatch_tokens_per_rank, int hidden, int num_ranks, int num_experts)
+namespace {
+
+// Window layout of the kernels, kept in line with the window checks of the tilings in ops/op_host and ops2/op_host
+constexpr size_t MB_SIZE = 1024UL * 1024UL;
+constexpr size_t WIN_ADDR_ALIGN = 512;
+constexpr size_t UB_ALIGN = 32;
+// Dispatched tokens carry a 32B scale and three int32 expand indices behind the hidden states
+constexpr size_t TOKEN_META_BYTES = 44;
+// Consecutive calls alternate between two halves of the window
+constexpr size_t DOUBLE_DATA_BUFFER = 2;
+constexpr size_t NOTIFY_FLAG_BYTES = 2 * MB_SIZE;
+constexpr size_t A2_COMBINE_STATE_WIN_OFFSET = 3 * MB_SIZE;
+constexpr size_t A2_NOTIFY_DISPATCH_WIN_OFFSET = 204 * MB_SIZE;
+constexpr size_t A3_COMBINE_STATE_WIN_OFFSET = 4 * MB_SIZE;
+constexpr size_t A3_NOTIFY_DISPATCH_WIN_OFFSET = 102 * MB_SIZE;
+
+// The A2 internode kernels reserve this many tokens per rank whatever the batch is
+constexpr size_t A2_MAX_BATCH_SIZE = 4096;
+constexpr int A2_LOCAL_RANK_SIZE = 8;
+constexpr int MAX_NUM_RANKS = 384;
+// Vector cores of one die, an upper bound over the SoCs the A3 layout kernel runs on
+constexpr int64_t MAX_AIV_NUM = 64;
+// The layout kernel copies the expert counts of a core in 32-byte blocks
+constexpr int64_t LAYOUT_COPY_ALIGN = 8;
+
+constexpr size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Every token in a window starts on a `WIN_ADDR_ALIGN` boundary, a combined token is the hidden states only
+constexpr size_t combine_token_bytes(size_t hidden_bytes)
+{
+    return align_up(hidden_bytes, WIN_ADDR_ALIGN);
+}
+
+constexpr size_t dispatch_token_bytes(size_t hidden_bytes)
+{
+    return align_up(align_up(hidden_bytes, UB_ALIGN) + TOKEN_META_BYTES, WIN_ADDR_ALIGN);
+}
+
+// Window bytes of a normal-mode intranode dispatch and combine of `num_tokens_per_round` tokens per rank and round.
+// Every token takes `num_topk` slots in the window whatever rank it comes from, so `num_ranks` does not count.
+// Multi-round combine double-buffers its slots so that a round can be sent while the previous one is reduced
+size_t normal_window_bytes(size_t hidden_bytes, int num_topk, size_t num_tokens_per_round, int round, SocType soc)
+{
+    size_t combine_bytes = combine_token_bytes(hidden_bytes) * (round > 1 ? 2 : 1);
+    size_t token_bytes = combine_bytes + dispatch_token_bytes(hidden_bytes);
+    size_t reserved_bytes = soc == SocType::A2 ? A2_COMBINE_STATE_WIN_OFFSET + A2_NOTIFY_DISPATCH_WIN_OFFSET
+                                               : A3_COMBINE_STATE_WIN_OFFSET + A3_NOTIFY_DISPATCH_WIN_OFFSET;
+    size_t num_slots = num_tokens_per_round * static_cast<size_t>(num_topk);
+    return (num_slots * token_bytes + reserved_bytes) * DOUBLE_DATA_BUFFER;
+}
+
+struct ConfigPreset {
+    int num_ranks;
+    int num_max_nvl_chunked_send_tokens;
+    int num_max_nvl_chunked_recv_tokens;
+    int num_max_rdma_chunked_send_tokens;
+    int num_max_rdma_chunked_recv_tokens;
+};
+
+constexpr std::array<ConfigPreset, 10> DISPATCH_PRESETS = {{
+    {2, 24, 256, 6, 128},
+    {4, 6, 256, 6, 128},
+    {8, 6, 256, 6, 128},
+    {16, 36, 288, 20, 128},
+    {24, 8, 288, 32, 128},
+    {32, 32, 288, 32, 128},
+    {64, 20, 288, 28, 128},
+    {128, 20, 560, 32, 128},
+    {144, 32, 720, 12, 128},
+    {160, 28, 720, 12, 128},
+}};
+
+constexpr std::array<ConfigPreset, 10> COMBINE_PRESETS = {{
+    {2, 10, 256, 6, 128},
+    {4, 9, 256, 6, 128},
+    {8, 4, 256, 6, 128},
+    {16, 4, 288, 12, 128},
+    {24, 1, 288, 8, 128},
+    {32, 1, 288, 8, 128},
+    {64, 1, 288, 20, 128},
+    {128, 1, 560, 12, 128},
+    {144, 2, 720, 8, 128},
+    {160, 2, 720, 8, 128},
+}};
+
+template <size_t N>
+Config select_preset(const std::array<ConfigPreset, N> &presets, int num_ranks, int num_sms, SocType soc)
+{
+    EP_HOST_ASSERT(num_sms > 0 and num_sms % 2 == 0);
+    EP_HOST_ASSERT(num_ranks >= 2 and num_ranks <= MAX_NUM_RANKS);
+    // A2 servers join as a whole, every server brings its full set of HCCS peers
+    EP_HOST_ASSERT(soc != SocType::A2 or num_ranks <= A2_LOCAL_RANK_SIZE or num_ranks % A2_LOCAL_RANK_SIZE == 0);
+
+    auto preset = std::find_if(presets.begin(), presets.end(),
+                               [num_ranks](const ConfigPreset &entry) { return entry.num_ranks >= num_ranks; });
+    if (preset == presets.end()) {
+        preset = presets.end() - 1;
+    }
+    return Config(num_sms, preset->num_max_nvl_chunked_send_tokens, preset->num_max_nvl_chunked_recv_tokens,
+                  preset->num_max_rdma_chunked_send_tokens, preset->num_max_rdma_chunked_recv_tokens);
+}
+
+}  // namespace
+
+size_t Config::get_nvl_buffer_size_hint(size_t hidden_bytes, int num_ranks, int num_topk,
+                                        int num_max_tokens_per_round, int round, SocType soc) const
+{
+    EP_HOST_ASSERT(num_ranks > 0 and num_topk > 0 and num_max_tokens_per_round > 0 and round >= 1);
+    return normal_window_bytes(hidden_bytes, num_topk, static_cast<size_t>(num_max_tokens_per_round), round, soc);
+}
+
+size_t Config::get_rdma_buffer_size_hint(int64_t hidden_bytes, int num_ranks, int num_experts) const
+{
+    EP_HOST_ASSERT(hidden_bytes > 0 and num_ranks > 0 and num_experts % num_ranks == 0);
+    size_t num_local_experts = static_cast<size_t>(num_experts / num_ranks);
+    size_t dispatch_bytes = static_cast<size_t>(num_ranks) * A2_MAX_BATCH_SIZE * static_cast<size_t>(hidden_bytes) *
+                            num_local_experts * DOUBLE_DATA_BUFFER;
+
+    // The notify exchanges the int32 send data built by the layout, once to send and once to gather
+    size_t send_count = static_cast<size_t>(
+        get_notify_send_data_size(num_experts, num_ranks, SocType::A2, static_cast<int64_t>(A2_MAX_BATCH_SIZE)));
+    size_t notify_bytes = 2 * sizeof(int32_t) * send_count + NOTIFY_FLAG_BYTES;
+    return std::max(dispatch_bytes, notify_bytes);
+}
+
+int64_t get_notify_send_data_size(int num_experts, int num_ranks, SocType soc, int64_t max_bs)
+{
+    EP_HOST_ASSERT(num_experts > 0 and num_ranks > 0);
+    if (soc == SocType::A3) {
+        return MAX_AIV_NUM * num_experts + LAYOUT_COPY_ALIGN;
+    }
+    EP_HOST_ASSERT(max_bs > 0 and max_bs <= static_cast<int64_t>(A2_MAX_BATCH_SIZE));
+    int64_t server_num = num_ranks / A2_LOCAL_RANK_SIZE;
+    return num_experts * (1 + max_bs) + server_num + max_bs * (1 + 2 * server_num + num_experts);
+}
+
+size_t get_low_latency_rdma_size_hint(int num_max_dispatch_tokens_per_rank, int hidden, int num_ranks, int num_experts,
+                                      int num_topk, int num_shared_expert_ranks)
+{
+    EP_HOST_ASSERT(num_max_dispatch_tokens_per_rank > 0 and hidden > 0 and num_topk > 0);
+    EP_HOST_ASSERT(num_shared_expert_ranks >= 0 and num_shared_expert_ranks < num_ranks);
+    int num_moe_ranks = num_ranks - num_shared_expert_ranks;
+    EP_HOST_ASSERT(num_experts > 0 and num_experts % num_moe_ranks == 0);
+
+    // MoE ranks receive from every rank for every local expert, shared expert ranks take one expert and so never
+    // need more. The combine side keeps one slot per selected expert, plus one for the shared expert if any
+    size_t hidden_bytes = static_cast<size_t>(hidden) * sizeof(uint16_t);
+    size_t max_bs = static_cast<size_t>(num_max_dispatch_tokens_per_rank);
+    size_t num_local_experts = static_cast<size_t>(num_experts / num_moe_ranks);
+    size_t num_combine_slots = static_cast<size_t>(num_topk) + (num_shared_expert_ranks > 0 ? 1 : 0);
+    size_t dispatch_bytes =
+        max_bs * dispatch_token_bytes(hidden_bytes) * static_cast<size_t>(num_ranks) * num_local_experts;
+    size_t combine_bytes = max_bs * combine_token_bytes(hidden_bytes) * num_combine_slots;
+    return (dispatch_bytes + combine_bytes) * DOUBLE_DATA_BUFFER;
+}
+
+RoundConfig get_normal_round_config(int64_t num_max_tokens, int hidden, int num_topk, size_t window_bytes, SocType soc)
+{
+    EP_HOST_ASSERT(num_max_tokens >= 0 and num_max_tokens <= MAX_TOTAL_TOKENS);
+    EP_HOST_ASSERT(hidden >= 0 and num_topk > 0);
+    size_t hidden_bytes = static_cast<size_t>(hidden) * sizeof(uint16_t);
+    auto fits = [&](int64_t num_tokens_per_round, int round) {
+        return hidden == 0 or normal_window_bytes(hidden_bytes, num_topk, static_cast<size_t>(num_tokens_per_round),
+                                                  round, soc) <= window_bytes;
+    };
+
+    // A single round only reserves the window for the batch, not for `per_round_tokens`
+    if (num_max_tokens <= MAX_TOKENS_PER_ROUND and fits(num_max_tokens, 1)) {
+        return {1, static_cast<int>(MAX_TOKENS_PER_ROUND)};
+    }
+
+    // Power-of-two rounds divide `MAX_TOTAL_TOKENS`, so the rounds never cover more than that
+    int per_round_tokens = MAX_TOKENS_PER_ROUND;
+    while (per_round_tokens > static_cast<int>(MIN_TOKENS_PER_ROUND) and not fits(per_round_tokens, 2)) {
+        per_round_tokens /= 2;
+    }
+    // HCCL_BUFFSIZE is too small for even the smallest round
+    EP_HOST_ASSERT(fits(per_round_tokens, 2));
+    int round = static_cast<int>((num_max_tokens + per_round_tokens - 1) / per_round_tokens);
+    EP_HOST_ASSERT(round <= static_cast<int>(MAX_ROUNDS));
+    return {round, per_round_tokens};
+}
+
+RoundConfig get_fused_deep_moe_round_config(int64_t num_max_dispatch_tokens_per_rank)
+{
+    EP_HOST_ASSERT(num_max_dispatch_tokens_per_rank > 0);
+    int64_t round = (num_max_dispatch_tokens_per_rank + FUSED_DEEP_MOE_MAX_TOKENS - 1) / FUSED_DEEP_MOE_MAX_TOKENS;
+    int64_t per_round_tokens = (num_max_dispatch_tokens_per_rank + round - 1) / round;
+    return {static_cast<int>(round), static_cast<int>(per_round_tokens)};
+}
+
+size_t get_hccl_window_bytes()
+{
+    // The tilings fall back to 200MB, see Mc2TilingUtils::GetMaxWindowSize
+    const char *name = std::getenv("DEEPEP_HCCL_BUFFSIZE") != nullptr ? "DEEPEP_HCCL_BUFFSIZE" : "HCCL_BUFFSIZE";
+    return static_cast<size_t>(get_value_from_env(name, 200)) * MB_SIZE;
+}
+
+std::vector<int32_t> get_elastic_info(const std::vector<bool> &active, int num_experts)
+{
+    int num_ranks = static_cast<int>(active.size());
+    EP_HOST_ASSERT(num_ranks > 0 and num_experts % num_ranks == 0);
+    std::vector<int32_t> info(ELASTIC_INFO_OFFSET + 2 * num_ranks, -1);
+    int num_active = 0;
+    for (int rank = 0; rank < num_ranks; ++rank) {
+        if (active[rank]) {
+            info[ELASTIC_INFO_OFFSET + rank] = num_active;
+            info[ELASTIC_INFO_OFFSET + num_ranks + num_active] = rank;
+            ++num_active;
+        }
+    }
+    EP_HOST_ASSERT(num_active > 0);
+    info[0] = num_active < num_ranks ? 1 : 0;
+    info[1] = num_active;
+    info[2] = 0;
+    info[3] = num_active * (num_experts / num_ranks);
+    return info;
+}
+
+int get_cost_bucket(int64_t cost_us)
+{
+    int bucket = 0;
+    while (cost_us > 0 and bucket < NUM_COST_BUCKETS - 1) {
+        cost_us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+Config get_dispatch_config_preset(int num_ranks, int num_sms, SocType soc)
+{
+    return select_preset(DISPATCH_PRESETS, num_ranks, num_sms, soc);
+}
+
+Config get_combine_config_preset(int num_ranks, int num_sms, SocType soc)
 {
-    return num_max_dispatch_tokens_per_rank;
+    return select_preset(COMBINE_PRESETS, num_ranks, num_sms, soc);
 }
 
 int get_value_from_env(const std::string &name, int defaultValue)
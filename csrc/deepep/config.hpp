@@ -1,12 +1,34 @@
 #pragma once
-#include <pybind11/pybind11.h>
-#include <pybind11/pytypes.h>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cctype>
 #include <string>
+#include <vector>
 
 namespace deep_ep {
 
+// The op trees differ in their window layout, A2 runs ops2 and A3 runs ops
+enum class SocType : int {
+    A2 = 0,
+    A3 = 1,
+};
+
+// Upper bound of `num_topk` in every dispatch kernel, the size hints assume it unless told otherwise
+constexpr int MAX_NUM_TOPK = 16;
+
+// Limits of the multi-round normal-mode dispatch and combine kernels
+constexpr uint32_t MAX_ROUNDS = 256;
+constexpr uint32_t MIN_TOKENS_PER_ROUND = 32;
+constexpr uint32_t MAX_TOKENS_PER_ROUND = 8192;
+constexpr uint32_t MAX_TOTAL_TOKENS = 131072;
+
+// Every round of a normal-mode dispatch sends at most `per_round_tokens` tokens of every rank
+struct RoundConfig {
+    int round;
+    int per_round_tokens;
+};
+
 struct Config {
     int num_sms;
     int num_max_nvl_chunked_send_tokens;
@@ -23,18 +45,56 @@ struct Config {
           num_max_rdma_chunked_recv_tokens(num_max_rdma_chunked_recv_tokens)
     {}
 
-    size_t get_nvl_buffer_size_hint(size_t hidden_bytes, int num_ranks) const
-    {
-        return hidden_bytes;
-    }
+    // HCCL window bytes the normal-mode intranode notify, dispatch and combine need, `num_max_tokens_per_round` is
+    // the per-round token count when `round > 1` and the largest batch otherwise
+    size_t get_nvl_buffer_size_hint(size_t hidden_bytes, int num_ranks, int num_topk = MAX_NUM_TOPK,
+                                    int num_max_tokens_per_round = 8192, int round = 1,
+                                    SocType soc = SocType::A3) const;
 
-    size_t get_rdma_buffer_size_hint(int64_t hidden_bytes, int num_ranks) const
-    {
-        return hidden_bytes;
-    }
+    // HCCL window bytes the A2 internode notify and dispatch need, they always reserve the largest batch
+    size_t get_rdma_buffer_size_hint(int64_t hidden_bytes, int num_ranks, int num_experts = 256) const;
 };
 
-size_t get_low_latency_rdma_size_hint(int num_max_dispatch_tokens_per_rank, int hidden, int num_ranks, int num_experts);
+size_t get_low_latency_rdma_size_hint(int num_max_dispatch_tokens_per_rank, int hidden, int num_ranks, int num_experts,
+                                      int num_topk = MAX_NUM_TOPK, int num_shared_expert_ranks = 0);
+
+// Rounds of a normal-mode intranode dispatch whose largest batch over the ranks is `num_max_tokens`: one round when
+// the batch fits in the window, otherwise the fewest rounds of the largest power-of-two size that fits. A zero
+// `hidden` leaves the window out and only the kernel limits apply
+RoundConfig get_normal_round_config(int64_t num_max_tokens, int hidden, int num_topk, size_t window_bytes,
+                                    SocType soc = SocType::A3);
+
+// Tokens of every rank the fused dispatch, GEMM and combine kernel takes in one launch
+constexpr int FUSED_DEEP_MOE_MAX_TOKENS = 256;
+
+// Launches of a fused MoE call and the tokens of every rank in each, as few launches of equal size as fit. They follow
+// `num_max_dispatch_tokens_per_rank` only, so that every rank launches the kernel the same number of times
+RoundConfig get_fused_deep_moe_round_config(int64_t num_max_dispatch_tokens_per_rank);
+
+// Int32 entries of the `notify_send_data` the layout kernel writes. The A2 kernel builds the internode notify input,
+// laid out for `max_bs` tokens on every rank; the A3 kernel only keeps per-core expert counts in it
+int64_t get_notify_send_data_size(int num_experts, int num_ranks, SocType soc, int64_t max_bs);
+
+// Bytes of the HCCL window the kernels check against, `DEEPEP_HCCL_BUFFSIZE` or else `HCCL_BUFFSIZE` in MB
+size_t get_hccl_window_bytes();
+
+// Layout of the `elastic_info` input of the A3 low-latency kernels
+constexpr int ELASTIC_INFO_OFFSET = 4;
+
+// `elastic_info` for the ranks whose `active` entry is set, all of them MoE ranks keeping their experts: the scale-down
+// flag, the active rank count, the shared expert rank count and the MoE expert count, then the compact id of every
+// rank (-1 if inactive) and the rank of every compact id (-1 past the active ranks)
+std::vector<int32_t> get_elastic_info(const std::vector<bool> &active, int num_experts);
+
+// Cost telemetry keeps a histogram of the per-peer microseconds of every call: bucket 0 counts zero costs, bucket `i`
+// costs in [2^(i-1), 2^i) and the last bucket all costs from 2^(NUM_COST_BUCKETS - 2) on
+constexpr int NUM_COST_BUCKETS = 16;
+int get_cost_bucket(int64_t cost_us);
+
+// Normal-mode presets, rank counts between the tuned ones take the next larger tuned count
+Config get_dispatch_config_preset(int num_ranks, int num_sms, SocType soc);
+
+Config get_combine_config_preset(int num_ranks, int num_sms, SocType soc);
 
 int get_value_from_env(const std::string &name, int defaultValue);
 }  // namespace deep_ep
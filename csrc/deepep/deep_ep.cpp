@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <cmath>
 #include <pybind11/functional.h>
@@ -9,18 +10,85 @@
 
 namespace deep_ep {
 constexpr int PADDING_SIZE = 1;
-constexpr size_t HCOMM_NAME_LEN = 128;
 constexpr uint32_t NO_SCALES = 0;
 constexpr uint32_t DYNAMIC_SCALES = 2;
 constexpr int LOCAL_RANK_SIZE = 8;
 constexpr int MAX_BATCH_SIZE = 4096;
-constexpr int EXPERT_DATA_SIZE = 1 + MAX_BATCH_SIZE;  // 4097
+// The A2 layout stages the counts of each of up to 64 cores in the [max_bs, num_experts] section of its notify data,
+// which needs two rows per core
+constexpr int A2_MIN_NOTIFY_BATCH = 128;
 constexpr int A3_MAX_HCCS_PEERS = 384;
 constexpr int A2_MAX_HCCS_PEERS = 8;
-constexpr uint32_t MAX_ROUNDS = 256;
-constexpr uint32_t MIN_TOKENS_PER_ROUND = 32;
-constexpr uint32_t MAX_TOKENS_PER_ROUND = 8192;
-constexpr uint32_t MAX_TOTAL_TOKENS = 131072;
+// How a logical expert picks one of its replicas, only the A3 low-latency dispatch kernel balances by load
+constexpr int64_t REPLICA_ROUND_ROBIN = 0;
+constexpr int64_t REPLICA_LEAST_LOADED = 1;
+
+// Picks a physical replica for every logical expert id on the device with the rule of the A3 low-latency dispatch
+// kernel: token i of rank r takes replica (i + r) % logcnt, negative ids are kept
+at::Tensor map_to_expert_replicas(const at::Tensor &topk_idx, const at::Tensor &log2phy, const at::Tensor &logcnt,
+                                  int64_t rank)
+{
+    auto logical = topk_idx.clamp_min(0).to(at::kLong);
+    auto token = at::arange(topk_idx.size(0), logical.options()).unsqueeze(1) + rank;
+    auto replica_cnt = logcnt.to(at::kLong).index_select(0, logical.flatten()).view_as(logical);
+    auto entry = logical * log2phy.size(1) + token.remainder(replica_cnt);
+    auto physical = log2phy.flatten().index_select(0, entry.flatten()).view_as(logical);
+    return at::where(topk_idx >= 0, physical.to(topk_idx.scalar_type()), topk_idx);
+}
+
+// Splits the capacity of every expert over the source ranks by water-filling their `counts` ([num_ranks,
+// num_experts]): a rank under the common level keeps all its entries, the others get the level, and the units left
+// below the next level go to the lower ranks first. Every rank splits the same counts, so the quotas of all the ranks
+// add up to at most `capacity` and each one reads its own row
+at::Tensor split_expert_capacity(const at::Tensor &counts, const at::Tensor &capacity)
+{
+    int64_t num_ranks = counts.size(0);
+    auto sorted = std::get<0>(at::sort(counts, 0));
+    auto before = sorted.cumsum(0) - sorted;
+    auto left = at::arange(num_ranks, 0, -1, counts.options()).unsqueeze(1);
+    // The level if the `k` smallest counts are kept whole, it settles at the first count it falls below
+    auto level = (capacity - before).clamp_min(0).div(left, "floor");
+    auto kept = level.ge(sorted).to(at::kLong).cumprod(0).sum(0, true);
+    auto first = kept.clamp_max(num_ranks - 1);
+    auto water = level.gather(0, first);
+    auto spare = capacity - before.gather(0, first) - (num_ranks - first) * water;
+    auto over = counts.gt(water).to(at::kLong);
+    auto extra = over.logical_and((over.cumsum(0) - over).lt(spare)).to(at::kLong);
+    return at::where(kept.eq(num_ranks), counts, at::minimum(counts, water) + extra);
+}
+
+// Sets the entries of `topk_idx` beyond `capacity` ([num_experts]) of their expert to -1 on the device, higher
+// `priority` and then earlier entries keep their slots, negative ids are kept
+at::Tensor drop_over_capacity(const at::Tensor &topk_idx, const at::Tensor &priority, const at::Tensor &capacity)
+{
+    int64_t num_experts = capacity.size(0);
+    auto expert = topk_idx.flatten().to(at::kLong);
+    expert = expert.masked_fill(expert.lt(0), num_experts);
+    // Two stable sorts list the entries of every expert by descending priority
+    auto by_priority = std::get<1>(at::sort(priority.flatten(), true, 0, true));
+    auto by_expert = std::get<1>(at::sort(expert.index_select(0, by_priority), true, 0, false));
+    auto order = by_priority.index_select(0, by_expert);
+    auto sorted_expert = expert.index_select(0, order);
+    auto counts = at::bincount(sorted_expert, {}, num_experts + 1);
+    auto first = counts.cumsum(0) - counts;
+    auto slot = at::arange(order.size(0), order.options()) - first.index_select(0, sorted_expert);
+    // Negative ids take the slots past every capacity
+    auto limit = at::cat({capacity.to(at::kLong), slot.new_full({1}, order.size(0))});
+    auto dropped = at::empty_like(slot, at::kBool).scatter_(0, order, slot.ge(limit.index_select(0, sorted_expert)));
+    return topk_idx.masked_fill(dropped.view_as(topk_idx), -1);
+}
+
+// Drops the rows a dispatch appended to an empty batch from the combine output
+at::Tensor strip_padding(const DispatchHandle &handle, const at::Tensor &combined_x)
+{
+    if (not handle.is_padding()) {
+        return combined_x;
+    }
+    if (handle.padding_cnt == PADDING_SIZE) {
+        return handle.ori_x;
+    }
+    return combined_x.slice(0, 0, PADDING_SIZE - handle.padding_cnt);
+}
 
 Buffer::Buffer(int64_t rank, int64_t num_ranks, int64_t num_nvl_bytes, int64_t num_rdma_bytes, bool low_latency_mode,
                std::string moe_all_to_all_group_name)
@@ -29,7 +97,8 @@ Buffer::Buffer(int64_t rank, int64_t num_ranks, int64_t num_nvl_bytes, int64_t n
       num_nvl_bytes(num_nvl_bytes),
       num_rdma_bytes(num_rdma_bytes),
       low_latency_mode(low_latency_mode),
-      moe_all_to_all_group_name(moe_all_to_all_group_name)
+      moe_all_to_all_group_name(moe_all_to_all_group_name),
+      comm_stream(c10_npu::getNPUStreamFromPool())
 {
     rdma_rank = rank;
     EP_HOST_ASSERT(0 <= rank and rank < num_ranks);
@@ -45,6 +114,35 @@ Buffer::Buffer(int64_t rank, int64_t num_ranks, int64_t num_nvl_bytes, int64_t n
         EP_HOST_ASSERT(moe_all_to_all_group_name.size() < HCOMM_NAME_LEN);
     }
 
+    // Resolved once, every launch passes the same name
+    if (!moe_all_to_all_group_name.empty()) {
+        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
+    } else {
+        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
+    }
+
+    soc_version = op::GetCurrentPlatformInfo().GetSocVersion();
+    num_rdma_ranks = 1;
+    num_nvl_ranks = num_ranks;
+    rdma_rank = rank;
+    nvl_rank = rank;
+    if (soc_version == op::SocVersion::ASCEND910B) {
+        num_rdma_ranks = std::max(static_cast<int64_t>(1), num_ranks / A2_MAX_HCCS_PEERS);
+        num_nvl_ranks = std::min(num_ranks, static_cast<int64_t>(A2_MAX_HCCS_PEERS));
+        rdma_rank = rank / A2_MAX_HCCS_PEERS;
+        nvl_rank = rank % A2_MAX_HCCS_PEERS;
+    }
+
+    reconfigure();
+}
+
+Buffer::~Buffer() noexcept(false) {}
+
+void Buffer::reconfigure()
+{
+    // A pending receive hook would launch with the switches its send phase did not use
+    EP_HOST_ASSERT(not low_latency_recv->any_pending());
+
     this->shared_expert_rank_num = get_value_from_env("MOE_SHARED_EXPERT_RANK_NUM", 0);
     const char *roundEnv = std::getenv("DEEPEP_NORMAL_LONG_SEQ_ROUND");
     const char *tokensEnv = std::getenv("DEEPEP_NORMAL_LONG_SEQ_PER_ROUND_TOKENS");
@@ -55,10 +153,12 @@ Buffer::Buffer(int64_t rank, int64_t num_ranks, int64_t num_nvl_bytes, int64_t n
     // 检查设置状态
     EP_HOST_ASSERT(roundSet == tokensSet);
 
-    // 未设置时使用默认值
+    // 未设置时按调用方给出的各卡最大token数和win区大小自动选择轮数，未给出时为单轮
+    this->auto_round = !roundSet;
+    this->hccl_window_bytes = get_hccl_window_bytes();
     if (!roundSet && !tokensSet) {
         this->round = 1;
-        this->per_round_tokens = 8192;
+        this->per_round_tokens = MAX_TOKENS_PER_ROUND;
     } else {
         // 转换并验证数值
         char *end;
@@ -67,108 +167,169 @@ Buffer::Buffer(int64_t rank, int64_t num_ranks, int64_t num_nvl_bytes, int64_t n
         long t = std::strtol(tokensEnv, &end, 10);
         EP_HOST_ASSERT(*end == '\0' && t >= MIN_TOKENS_PER_ROUND && t <= MAX_TOKENS_PER_ROUND);
         // 验证乘积限制
-        EP_HOST_ASSERT(r * t <= 131072);
+        EP_HOST_ASSERT(r * t <= MAX_TOTAL_TOKENS);
         round = static_cast<int>(r);
         per_round_tokens = static_cast<int>(t);
     }
 
-    soc_version = op::GetCurrentPlatformInfo().GetSocVersion();
-    num_rdma_ranks = 1;
-    num_nvl_ranks = num_ranks;
-    rdma_rank = rank;
-    nvl_rank = rank;
+    // indicates the value type of the output num_recv_tokens_per_expert_list, with a range of [0, 1]
+    // 0 means the prefix sum of the number of tokens received by each expert;
+    // 1 means the number of tokens received by each expert (default)
+    expert_token_nums_type = get_value_from_env("MOE_EXPERT_TOKEN_NUMS_TYPE", 1);
+    EP_HOST_ASSERT(expert_token_nums_type == 1 or expert_token_nums_type == 0);
+    enable_topk_neg_one = get_value_from_env("MOE_ENABLE_TOPK_NEG_ONE", 0) != 0;
+
+    a2_layered = false;
     if (soc_version == op::SocVersion::ASCEND910B) {
-        num_rdma_ranks = std::max(static_cast<int64_t>(1), num_ranks / A2_MAX_HCCS_PEERS);
-        num_nvl_ranks = std::min(num_ranks, static_cast<int64_t>(A2_MAX_HCCS_PEERS));
-        rdma_rank = rank / A2_MAX_HCCS_PEERS;
-        nvl_rank = rank % A2_MAX_HCCS_PEERS;
+        const char *hcclIntraPcieEnable = getenv("HCCL_INTRA_PCIE_ENABLE");
+        const char *hcclIntraRoceEnable = getenv("HCCL_INTRA_ROCE_ENABLE");
+        if (hcclIntraPcieEnable != nullptr && hcclIntraRoceEnable != nullptr && strcmp(hcclIntraPcieEnable, "1") == 0 &&
+            strcmp(hcclIntraRoceEnable, "0") == 0) {  // A2 layered
+            a2_layered = true;
+        }
     }
 }
 
-Buffer::~Buffer() noexcept(false) {}
-
 bool Buffer::is_available() const
 {
     return available;
 }
 
-std::tuple<torch::Tensor, std::optional<torch::Tensor>, torch::Tensor, torch::Tensor, std::optional<EventHandle>>
-Buffer::get_dispatch_layout(const torch::Tensor &topk_idx, int num_experts, std::optional<EventHandle> &previous_event,
-                            bool async, bool allocate_on_comm_stream)
+bool Buffer::is_auto_round() const
+{
+    // The internode kernels run a single round
+    return auto_round and num_rdma_ranks == 1;
+}
+
+int Buffer::get_expert_token_nums_type() const
+{
+    return expert_token_nums_type;
+}
+
+std::tuple<torch::Tensor, std::optional<torch::Tensor>, torch::Tensor, torch::Tensor, DispatchHandle,
+           std::optional<EventHandle>>
+Buffer::get_dispatch_layout(const torch::Tensor &topk_idx, int num_experts, int64_t num_max_tokens, int hidden,
+                            std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream,
+                            const std::optional<at::Tensor> &topk_weights,
+                            const std::optional<at::Tensor> &expert_counts)
 {
     EP_HOST_ASSERT(topk_idx.dim() == 2);
     EP_HOST_ASSERT(topk_idx.is_contiguous());
     EP_HOST_ASSERT(num_experts > 0);
+    // The normal kernels exchange counts with every rank, they cannot leave inactive ranks out. The dispatches and
+    // combines check it again, as a layout or handle from before `set_active_ranks` would wait on the inactive ranks
+    EP_HOST_ASSERT(active_ranks.empty());
+
+    // Every rank must pick the same rounds, so they follow the largest batch over the ranks given by the caller, not
+    // this one. Without it the fixed single round is kept, agreeing on the batch here would need a collective
+    DispatchHandle layout;
+    layout.round = round;
+    layout.per_round_tokens = per_round_tokens;
+    layout.num_max_tokens = num_max_tokens;
+    EP_HOST_ASSERT(num_max_tokens == 0 or num_max_tokens >= topk_idx.size(0));
+    if (is_auto_round() and num_max_tokens > 0) {
+        auto soc = soc_version == op::SocVersion::ASCEND910B ? SocType::A2 : SocType::A3;
+        auto rounds = get_normal_round_config(std::max<int64_t>(num_max_tokens, PADDING_SIZE), hidden,
+                                              static_cast<int>(topk_idx.size(1)), hccl_window_bytes, soc);
+        layout.round = rounds.round;
+        layout.per_round_tokens = rounds.per_round_tokens;
+    }
+    if (num_rdma_ranks > 1) {
+        // The two-level kernels run a single round and lay their notify data out for the largest batch of any rank,
+        // sized by the caller's bound when given. A multiple of 8 keeps every server's offsetInner block 32-byte
+        // aligned for the combine
+        int64_t max_bs = num_max_tokens > 0 ? std::max<int64_t>(num_max_tokens, A2_MIN_NOTIFY_BATCH) : MAX_BATCH_SIZE;
+        layout.round = 1;
+        layout.per_round_tokens = static_cast<int32_t>((max_bs + 7) / 8 * 8);
+        EP_HOST_ASSERT(layout.per_round_tokens <= MAX_BATCH_SIZE);
+    }
+    int32_t round = layout.round;
+    int32_t per_round_tokens = layout.per_round_tokens;
     EP_HOST_ASSERT(topk_idx.size(0) <= round * per_round_tokens);
 
-    this->new_topk_idx = topk_idx;
+    CommStreamOverlap overlap(comm_stream, previous_event, async, allocate_on_comm_stream);
+
+    // The capacity counts the logical experts the callers route to, before the padding and the replicas
+    layout.new_topk_idx = apply_expert_capacity(layout, topk_idx, num_experts, topk_weights, expert_counts);
     // for padding
     if (topk_idx.size(0) < PADDING_SIZE) {
-        this->is_padding = true;
-        this->padding_cnt = PADDING_SIZE - topk_idx.size(0);
+        layout.padding_cnt = PADDING_SIZE - topk_idx.size(0);
         std::vector<at::Tensor> topk_blocks;
         if (topk_idx.size(0) != 0) {
-            topk_blocks.emplace_back(topk_idx);
+            topk_blocks.emplace_back(layout.new_topk_idx);
         }
         int topk = static_cast<int>(topk_idx.size(1));
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < layout.padding_cnt; i++) {
             at::Tensor tmp_topk = torch::arange(0, topk, topk_idx.options()).reshape({1, topk});
             topk_blocks.emplace_back(tmp_topk);
         }
-        this->new_topk_idx = torch::cat(topk_blocks, 0);
+        layout.new_topk_idx = torch::cat(topk_blocks, 0);
     }
+    if (expert_log2phy.defined()) {
+        EP_HOST_ASSERT(max_physical_expert < num_experts);
+        layout.new_topk_idx = map_to_expert_replicas(layout.new_topk_idx, expert_log2phy, expert_logcnt, rank);
+        layout.mapped_topk_idx = true;
+    }
+    const at::Tensor &new_topk_idx = layout.new_topk_idx;
 
     const int num_tokens = new_topk_idx.size(0);
     const int num_topk = new_topk_idx.size(1);
     const int local_ranksize = LOCAL_RANK_SIZE;
-    auto server_num = num_ranks / local_ranksize;
 
     auto device = new_topk_idx.device();
 
     auto num_tokens_per_expert = at::zeros({round, num_experts}, at::dtype(at::kInt).device(device));
     auto num_tokens_per_rank = at::zeros({num_ranks}, at::dtype(at::kInt).device(device));
     auto is_token_in_rank = at::zeros({num_tokens, num_ranks}, at::dtype(at::kInt).device(device));
+    auto soc = soc_version == op::SocVersion::ASCEND910B ? SocType::A2 : SocType::A3;
+    // A single A2 node still runs the layout kernel laid out for the largest batch
+    const int64_t notify_max_bs = num_rdma_ranks > 1 ? per_round_tokens : MAX_BATCH_SIZE;
     const int notify_send_data_size =
-        num_experts * EXPERT_DATA_SIZE + server_num + MAX_BATCH_SIZE * (1 + 2 * server_num + num_experts);
+        static_cast<int>(get_notify_send_data_size(num_experts, num_ranks, soc, notify_max_bs));
     /*
-    The notify send data is constructed by 7 parameters and the 7 parameters are ordered as follows:
+    On A2 the notify send data is constructed by 7 parameters and the 7 parameters are ordered as follows:
     1. the number of the tokens that every expert received from this NPU.
        size:[numExpert]
     2. The number of tokens received by each server from this NPU (deduplicated).
        size:[serverNum]
     3. The number of tokens sent from this NPU to each server (without deduplication).
-       size:[MAX_BS, serverNum]
+       size:[max_bs, serverNum]
     4. The number of servers each token is sent to by this NPU.
-       size:[MAX_BS]
+       size:[max_bs]
     5. The order in which each token of this NPU is sent to various servers.
-       size:[MAX_BS, serverNum]
+       size:[max_bs, serverNum]
     6. The order in which each token is sent to the expert.
-       size:[MAX_BS, numTopk]
+       size:[max_bs, numExpert]
     7. The server offset of tokens received by each expert from this NPU.
-       size:[numExpert, MAX_BS]
+       size:[numExpert, max_bs]
+    max_bs is the per_round_tokens of the single internode round, the notify finds it again from the size. The layout
+    accumulates into it atomically and unwritten rows read as -1 after the notify, so it is zeroed, which costs
+    little once max_bs follows the caller's batch. On A3 it only holds the expert counts of every core, which the
+    kernel clears itself, so it is neither sized by max_bs nor zeroed here.
     */
     auto send_token_idx_small = at::zeros({num_tokens, num_topk}, at::dtype(at::kInt).device(device));
-    auto notify_send_data = at::zeros({notify_send_data_size}, at::dtype(at::kInt).device(device));
+    auto notify_send_data = soc == SocType::A2
+                                ? at::zeros({notify_send_data_size}, at::dtype(at::kInt).device(device))
+                                : at::empty({notify_send_data_size}, at::dtype(at::kInt).device(device));
     int32_t rank_id = static_cast<int>(rank);
     EXEC_NPU_CMD(aclnnDispatchLayout, new_topk_idx, num_tokens, num_ranks, num_experts, num_topk, local_ranksize,
                  per_round_tokens, rank_id, num_tokens_per_rank, num_tokens_per_expert, is_token_in_rank,
                  notify_send_data, send_token_idx_small);
 
-    this->notify_send_data = notify_send_data;
-    this->send_token_idx_small = send_token_idx_small;
-    this->notify_send_data_size = notify_send_data_size;
+    layout.notify_send_data = notify_send_data;
+    layout.send_token_idx_small = send_token_idx_small;
+    layout.notify_send_data_size = notify_send_data_size;
 
     std::optional<torch::Tensor> num_tokens_per_rdma_rank = std::nullopt;
-    std::optional<EventHandle> output_event = std::nullopt;
+
+    // Wait streams
+    overlap.record_tensors(topk_idx, new_topk_idx, num_tokens_per_rank, num_tokens_per_expert, is_token_in_rank,
+                           notify_send_data, send_token_idx_small);
+    std::optional<EventHandle> output_event = overlap.finish();
 
     auto num_tokens_per_expert_one_dim = num_tokens_per_expert.flatten();
     return std::make_tuple(num_tokens_per_rank, num_tokens_per_rdma_rank, num_tokens_per_expert_one_dim,
-                           is_token_in_rank, output_event);
-}
-
-torch::Tensor Buffer::get_notify_send_data()
-{
-    return this->notify_send_data;
+                           is_token_in_rank, layout, output_event);
 }
 
 int Buffer::get_num_rdma_ranks() const
@@ -181,30 +342,228 @@ int Buffer::get_rdma_rank() const
     return rdma_rank;
 }
 
+torch::Stream Buffer::get_comm_stream() const
+{
+    return comm_stream.unwrap();
+}
+
+void Buffer::set_expert_replicas(const std::optional<at::Tensor> &log2phy, const std::optional<at::Tensor> &logcnt,
+                                 int64_t policy)
+{
+    EP_HOST_ASSERT(log2phy.has_value() == logcnt.has_value());
+    if (not log2phy.has_value()) {
+        expert_log2phy = at::Tensor();
+        expert_logcnt = at::Tensor();
+        max_physical_expert = -1;
+        return;
+    }
+    EP_HOST_ASSERT(policy == REPLICA_ROUND_ROBIN or policy == REPLICA_LEAST_LOADED);
+    const at::Tensor &table = log2phy.value();
+    const at::Tensor &counts = logcnt.value();
+    EP_HOST_ASSERT(table.scalar_type() == at::kInt and table.is_contiguous() and table.dim() == 2);
+    EP_HOST_ASSERT(counts.scalar_type() == at::kInt and counts.is_contiguous() and counts.dim() == 1);
+    EP_HOST_ASSERT(table.size(0) > 0 and table.size(1) > 0 and counts.size(0) == table.size(0));
+
+    // Validated once here so that dispatch never syncs: every logical expert has 1..max_replicas valid entries
+    auto table_cpu = table.cpu();
+    auto counts_cpu = counts.cpu();
+    EP_HOST_ASSERT(counts_cpu.min().item<int>() >= 1 and counts_cpu.max().item<int>() <= table.size(1));
+    auto used = at::arange(table.size(1), counts_cpu.options()).unsqueeze(0) < counts_cpu.unsqueeze(1);
+    auto used_entries = table_cpu.masked_select(used);
+    EP_HOST_ASSERT(used_entries.min().item<int>() >= 0);
+    max_physical_expert = used_entries.max().item<int>();
+
+    expert_log2phy = table;
+    expert_logcnt = counts;
+    expert_replica_policy = policy;
+}
+
+void Buffer::set_expert_capacity(int64_t capacity, double capacity_factor)
+{
+    EP_HOST_ASSERT(capacity >= 0 and capacity_factor >= 0);
+    expert_capacity = capacity;
+    expert_capacity_factor = capacity_factor;
+}
+
+at::Tensor Buffer::apply_expert_capacity(DispatchHandle &handle, const at::Tensor &topk_idx, int64_t num_experts,
+                                         const std::optional<at::Tensor> &topk_weights,
+                                         const std::optional<at::Tensor> &expert_counts)
+{
+    if (expert_capacity == 0 and expert_capacity_factor == 0) {
+        return topk_idx;
+    }
+    // The quotas only add up to the capacity if every rank splits the counts of the whole group
+    EP_HOST_ASSERT(expert_counts.has_value() and expert_counts->dim() == 2);
+    EP_HOST_ASSERT(expert_counts->size(0) == num_ranks and expert_counts->size(1) == num_experts);
+    auto counts = expert_counts->to(at::kLong);
+    at::Tensor capacity;
+    if (expert_capacity > 0) {
+        capacity = at::scalar_tensor(expert_capacity, counts.options());
+    } else {
+        // The mean is taken over the logical experts the callers route to
+        int64_t num_logical_experts = expert_log2phy.defined() ? expert_log2phy.size(0) : num_experts;
+        capacity = counts.sum().to(at::kDouble).mul(expert_capacity_factor / num_logical_experts);
+        capacity = capacity.ceil().clamp_min(1).to(at::kLong);
+    }
+    auto quota = split_expert_capacity(counts, capacity).select(0, rank);
+
+    // Without weights every entry has the same priority and the earlier tokens are kept
+    at::Tensor priority = at::zeros(topk_idx.sizes(), at::dtype(at::kFloat).device(topk_idx.device()));
+    if (topk_weights.has_value()) {
+        EP_HOST_ASSERT(topk_weights->sizes() == topk_idx.sizes());
+        priority.copy_(topk_weights.value());
+    }
+    auto kept_idx = drop_over_capacity(topk_idx, priority, quota);
+    handle.dropped_topk = kept_idx.lt(0).logical_and(topk_idx.ge(0));
+    handle.capped_topk_idx = true;
+    return kept_idx;
+}
+
+void Buffer::set_active_ranks(const std::optional<at::Tensor> &active_mask)
+{
+    // Only the A3 low-latency kernels take an `elastic_info`, the notify and sync collectives of the normal kernels
+    // and the A2 kernels always wait for every rank
+    EP_HOST_ASSERT(low_latency_mode and soc_version != op::SocVersion::ASCEND910B);
+    EP_HOST_ASSERT(not low_latency_recv->any_pending());
+    active_ranks.clear();
+    elastic_info = at::Tensor();
+    elastic_num_experts = -1;
+    if (not active_mask.has_value()) {
+        return;
+    }
+    const at::Tensor &mask = active_mask.value();
+    EP_HOST_ASSERT(mask.dim() == 1 and mask.size(0) == num_ranks);
+
+    // Read once here so that dispatch never syncs, an inactive rank makes no calls at all
+    auto mask_cpu = mask.to(at::kBool).cpu();
+    std::vector<bool> active(num_ranks);
+    for (int i = 0; i < num_ranks; ++i) {
+        active[i] = mask_cpu[i].item<bool>();
+    }
+    EP_HOST_ASSERT(active[rank]);
+    if (std::all_of(active.begin(), active.end(), [](bool is_active) { return is_active; })) {
+        return;
+    }
+    // The elastic layout only covers MoE ranks, not shared expert ranks
+    EP_HOST_ASSERT(shared_expert_rank_num == 0);
+    active_ranks = active;
+}
+
+at::Tensor Buffer::get_elastic_topk_idx(const at::Tensor &topk_idx, int64_t num_experts)
+{
+    if (elastic_num_experts != num_experts) {
+        auto info = get_elastic_info(active_ranks, static_cast<int>(num_experts));
+        auto info_cpu = at::tensor(info, at::dtype(at::kInt));
+        elastic_info = info_cpu.to(topk_idx.device());
+        elastic_num_experts = num_experts;
+    }
+    // The experts of active rank `r` become those of its compact id, `-1` entries stay unselected
+    int64_t num_local_experts = num_experts / num_ranks;
+    auto compact_ranks = elastic_info.slice(0, ELASTIC_INFO_OFFSET, ELASTIC_INFO_OFFSET + num_ranks);
+    auto expert_idx = topk_idx.clamp_min(0);
+    auto owner = at::floor_divide(expert_idx, num_local_experts);
+    auto compact_owner = compact_ranks.index_select(0, owner.flatten()).view_as(owner).to(topk_idx.scalar_type());
+    auto compact_idx = compact_owner * num_local_experts + expert_idx.remainder(num_local_experts);
+    return compact_idx.masked_fill(topk_idx.lt(0).logical_or(compact_owner.lt(0)), -1);
+}
+
+void Buffer::set_telemetry(bool enable)
+{
+    // Only the normal intranode kernels measure per-peer costs, a low-latency or internode buffer would report
+    // nothing for its calls
+    EP_HOST_ASSERT(not enable or (not low_latency_mode and num_rdma_ranks == 1));
+    if (enable and not cost_totals.defined()) {
+        auto options = at::dtype(at::kLong).device(comm_stream.device());
+        cost_totals = at::zeros({NUM_COST_KINDS, num_ranks}, options);
+        cost_histogram = at::zeros({NUM_COST_KINDS, num_ranks, NUM_COST_BUCKETS}, options);
+    }
+    telemetry_enabled = enable;
+}
+
+std::tuple<at::Tensor, at::Tensor, std::vector<int64_t>> Buffer::get_telemetry(bool reset)
+{
+    EP_HOST_ASSERT(cost_totals.defined());
+    // Queued after every recorded call on the comm stream, the host never waits for the device
+    CommStreamOverlap overlap(comm_stream, std::nullopt, false, false);
+    auto totals = cost_totals.clone();
+    auto histogram = cost_histogram.clone();
+    std::vector<int64_t> calls(cost_calls.begin(), cost_calls.end());
+    if (reset) {
+        cost_totals.zero_();
+        cost_histogram.zero_();
+        cost_calls.fill(0);
+    }
+    overlap.record_tensors(totals, histogram);
+    overlap.finish();
+    return {totals, histogram, calls};
+}
+
+at::Tensor Buffer::get_cost_stats_out(const std::optional<at::Tensor> &cost_stats)
+{
+    if (cost_stats.has_value()) {
+        EP_HOST_ASSERT(cost_stats->scalar_type() == torch::kInt32);
+        EP_HOST_ASSERT(cost_stats->dim() == 1 and cost_stats->is_contiguous());
+        EP_HOST_ASSERT(cost_stats->size(0) == num_ranks);
+    }
+    if (not telemetry_enabled) {
+        return cost_stats.has_value() ? cost_stats.value() : at::Tensor();
+    }
+    return at::zeros({num_ranks}, at::dtype(at::kInt).device(cost_totals.device()));
+}
+
+void Buffer::record_cost_stats(int kind, const at::Tensor &cost_stats_out, const std::optional<at::Tensor> &cost_stats)
+{
+    if (not telemetry_enabled) {
+        return;
+    }
+    if (cost_stats.has_value()) {
+        cost_stats->add_(cost_stats_out);
+    }
+    cost_totals[kind].add_(cost_stats_out);
+
+    // The bucket of every peer as `get_cost_bucket` picks it
+    auto bucket = (cost_stats_out.clamp_min(1).to(at::kFloat).log2().floor() + 1).to(at::kLong);
+    bucket = bucket.clamp_max(NUM_COST_BUCKETS - 1).masked_fill(cost_stats_out <= 0, 0);
+    cost_histogram[kind].scatter_add_(1, bucket.view({-1, 1}), at::ones({num_ranks, 1}, cost_histogram.options()));
+    ++cost_calls[kind];
+}
+
 std::tuple<at::Tensor, std::optional<at::Tensor>, std::optional<at::Tensor>, std::optional<at::Tensor>,
-           std::vector<int>, at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tensor, std::optional<EventHandle>>
+           std::vector<int>, std::optional<at::Tensor>, at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tensor,
+           DispatchHandle, std::optional<EventHandle>>
 Buffer::intranode_dispatch(const at::Tensor &x, const std::optional<at::Tensor> &x_scales,
                            const std::optional<at::Tensor> &topk_idx, const std::optional<at::Tensor> &topk_weights,
                            const std::optional<at::Tensor> &num_tokens_per_rank, const at::Tensor &is_token_in_rank,
-                           const std::optional<at::Tensor> &num_tokens_per_expert, int cached_num_recv_tokens,
+                           const std::optional<at::Tensor> &num_tokens_per_expert, const DispatchHandle &layout,
+                           int cached_num_recv_tokens,
                            const std::optional<at::Tensor> &cached_rank_prefix_matrix,
                            const std::optional<at::Tensor> &cached_channel_prefix_matrix,
-                           const std::optional<at::Tensor> &dispatch_wait_recv_cost_stats, int expert_alignment,
+                           const std::optional<at::Tensor> &dispatch_wait_recv_cost_stats,
+                           const std::optional<at::Tensor> &cumulative_local_expert_recv_stats, int expert_alignment,
                            int num_worst_tokens, const Config &config, std::optional<EventHandle> &previous_event,
                            bool async, bool allocate_on_comm_stream, bool use_quant)
 {
+    EP_HOST_ASSERT(active_ranks.empty());
     // One channel use two blocks, even-numbered blocks for sending, odd-numbered blocks for receiving.
     EP_HOST_ASSERT(config.num_sms % 2 == 0);
     int num_channels = config.num_sms / 2;
 
+    CommStreamOverlap overlap(comm_stream, previous_event, async, allocate_on_comm_stream);
+
+    // Cached mode: `layout` is the handle of an earlier dispatch with the same routing, only the data is sent
+    bool cached_mode = cached_rank_prefix_matrix.has_value();
+    DispatchHandle handle = layout;
+    NotifyLayout &notify = handle.notify;
+    EP_HOST_ASSERT(not cached_mode or notify.defined());
+    int32_t round = handle.round;
+    int32_t per_round_tokens = handle.per_round_tokens;
+    const at::Tensor &new_topk_idx = handle.new_topk_idx;
     at::Tensor expert_ids = new_topk_idx.to(at::kInt);
     int64_t tp_size = 1;
     int64_t tp_rank = 0;
     int64_t quant_mode = use_quant ? DYNAMIC_SCALES : NO_SCALES;
     auto recv_topk_idx = std::optional<at::Tensor>();
     auto recv_topk_weights = std::optional<at::Tensor>();
-    // Wait streams
-    std::optional<EventHandle> event;
     auto rank_prefix_matrix = at::empty({num_ranks, num_ranks}, at::dtype(at::kInt).device(x.device()));
     auto channel_prefix_matrix = at::empty({num_ranks, num_channels}, at::dtype(at::kInt).device(x.device()));
     auto recv_channel_prefix_matrix = at::empty({num_ranks, num_channels}, at::dtype(at::kInt).device(x.device()));
@@ -212,37 +571,39 @@ Buffer::intranode_dispatch(const at::Tensor &x, const std::optional<at::Tensor>
     at::Tensor new_x = x;
     // for padding
     if (topk_idx->size(0) < PADDING_SIZE) {
-        this->is_padding = true;
-        this->padding_cnt = PADDING_SIZE - topk_idx->size(0);
+        handle.padding_cnt = PADDING_SIZE - topk_idx->size(0);
         std::vector<at::Tensor> x_blocks;
         if (topk_idx->size(0) != 0) {
             x_blocks.emplace_back(x);
         } else {
-            this->ori_x = x.clone();
+            handle.ori_x = x.clone();
         }
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_x = torch::ones({1, x.size(1)}, x.options()) * (i + 1) * 2;
             x_blocks.emplace_back(tmp_x);
         }
         new_x = torch::cat(x_blocks, 0);
     }
 
-    EP_HOST_ASSERT(num_tokens_per_rank.has_value());
-    EP_HOST_ASSERT(num_tokens_per_expert.has_value());
+    if (not cached_mode) {
+        EP_HOST_ASSERT(num_tokens_per_rank.has_value());
+        EP_HOST_ASSERT(num_tokens_per_expert.has_value());
 
-    // Type checks
-    EP_HOST_ASSERT(num_tokens_per_expert->scalar_type() == at::kInt);
-    EP_HOST_ASSERT(num_tokens_per_rank->scalar_type() == at::kInt);
+        // Type checks
+        EP_HOST_ASSERT(num_tokens_per_expert->scalar_type() == at::kInt);
+        EP_HOST_ASSERT(num_tokens_per_rank->scalar_type() == at::kInt);
 
-    // Shape and contiguous checks
+        // Shape and contiguous checks
+        EP_HOST_ASSERT(num_tokens_per_expert->dim() == 1 and num_tokens_per_expert->is_contiguous());
+        EP_HOST_ASSERT(num_tokens_per_expert->size(0) % num_ranks == 0);
+        EP_HOST_ASSERT(num_tokens_per_rank->dim() == 1 and num_tokens_per_rank->is_contiguous());
+        EP_HOST_ASSERT(num_tokens_per_rank->size(0) == num_ranks);
+    }
     EP_HOST_ASSERT(new_x.dim() == 2 and new_x.is_contiguous());
-    EP_HOST_ASSERT(num_tokens_per_expert->dim() == 1 and num_tokens_per_expert->is_contiguous());
-    EP_HOST_ASSERT(num_tokens_per_expert->size(0) % num_ranks == 0);
-    EP_HOST_ASSERT(num_tokens_per_rank->dim() == 1 and num_tokens_per_rank->is_contiguous());
-    EP_HOST_ASSERT(num_tokens_per_rank->size(0) == num_ranks);
 
     auto num_tokens = static_cast<int>(new_x.size(0)), hidden = static_cast<int>(new_x.size(1));
-    auto num_experts = static_cast<int64_t>(num_tokens_per_expert->size(0) / round);
+    auto num_experts = cached_mode ? static_cast<int64_t>(notify.recv_offset.size(1))
+                                   : static_cast<int64_t>(num_tokens_per_expert->size(0) / round);
     auto num_local_experts = static_cast<int>(num_experts / num_ranks);
 
     // Top-k checks
@@ -272,65 +633,74 @@ Buffer::intranode_dispatch(const at::Tensor &x, const std::optional<at::Tensor>
         scale_hidden_stride = static_cast<int>(x_scales->stride(1));
     }
 
-    at::Tensor dispatch_wait_recv_cost_stats_out;
-    if (dispatch_wait_recv_cost_stats.has_value()) {
-        EP_HOST_ASSERT(dispatch_wait_recv_cost_stats->scalar_type() == torch::kInt32);
-        EP_HOST_ASSERT(dispatch_wait_recv_cost_stats->dim() == 1 and dispatch_wait_recv_cost_stats->is_contiguous());
-        EP_HOST_ASSERT(dispatch_wait_recv_cost_stats->size(0) == num_ranks);
-        dispatch_wait_recv_cost_stats_out = dispatch_wait_recv_cost_stats.value();
-    }
-
-    int send_per_group = 3;  // (send_to_expert_num, send_to_expert_offset, send_rank_tokens)
+    at::Tensor dispatch_wait_recv_cost_stats_out = get_cost_stats_out(dispatch_wait_recv_cost_stats);
 
-    auto send_data = torch::empty({round, num_experts * send_per_group}, at::dtype(at::kInt).device(x.device()));
-    int64_t send_count = send_per_group * num_local_experts * num_ranks * round;
-
-    auto send_data_offset = torch::empty({round, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_data = torch::empty({round, num_experts * send_per_group}, at::dtype(at::kInt).device(x.device()));
-    // get ep name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
+    // Received-token counts for the expert load balancer, the notify kernel adds them in place with an atomic add
+    at::Tensor expert_recv_stats;
+    if (cumulative_local_expert_recv_stats.has_value()) {
+        expert_recv_stats = cumulative_local_expert_recv_stats.value();
+        EP_HOST_ASSERT(expert_recv_stats.scalar_type() == at::kInt and expert_recv_stats.is_contiguous());
+        EP_HOST_ASSERT(expert_recv_stats.dim() == 1 or expert_recv_stats.dim() == 2);
+        EP_HOST_ASSERT(expert_recv_stats.size(0) == num_local_experts);
+        EP_HOST_ASSERT(expert_recv_stats.dim() == 1 or expert_recv_stats.size(1) == num_ranks);
     }
-    at::Tensor total_recv_token = torch::empty({1}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_offset = at::empty({round, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_count = at::empty({round, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor max_bs = torch::empty({1}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_tokens_per_expert =
-        torch::empty({round * num_local_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor expert_global_offset = at::empty({num_local_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor srcrank_in_expert_offset =
-        at::empty({num_local_experts * num_ranks}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor r_in_srcrank_offset =
-        at::empty({num_local_experts * num_ranks * round}, at::dtype(at::kInt).device(x.device()));
-
-    int64_t local_rank_size = num_ranks;
-    int64_t local_rank_id = rank % local_rank_size;
-    auto new_num_tokens_per_expert = num_tokens_per_expert.value();
-    std::vector<int> num_recv_tokens_per_expert_list;
-    // indicates the value type of the output num_recv_tokens_per_expert_list, with a range of [0, 1]
-    // 0 means the prefix sum of the number of tokens received by each expert;
-    // 1 means the number of tokens received by each expert (default)
-    int expert_token_nums_type = get_value_from_env("MOE_EXPERT_TOKEN_NUMS_TYPE", 1);
-    EP_HOST_ASSERT(expert_token_nums_type == 1 or expert_token_nums_type == 0);
-
-    EXEC_NPU_CMD(aclnnNotifyDispatch, send_data, new_num_tokens_per_expert, send_count, num_tokens,
-                 hcom_ep_name,  // commGroup
-                 num_ranks,     // rankSize
-                 rank,          // rankId
-                 local_rank_size, local_rank_id, round, per_round_tokens, send_data_offset, recv_data, recv_count,
-                 recv_offset, expert_global_offset, srcrank_in_expert_offset, r_in_srcrank_offset, total_recv_token,
-                 max_bs, recv_tokens_per_expert);
-    auto send_token_idx_small = this->send_token_idx_small;
 
-    real_max_bs = static_cast<int64_t>(std::max(max_bs.item<int>(), static_cast<int>(num_worst_tokens)));
+    // With `num_worst_tokens` the host never reads the notify results back: the batch size is bounded by the largest
+    // batch given to `get_dispatch_layout`, or else by the rounds it enforces, and the outputs by `num_worst_tokens`
+    bool sync_free = num_worst_tokens > 0;
+    if (not cached_mode) {
+        int send_per_group = 3;  // (send_to_expert_num, send_to_expert_offset, send_rank_tokens)
+
+        // Results only read within this call live in the arena, the ones a cached dispatch reuses are kept by the
+        // returned handle
+        auto int_options = at::dtype(at::kInt).device(x.device());
+        auto scratch = arena.begin(ArenaRegion::NOTIFY_SCRATCH, int_options);
+        auto send_data = scratch.take({round, num_experts * send_per_group}, int_options);
+        int64_t send_count = send_per_group * num_local_experts * num_ranks * round;
+        at::Tensor recv_data = scratch.take({round, num_experts * send_per_group}, int_options);
+        at::Tensor total_recv_token = scratch.take({1}, int_options);
+        at::Tensor max_bs = scratch.take({1}, int_options);
+
+        notify.send_data_offset = at::empty({round, num_experts}, int_options);
+        notify.recv_offset = at::empty({round, num_experts}, int_options);
+        notify.recv_count = at::empty({round, num_experts}, int_options);
+        notify.recv_tokens_per_expert = at::empty({round * num_local_experts}, int_options);
+        notify.expert_global_offset = at::empty({num_local_experts}, int_options);
+        notify.srcrank_in_expert_offset = at::empty({num_local_experts * num_ranks}, int_options);
+        notify.r_in_srcrank_offset = at::empty({num_local_experts * num_ranks * round}, int_options);
+
+        int64_t local_rank_size = num_ranks;
+        int64_t local_rank_id = rank % local_rank_size;
+        auto new_num_tokens_per_expert = num_tokens_per_expert.value();
+        EXEC_NPU_CMD(aclnnNotifyDispatch, send_data, new_num_tokens_per_expert, send_count, num_tokens,
+                     hcom_ep_name,  // commGroup
+                     num_ranks,     // rankSize
+                     rank,          // rankId
+                     local_rank_size, local_rank_id, round, per_round_tokens, notify.send_data_offset, recv_data,
+                     notify.recv_count, notify.recv_offset, notify.expert_global_offset,
+                     notify.srcrank_in_expert_offset, notify.r_in_srcrank_offset, total_recv_token, max_bs,
+                     notify.recv_tokens_per_expert, expert_recv_stats);
+
+        if (sync_free) {
+            handle.real_max_bs = static_cast<int64_t>(round) * per_round_tokens;
+            // The window is reserved for `real_max_bs` tokens per rank, so follow the agreed largest batch if known
+            if (handle.num_max_tokens > 0) {
+                int64_t num_max_tokens = std::max<int64_t>(handle.num_max_tokens, PADDING_SIZE);
+                handle.real_max_bs = std::min(handle.real_max_bs, num_max_tokens);
+            }
+            notify.num_recv_tokens = num_worst_tokens;
+        } else {
+            handle.real_max_bs = static_cast<int64_t>(max_bs.item<int>());
+            notify.num_recv_tokens = total_recv_token.item<int>();
+        }
+    }
+    auto send_token_idx_small = handle.send_token_idx_small;
+    int64_t trt = notify.num_recv_tokens;
 
     // dispatch算子内部按照 min(per_round_tokens, real_max_bs)来预留显存
-    int64_t global_bs = static_cast<int64_t>(std::min(static_cast<int64_t>(per_round_tokens), real_max_bs) * num_ranks);
+    int64_t global_bs =
+        static_cast<int64_t>(std::min(static_cast<int64_t>(per_round_tokens), handle.real_max_bs) * num_ranks);
 
-    int64_t trt = total_recv_token.item<int>();
     int num_recv_tokens = (trt == 0) ? 1 : trt;
     auto expandx_out = use_quant ? torch::empty({num_recv_tokens, hidden}, at::dtype(at::kChar).device(x.device()))
                                  : torch::empty({num_recv_tokens, hidden}, x.options());
@@ -340,46 +710,84 @@ Buffer::intranode_dispatch(const at::Tensor &x, const std::optional<at::Tensor>
         recv_topk_idx = at::empty({trt, num_topk}, topk_idx->options());
         recv_topk_weights = at::empty({trt, num_topk}, topk_weights->options());
     }
-    EXEC_NPU_CMD(aclnnCamMoeDispatchNormal, new_x, expert_ids, send_data_offset, send_token_idx_small, recv_offset,
-                 recv_count, expert_global_offset, srcrank_in_expert_offset, r_in_srcrank_offset, hcom_ep_name,
+    EXEC_NPU_CMD(aclnnCamMoeDispatchNormal, new_x, expert_ids, notify.send_data_offset, send_token_idx_small,
+                 notify.recv_offset, notify.recv_count, notify.expert_global_offset, notify.srcrank_in_expert_offset,
+                 notify.r_in_srcrank_offset, hcom_ep_name,
                  num_ranks,  // rankSize
                  rank,       // rankId
-                 hcom_ep_name, tp_size, tp_rank, num_experts, quant_mode, real_max_bs, global_bs, round,
+                 hcom_ep_name, tp_size, tp_rank, num_experts, quant_mode, handle.real_max_bs, global_bs, round,
                  per_round_tokens, expandx_out, dynamic_scales_out, expand_idx_out, dispatch_wait_recv_cost_stats_out);
-    auto recv_token_per_exp_cpu = recv_tokens_per_expert.to(at::kCPU);
-    auto recv_token_per_exp_ptr = recv_token_per_exp_cpu.data_ptr<int32_t>();
+    record_cost_stats(COST_DISPATCH_WAIT_RECV, dispatch_wait_recv_cost_stats_out, dispatch_wait_recv_cost_stats);
 
-    int token_cnt = 0;
+    // A cached dispatch skips the notify kernel, its counts are taken from the cached notify results
+    if (cached_mode and expert_recv_stats.defined()) {
+        if (expert_recv_stats.dim() == 1) {
+            expert_recv_stats.add_(notify.recv_tokens_per_expert.view({round, num_local_experts}).sum(0).to(at::kInt));
+        } else {
+            // `recv_count` holds per round prefix sums over (local expert, source rank)
+            auto counts = notify.recv_count.diff(1, 1, at::zeros({round, 1}, notify.recv_count.options()));
+            expert_recv_stats.add_(counts.sum(0).view({num_local_experts, num_ranks}).to(at::kInt));
+        }
+    }
     // 多轮处理为一维
-    std::vector<int> round_recv_tokens_per_expert;
-    round_recv_tokens_per_expert.resize(num_local_experts);
-    for (int r = 0; r < round; r++) {
+    std::optional<at::Tensor> num_recv_tokens_per_expert;
+    if (sync_free) {
+        // The counts stay on device, the list is left empty
+        num_recv_tokens_per_expert =
+            notify.recv_tokens_per_expert.view({round, num_local_experts}).sum(0).to(at::kInt);
+        if (expert_token_nums_type == 0) {
+            num_recv_tokens_per_expert = num_recv_tokens_per_expert->cumsum(0).to(at::kInt);
+        }
+    } else if (not cached_mode) {
+        auto recv_token_per_exp_cpu = notify.recv_tokens_per_expert.to(at::kCPU);
+        auto recv_token_per_exp_ptr = recv_token_per_exp_cpu.data_ptr<int32_t>();
+
+        int token_cnt = 0;
+        std::vector<int> round_recv_tokens_per_expert;
+        round_recv_tokens_per_expert.resize(num_local_experts);
+        for (int r = 0; r < round; r++) {
+            for (int local_e = 0; local_e < num_local_experts; ++local_e) {
+                int current_tokens = static_cast<int>(recv_token_per_exp_ptr[r * num_local_experts + local_e]);
+                token_cnt = round_recv_tokens_per_expert[local_e] + current_tokens;
+                round_recv_tokens_per_expert[local_e] = token_cnt;
+            }
+        }
+
+        token_cnt = 0;
+        notify.num_recv_tokens_per_expert_list.clear();
         for (int local_e = 0; local_e < num_local_experts; ++local_e) {
-            int current_tokens = static_cast<int>(recv_token_per_exp_ptr[r * num_local_experts + local_e]);
-            token_cnt = round_recv_tokens_per_expert[local_e] + current_tokens;
-            round_recv_tokens_per_expert[local_e] = token_cnt;
+            int current_tokens = static_cast<int>(round_recv_tokens_per_expert[local_e]);
+            token_cnt = (expert_token_nums_type == 0) ? token_cnt + current_tokens : current_tokens;
+            notify.num_recv_tokens_per_expert_list.emplace_back(token_cnt);
         }
     }
 
-    token_cnt = 0;
-    for (int local_e = 0; local_e < num_local_experts; ++local_e) {
-        int current_tokens = static_cast<int>(round_recv_tokens_per_expert[local_e]);
-        token_cnt = (expert_token_nums_type == 0) ? token_cnt + current_tokens : current_tokens;
-        num_recv_tokens_per_expert_list.emplace_back(token_cnt);
-    }
+    auto recv_count_one_dim = notify.recv_count.sum(0, false).to(at::kInt);
+
+    // Wait streams
+    overlap.record_tensors(x, new_x, topk_idx, topk_weights, num_tokens_per_rank, num_tokens_per_expert,
+                           is_token_in_rank, expert_ids, send_token_idx_small, notify.send_data_offset,
+                           notify.recv_offset, notify.recv_count, notify.expert_global_offset,
+                           notify.srcrank_in_expert_offset, notify.r_in_srcrank_offset, expandx_out, dynamic_scales_out,
+                           expand_idx_out, recv_topk_idx, recv_topk_weights,
+                           rank_prefix_matrix, channel_prefix_matrix, recv_channel_prefix_matrix, recv_count_one_dim,
+                           dispatch_wait_recv_cost_stats_out, notify.recv_tokens_per_expert,
+                           num_recv_tokens_per_expert, expert_recv_stats);
+    std::optional<EventHandle> event = overlap.finish();
 
-    auto recv_count_one_dim = recv_count.sum(0, false).to(at::kInt);
     // Return values
     return {expandx_out,
             dynamic_scales_out,
             recv_topk_idx,
             recv_topk_weights,
-            num_recv_tokens_per_expert_list,
+            notify.num_recv_tokens_per_expert_list,
+            num_recv_tokens_per_expert,
             rank_prefix_matrix,
             channel_prefix_matrix,
             recv_channel_prefix_matrix,
             expand_idx_out,
             recv_count_one_dim,
+            handle,
             event};
 }
 
@@ -387,25 +795,32 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tenso
 Buffer::notify_verify(const at::Tensor &x, const std::optional<at::Tensor> &x_scales,
                       const std::optional<at::Tensor> &topk_idx, const std::optional<at::Tensor> &topk_weights,
                       const std::optional<at::Tensor> &num_tokens_per_rank, const at::Tensor &is_token_in_rank,
-                      const std::optional<at::Tensor> &num_tokens_per_expert, int cached_num_recv_tokens,
+                      const std::optional<at::Tensor> &num_tokens_per_expert, const DispatchHandle &layout,
+                      int cached_num_recv_tokens,
                       const std::optional<at::Tensor> &cached_rank_prefix_matrix,
                       const std::optional<at::Tensor> &cached_channel_prefix_matrix,
                       const std::optional<at::Tensor> &dispatch_wait_recv_cost_stats, int expert_alignment,
                       int num_worst_tokens, const Config &config, std::optional<EventHandle> &previous_event,
                       bool async, bool allocate_on_comm_stream, bool use_quant)
 {
+    EP_HOST_ASSERT(active_ranks.empty());
     // One channel use two blocks, even-numbered blocks for sending, odd-numbered blocks for receiving.
     EP_HOST_ASSERT(config.num_sms % 2 == 0);
     int num_channels = config.num_sms / 2;
 
+    // notify_verify returns no event, so the compute stream always waits for it
+    CommStreamOverlap overlap(comm_stream, previous_event, false, false);
+
+    DispatchHandle handle = layout;
+    int32_t round = handle.round;
+    int32_t per_round_tokens = handle.per_round_tokens;
+    const at::Tensor &new_topk_idx = handle.new_topk_idx;
     at::Tensor expert_ids = new_topk_idx.to(at::kInt);
     int64_t tp_size = 1;
     int64_t tp_rank = 0;
     int64_t quant_mode = use_quant ? DYNAMIC_SCALES : NO_SCALES;
     auto recv_topk_idx = std::optional<at::Tensor>();
     auto recv_topk_weights = std::optional<at::Tensor>();
-    // Wait streams
-    std::optional<EventHandle> event;
     auto rank_prefix_matrix = at::empty({num_ranks, num_ranks}, at::dtype(at::kInt).device(x.device()));
     auto channel_prefix_matrix = at::empty({num_ranks, num_channels}, at::dtype(at::kInt).device(x.device()));
     auto recv_channel_prefix_matrix = at::empty({num_ranks, num_channels}, at::dtype(at::kInt).device(x.device()));
@@ -413,15 +828,14 @@ Buffer::notify_verify(const at::Tensor &x, const std::optional<at::Tensor> &x_sc
     at::Tensor new_x = x;
     // for padding
     if (topk_idx->size(0) < PADDING_SIZE) {
-        this->is_padding = true;
-        this->padding_cnt = PADDING_SIZE - topk_idx->size(0);
+        handle.padding_cnt = PADDING_SIZE - topk_idx->size(0);
         std::vector<at::Tensor> x_blocks;
         if (topk_idx->size(0) != 0) {
             x_blocks.emplace_back(x);
         } else {
-            this->ori_x = x.clone();
+            handle.ori_x = x.clone();
         }
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_x = torch::ones({1, x.size(1)}, x.options()) * (i + 1) * 2;
             x_blocks.emplace_back(tmp_x);
         }
@@ -483,47 +897,36 @@ Buffer::notify_verify(const at::Tensor &x, const std::optional<at::Tensor> &x_sc
 
     int send_per_group = 3;  // (send_to_expert_num, send_to_expert_offset, send_rank_tokens)
 
-    auto send_data = torch::empty({round, num_experts * send_per_group}, at::dtype(at::kInt).device(x.device()));
+    // Tensors only read within this call live in the arena, the returned ones are allocated per call
+    auto int_options = at::dtype(at::kInt).device(x.device());
+    auto scratch = arena.begin(ArenaRegion::NOTIFY_SCRATCH, int_options);
+    auto send_data = scratch.take({round, num_experts * send_per_group}, int_options);
     int64_t send_count = send_per_group * num_local_experts * num_ranks * round;
 
-    auto send_data_offset = torch::empty({round, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_data = torch::empty({round, num_experts * send_per_group}, at::dtype(at::kInt).device(x.device()));
-    // get ep name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
-    }
-    at::Tensor total_recv_token = torch::empty({1}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_offset = at::empty({round, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_count = at::empty({round, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor max_bs = torch::empty({1}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor recv_tokens_per_expert =
-        torch::empty({round * num_local_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor expert_global_offset = at::empty({num_local_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor srcrank_in_expert_offset =
-        at::empty({num_local_experts * num_ranks}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor r_in_srcrank_offset =
-        at::empty({num_local_experts * num_ranks * round}, at::dtype(at::kInt).device(x.device()));
+    auto send_data_offset = scratch.take({round, num_experts}, int_options);
+    at::Tensor recv_data = at::empty({round, num_experts * send_per_group}, int_options);
+    at::Tensor total_recv_token = at::empty({1}, int_options);
+    at::Tensor recv_offset = at::empty({round, num_experts}, int_options);
+    at::Tensor recv_count = at::empty({round, num_experts}, int_options);
+    at::Tensor max_bs = at::empty({1}, int_options);
+    at::Tensor recv_tokens_per_expert = at::empty({round * num_local_experts}, int_options);
+    at::Tensor expert_global_offset = at::empty({num_local_experts}, int_options);
+    at::Tensor srcrank_in_expert_offset = at::empty({num_local_experts * num_ranks}, int_options);
+    at::Tensor r_in_srcrank_offset = at::empty({num_local_experts * num_ranks * round}, int_options);
 
     int64_t local_rank_size = num_ranks;
     int64_t local_rank_id = rank % local_rank_size;
     auto new_num_tokens_per_expert = num_tokens_per_expert.value();
     std::vector<int> num_recv_tokens_per_expert_list;
-    // indicates the value type of the output num_recv_tokens_per_expert_list, with a range of [0, 1]
-    // 0 means the prefix sum of the number of tokens received by each expert;
-    // 1 means the number of tokens received by each expert (default)
-    int expert_token_nums_type = get_value_from_env("MOE_EXPERT_TOKEN_NUMS_TYPE", 1);
-    EP_HOST_ASSERT(expert_token_nums_type == 1 or expert_token_nums_type == 0);
-
+    at::Tensor no_recv_stats;
     EXEC_NPU_CMD(aclnnNotifyDispatch, send_data, new_num_tokens_per_expert, send_count, num_tokens,
                  hcom_ep_name,  // commGroup
                  num_ranks,     // rankSize
                  rank,          // rankId
                  local_rank_size, local_rank_id, round, per_round_tokens, send_data_offset, recv_data, recv_count,
                  recv_offset, expert_global_offset, srcrank_in_expert_offset, r_in_srcrank_offset, total_recv_token,
-                 max_bs, recv_tokens_per_expert);
+                 max_bs, recv_tokens_per_expert, no_recv_stats);
+    overlap.finish();
 
     return {recv_data,           recv_count,       recv_offset, expert_global_offset,  srcrank_in_expert_offset,
             r_in_srcrank_offset, total_recv_token, max_bs,      recv_tokens_per_expert};
@@ -534,17 +937,38 @@ void Buffer::clean_low_latency_buffer(int num_max_dispatch_tokens_per_rank, int
     return;
 }
 
+at::Tensor Buffer::get_next_low_latency_combine_buffer(const DispatchHandle &handle, int64_t hidden)
+{
+    EP_HOST_ASSERT(low_latency_mode);
+    // Only a low-latency dispatch knows which receive copy, and so which send copy, its combine belongs to
+    EP_HOST_ASSERT(handle.low_latency_buffer_idx == 0 or handle.low_latency_buffer_idx == 1);
+    EP_HOST_ASSERT(hidden > 0);
+
+    // Paired with the receive copy, so it stays valid as long as the dispatch outputs do
+    auto region =
+        handle.low_latency_buffer_idx == 0 ? ArenaRegion::LOW_LATENCY_SEND_0 : ArenaRegion::LOW_LATENCY_SEND_1;
+    auto options = at::dtype(at::kBFloat16).device(handle.new_topk_idx.device());
+    auto combine_buffer = arena.begin(region, options).take({handle.num_max_recv_tokens, hidden}, options);
+    low_latency_combine_buffers[handle.low_latency_buffer_idx] = combine_buffer;
+    return combine_buffer;
+}
+
 std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<EventHandle>>
 Buffer::intranode_combine(const torch::Tensor &x, const torch::Tensor &topk_idx,
                           const std::optional<torch::Tensor> &topk_weights, const torch::Tensor &src_idx,
-                          const torch::Tensor &send_head, const std::optional<at::Tensor> &combine_send_cost_stats)
+                          const torch::Tensor &send_head, const DispatchHandle &handle,
+                          const std::optional<at::Tensor> &combine_send_cost_stats,
+                          std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream)
 {
+    EP_HOST_ASSERT(active_ranks.empty());
     EP_HOST_ASSERT(x.dim() == 2 and x.is_contiguous());
     at::Tensor recv_x = x;
 
+    CommStreamOverlap overlap(comm_stream, previous_event, async, allocate_on_comm_stream);
+
     at::Tensor topk_idx_p = topk_idx;
-    if (this->is_padding) {
-        topk_idx_p = this->new_topk_idx;
+    if (handle.is_padding() or handle.mapped_topk_idx or handle.capped_topk_idx) {
+        topk_idx_p = handle.new_topk_idx;
     }
 
     auto topk_idx_int32 = topk_idx_p.to(at::kInt);
@@ -557,14 +981,14 @@ Buffer::intranode_combine(const torch::Tensor &x, const torch::Tensor &topk_idx,
     at::Tensor expert_scales;
     // for padding
     if (topk_weights.has_value()) {
-        if (!this->is_padding) {
+        if (!handle.is_padding()) {
             expert_scales = topk_weights.value();
         } else {
             std::vector<at::Tensor> weight_blocks;
             if (topk_weights->size(0) != 0) {
                 weight_blocks.emplace_back(topk_weights.value());
             }
-            for (int i = 0; i < this->padding_cnt; i++) {
+            for (int i = 0; i < handle.padding_cnt; i++) {
                 if (topk_weights.has_value()) {
                     at::Tensor tmp_weight = torch::arange(0, num_topk, topk_weights->options()).reshape({1, num_topk});
                     weight_blocks.emplace_back(tmp_weight);
@@ -576,77 +1000,65 @@ Buffer::intranode_combine(const torch::Tensor &x, const torch::Tensor &topk_idx,
         expert_scales = at::ones({num_tokens, num_topk}, at::dtype(at::kFloat).device(device));
     }
 
-    at::Tensor combine_send_cost_stats_out;
-    if (combine_send_cost_stats.has_value()) {
-        EP_HOST_ASSERT(combine_send_cost_stats->scalar_type() == torch::kInt32);
-        EP_HOST_ASSERT(combine_send_cost_stats->dim() == 1 and combine_send_cost_stats->is_contiguous());
-        EP_HOST_ASSERT(combine_send_cost_stats->size(0) == num_ranks);
-        combine_send_cost_stats_out = combine_send_cost_stats.value();
-    }
+    at::Tensor combine_send_cost_stats_out = get_cost_stats_out(combine_send_cost_stats);
 
     int64_t hidden = static_cast<int>(recv_x.size(1));
-    at::Tensor tp_send_counts = at::empty({1}, at::dtype(at::kInt).device(device));
+    auto int_options = at::dtype(at::kInt).device(device);
+    at::Tensor tp_send_counts = arena.begin(ArenaRegion::PLACEHOLDER, int_options).take({1}, int_options);
     int64_t tp_world_size = 1;
     int64_t tp_rankId = 0;
     int64_t moe_expert_number = send_head.size(0);
 
-    // get ep & tp name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
-    }
-
     // Combine data
     auto combined_x = torch::empty({expert_scales.size(0), hidden}, x.options());
     std::optional<torch::Tensor> recv_topk_weights;
-    std::optional<EventHandle> event;
 
-    int32_t round = this->combine_enable_long_seq ? this->round : 1;
-    int32_t per_round_tokens = this->combine_enable_long_seq ? this->per_round_tokens : MAX_TOKENS_PER_ROUND;
+    int32_t round = this->combine_enable_long_seq ? handle.round : 1;
+    int32_t per_round_tokens = this->combine_enable_long_seq ? handle.per_round_tokens : MAX_TOKENS_PER_ROUND;
     EXEC_NPU_CMD(aclnnCamMoeCombineNormal, recv_x, token_src_info, ep_send_counts, expert_scales, topk_idx_int32,
                  tp_send_counts, hcom_ep_name, num_ranks, rank, hcom_ep_name, tp_world_size, tp_rankId,
-                 moe_expert_number, real_max_bs, round, per_round_tokens, combined_x, combine_send_cost_stats_out);
+                 moe_expert_number, handle.real_max_bs, round, per_round_tokens, combined_x,
+                 combine_send_cost_stats_out);
+    record_cost_stats(COST_COMBINE_SEND, combine_send_cost_stats_out, combine_send_cost_stats);
 
-    if (this->is_padding) {
-        if (this->padding_cnt == PADDING_SIZE) {
-            combined_x = this->ori_x;
-        } else {
-            combined_x = combined_x.slice(0, 0, PADDING_SIZE - this->padding_cnt);
-        }
-        is_padding = false;
-    }
+    // Wait streams
+    overlap.record_tensors(x, topk_idx_int32, token_src_info, ep_send_counts, expert_scales, tp_send_counts, combined_x,
+                           combine_send_cost_stats_out);
+    std::optional<EventHandle> event = overlap.finish();
 
-    return {combined_x, recv_topk_weights, event};
+    return {strip_padding(handle, combined_x), recv_topk_weights, event};
 }
 
 std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<torch::Tensor>, std::optional<torch::Tensor>,
            std::vector<int>, torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor,
-           std::optional<EventHandle>>
+           DispatchHandle, std::optional<EventHandle>>
 Buffer::internode_dispatch(
     const torch::Tensor &x, const std::optional<torch::Tensor> &x_scales, const std::optional<torch::Tensor> &topk_idx,
     const std::optional<torch::Tensor> &topk_weights, const std::optional<torch::Tensor> &num_tokens_per_rank,
     const std::optional<torch::Tensor> &num_tokens_per_rdma_rank, const torch::Tensor &is_token_in_rank,
-    const std::optional<torch::Tensor> &num_tokens_per_expert, const Config &config,
+    const std::optional<torch::Tensor> &num_tokens_per_expert, const DispatchHandle &layout, const Config &config,
     std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream, bool use_quant)
 {
+    EP_HOST_ASSERT(active_ranks.empty());
     // One channel use two blocks, even-numbered blocks for sending, odd-numbered blocks for receiving.
     EP_HOST_ASSERT(config.num_sms % 2 == 0);
     int num_channels = config.num_sms / 2;
 
+    CommStreamOverlap overlap(comm_stream, previous_event, async, allocate_on_comm_stream);
+
+    DispatchHandle handle = layout;
+    const at::Tensor &new_topk_idx = handle.new_topk_idx;
     at::Tensor new_x = x;
     // for padding
     if (topk_idx->size(0) < PADDING_SIZE) {
-        this->is_padding = true;
-        this->padding_cnt = PADDING_SIZE - topk_idx->size(0);
+        handle.padding_cnt = PADDING_SIZE - topk_idx->size(0);
         std::vector<at::Tensor> x_blocks;
         if (topk_idx->size(0) != 0) {
             x_blocks.emplace_back(x);
         } else {
-            this->ori_x = x.clone();
+            handle.ori_x = x.clone();
         }
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_x = torch::zeros({1, x.size(1)}, x.options());
             x_blocks.emplace_back(tmp_x);
         }
@@ -687,14 +1099,14 @@ Buffer::internode_dispatch(
     at::Tensor new_topk_weights;
     // for padding
     if (topk_weights.has_value()) {
-        if (!this->is_padding) {
+        if (!handle.is_padding()) {
             new_topk_weights = topk_weights.value();
         } else {
             std::vector<at::Tensor> weight_blocks;
             if (topk_weights->size(0) != 0) {
                 weight_blocks.emplace_back(topk_weights.value());
             }
-            for (int i = 0; i < this->padding_cnt; i++) {
+            for (int i = 0; i < handle.padding_cnt; i++) {
                 at::Tensor tmp_weight = torch::arange(0, num_topk, topk_weights->options()).reshape({1, num_topk});
                 weight_blocks.emplace_back(tmp_weight);
             }
@@ -727,62 +1139,49 @@ Buffer::internode_dispatch(
     int64_t expertTokenNumsType = 0;
 
     int64_t quant_mode = use_quant ? DYNAMIC_SCALES : NO_SCALES;
-    int64_t global_bs = static_cast<int64_t>(MAX_BATCH_SIZE * num_ranks);
+    // The notify lays the token offsets out for the layout's batch bound, the dispatch finds it from global_bs
+    const int max_bs = handle.per_round_tokens;
+    EP_HOST_ASSERT(num_tokens <= max_bs);
+    int64_t global_bs = static_cast<int64_t>(max_bs) * num_ranks;
     at::Tensor expert_ids = new_topk_idx.to(at::kInt);
-    at::Tensor xActiveMask = at::empty({1}, at::dtype(at::kInt).device(x.device()));
-
-    auto expertTokenNums = at::zeros({1}, at::dtype(at::kLong).device(x.device()));
-    auto epRecvCount = at::zeros({1}, at::dtype(at::kInt).device(x.device()));
-    auto tpRecvCount = at::zeros({1}, at::dtype(at::kInt).device(x.device()));
+    auto int_options = at::dtype(at::kInt).device(x.device());
+    auto placeholder = arena.begin(ArenaRegion::PLACEHOLDER, int_options);
+    at::Tensor xActiveMask = placeholder.take({1}, int_options);
+
+    // The A2 kernel keeps these output addresses without writing them
+    auto expertTokenNums = placeholder.take({1}, at::dtype(at::kLong).device(x.device()));
+    auto epRecvCount = placeholder.take({1}, int_options);
+    auto tpRecvCount = placeholder.take({1}, int_options);
     at::Tensor dispatch_wait_recv_cost_stats_out;
     auto recv_topk_idx = std::optional<at::Tensor>();
     auto recv_topk_weights = std::optional<at::Tensor>();
-    // Wait streams
-    std::optional<EventHandle> event;
 
     int64_t local_rank_size = A2_MAX_HCCS_PEERS;
     int32_t server_num = num_ranks / local_rank_size;
     int64_t local_rank_id = rank % local_rank_size;
     auto new_num_tokens_per_expert = num_tokens_per_expert.value();
     std::vector<int> num_recv_tokens_per_expert_list;
-    // indicates the value type of the output num_recv_tokens_per_expert_list, with a range of [0, 1]
-    // 0 means the prefix sum of the number of tokens received by each expert;
-    // 1 means the number of tokens received by each expert (default)
-    int expert_token_nums_type = get_value_from_env("MOE_EXPERT_TOKEN_NUMS_TYPE", 1);
-    EP_HOST_ASSERT(expert_token_nums_type == 1 or expert_token_nums_type == 0);
-
     // Corresponding to the output data and length of the layout
-    auto new_send_data = this->notify_send_data;
-    int send_count = this->notify_send_data_size;
-
-    auto send_data_offset = at::empty({num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor tmp_data =
-        at::empty({send_count * num_ranks}, at::dtype(at::kInt).device(x.device()));  // 给notify算子用来临时存数的空间
-    at::Tensor recv_data = at::empty({send_count * num_ranks}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor token_server_idx =
-        at::empty({MAX_BATCH_SIZE, server_num}, at::dtype(at::kInt).device(x.device()));  // offset_outer
-    at::Tensor token_unique_per_server = at::empty({server_num}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor ep_rank_token_cnt =
-        at::empty({num_experts, num_ranks}, at::dtype(at::kInt).device(x.device()));  // 包含全局的
+    auto new_send_data = handle.notify_send_data;
+    int send_count = handle.notify_send_data_size;
+
+    // Tensors only read within this call live in the arena, the ones combine reads are allocated per call
+    auto scratch = arena.begin(ArenaRegion::NOTIFY_SCRATCH, int_options);
+    auto send_data_offset = scratch.take({num_experts}, int_options);
+    at::Tensor tmp_data = scratch.take({send_count * num_ranks}, int_options);  // 给notify算子用来临时存数的空间
+    at::Tensor recv_data = scratch.take({send_count * num_ranks}, int_options);
+    at::Tensor token_server_idx = at::empty({max_bs, server_num}, int_options);  // offset_outer
+    at::Tensor token_unique_per_server = scratch.take({server_num}, int_options);
+    at::Tensor ep_rank_token_cnt = at::empty({num_experts, num_ranks}, int_options);  // 包含全局的
     // The number of tokens received by each expert on this rank, not a prefix sum
-    at::Tensor recv_tokens_per_expert = at::empty({num_local_experts}, at::dtype(at::kLong).device(x.device()));
-    at::Tensor src_offset_rank_token_idx =
-        at::empty({num_experts, num_ranks, MAX_BATCH_SIZE}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor dst_offset_rank_token_idx =
-        at::empty({num_experts, num_ranks, MAX_BATCH_SIZE}, at::dtype(at::kInt).device(x.device()));
+    at::Tensor recv_tokens_per_expert = scratch.take({num_local_experts}, at::dtype(at::kLong).device(x.device()));
+    at::Tensor src_offset_rank_token_idx = scratch.take({num_experts, num_ranks, max_bs}, int_options);
+    at::Tensor dst_offset_rank_token_idx = scratch.take({num_experts, num_ranks, max_bs}, int_options);
     // The offsetInner for the current rank and the peer rank
-    at::Tensor offset_inner = at::empty({2, MAX_BATCH_SIZE, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor count_outer = at::empty({MAX_BATCH_SIZE}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor expand_idx = at::empty({MAX_BATCH_SIZE, num_experts}, at::dtype(at::kInt).device(x.device()));
-    at::Tensor total_recv_token = torch::empty({1}, at::dtype(at::kInt).device(x.device()));
-
-    // get ep name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
-    }
+    at::Tensor offset_inner = at::empty({2, max_bs, num_experts}, int_options);
+    at::Tensor count_outer = at::empty({max_bs}, int_options);
+    at::Tensor expand_idx = at::empty({max_bs, num_experts}, int_options);
+    at::Tensor total_recv_token = scratch.take({1}, int_options);
 
     EXEC_NPU_CMD(aclnnNotifyDispatchA2, new_send_data, new_num_tokens_per_expert, tmp_data, send_count, num_tokens,
                  num_topk, num_experts,
@@ -824,6 +1223,13 @@ Buffer::internode_dispatch(
         num_recv_tokens_per_expert_list.emplace_back(token_cnt);
     }
 
+    // Wait streams
+    overlap.record_tensors(x, new_x, expert_ids, new_topk_weights, x_scales, new_send_data, new_num_tokens_per_expert,
+                           tmp_data, recv_data, token_server_idx, token_unique_per_server, ep_rank_token_cnt,
+                           src_offset_rank_token_idx, dst_offset_rank_token_idx, offset_inner, count_outer, expand_idx,
+                           expandx_out, dynamic_scales_out, expand_scales, recv_topk_idx, recv_topk_weights);
+    std::optional<EventHandle> event = overlap.finish();
+
     return {expandx_out,
             dynamic_scales_out,
             recv_topk_idx,
@@ -835,20 +1241,25 @@ Buffer::internode_dispatch(
             token_server_idx,
             count_outer,
             expand_scales,
+            handle,
             event};
 }
 
 std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<EventHandle>> Buffer::internode_combine(
     const torch::Tensor &x, const torch::Tensor &topk_idx, const std::optional<torch::Tensor> &topk_weights,
     const torch::Tensor &src_idx, const torch::Tensor &send_head, const torch::Tensor &offsetInner,
-    const torch::Tensor &offsetOuter, const torch::Tensor &countOuter, const torch::Tensor &expand_scales)
+    const torch::Tensor &offsetOuter, const torch::Tensor &countOuter, const torch::Tensor &expand_scales,
+    const DispatchHandle &handle, std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream)
 {
+    EP_HOST_ASSERT(active_ranks.empty());
     EP_HOST_ASSERT(x.dim() == 2 and x.is_contiguous());
     at::Tensor recv_x = x;
 
+    CommStreamOverlap overlap(comm_stream, previous_event, async, allocate_on_comm_stream);
+
     at::Tensor topk_idx_p = topk_idx;
-    if (this->is_padding) {
-        topk_idx_p = this->new_topk_idx;
+    if (handle.is_padding() or handle.mapped_topk_idx or handle.capped_topk_idx) {
+        topk_idx_p = handle.new_topk_idx;
     }
 
     auto topk_idx_int32 = topk_idx_p.to(at::kInt);
@@ -861,27 +1272,21 @@ std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<EventHandl
 
     const int num_tokens = topk_idx_p.size(0);
     const int num_topk = topk_idx_p.size(1);
-    at::Tensor expert_scales = at::empty({1}, at::dtype(at::kFloat).device(x.device()));
+    auto int_options = at::dtype(at::kInt).device(device);
+    auto placeholder = arena.begin(ArenaRegion::PLACEHOLDER, int_options);
+    at::Tensor expert_scales = placeholder.take({1}, at::dtype(at::kFloat).device(device));
 
     int64_t hidden = static_cast<int>(recv_x.size(1));
-    at::Tensor tp_send_counts = at::empty({1}, at::dtype(at::kInt).device(device));
+    at::Tensor tp_send_counts = placeholder.take({1}, int_options);
     int64_t tp_world_size = 1;
     int64_t tp_rankId = 0;
     int64_t moe_expert_number = send_head.size(0);
-    int64_t global_bs = static_cast<int64_t>(MAX_BATCH_SIZE * num_ranks);
-
-    // get ep & tp name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
-    }
+    // offsetInner holds the layout's batch bound of rows for every rank, the combine reduces that many
+    int64_t global_bs = static_cast<int64_t>(handle.per_round_tokens) * num_ranks;
 
     // Combine data
-    auto combined_x = torch::empty({new_topk_idx.size(0), hidden}, x.options());
+    auto combined_x = torch::empty({handle.new_topk_idx.size(0), hidden}, x.options());
     std::optional<torch::Tensor> recv_topk_weights;
-    std::optional<EventHandle> event;
     at::Tensor x_active_mask, activation_scale, weight_scale, group_list;
     int64_t expert_shared_type = 0;
     int64_t out_dtype = 0;
@@ -894,54 +1299,65 @@ std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<EventHandl
                  tp_rankId, expert_shared_type, shared_expert_num, shared_expert_rank_num, global_bs, out_dtype,
                  comm_quant_mode, group_list_type, combined_x);
 
-    if (this->is_padding) {
-        if (this->padding_cnt == PADDING_SIZE) {
-            combined_x = this->ori_x;
-        } else {
-            combined_x = combined_x.slice(0, 0, PADDING_SIZE - this->padding_cnt);
-        }
-        is_padding = false;
-    }
-    return {combined_x, recv_topk_weights, event};
+    // Wait streams
+    overlap.record_tensors(x, expert_ids, expand_idx, ep_send_counts, expert_scales, tp_send_counts, expand_scales,
+                           offsetInner, offsetOuter, countOuter, combined_x);
+    std::optional<EventHandle> event = overlap.finish();
+
+    return {strip_padding(handle, combined_x), recv_topk_weights, event};
 }
 
-std::tuple<at::Tensor, std::optional<at::Tensor>, at::Tensor, at::Tensor, at::Tensor, std::optional<EventHandle>,
-           std::optional<std::function<void()>>>
+std::tuple<at::Tensor, std::optional<at::Tensor>, at::Tensor, at::Tensor, at::Tensor, DispatchHandle,
+           std::optional<EventHandle>, std::optional<std::function<void()>>>
 Buffer::low_latency_dispatch(const at::Tensor &x, const at::Tensor &topk_idx,
                              const std::optional<at::Tensor> &cumulative_local_expert_recv_stats,
-                             int num_max_dispatch_tokens_per_rank, int num_experts, bool use_fp8,
-                             bool round_scale, bool use_ue8m0, bool async, bool return_recv_hook)
+                             int64_t num_max_dispatch_tokens_per_rank, int64_t num_experts, bool use_fp8,
+                             bool round_scale, bool use_ue8m0, bool use_block_scales, bool async,
+                             bool return_recv_hook, const std::optional<at::Tensor> &topk_weights,
+                             const std::optional<at::Tensor> &expert_counts)
 {
-    this->is_padding = false;
     EP_HOST_ASSERT(low_latency_mode);
+    // The receive hook runs on the compute stream, so the send phase must already be ordered before it
+    EP_HOST_ASSERT(not(async and return_recv_hook));
+
+    CommStreamOverlap overlap(comm_stream, std::nullopt, async, false);
+    DispatchHandle handle;
     at::Tensor new_x = x;
-    this->new_topk_idx = topk_idx;
+    handle.new_topk_idx = apply_expert_capacity(handle, topk_idx, num_experts, topk_weights, expert_counts);
     if (topk_idx.size(0) < PADDING_SIZE) {
-        this->is_padding = true;
-        this->padding_cnt = PADDING_SIZE - topk_idx.size(0);
+        handle.padding_cnt = PADDING_SIZE - topk_idx.size(0);
         std::vector<at::Tensor> x_blocks;
         std::vector<at::Tensor> topk_blocks;
         if (topk_idx.size(0) != 0) {
             x_blocks.emplace_back(x);
-            topk_blocks.emplace_back(topk_idx);
+            topk_blocks.emplace_back(handle.new_topk_idx);
         } else {
-            this->ori_x = x.clone();
+            handle.ori_x = x.clone();
         }
-        int topk = static_cast<int>(new_topk_idx.size(1));
-        for (int i = 0; i < this->padding_cnt; i++) {
+        int topk = static_cast<int>(topk_idx.size(1));
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_x = torch::ones({1, x.size(1)}, x.options());
             at::Tensor tmp_topk = torch::arange(0, topk, topk_idx.options()).reshape({1, topk});
             x_blocks.emplace_back(tmp_x);
             topk_blocks.emplace_back(tmp_topk);
         }
         new_x = torch::cat(x_blocks, 0);
-        this->new_topk_idx = torch::cat(topk_blocks, 0);
+        handle.new_topk_idx = torch::cat(topk_blocks, 0);
     }
+    at::Tensor new_topk_idx = handle.new_topk_idx;
 
     EP_HOST_ASSERT(num_max_dispatch_tokens_per_rank >= new_x.size(0));
 
+    // Per-128-channel scales (optionally powers of two) are A3 only, the A2 kernels only have per-token scales
+    bool group_scales = use_fp8 and use_block_scales;
+    EP_HOST_ASSERT(not use_block_scales or (use_fp8 and soc_version != op::SocVersion::ASCEND910B));
+    EP_HOST_ASSERT(not round_scale or group_scales);
+    EP_HOST_ASSERT(not use_ue8m0 or round_scale);
+
     auto num_tokens = static_cast<int>(new_x.size(0)), hidden = static_cast<int>(new_x.size(1));
-    auto num_scales = hidden / 128, num_topk = static_cast<int>(new_topk_idx.size(1));
+    auto num_scales = group_scales ? hidden / 128 : 1, num_topk = static_cast<int>(new_topk_idx.size(1));
+    EP_HOST_ASSERT(not group_scales or hidden % 128 == 0);
+    EP_HOST_ASSERT(not use_ue8m0 or num_scales % 4 == 0);
     auto num_local_experts = num_experts / (num_ranks - shared_expert_rank_num);
     int64_t global_bs = num_max_dispatch_tokens_per_rank * num_ranks;
     auto num_max_tokens = 0;
@@ -953,51 +1369,76 @@ Buffer::low_latency_dispatch(const at::Tensor &x, const at::Tensor &topk_idx,
     }
     auto max_size = std::max(num_tokens * num_topk, num_max_tokens * 128);
 
-    // Allocate packed tensors
+    // Take the packed tensors from the arena copy the previous dispatch did not use, they stay valid until the
+    // dispatch after the next one
     auto device = new_x.device();
-    auto packed_recv_x =
-        at::empty({num_max_tokens, hidden}, new_x.options().dtype(use_fp8 ? at::kChar : at::kBFloat16));
-    auto packed_recv_x_scales = at::empty({num_max_tokens}, at::dtype(at::kFloat).device(device));
-    auto expandIdx = at::empty({max_size}, at::dtype(at::kInt).device(device));
+    auto int_options = at::dtype(at::kInt).device(device);
+    auto recv_region = low_latency_buffer_idx == 0 ? ArenaRegion::LOW_LATENCY_RECV_0 : ArenaRegion::LOW_LATENCY_RECV_1;
+    handle.low_latency_buffer_idx = low_latency_buffer_idx;
+    handle.num_max_recv_tokens = num_max_tokens;
+    low_latency_buffer_idx ^= 1;
+    auto outputs = arena.begin(recv_region, int_options);
+    auto packed_recv_x = outputs.take({num_max_tokens, hidden}, int_options.dtype(use_fp8 ? at::kChar : at::kBFloat16));
+    auto float_options = at::dtype(at::kFloat).device(device);
+    auto packed_recv_x_scales = group_scales ? outputs.take({num_max_tokens, num_scales}, float_options)
+                                             : outputs.take({num_max_tokens}, float_options);
+    // UE8M0 keeps only the exponent byte of each power-of-two scale, four of them packed into an int
+    at::Tensor packed_recv_x_ue8m0;
+    if (use_ue8m0) {
+        packed_recv_x_ue8m0 = outputs.take({num_max_tokens, num_scales / 4}, int_options);
+    }
+    auto expandIdx = outputs.take({max_size}, int_options);
 
     int32_t server_num = num_ranks / LOCAL_RANK_SIZE;
-    at::Tensor ep_recv_count =
-        at::empty({num_local_experts * num_ranks}, at::dtype(at::kInt).device(device));  // A2 non-layered / A3
-    auto tp_recv_count = at::empty({1}, at::dtype(at::kInt).device(device));
-    auto packed_recv_count = at::empty({num_local_experts}, at::dtype(at::kLong).device(device));
+    int64_t recv_count_tensor_size = num_local_experts * num_ranks;  // A2 non-layered / A3
+    auto tp_recv_count = outputs.take({1}, int_options);
+    auto packed_recv_count = outputs.take({num_local_experts}, at::dtype(at::kLong).device(device));
+
+    // Logical expert ids pick their replicas inside the A3 kernel, which returns the physical ids for the combine;
+    // the A2 kernels only take physical ids, so they are mapped round-robin beforehand
+    at::Tensor replica_log2phy;
+    at::Tensor replica_logcnt;
+    at::Tensor physical_topk_idx;
+    int64_t replica_policy = REPLICA_ROUND_ROBIN;
+    if (expert_log2phy.defined()) {
+        EP_HOST_ASSERT(max_physical_expert < num_experts);
+        handle.mapped_topk_idx = true;
+        if (soc_version == op::SocVersion::ASCEND910B) {
+            new_topk_idx = map_to_expert_replicas(new_topk_idx, expert_log2phy, expert_logcnt, rank);
+            handle.new_topk_idx = new_topk_idx;
+        } else {
+            replica_log2phy = expert_log2phy;
+            replica_logcnt = expert_logcnt;
+            replica_policy = expert_replica_policy;
+            physical_topk_idx = outputs.take({num_tokens, num_topk}, int_options);
+            handle.new_topk_idx = physical_topk_idx;
+        }
+    }
+    // Without inactive ranks the kernels keep the full group, otherwise the tokens of the experts they held are dropped
+    at::Tensor rank_elastic_info;
+    if (not active_ranks.empty()) {
+        EP_HOST_ASSERT(shared_expert_rank_num == 0 and not expert_log2phy.defined());
+        new_topk_idx = get_elastic_topk_idx(new_topk_idx, num_experts);
+        rank_elastic_info = elastic_info;
+        handle.new_topk_idx = new_topk_idx;
+        handle.mapped_topk_idx = true;
+        handle.elastic_info = rank_elastic_info;
+    }
     at::Tensor scales;
     at::Tensor active_mask;
-    int enable_neg_one = get_value_from_env("MOE_ENABLE_TOPK_NEG_ONE", 0);
-    int64_t quant_mode = use_fp8 ? 2 : 0;
+    // 2: one scale per token, 3: one scale per 128 channels, 4: as 3 with power-of-two scales
+    int64_t quant_mode = use_fp8 ? (group_scales ? (round_scale ? 4 : 3) : 2) : 0;
     int64_t tp_size = 1;
     int64_t tp_rank = 0;
     int64_t expert_shard_type = 0;
-    int outType = get_value_from_env("MOE_EXPERT_TOKEN_NUMS_TYPE", 1);
     char *comm_alg;
-    int64_t expert_token_nums_type = outType;
+    int64_t token_nums_type = expert_token_nums_type;
 
-    // get ep & tp name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
-    }
     char hcom_tp_name[HCOMM_NAME_LEN] = {0};
-    // Wait streams
-    std::optional<EventHandle> event;
-    bool isLayered = false;
-
-    if (soc_version == op::SocVersion::ASCEND910B) {
-        const char *hcclIntraPcieEnable = getenv("HCCL_INTRA_PCIE_ENABLE");
-        const char *hcclIntraRoceEnable = getenv("HCCL_INTRA_ROCE_ENABLE");
-        if (hcclIntraPcieEnable != nullptr && hcclIntraRoceEnable != nullptr && strcmp(hcclIntraPcieEnable, "1") == 0 &&
-            strcmp(hcclIntraRoceEnable, "0") == 0) {  // A2 layered
-            isLayered = true;
-            int64_t recv_count_tensor_size = num_experts + 2 * global_bs * num_topk * server_num;
-            ep_recv_count = at::empty({recv_count_tensor_size}, at::dtype(at::kInt).device(device));
-        }
+    if (a2_layered) {
+        recv_count_tensor_size = num_experts + 2 * global_bs * num_topk * server_num;
     }
+    at::Tensor ep_recv_count = outputs.take({recv_count_tensor_size}, int_options);
 
     if (soc_version == op::SocVersion::ASCEND910B) {
         comm_alg = "fullmesh";
@@ -1005,71 +1446,142 @@ Buffer::low_latency_dispatch(const at::Tensor &x, const at::Tensor &topk_idx,
         comm_alg = "fullmesh_v1";
     }
 
-    if (enable_neg_one) {
-        EP_HOST_ASSERT(isLayered == false);
+    if (enable_topk_neg_one or rank_elastic_info.defined() or handle.dropped_topk.defined()) {
+        EP_HOST_ASSERT(not a2_layered);
         active_mask = (new_topk_idx >= 0).to(torch::kBool);
     }
 
-    EXEC_NPU_CMD(aclnnMoeDistributeDispatchV2, new_x, new_topk_idx,
-                 scales,        // smooth scales,
-                 active_mask,   // active_mask
-                 hcom_ep_name,  // ep
-                 num_ranks,     // rankSize
-                 rank,          // rankId
-                 num_experts,
-                 hcom_tp_name,            // tp
-                 tp_size,                 // tp_size
-                 tp_rank,                 // tp_rank
-                 expert_shard_type,       // expert_shard_type
-                 shared_expert_num,       // shared_expert_num
-                 shared_expert_rank_num,  // shared_expert_rank_num
-                 quant_mode,
-                 global_bs,               // global_bs
-                 expert_token_nums_type,  // expert_token_nums_type
-                 comm_alg, packed_recv_x,
-                 packed_recv_x_scales,  // dynamicScalesOut
-                 expandIdx,
-                 packed_recv_count,  // expertTokenNumsOut
-                 ep_recv_count, tp_recv_count);
+    // Received-token counts for the expert load balancer, the A3 receive phase adds them in place with an atomic add,
+    // the A2 kernels have no such output and the per-expert counts they return are added instead
+    at::Tensor expert_recv_stats;
+    at::Tensor kernel_recv_stats;
+    if (cumulative_local_expert_recv_stats.has_value()) {
+        expert_recv_stats = cumulative_local_expert_recv_stats.value();
+        EP_HOST_ASSERT(expert_recv_stats.scalar_type() == at::kInt and expert_recv_stats.is_contiguous());
+        EP_HOST_ASSERT(expert_recv_stats.dim() == 1 or expert_recv_stats.dim() == 2);
+        EP_HOST_ASSERT(expert_recv_stats.size(0) == num_local_experts);
+        EP_HOST_ASSERT(expert_recv_stats.dim() == 1 or expert_recv_stats.size(1) == num_ranks);
+        if (soc_version == op::SocVersion::ASCEND910B) {
+            EP_HOST_ASSERT(expert_recv_stats.dim() == 1);
+        } else {
+            kernel_recv_stats = expert_recv_stats;
+        }
+    }
+
+    // The A2 kernels do not split sending and receiving, their hook has nothing left to do
+    bool split_recv = return_recv_hook and soc_version != op::SocVersion::ASCEND910B;
+    auto launch = [=](int64_t comm_phase) mutable {
+        EXEC_NPU_CMD(aclnnMoeDistributeDispatchV2, new_x, new_topk_idx,
+                     scales,        // smooth scales,
+                     active_mask,   // active_mask
+                     rank_elastic_info, replica_log2phy, replica_logcnt,
+                     hcom_ep_name,  // ep
+                     num_ranks,     // rankSize
+                     rank,          // rankId
+                     num_experts,
+                     hcom_tp_name,            // tp
+                     tp_size,                 // tp_size
+                     tp_rank,                 // tp_rank
+                     expert_shard_type,       // expert_shard_type
+                     shared_expert_num,       // shared_expert_num
+                     shared_expert_rank_num,  // shared_expert_rank_num
+                     quant_mode,
+                     global_bs,               // global_bs
+                     token_nums_type,         // expert_token_nums_type
+                     comm_alg,
+                     comm_phase,  // comm_phase
+                     replica_policy,
+                     packed_recv_x,
+                     packed_recv_x_scales,  // dynamicScalesOut
+                     expandIdx,
+                     packed_recv_count,  // expertTokenNumsOut
+                     ep_recv_count, tp_recv_count, kernel_recv_stats, physical_topk_idx);
+        if (expert_recv_stats.defined() and not kernel_recv_stats.defined()) {
+            auto counts = packed_recv_count;
+            if (token_nums_type == 0) {
+                counts = counts.diff(1, 0, at::zeros({1}, counts.options()));
+            }
+            expert_recv_stats.add_(counts.to(at::kInt));
+        }
+        // The scales are only complete once the tokens are received
+        if (use_ue8m0 and comm_phase != COMM_PHASE_SEND) {
+            auto ue8m0_bytes = packed_recv_x_ue8m0.view(at::kByte);
+            ue8m0_bytes.copy_(packed_recv_x_scales.view(at::kInt).bitwise_right_shift(23));
+        }
+    };
+    // Every dispatch send takes the half after the previous dispatch send, the combine keeps a state of its own
+    uint64_t send_idx = begin_low_latency_send(*low_latency_recv, LowLatencyKernel::DISPATCH);
+    launch(split_recv ? COMM_PHASE_SEND : COMM_PHASE_ALL);
+
+    // Wait streams
+    overlap.record_tensors(x, new_x, new_topk_idx, active_mask, rank_elastic_info, packed_recv_x, packed_recv_x_scales,
+                           expandIdx, packed_recv_count, ep_recv_count, tp_recv_count, packed_recv_x_ue8m0,
+                           expert_recv_stats, physical_topk_idx);
+    std::optional<EventHandle> event = overlap.finish();
+
+    // Receiving hook
+    std::optional<std::function<void()>> recv_hook = std::nullopt;
+    if (return_recv_hook) {
+        recv_hook =
+            make_low_latency_recv_hook(split_recv, low_latency_recv, LowLatencyKernel::DISPATCH, send_idx, launch);
+    }
 
     // Return values
-    return {packed_recv_x, packed_recv_x_scales,        packed_recv_count, expandIdx, ep_recv_count,
-            event,         std::function<void()>([] {})};
+    if (use_ue8m0) {
+        packed_recv_x_scales = packed_recv_x_ue8m0;
+    }
+    return {packed_recv_x, packed_recv_x_scales, packed_recv_count, expandIdx, ep_recv_count, handle, event, recv_hook};
 }
 
 std::tuple<at::Tensor, std::optional<EventHandle>, std::optional<std::function<void()>>> Buffer::low_latency_combine(
     const at::Tensor &x, const at::Tensor &topk_idx, const at::Tensor &topk_weights, const at::Tensor &src_info,
     const at::Tensor &layout_range, int64_t num_max_dispatch_tokens_per_rank, int64_t num_experts,
-    const at::Tensor &packed_recv_count, bool zero_copy, bool async, bool return_recv_hook,
-    const std::optional<at::Tensor> &out)
+    const at::Tensor &packed_recv_count, const DispatchHandle &handle, bool use_int8, bool int8_block_scaled,
+    bool zero_copy, bool async, bool return_recv_hook, const std::optional<at::Tensor> &out,
+    const std::optional<at::Tensor> &shared_expert_x, const std::optional<at::Tensor> &residual)
 {
+    EP_HOST_ASSERT(not(async and return_recv_hook));
+    // The A2 combine kernels only send bf16
+    EP_HOST_ASSERT(not use_int8 or soc_version != op::SocVersion::ASCEND910B);
+
+    CommStreamOverlap overlap(comm_stream, std::nullopt, async, false);
+
     at::Tensor new_idx = topk_idx;
     at::Tensor new_scales = topk_weights;
-    if (this->is_padding) {
+    if (handle.is_padding()) {
         std::vector<at::Tensor> scales_blocks;
-        if (this->padding_cnt != PADDING_SIZE) {
+        if (handle.padding_cnt != PADDING_SIZE) {
             scales_blocks.emplace_back(topk_weights);
         }
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_scales = torch::zeros({1, topk_weights.size(1)}, topk_weights.options());
             scales_blocks.emplace_back(tmp_scales);
         }
-        new_idx = this->new_topk_idx;
-        this->new_scales = torch::cat(scales_blocks, 0);
-        new_scales = this->new_scales;
+        new_idx = handle.new_topk_idx;
+        new_scales = torch::cat(scales_blocks, 0);
+    }
+    if (handle.mapped_topk_idx or handle.capped_topk_idx) {
+        new_idx = handle.new_topk_idx;
+    }
+    // The weights of the experts the dispatch dropped for inactive ranks go to the kept ones, every token keeps its sum
+    at::Tensor rank_elastic_info = handle.elastic_info;
+    if (rank_elastic_info.defined()) {
+        auto kept_scales = new_scales.masked_fill(new_idx.lt(0), 0);
+        auto kept_sum = kept_scales.sum(1, true);
+        new_scales = kept_scales * (new_scales.sum(1, true) / kept_sum.masked_fill(kept_sum.eq(0), 1));
     }
     // Tensor checks
     EP_HOST_ASSERT(x.dim() == 2 and x.is_contiguous() and x.scalar_type() == at::kBFloat16);
     EP_HOST_ASSERT(num_max_dispatch_tokens_per_rank >= new_idx.size(0));
+    // The kernel reads `x` in place, a zero-copy input must be the buffer the expert GEMM was given for this dispatch
+    if (zero_copy) {
+        EP_HOST_ASSERT(handle.low_latency_buffer_idx == 0 or handle.low_latency_buffer_idx == 1);
+        const at::Tensor &combine_buffer = low_latency_combine_buffers[handle.low_latency_buffer_idx];
+        EP_HOST_ASSERT(combine_buffer.defined() and x.data_ptr() == combine_buffer.data_ptr());
+        EP_HOST_ASSERT(x.sizes() == combine_buffer.sizes());
+    }
     // EP_HOST_ASSERT(x.size(0) == num_experts / num_ranks);
 
-    // get ep & tp name
-    char hcom_ep_name[HCOMM_NAME_LEN];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
-    }
     char hcom_tp_name[HCOMM_NAME_LEN] = {0};
 
     auto device = x.device();
@@ -1078,58 +1590,85 @@ std::tuple<at::Tensor, std::optional<EventHandle>, std::optional<std::function<v
     at::Tensor expand_idx = src_info;  // handle[0] = src_info
     at::Tensor ep_send_counts = layout_range;
     at::Tensor expert_scales = new_scales;
-    at::Tensor tp_send_counts = at::empty({1}, at::dtype(at::kInt).device(device));
+    auto int_options = at::dtype(at::kInt).device(device);
+    at::Tensor tp_send_counts = arena.begin(ArenaRegion::PLACEHOLDER, int_options).take({1}, int_options);
     at::Tensor x_active_mask, activation_scale, weight_scale, group_list, expand_scales;
-    int enable_neg_one = get_value_from_env("MOE_ENABLE_TOPK_NEG_ONE", 0);
     int64_t tp_world_size = 1;
     int64_t tp_rankId = 0;
     int64_t expert_shared_type = 0;
     int64_t global_bs = num_max_dispatch_tokens_per_rank * num_ranks;
     int64_t out_dtype = 0;
-    int64_t comm_quant_mode = 0;
+    // 2: int8 with one scale per 8 channels, 3: int8 with one scale per token
+    int64_t comm_quant_mode = use_int8 ? (int8_block_scaled ? 2 : 3) : 0;
     int64_t group_list_type = 0;
-    bool isLayered = false;
     char *comm_alg;
 
     auto num_combined_tokens = static_cast<int>(new_scales.size(0));
     auto hidden = static_cast<int>(x.size(1));
-    at::Tensor shared_expert_x{nullptr};
-    at::Tensor combined_x = at::empty({num_combined_tokens, hidden}, x.options());
-    std::optional<EventHandle> event;
-    if (soc_version == op::SocVersion::ASCEND910B) {
-        const char *hcclIntraPcieEnable = getenv("HCCL_INTRA_PCIE_ENABLE");
-        const char *hcclIntraRoceEnable = getenv("HCCL_INTRA_ROCE_ENABLE");
-        if (hcclIntraPcieEnable != nullptr && hcclIntraRoceEnable != nullptr && strcmp(hcclIntraPcieEnable, "1") == 0 &&
-            strcmp(hcclIntraRoceEnable, "0") == 0) {  // A2 layered
-            isLayered = true;
+    // The kernel adds one unweighted addend to every token before its final rounding, it carries the shared expert
+    // output and the residual, summed here when both are given
+    at::Tensor combine_addend{nullptr};
+    for (const auto &addend : {shared_expert_x, residual}) {
+        if (not addend.has_value()) {
+            continue;
         }
+        EP_HOST_ASSERT(shared_expert_rank_num == 0 and not a2_layered);
+        EP_HOST_ASSERT(addend->dim() == 2 and addend->is_contiguous());
+        EP_HOST_ASSERT(addend->size(0) == topk_idx.size(0) and addend->size(1) == hidden);
+        EP_HOST_ASSERT(addend->scalar_type() == x.scalar_type());
+        combine_addend = combine_addend.defined() ? combine_addend + addend.value() : addend.value();
+    }
+    // The padded rows are stripped from the output again
+    if (combine_addend.defined() and combine_addend.size(0) != num_combined_tokens) {
+        at::Tensor padding = combine_addend.new_zeros({num_combined_tokens - combine_addend.size(0), hidden});
+        combine_addend = torch::cat({combine_addend, padding}, 0);
+    }
+    at::Tensor combined_x;
+    // An empty batch is padded and returns its original input, `out` has no rows to write then
+    if (out.has_value() and not handle.is_padding()) {
+        EP_HOST_ASSERT(out->dim() == 2 and out->is_contiguous());
+        EP_HOST_ASSERT(out->size(0) == num_combined_tokens and out->size(1) == hidden);
+        EP_HOST_ASSERT(out->scalar_type() == x.scalar_type());
+        combined_x = out.value();
+    } else {
+        combined_x = at::empty({num_combined_tokens, hidden}, x.options());
     }
-
     if (soc_version == op::SocVersion::ASCEND910B) {
         comm_alg = "fullmesh";
     } else {
         comm_alg = "fullmesh_v1";
     }
 
-    if (enable_neg_one) {
-        EP_HOST_ASSERT(isLayered == false);
-        x_active_mask = (new_topk_idx >= 0).to(torch::kBool);
+    if (enable_topk_neg_one or rank_elastic_info.defined() or handle.dropped_topk.defined()) {
+        EP_HOST_ASSERT(not a2_layered);
+        x_active_mask = (new_idx >= 0).to(torch::kBool);
     }
 
-    EXEC_NPU_CMD(aclnnMoeDistributeCombineV2, expand_x, expert_ids, expand_idx, ep_send_counts, expert_scales,
-                 tp_send_counts, x_active_mask, activation_scale, weight_scale, group_list, expand_scales,
-                 shared_expert_x, hcom_ep_name, num_ranks, rank, num_experts, hcom_tp_name, tp_world_size, tp_rankId,
-                 expert_shared_type, shared_expert_num, shared_expert_rank_num, global_bs, out_dtype, comm_quant_mode,
-                 group_list_type, comm_alg, combined_x);
-    if (this->is_padding) {
-        if (this->padding_cnt == PADDING_SIZE) {
-            combined_x = this->ori_x;
-        } else {
-            combined_x = combined_x.slice(0, 0, PADDING_SIZE - this->padding_cnt);
-        }
-        is_padding = false;
+    bool split_recv = return_recv_hook and soc_version != op::SocVersion::ASCEND910B;
+    auto launch = [=](int64_t comm_phase) mutable {
+        EXEC_NPU_CMD(aclnnMoeDistributeCombineV2, expand_x, expert_ids, expand_idx, ep_send_counts, expert_scales,
+                     tp_send_counts, x_active_mask, activation_scale, weight_scale, group_list, expand_scales,
+                     combine_addend, rank_elastic_info, hcom_ep_name, num_ranks, rank, num_experts, hcom_tp_name,
+                     tp_world_size, tp_rankId, expert_shared_type, shared_expert_num, shared_expert_rank_num,
+                     global_bs, out_dtype, comm_quant_mode, group_list_type, comm_alg, comm_phase, combined_x);
+    };
+    // Every combine send takes the half after the previous combine send, the dispatch keeps a state of its own
+    uint64_t send_idx = begin_low_latency_send(*low_latency_recv, LowLatencyKernel::COMBINE);
+    launch(split_recv ? COMM_PHASE_SEND : COMM_PHASE_ALL);
+
+    // Wait streams
+    overlap.record_tensors(x, expert_ids, expand_idx, ep_send_counts, expert_scales, tp_send_counts, x_active_mask,
+                           combine_addend, rank_elastic_info, combined_x);
+    std::optional<EventHandle> event = overlap.finish();
+
+    // Receiving hook
+    std::optional<std::function<void()>> recv_hook = std::nullopt;
+    if (return_recv_hook) {
+        recv_hook =
+            make_low_latency_recv_hook(split_recv, low_latency_recv, LowLatencyKernel::COMBINE, send_idx, launch);
     }
-    return {combined_x, event, std::function<void()>([] {})};
+
+    return {strip_padding(handle, combined_x), event, recv_hook};
 }
 
 std::vector<at::Tensor> Buffer::fused_deep_moe(const at::Tensor &x, const at::Tensor &expert_ids,
@@ -1142,15 +1681,58 @@ std::vector<at::Tensor> Buffer::fused_deep_moe(const at::Tensor &x, const at::Te
 {
     EP_HOST_ASSERT(expert_ids.dim() == 2);
     EP_HOST_ASSERT(expert_scales_optional.dim() == 2);
+    // The fused kernel has no `elastic_info` input and selects every routed expert
+    EP_HOST_ASSERT(active_ranks.empty());
+    EP_HOST_ASSERT(expert_capacity == 0 and expert_capacity_factor == 0);
+
+    // The kernel only has the W8A8 path, 0 is taken as 1 as it always was
+    EP_HOST_ASSERT(quant_mode == 0 or quant_mode == 1);
+
+    RoundConfig rounds = get_fused_deep_moe_round_config(num_max_dispatch_tokens_per_rank);
+    if (rounds.round == 1) {
+        return fused_deep_moe_round(x, expert_ids, gmm1_permuted_weight, gmm1_permuted_weight_scale, gmm2_weight,
+                                    gmm2_weight_scale, expert_scales_optional, num_max_dispatch_tokens_per_rank,
+                                    num_experts, quant_mode);
+    }
 
-    this->is_padding = false;
+    // Larger batches run as rounds of the tokens `[r * per_round_tokens, (r + 1) * per_round_tokens)`, the workspace
+    // and the window only hold one round; a rank with fewer tokens launches its empty rounds padded. The launches
+    // share the window and run one after another, nothing of one round overlaps the next. This only removes the cap
+    // on the tokens per rank, a round costs about as much as a call of its own
+    int64_t num_tokens = expert_ids.size(0);
+    EP_HOST_ASSERT(num_tokens <= num_max_dispatch_tokens_per_rank);
+    std::vector<at::Tensor> outputs;
+    at::Tensor ep_recv_count;
+    for (int r = 0; r < rounds.round; ++r) {
+        int64_t begin = std::min<int64_t>(static_cast<int64_t>(r) * rounds.per_round_tokens, num_tokens);
+        int64_t end = std::min<int64_t>(begin + rounds.per_round_tokens, num_tokens);
+        auto round_outputs = fused_deep_moe_round(
+            x.slice(0, begin, end), expert_ids.slice(0, begin, end), gmm1_permuted_weight, gmm1_permuted_weight_scale,
+            gmm2_weight, gmm2_weight_scale, expert_scales_optional.slice(0, begin, end), rounds.per_round_tokens,
+            num_experts, quant_mode);
+        outputs.emplace_back(round_outputs[0]);
+        // Counts and prefix sums alike add up over the rounds
+        ep_recv_count = r == 0 ? round_outputs[1] : ep_recv_count + round_outputs[1];
+    }
+    return {torch::cat(outputs, 0), ep_recv_count};
+}
+
+std::vector<at::Tensor> Buffer::fused_deep_moe_round(const at::Tensor &x, const at::Tensor &expert_ids,
+                                                     const at::Tensor &gmm1_permuted_weight,
+                                                     const at::Tensor &gmm1_permuted_weight_scale,
+                                                     const at::Tensor &gmm2_weight,
+                                                     const at::Tensor &gmm2_weight_scale,
+                                                     const at::Tensor &expert_scales_optional,
+                                                     int64_t num_max_dispatch_tokens_per_rank, int64_t num_experts,
+                                                     int quant_mode)
+{
+    DispatchHandle handle;
     at::Tensor new_x = x;
-    this->new_topk_idx = expert_ids;
+    handle.new_topk_idx = expert_ids;
     at::Tensor new_scales = expert_scales_optional;
 
     if (expert_ids.size(0) < PADDING_SIZE) {
-        this->is_padding = true;
-        this->padding_cnt = PADDING_SIZE - expert_ids.size(0);
+        handle.padding_cnt = PADDING_SIZE - expert_ids.size(0);
 
         std::vector<at::Tensor> x_blocks;
         std::vector<at::Tensor> idx_blocks;
@@ -1159,43 +1741,41 @@ std::vector<at::Tensor> Buffer::fused_deep_moe(const at::Tensor &x, const at::Te
             x_blocks.emplace_back(x);
             idx_blocks.emplace_back(expert_ids);
         } else {
-            this->ori_x = x.clone();  // store the original input when the batch is completely empty
+            handle.ori_x = x.clone();  // store the original input when the batch is completely empty
         }
 
         int topk = static_cast<int>(expert_ids.size(1));
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_x = torch::ones({1, x.size(1)}, x.options());
             at::Tensor tmp_idx = torch::arange(0, topk, expert_ids.options()).reshape({1, topk});
             x_blocks.emplace_back(tmp_x);
             idx_blocks.emplace_back(tmp_idx);
         }
         new_x = torch::cat(x_blocks, 0);
-        this->new_topk_idx = torch::cat(idx_blocks, 0);
+        handle.new_topk_idx = torch::cat(idx_blocks, 0);
 
         // padding expert_scales_optional
         std::vector<at::Tensor> scales_blocks;
-        if (this->padding_cnt != PADDING_SIZE) {
+        if (handle.padding_cnt != PADDING_SIZE) {
             scales_blocks.emplace_back(expert_scales_optional);
         }
-        for (int i = 0; i < this->padding_cnt; i++) {
+        for (int i = 0; i < handle.padding_cnt; i++) {
             at::Tensor tmp_scales = torch::zeros({1, expert_scales_optional.size(1)}, expert_scales_optional.options());
             scales_blocks.emplace_back(tmp_scales);
         }
         new_scales = torch::cat(scales_blocks, 0);
     }
-
-    char hcom_ep_name[128];
-    if (!moe_all_to_all_group_name.empty()) {
-        std::memcpy(hcom_ep_name, moe_all_to_all_group_name.data(), moe_all_to_all_group_name.size() + 1);
-    } else {
-        HCCL_CHECK(HcclGetCommName(ep_comm, hcom_ep_name));
+    // Dispatch and combine run inside one kernel, so the picked replicas never need to be returned
+    if (expert_log2phy.defined()) {
+        EP_HOST_ASSERT(max_physical_expert < num_experts);
+        handle.new_topk_idx = map_to_expert_replicas(handle.new_topk_idx, expert_log2phy, expert_logcnt, rank);
     }
 
-    int64_t global_bs = std::max(new_topk_idx.size(0), num_max_dispatch_tokens_per_rank) * num_ranks;
+    int64_t global_bs = std::max(handle.new_topk_idx.size(0), num_max_dispatch_tokens_per_rank) * num_ranks;
 
     auto x_shape = x.sizes();
     int h = x_shape[1];
-    int bs = this->new_topk_idx.size(0);
+    int bs = handle.new_topk_idx.size(0);
 
     at::Tensor output = at::empty({bs, h}, x.options());
 
@@ -1205,7 +1785,7 @@ std::vector<at::Tensor> Buffer::fused_deep_moe(const at::Tensor &x, const at::Te
 
     EXEC_NPU_CMD(aclnnFusedDeepMoe,
                  // input
-                 new_x, this->new_topk_idx, gmm1_permuted_weight, gmm1_permuted_weight_scale, gmm2_weight,
+                 new_x, handle.new_topk_idx, gmm1_permuted_weight, gmm1_permuted_weight_scale, gmm2_weight,
                  gmm2_weight_scale, static_cast<const std::nullptr_t &>(nullptr), new_scales,
                  // attr
                  hcom_ep_name, num_ranks, rank, num_experts, shared_expert_num, shared_expert_rank_num, quant_mode,
@@ -1214,15 +1794,6 @@ std::vector<at::Tensor> Buffer::fused_deep_moe(const at::Tensor &x, const at::Te
                  output, ep_recv_count);
 
     // ---------- unpadding ----------
-    if (this->is_padding) {
-        if (expert_ids.size(0) == 0) {
-            output = this->ori_x;
-        } else {
-            output = output.slice(0, 0, PADDING_SIZE - this->padding_cnt);
-        }
-        this->is_padding = false;
-    }
-
-    return {output, ep_recv_count};
+    return {strip_padding(handle, output), ep_recv_count};
 }
 }  // namespace deep_ep
@@ -5,15 +5,98 @@
 #include <tuple>
 #include <vector>
 #include <optional>
+#include <array>
+#include <memory>
 #include "hccl/hccl.h"
 #include "hccl/hccl_types.h"
 #include "aclnn/opdev/platform.h"
 
 #include "config.hpp"
 #include "event.hpp"
+#include "low_latency_recv.hpp"
+#include "output_arena.hpp"
 
 namespace deep_ep {
 
+constexpr size_t HCOMM_NAME_LEN = 128;
+// Per-peer costs the normal kernels measure, the rows of the telemetry accumulators
+constexpr int COST_DISPATCH_WAIT_RECV = 0;
+constexpr int COST_COMBINE_SEND = 1;
+constexpr int NUM_COST_KINDS = 2;
+
+struct NPUTensorOps {
+    using Tensor = at::Tensor;
+    using Options = at::TensorOptions;
+
+    static int64_t element_size(const Options &options)
+    {
+        return static_cast<int64_t>(options.dtype().itemsize());
+    }
+
+    static Tensor allocate(int64_t num_bytes, const Options &options)
+    {
+        return at::empty({num_bytes}, options.dtype(at::kByte));
+    }
+
+    static Tensor view(const Tensor &storage, int64_t byte_offset, const std::vector<int64_t> &sizes,
+                       const Options &options)
+    {
+        int64_t num_bytes = element_size(options);
+        for (int64_t size : sizes) {
+            num_bytes *= size;
+        }
+        return storage.narrow(0, byte_offset, num_bytes).view(options.dtype().toScalarType()).view(sizes);
+    }
+};
+
+using TensorArena = OutputArena<NPUTensorOps>;
+
+// Notify results of an intranode dispatch, a cached dispatch with the same routing reuses them instead of running
+// the notify all-to-all again
+struct NotifyLayout {
+    at::Tensor send_data_offset;
+    at::Tensor recv_offset;
+    at::Tensor recv_count;
+    at::Tensor expert_global_offset;
+    at::Tensor srcrank_in_expert_offset;
+    at::Tensor r_in_srcrank_offset;
+    at::Tensor recv_tokens_per_expert;
+    int64_t num_recv_tokens = 0;
+    std::vector<int> num_recv_tokens_per_expert_list;  // Empty for a sync-free dispatch
+
+    bool defined() const
+    {
+        return recv_offset.defined();
+    }
+};
+
+// Per-call state produced by `get_dispatch_layout` or a dispatch and consumed by the matching dispatch or combine.
+// Keeping it out of `Buffer` lets several dispatch/combine pairs be in flight on one buffer.
+struct DispatchHandle {
+    int padding_cnt = 0;              // Rows appended to an empty batch, 0 if the batch was not padded
+    at::Tensor ori_x;                 // The original input of an empty batch, returned as is by combine
+    at::Tensor new_topk_idx;          // topk_idx after padding, and after replica selection if mapped
+    at::Tensor notify_send_data;      // only for internode notify
+    int notify_send_data_size = 0;    // only for internode notify
+    at::Tensor send_token_idx_small;  // The order in which each token is sent to its experts
+    int64_t real_max_bs = 0;          // Max batch size over all ranks, used by the normal combine
+    int64_t num_max_tokens = 0;       // The largest batch over the ranks given to `get_dispatch_layout`, 0 if unknown
+    NotifyLayout notify;              // Set by the intranode dispatch, reused by a cached dispatch
+    bool mapped_topk_idx = false;     // new_topk_idx holds the physical replicas picked for logical expert ids
+    bool capped_topk_idx = false;     // new_topk_idx holds -1 for the entries over the expert capacity
+    int low_latency_buffer_idx = -1;  // The arena copy a low-latency dispatch received into, -1 for other paths
+    int64_t num_max_recv_tokens = 0;  // Rows of the packed low-latency receive tensors
+    int32_t round = 1;                // Rounds of the normal dispatch, picked by `get_dispatch_layout`
+    int32_t per_round_tokens = MAX_TOKENS_PER_ROUND;
+    at::Tensor elastic_info;          // The active ranks a low-latency dispatch sent to, undefined if all of them
+    at::Tensor dropped_topk;          // [num_tokens, num_topk] bool, entries over the expert capacity, or undefined
+
+    bool is_padding() const
+    {
+        return padding_cnt > 0;
+    }
+};
+
 struct Buffer {
     int32_t rank, rdma_rank, nvl_rank;
     int32_t num_ranks, num_rdma_ranks, num_nvl_ranks;
@@ -22,31 +105,88 @@ struct Buffer {
     int64_t num_nvl_bytes;
     int64_t num_rdma_bytes;
 
+    // Rounds set by `DEEPEP_NORMAL_LONG_SEQ_*`, without them every layout picks its own rounds
     int32_t round;
     int32_t per_round_tokens;
+    bool auto_round = true;
+    size_t hccl_window_bytes = 0;
     bool combine_enable_long_seq = false;  // Whether to enable the Combine Ant Migration feature
 
     bool low_latency_mode = false;
-    bool is_padding = false;
-    int padding_cnt = 0;
-    at::Tensor ori_x;
-    at::Tensor new_topk_idx;
-    at::Tensor new_scales;
-    at::Tensor notify_send_data;  // only for internode notify
-    at::Tensor send_token_idx_small;
-    int notify_send_data_size;  // only for internode notify
 
     int32_t shared_expert_rank_num;
     int32_t shared_expert_num = 1;
-    int64_t real_max_bs;
 
 private:
     std::string moe_all_to_all_group_name;
+    // The group name every kernel takes, resolved once so launches skip HcclGetCommName
+    char hcom_ep_name[HCOMM_NAME_LEN] = {0};
+
+    // Environment switches of the hot path, read by the constructor and again only by `reconfigure`
+    int expert_token_nums_type = 1;    // MOE_EXPERT_TOKEN_NUMS_TYPE, 1: tokens per expert, 0: their prefix sums
+    bool enable_topk_neg_one = false;  // MOE_ENABLE_TOPK_NEG_ONE, low-latency tokens may select no expert
+    bool a2_layered = false;           // HCCL_INTRA_PCIE_ENABLE=1 with HCCL_INTRA_ROCE_ENABLE=0 on A2
 
     int device_id;
 
     HcclComm ep_comm;
 
+    // Stream for communication
+    c10_npu::NPUStream comm_stream;
+
+    // Scratch and low-latency outputs reused across calls, and the low-latency copy the next dispatch writes
+    TensorArena arena;
+    int low_latency_buffer_idx = 0;
+    // Split low-latency launches whose receive hook has not run yet, the hooks only hold it weakly
+    std::shared_ptr<LowLatencyRecvState> low_latency_recv = std::make_shared<LowLatencyRecvState>();
+    // The last combine input handed out for each copy, a zero-copy combine must be given exactly this tensor
+    std::array<at::Tensor, 2> low_latency_combine_buffers;
+
+    // Logical-to-physical expert replicas set by `set_expert_replicas`, undefined while topk_idx holds physical ids
+    at::Tensor expert_log2phy;  // [num_logical_experts, max_replicas], int32
+    at::Tensor expert_logcnt;   // [num_logical_experts], int32
+    int64_t expert_replica_policy = 0;
+    int64_t max_physical_expert = -1;
+
+    // Entries every expert takes from the whole group, set by `set_expert_capacity`, 0 for none
+    int64_t expert_capacity = 0;
+    double expert_capacity_factor = 0;
+
+    // Drops the entries of `topk_idx` over this rank's quota of the expert capacity, lowest weight first, reports
+    // them in `handle.dropped_topk` and returns the kept ones. The quotas are split from `expert_counts`, the top-k
+    // entries every rank routes to every expert, gathered over the group by the caller
+    at::Tensor apply_expert_capacity(DispatchHandle &handle, const at::Tensor &topk_idx, int64_t num_experts,
+                                     const std::optional<at::Tensor> &topk_weights,
+                                     const std::optional<at::Tensor> &expert_counts);
+
+    // Ranks left in the low-latency group by `set_active_ranks`, empty while every rank takes part
+    std::vector<bool> active_ranks;
+    at::Tensor elastic_info;  // `get_elastic_info` of `active_ranks` on the device, built for `elastic_num_experts`
+    int64_t elastic_num_experts = -1;
+
+    // Maps expert ids to the compact experts of the active ranks, the experts of inactive ranks become -1
+    at::Tensor get_elastic_topk_idx(const at::Tensor &topk_idx, int64_t num_experts);
+
+    // Per-peer cost telemetry of the normal kernels, accumulated on the comm stream while enabled
+    bool telemetry_enabled = false;
+    at::Tensor cost_totals;     // [NUM_COST_KINDS, num_ranks], int64, microseconds summed over the calls
+    at::Tensor cost_histogram;  // [NUM_COST_KINDS, num_ranks, NUM_COST_BUCKETS], int64, calls per cost bucket
+    std::array<int64_t, NUM_COST_KINDS> cost_calls{};
+
+    // Returns the tensor a normal kernel writes the costs of one call into, zeroed as the kernels add into it
+    at::Tensor get_cost_stats_out(const std::optional<at::Tensor> &cost_stats);
+    // Adds the costs of one call to the telemetry and to the caller's tensor, on the current (comm) stream
+    void record_cost_stats(int kind, const at::Tensor &cost_stats_out, const std::optional<at::Tensor> &cost_stats);
+
+    // One launch of the fused kernel, for at most `FUSED_DEEP_MOE_MAX_TOKENS` tokens of every rank
+    std::vector<at::Tensor> fused_deep_moe_round(const at::Tensor &x, const at::Tensor &expert_ids,
+                                                 const at::Tensor &gmm1_permuted_weight,
+                                                 const at::Tensor &gmm1_permuted_weight_scale,
+                                                 const at::Tensor &gmm2_weight, const at::Tensor &gmm2_weight_scale,
+                                                 const at::Tensor &expert_scales_optional,
+                                                 int64_t num_max_dispatch_tokens_per_rank, int64_t num_experts,
+                                                 int quant_mode);
+
     bool available = false;
 
 public:
@@ -57,25 +197,51 @@ public:
 
     bool is_available() const;
 
+    // Whether `get_dispatch_layout` picks the rounds from `num_max_tokens`, which must then agree over the ranks
+    bool is_auto_round() const;
+
+    // 1 if the low-latency dispatch returns the tokens of every local expert, 0 if it returns their prefix sums
+    int get_expert_token_nums_type() const;
+
     int get_num_rdma_ranks() const;
 
     int get_rdma_rank() const;
 
-    std::tuple<torch::Tensor, std::optional<torch::Tensor>, torch::Tensor, torch::Tensor, std::optional<EventHandle>>
-    get_dispatch_layout(const torch::Tensor &topk_idx, int num_experts, std::optional<EventHandle> &previous_event,
-                        bool async, bool allocate_on_comm_stream);
+    torch::Stream get_comm_stream() const;
+
+    void reconfigure();
+
+    void set_expert_replicas(const std::optional<at::Tensor> &log2phy, const std::optional<at::Tensor> &logcnt,
+                             int64_t policy);
+
+    void set_expert_capacity(int64_t capacity, double capacity_factor);
 
-    torch::Tensor get_notify_send_data();
+    // Restricts the low-latency dispatch and combine to the ranks set in `active_mask`, all ranks if it is empty
+    void set_active_ranks(const std::optional<at::Tensor> &active_mask);
+
+    void set_telemetry(bool enable);
+
+    // Device copies of the cost totals and histogram with the number of calls behind every kind, `reset` clears them
+    std::tuple<at::Tensor, at::Tensor, std::vector<int64_t>> get_telemetry(bool reset);
+
+    std::tuple<torch::Tensor, std::optional<torch::Tensor>, torch::Tensor, torch::Tensor, DispatchHandle,
+               std::optional<EventHandle>>
+    get_dispatch_layout(const torch::Tensor &topk_idx, int num_experts, int64_t num_max_tokens, int hidden,
+                        std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream,
+                        const std::optional<at::Tensor> &topk_weights, const std::optional<at::Tensor> &expert_counts);
 
     std::tuple<at::Tensor, std::optional<at::Tensor>, std::optional<at::Tensor>, std::optional<at::Tensor>,
-               std::vector<int>, at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tensor, std::optional<EventHandle>>
+               std::vector<int>, std::optional<at::Tensor>, at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tensor,
+               DispatchHandle, std::optional<EventHandle>>
     intranode_dispatch(const at::Tensor &x, const std::optional<at::Tensor> &x_scales,
                        const std::optional<at::Tensor> &topk_idx, const std::optional<at::Tensor> &topk_weights,
                        const std::optional<at::Tensor> &num_tokens_per_rank, const at::Tensor &is_token_in_rank,
-                       const std::optional<at::Tensor> &num_tokens_per_expert, int cached_num_recv_tokens,
+                       const std::optional<at::Tensor> &num_tokens_per_expert, const DispatchHandle &layout,
+                       int cached_num_recv_tokens,
                        const std::optional<at::Tensor> &cached_rank_prefix_matrix,
                        const std::optional<at::Tensor> &cached_channel_prefix_matrix,
-                       const std::optional<at::Tensor> &dispatch_wait_recv_cost_stats, int expert_alignment,
+                       const std::optional<at::Tensor> &dispatch_wait_recv_cost_stats,
+                       const std::optional<at::Tensor> &cumulative_local_expert_recv_stats, int expert_alignment,
                        int num_worst_tokens, const Config &config, std::optional<EventHandle> &previous_event,
                        bool async, bool allocate_on_comm_stream, bool use_quant);
 
@@ -84,7 +250,8 @@ public:
     notify_verify(const at::Tensor &x, const std::optional<at::Tensor> &x_scales,
                   const std::optional<at::Tensor> &topk_idx, const std::optional<at::Tensor> &topk_weights,
                   const std::optional<at::Tensor> &num_tokens_per_rank, const at::Tensor &is_token_in_rank,
-                  const std::optional<at::Tensor> &num_tokens_per_expert, int cached_num_recv_tokens,
+                  const std::optional<at::Tensor> &num_tokens_per_expert, const DispatchHandle &layout,
+                  int cached_num_recv_tokens,
                   const std::optional<at::Tensor> &cached_rank_prefix_matrix,
                   const std::optional<at::Tensor> &cached_channel_prefix_matrix,
                   const std::optional<at::Tensor> &dispatch_wait_recv_cost_stats, int expert_alignment,
@@ -93,39 +260,48 @@ public:
 
     void clean_low_latency_buffer(int num_max_dispatch_tokens_per_rank, int hidden, int num_experts);
 
+    at::Tensor get_next_low_latency_combine_buffer(const DispatchHandle &handle, int64_t hidden);
+
     std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<EventHandle>>
     intranode_combine(const torch::Tensor &x, const torch::Tensor &topk_idx,
                       const std::optional<torch::Tensor> &topk_weights, const torch::Tensor &src_idx,
-                      const torch::Tensor &send_head, const std::optional<at::Tensor> &combine_send_cost_stats);
+                      const torch::Tensor &send_head, const DispatchHandle &handle,
+                      const std::optional<at::Tensor> &combine_send_cost_stats,
+                      std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream);
 
     std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<torch::Tensor>, std::optional<torch::Tensor>,
                std::vector<int>, torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor, torch::Tensor,
-               torch::Tensor, std::optional<EventHandle>>
+               torch::Tensor, DispatchHandle, std::optional<EventHandle>>
     internode_dispatch(const torch::Tensor &x, const std::optional<torch::Tensor> &x_scales,
                        const std::optional<torch::Tensor> &topk_idx, const std::optional<torch::Tensor> &topk_weights,
                        const std::optional<torch::Tensor> &num_tokens_per_rank,
                        const std::optional<torch::Tensor> &num_tokens_per_rdma_rank,
                        const torch::Tensor &is_token_in_rank, const std::optional<torch::Tensor> &num_tokens_per_expert,
-                       const Config &config, std::optional<EventHandle> &previous_event, bool async,
-                       bool allocate_on_comm_stream, bool use_quant);
+                       const DispatchHandle &layout, const Config &config,
+                       std::optional<EventHandle> &previous_event, bool async, bool allocate_on_comm_stream,
+                       bool use_quant);
 
     std::tuple<torch::Tensor, std::optional<torch::Tensor>, std::optional<EventHandle>> internode_combine(
         const torch::Tensor &x, const torch::Tensor &topk_idx, const std::optional<torch::Tensor> &topk_weights,
         const torch::Tensor &src_idx, const torch::Tensor &send_head, const torch::Tensor &offsetInner,
-        const torch::Tensor &offsetOuter, const torch::Tensor &countOuter, const torch::Tensor &expand_scales);
+        const torch::Tensor &offsetOuter, const torch::Tensor &countOuter, const torch::Tensor &expand_scales,
+        const DispatchHandle &handle, std::optional<EventHandle> &previous_event, bool async,
+        bool allocate_on_comm_stream);
 
-    std::tuple<at::Tensor, std::optional<at::Tensor>, at::Tensor, at::Tensor, at::Tensor, std::optional<EventHandle>,
-               std::optional<std::function<void()>>>
+    std::tuple<at::Tensor, std::optional<at::Tensor>, at::Tensor, at::Tensor, at::Tensor, DispatchHandle,
+               std::optional<EventHandle>, std::optional<std::function<void()>>>
     low_latency_dispatch(const at::Tensor &x, const at::Tensor &topk_idx,
                          const std::optional<at::Tensor> &cumulative_local_expert_recv_stats,
                          int64_t num_max_dispatch_tokens_per_rank, int64_t num_experts, bool use_fp8, bool round_scale,
-                         bool use_ue8m0, bool async, bool return_recv_hook);
+                         bool use_ue8m0, bool use_block_scales, bool async, bool return_recv_hook,
+                         const std::optional<at::Tensor> &topk_weights, const std::optional<at::Tensor> &expert_counts);
 
     std::tuple<at::Tensor, std::optional<EventHandle>, std::optional<std::function<void()>>> low_latency_combine(
         const at::Tensor &x, const at::Tensor &topk_idx, const at::Tensor &topk_weights, const at::Tensor &src_info,
         const at::Tensor &layout_range, int64_t num_max_dispatch_tokens_per_rank, int64_t num_experts,
-        const at::Tensor &packed_recv_count, bool zero_copy, bool async, bool return_recv_hook,
-        const std::optional<at::Tensor> &out);
+        const at::Tensor &packed_recv_count, const DispatchHandle &handle, bool use_int8, bool int8_block_scaled,
+        bool zero_copy, bool async, bool return_recv_hook, const std::optional<at::Tensor> &out,
+        const std::optional<at::Tensor> &shared_expert_x, const std::optional<at::Tensor> &residual);
 
     std::vector<at::Tensor> fused_deep_moe(const at::Tensor &x, const at::Tensor &expertIds,
                                            const at::Tensor &gmm1PermutedWeight,
@@ -1,16 +1,76 @@
 #pragma once
 #include <memory>
+#include <optional>
+#include <ATen/ATen.h>
+#include "torch_npu/csrc/core/npu/NPUStream.h"
+#include "torch_npu/csrc/core/npu/NPUEvent.h"
+
+#include "stream_overlap.hpp"
 
 namespace deep_ep {
 
 struct EventHandle {
-    EventHandle() {}
+    std::shared_ptr<c10_npu::NPUEvent> event;
+
+    EventHandle()
+    {
+        event = std::make_shared<c10_npu::NPUEvent>();
+        event->record(c10_npu::getCurrentNPUStream());
+    }
+
+    explicit EventHandle(const c10_npu::NPUStream &stream)
+    {
+        event = std::make_shared<c10_npu::NPUEvent>();
+        event->record(stream);
+    }
 
     EventHandle(const EventHandle &other) = default;
 
     void current_stream_wait() const
     {
-        return;
+        event->block(c10_npu::getCurrentNPUStream());
     }
 };
+
+struct NPUStreamOps {
+    using Stream = c10_npu::NPUStream;
+    using Event = EventHandle;
+
+    static Stream current()
+    {
+        return c10_npu::getCurrentNPUStream();
+    }
+
+    static void set_current(const Stream &stream)
+    {
+        c10_npu::setCurrentNPUStream(stream);
+    }
+
+    static Event record(const Stream &stream)
+    {
+        return EventHandle(stream);
+    }
+
+    static void wait(const Stream &stream, const Event &event)
+    {
+        event.event->block(stream);
+    }
+
+    static void record_tensor(const at::Tensor &tensor, const Stream &stream)
+    {
+        if (tensor.defined()) {
+            tensor.record_stream(stream.unwrap());
+        }
+    }
+
+    static void record_tensor(const std::optional<at::Tensor> &tensor, const Stream &stream)
+    {
+        if (tensor.has_value()) {
+            record_tensor(tensor.value(), stream);
+        }
+    }
+};
+
+using CommStreamOverlap = StreamOverlap<NPUStreamOps>;
+
 }  // namespace deep_ep
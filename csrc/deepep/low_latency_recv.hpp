@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "exception.hpp"
+
+namespace deep_ep {
+
+// commPhase attribute of the low-latency dispatch/combine kernels
+constexpr int64_t COMM_PHASE_ALL = 0;
+constexpr int64_t COMM_PHASE_SEND = 1;
+constexpr int64_t COMM_PHASE_RECV = 2;
+constexpr int64_t COMM_PHASE_RECV_PREV = 3;
+
+// The low-latency kernels with a window state of their own, the dispatch and the combine flip separate state words
+enum class LowLatencyKernel : int {
+    DISPATCH = 0,
+    COMBINE = 1,
+    COUNT = 2,
+};
+
+// Receive hooks of the split low-latency launches. Every send of a kernel flips that kernel's window state, so its send
+// `n` holds half `n % 2` until its hook runs and at most one send per half of each kernel is in flight
+struct LowLatencyRecvState {
+    struct KernelSends {
+        uint64_t num_sends = 0;
+        std::array<bool, 2> pending = {false, false};
+    };
+    std::array<KernelSends, static_cast<int>(LowLatencyKernel::COUNT)> kernels;
+
+    KernelSends &of(LowLatencyKernel kernel)
+    {
+        return kernels[static_cast<int>(kernel)];
+    }
+
+    bool any_pending() const
+    {
+        for (const auto &sends : kernels) {
+            if (sends.pending[0] or sends.pending[1]) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Claims the window half of the next send of `kernel`, which must not still hold a send whose receive hook is pending
+inline uint64_t begin_low_latency_send(LowLatencyRecvState &state, LowLatencyKernel kernel)
+{
+    auto &sends = state.of(kernel);
+    uint64_t send_idx = sends.num_sends++;
+    EP_HOST_ASSERT(not sends.pending[send_idx % 2]);
+    return send_idx;
+}
+
+// Builds the hook returned by a low-latency launch. For a split launch it issues the receive phase of send `send_idx`
+// of `kernel`, `launch(comm_phase)` runs the kernel on the current stream. The hook holds the state weakly, so it
+// fails instead of launching once the Buffer is freed
+template <typename Launch>
+std::function<void()> make_low_latency_recv_hook(bool split_recv, const std::shared_ptr<LowLatencyRecvState> &state,
+                                                 LowLatencyKernel kernel, uint64_t send_idx, Launch launch)
+{
+    if (not split_recv) {
+        return [] {};
+    }
+    state->of(kernel).pending[send_idx % 2] = true;
+    std::weak_ptr<LowLatencyRecvState> weak_state = state;
+    return [weak_state, kernel, send_idx, launch]() mutable {
+        auto state = weak_state.lock();
+        EP_HOST_ASSERT(state != nullptr);
+        auto &sends = state->of(kernel);
+        EP_HOST_ASSERT(sends.pending[send_idx % 2]);
+        // A later send of the same kernel flipped its state back to the other half, which is still the one of this
+        // send. Sends of the other kernel leave this state alone
+        uint64_t later_sends = sends.num_sends - send_idx - 1;
+        EP_HOST_ASSERT(later_sends <= 1);
+        launch(later_sends == 0 ? COMM_PHASE_RECV : COMM_PHASE_RECV_PREV);
+        sends.pending[send_idx % 2] = false;
+    };
+}
+
+}  // namespace deep_ep
@@ -46,6 +46,7 @@ constexpr uint32_t ATTR_RANK_ID_INDEX = 6;
 const int64_t MAX_COMM_WORLD_SIZE = 384;
 const int64_t MAX_MOE_EXPERTS_NUM = 512;
 const int64_t MAX_LOCAL_RANKSIZE = 8;
+const int64_t MAX_BATCH_SIZE_A2 = 4096;
 
 constexpr uint32_t SYSTEM_NEED_WORKSPACE = 16 * 1024 * 1024;
 constexpr uint32_t KERNEL_USE_WORKSPACE = 1 * 1024 * 1024;
@@ -131,6 +132,13 @@ static ge::graphStatus GetAttrAndSetTilingData(gert::TilingContext *context, con
             OP_LOGE(nodeName, "localRankSizePtr is invalid, only support (0, %ld], but got localRankSize=%ld.",
                     MAX_LOCAL_RANKSIZE, *localRankSizePtr),
             return ge::GRAPH_FAILED);
+        // Across nodes notifySendData is laid out for perRoundTokens tokens, the single round of the two-level kernels
+        OP_TILING_CHECK(
+            (*numRanksPtr > *localRankSizePtr) &&
+                ((*perRoundTokensPtr < *numTokensPtr) || (*perRoundTokensPtr > MAX_BATCH_SIZE_A2)),
+            OP_LOGE(nodeName, "perRoundTokens is invalid, only support [%ld, %ld], but got perRoundTokens=%ld.",
+                    *numTokensPtr, MAX_BATCH_SIZE_A2, *perRoundTokensPtr),
+            return ge::GRAPH_FAILED);
     }
 
     tilingData.dispatchLayoutInfo.numTokens = static_cast<uint32_t>(*numTokensPtr);
@@ -67,8 +67,10 @@ constexpr uint32_t ATTR_COMM_ALG_INDEX = 14;
 constexpr uint32_t ATTR_ZERO_EXPERT_NUM_INDEX = 15;
 constexpr uint32_t ATTR_COPY_EXPERT_NUM_INDEX = 16;
 constexpr uint32_t ATTR_CONST_EXPERT_NUM_INDEX = 17;
+constexpr uint32_t ATTR_COMM_PHASE_INDEX = 18;
 
-constexpr uint32_t INT8_COMM_QUANT = 2U;
+constexpr uint32_t INT8_COMM_QUANT = 2U;        // int8 with one scale per 8 channels
+constexpr uint32_t INT8_TOKEN_COMM_QUANT = 3U;  // int8 with one scale per token
 constexpr uint64_t INIT_TILINGKEY = 10000;
 constexpr uint64_t TILINGKEY_TP_WORLD_SIZE = 100;
 constexpr uint64_t TP_WORLD_SIZE_TWO = 2;
@@ -92,6 +94,7 @@ constexpr int64_t MIN_EP_WORLD_SIZE = 2;
 constexpr int64_t EP_RESTRICT_8 = 8;
 constexpr int64_t MAX_TP_WORLD_SIZE = 2;
 constexpr int64_t BS_UPPER_BOUND = 512;
+constexpr int64_t MAX_COMM_PHASE = 3;  // 0: send and receive, 1: send only, 2/3: receive only
 
 constexpr size_t SYSTEM_NEED_WORKSPACE = 16UL * 1024UL * 1024UL;
 constexpr size_t MASK_CALC_NEED_WORKSPACE = 10UL * 1024UL;
@@ -159,6 +162,7 @@ static ge::graphStatus GetAttrAndSetTilingData(const gert::TilingContext *contex
     auto zeroExpertNumPtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_ZERO_EXPERT_NUM_INDEX));
     auto copyExpertNumPtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_COPY_EXPERT_NUM_INDEX));
     auto constExpertNumPtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_CONST_EXPERT_NUM_INDEX));
+    auto commPhasePtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_COMM_PHASE_INDEX));
 
     // 判空
     OP_TILING_CHECK((groupEpPtr == nullptr) || (strnlen(groupEpPtr, MAX_GROUP_NAME_LENGTH) == 0) ||
@@ -179,6 +183,7 @@ static ge::graphStatus GetAttrAndSetTilingData(const gert::TilingContext *contex
     OP_TILING_CHECK(copyExpertNumPtr == nullptr, OP_LOGE(nodeName, "copyExpertNum is null."), return ge::GRAPH_FAILED);
     OP_TILING_CHECK(constExpertNumPtr == nullptr, OP_LOGE(nodeName, "constExpertNum is null."),
                     return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(commPhasePtr == nullptr, OP_LOGE(nodeName, "commPhase is null."), return ge::GRAPH_FAILED);
 
     // 判断是否满足uint32_t及其他限制
     int64_t moeExpertNum = *moeExpertNumPtr;
@@ -252,10 +257,17 @@ static ge::graphStatus GetAttrAndSetTilingData(const gert::TilingContext *contex
                             MOE_EXPERT_MAX_NUM, moeExpertNum),
                     return ge::GRAPH_FAILED);
     OP_TILING_CHECK(
-        (*commQuantModePtr != 0) && (*commQuantModePtr != INT8_COMM_QUANT),
-        OP_LOGE(nodeName, "commQuantMode only support 0(default) or 2(int8 comm quant), but got commQuantMode=%ld.",
+        (*commQuantModePtr != 0) && (*commQuantModePtr != INT8_COMM_QUANT) &&
+            (*commQuantModePtr != INT8_TOKEN_COMM_QUANT),
+        OP_LOGE(nodeName,
+                "commQuantMode only support 0(default), 2(int8 comm quant) or 3(int8 per-token comm quant), "
+                "but got commQuantMode=%ld.",
                 *commQuantModePtr),
         return ge::GRAPH_FAILED);
+    OP_TILING_CHECK((*commPhasePtr < 0) || (*commPhasePtr > MAX_COMM_PHASE),
+                    OP_LOGE(nodeName, "commPhase is invalid, only support [0, %ld], but got commPhase=%ld.",
+                            MAX_COMM_PHASE, *commPhasePtr),
+                    return ge::GRAPH_FAILED);
 
     commQuantMode = static_cast<uint32_t>(*commQuantModePtr);
     groupEp = std::string(groupEpPtr);
@@ -275,6 +287,8 @@ static ge::graphStatus GetAttrAndSetTilingData(const gert::TilingContext *contex
     tilingData.moeDistributeCombineV2Info.zeroExpertNum = static_cast<uint32_t>(zeroExpertNum);
     tilingData.moeDistributeCombineV2Info.copyExpertNum = static_cast<uint32_t>(copyExpertNum);
     tilingData.moeDistributeCombineV2Info.constExpertNum = static_cast<uint32_t>(constExpertNum);
+    tilingData.moeDistributeCombineV2Info.commPhase = static_cast<uint32_t>(*commPhasePtr);
+    tilingData.moeDistributeCombineV2Info.commQuantMode = commQuantMode;
 
     return ge::GRAPH_SUCCESS;
 }
@@ -1064,7 +1078,7 @@ static void CalTilingKey(uint64_t &tilingKey, const uint64_t tpWorldSize, uint32
     if (tpWorldSize == TP_WORLD_SIZE_TWO) {
         tilingKey += TILINGKEY_TP_WORLD_SIZE;
     }
-    if (commQuantMode == INT8_COMM_QUANT) {
+    if ((commQuantMode == INT8_COMM_QUANT) || (commQuantMode == INT8_TOKEN_COMM_QUANT)) {
         tilingKey += TILINGKEY_INT8_COMM_QUANT;
     }
 }
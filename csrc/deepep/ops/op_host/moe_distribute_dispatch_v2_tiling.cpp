@@ -36,12 +36,16 @@ constexpr uint32_t EXPERT_IDS_INDEX = 1U;
 constexpr uint32_t SCALES_INDEX = 2U;
 constexpr uint32_t X_ACTIVE_MASK_INDEX = 3U;
 constexpr uint32_t ELASTIC_INFO_INDEX = 4U;
+constexpr uint32_t EXPERT_LOG2PHY_INDEX = 5U;
+constexpr uint32_t EXPERT_LOGCNT_INDEX = 6U;
 constexpr uint32_t OUTPUT_EXPAND_X_INDEX = 0U;
 constexpr uint32_t OUTPUT_DYNAMIC_SCALES_INDEX = 1U;
 constexpr uint32_t OUTPUT_ASSIST_INFO_INDEX = 2U;
 constexpr uint32_t OUTPUT_EXPERT_TOKEN_NUMS_INDEX = 3U;
 constexpr uint32_t OUTPUT_EP_RECV_COUNTS_INDEX = 4U;
 constexpr uint32_t OUTPUT_TP_RECV_COUNTS_INDEX = 5U;
+constexpr uint32_t OUTPUT_EXPERT_RECV_STATS_INDEX = 6U;
+constexpr uint32_t OUTPUT_PHYSICAL_EXPERT_IDS_INDEX = 7U;
 
 constexpr uint32_t ATTR_GROUP_EP_INDEX = 0;
 constexpr uint32_t ATTR_EP_WORLD_SIZE_INDEX = 1;
@@ -60,18 +64,24 @@ constexpr uint32_t ATTR_COMM_ALG_INDEX = 13;
 constexpr uint32_t ATTR_ZERO_EXPERT_NUM_INDEX = 14;
 constexpr uint32_t ATTR_COPY_EXPERT_NUM_INDEX = 15;
 constexpr uint32_t ATTR_CONST_EXPERT_NUM_INDEX = 16;
+constexpr uint32_t ATTR_COMM_PHASE_INDEX = 17;
+constexpr uint32_t ATTR_REPLICA_POLICY_INDEX = 18;
 
 constexpr uint32_t TWO_DIMS = 2;
 constexpr uint32_t ONE_DIM = 1;
 constexpr uint32_t DYN_SCALE_DIMS = 1;
 constexpr uint32_t ASSIST_INFO_DIMS = 1;
 constexpr uint32_t DYNAMIC_SCALE_DIM_NUM = 1;
+constexpr uint32_t DYNAMIC_GROUP_SCALE_DIM_NUM = 2;
 constexpr uint64_t INIT_TILINGKEY = 10000;
 constexpr uint32_t ARR_LENGTH = 128;
 constexpr uint32_t OP_TYPE_ALL_TO_ALL = 8;
 constexpr uint32_t NO_SCALES = 0;
 constexpr uint32_t STATIC_SCALES = 1;
 constexpr uint32_t DYNAMIC_SCALES = 2;
+constexpr uint32_t DYNAMIC_GROUP_SCALES = 3;       // 每QUANT_GROUP_SIZE个通道一个动态scale
+constexpr uint32_t DYNAMIC_GROUP_POW2_SCALES = 4;  // 同上，scale向上取整到2的幂
+constexpr int64_t QUANT_GROUP_SIZE = 128;
 constexpr uint32_t OP_TYPE_ALL_GATHER = 6;
 
 constexpr uint32_t UNQUANT_MODE = 0;
@@ -84,6 +94,12 @@ constexpr int64_t MIN_EP_WORLD_SIZE = 2;
 constexpr int64_t EP_RESTRICT_8 = 8;
 constexpr int64_t MAX_TP_WORLD_SIZE = 2;
 constexpr int64_t BS_UPPER_BOUND = 512;
+constexpr int64_t MAX_COMM_PHASE = 3;  // 0: send and receive, 1: send only, 2/3: receive only
+constexpr int64_t MAX_REPLICA_POLICY = 1;         // 0: 按token轮询, 1: 本卡负载最少的副本
+constexpr int64_t MAX_REPLICA_TABLE_SIZE = 2048;  // 副本表常驻UB，限制[逻辑专家数, 最大副本数]的元素个数
+constexpr uint32_t RECV_STATS_NONE = 0;
+constexpr uint32_t RECV_STATS_PER_EXPERT = 1;    // expertRecvStats为[本卡专家数]
+constexpr uint32_t RECV_STATS_PER_SRC_RANK = 2;  // expertRecvStats为[本卡专家数, epWorldSize]
 
 constexpr uint64_t NUM_10 = 10ULL;
 constexpr uint32_t TILINGKEY_SCALES = 10;
@@ -133,6 +149,22 @@ static void PrintTilingDataInfo(const char *nodeName, MoeDistributeDispatchV2Til
     OP_LOGD(nodeName, "hasElastic is %d.", tilingData.moeDistributeDispatchV2Info.hasElasticInfo);
     OP_LOGD(nodeName, "zeroComputeExpertNum is %d", tilingData.moeDistributeDispatchV2Info.zeroComputeExpertNum);
     OP_LOGD(nodeName, "cumSumUBMinValue is %d", tilingData.moeDistributeDispatchV2Info.cumSumUBMinValue);
+    OP_LOGD(nodeName, "commPhase is %u", tilingData.moeDistributeDispatchV2Info.commPhase);
+    OP_LOGD(nodeName, "expertRecvStatsMode is %u", tilingData.moeDistributeDispatchV2Info.expertRecvStatsMode);
+    OP_LOGD(nodeName, "logicalExpertNum is %u", tilingData.moeDistributeDispatchV2Info.logicalExpertNum);
+    OP_LOGD(nodeName, "maxReplicaNum is %u", tilingData.moeDistributeDispatchV2Info.maxReplicaNum);
+    OP_LOGD(nodeName, "replicaPolicy is %u", tilingData.moeDistributeDispatchV2Info.replicaPolicy);
+}
+
+static bool IsDynamicQuant(const uint32_t quantMode)
+{
+    return (quantMode == DYNAMIC_SCALES) || (quantMode == DYNAMIC_GROUP_SCALES) ||
+           (quantMode == DYNAMIC_GROUP_POW2_SCALES);
+}
+
+static bool IsGroupQuant(const uint32_t quantMode)
+{
+    return (quantMode == DYNAMIC_GROUP_SCALES) || (quantMode == DYNAMIC_GROUP_POW2_SCALES);
 }
 
 static bool CheckTensorDim(const gert::TilingContext *context, const char *nodeName, const bool isScales,
@@ -210,13 +242,14 @@ static bool CheckTensorDim(const gert::TilingContext *context, const char *nodeN
     OP_LOGD(nodeName, "expandX dim0 = %ld", expandXStorageShape->GetStorageShape().GetDim(0));
     OP_LOGD(nodeName, "expandX dim1 = %ld", expandXStorageShape->GetStorageShape().GetDim(1));
 
-    if (quantMode == DYNAMIC_SCALES) {
+    if (IsDynamicQuant(quantMode)) {
         const gert::StorageShape *dynamicScalesStorageShape = context->GetOutputShape(OUTPUT_DYNAMIC_SCALES_INDEX);
         OP_TILING_CHECK(dynamicScalesStorageShape == nullptr, OP_LOGE(nodeName, "dynamicScalesShape is null."),
                         return false);
-        OP_TILING_CHECK(dynamicScalesStorageShape->GetStorageShape().GetDimNum() != DYNAMIC_SCALE_DIM_NUM,
+        uint32_t dynamicScalesDimNum = IsGroupQuant(quantMode) ? DYNAMIC_GROUP_SCALE_DIM_NUM : DYNAMIC_SCALE_DIM_NUM;
+        OP_TILING_CHECK(dynamicScalesStorageShape->GetStorageShape().GetDimNum() != dynamicScalesDimNum,
                         OP_LOGE(nodeName, "dynamicScalesShape dims must be %u, but current dim num is %lu.",
-                                DYNAMIC_SCALE_DIM_NUM, dynamicScalesStorageShape->GetStorageShape().GetDimNum()),
+                                dynamicScalesDimNum, dynamicScalesStorageShape->GetStorageShape().GetDimNum()),
                         return false);
         OP_LOGD(nodeName, "dynamicScales dim0 = %ld", dynamicScalesStorageShape->GetStorageShape().GetDim(0));
     }
@@ -317,7 +350,7 @@ static bool CheckTensorDataType(const gert::TilingContext *context, const char *
             return false);
     }
 
-    if (quantMode == DYNAMIC_SCALES) {
+    if (IsDynamicQuant(quantMode)) {
         auto dynamicScalesDesc = context->GetOutputDesc(OUTPUT_DYNAMIC_SCALES_INDEX);
         OP_TILING_CHECK(dynamicScalesDesc == nullptr, OP_LOGE(nodeName, "dynamicScalesDesc is null."), return false);
         OP_TILING_CHECK(dynamicScalesDesc->GetDataType() != ge::DT_FLOAT,
@@ -401,7 +434,7 @@ static bool CheckTensorFormat(const gert::TilingContext *context, const char *no
         static_cast<ge::Format>(ge::GetPrimaryFormat(expandXDesc->GetStorageFormat())) == ge::FORMAT_FRACTAL_NZ,
         OP_LOGE(nodeName, "expandX format is invalid."), return false);
 
-    if (quantMode == DYNAMIC_SCALES) {
+    if (IsDynamicQuant(quantMode)) {
         auto dynamicScalesDesc = context->GetOutputDesc(OUTPUT_DYNAMIC_SCALES_INDEX);
         OP_TILING_CHECK(dynamicScalesDesc == nullptr, OP_LOGE(nodeName, "dynamicScalesDesc is null."), return false);
         OP_TILING_CHECK(static_cast<ge::Format>(ge::GetPrimaryFormat(dynamicScalesDesc->GetStorageFormat())) ==
@@ -536,9 +569,10 @@ static ge::graphStatus CheckAndSetExpertInfo(const gert::TilingContext *context,
                             MOE_EXPERT_MAX_NUM, moeExpertNum),
                     return ge::GRAPH_FAILED);
     OP_TILING_CHECK(
-        (*quantModePtr < static_cast<int64_t>(NO_SCALES)) || (*quantModePtr > static_cast<int64_t>(DYNAMIC_SCALES)),
-        OP_LOGE(nodeName, "quantMode is invalid, only support [0, %u], but got quantMode=%ld.", DYNAMIC_SCALES,
-                *quantModePtr),
+        (*quantModePtr < static_cast<int64_t>(NO_SCALES)) ||
+            (*quantModePtr > static_cast<int64_t>(DYNAMIC_GROUP_POW2_SCALES)),
+        OP_LOGE(nodeName, "quantMode is invalid, only support [0, %u], but got quantMode=%ld.",
+                DYNAMIC_GROUP_POW2_SCALES, *quantModePtr),
         return ge::GRAPH_FAILED);
     OP_TILING_CHECK((*expertTokenNumsTypePtr != 0) && (*expertTokenNumsTypePtr != 1),
                     OP_LOGE(nodeName, "expertTokenNumsType only support 0 or 1, but got expertTokenNumsType=%ld.",
@@ -618,6 +652,27 @@ static ge::graphStatus CheckAndSetSpecialExpertInfo(const gert::TilingContext *c
     return ge::GRAPH_SUCCESS;
 }
 
+static ge::graphStatus CheckAndSetCommPhase(const gert::TilingContext *context, const char *nodeName,
+                                            MoeDistributeDispatchV2TilingData &tilingData, bool isSetCommAlg)
+{
+    auto attrs = context->GetAttrs();
+    auto commPhasePtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_COMM_PHASE_INDEX));
+    OP_TILING_CHECK(commPhasePtr == nullptr, OP_LOGE(nodeName, "commPhasePtr is null."), return ge::GRAPH_FAILED);
+    int64_t commPhase = *commPhasePtr;
+    OP_TILING_CHECK((commPhase < 0) || (commPhase > MAX_COMM_PHASE),
+                    OP_LOGE(nodeName, "commPhase is invalid, only support [0, %ld], but got commPhase=%ld.",
+                            MAX_COMM_PHASE, commPhase),
+                    return ge::GRAPH_FAILED);
+    // 拆分发送与接收依赖fullmesh_v1的窗口状态切换方式
+    OP_TILING_CHECK(isSetCommAlg && (commPhase != 0),
+                    OP_LOGE(nodeName, "Cannot support commPhase=%ld when comm_alg = fullmesh_v2", commPhase),
+                    return ge::GRAPH_FAILED);
+    tilingData.moeDistributeDispatchV2Info.commPhase = static_cast<uint32_t>(commPhase);
+    OP_LOGD(nodeName, "MoeDistributeDispatchV2 commPhase = %u\n", tilingData.moeDistributeDispatchV2Info.commPhase);
+
+    return ge::GRAPH_SUCCESS;
+}
+
 static ge::graphStatus GetAttrAndSetTilingData(const gert::TilingContext *context, const char *nodeName,
                                                MoeDistributeDispatchV2TilingData &tilingData, bool &isSetCommAlg)
 {
@@ -637,6 +692,10 @@ static ge::graphStatus GetAttrAndSetTilingData(const gert::TilingContext *contex
                     OP_LOGE(nodeName, "Get special expert, commAlg attr and set tiling data failed."),
                     return ge::GRAPH_FAILED);
 
+    // 获取commPhase
+    OP_TILING_CHECK(CheckAndSetCommPhase(context, nodeName, tilingData, isSetCommAlg) != ge::GRAPH_SUCCESS,
+                    OP_LOGE(nodeName, "Get commPhase attr and set tiling data failed."), return ge::GRAPH_FAILED);
+
     auto epWorldSizePtr = attrs->GetAttrPointer<int64_t>(ATTR_EP_WORLD_SIZE_INDEX);
     auto sharedExpertRankNumPtr = attrs->GetAttrPointer<int64_t>(ATTR_SHARED_EXPERT_RANK_NUM_INDEX);
     auto moeExpertNumPtr = attrs->GetAttrPointer<int64_t>(ATTR_MOE_EXPERT_NUM_INDEX);
@@ -924,6 +983,16 @@ static ge::graphStatus CheckTensorShape(const gert::TilingContext *context, cons
                 dynamicScalesDim0, A * tpWorldSize),
             return ge::GRAPH_FAILED);
     }
+    if (IsGroupQuant(quantMode)) {
+        const gert::StorageShape *dynamicScalesStorageShape = context->GetOutputShape(OUTPUT_DYNAMIC_SCALES_INDEX);
+        const int64_t dynamicScalesDim1 = dynamicScalesStorageShape->GetStorageShape().GetDim(1);
+        OP_TILING_CHECK((xDim1 % QUANT_GROUP_SIZE != 0) || (dynamicScalesDim1 != xDim1 / QUANT_GROUP_SIZE),
+                        OP_LOGE(nodeName,
+                                "group quant needs H divisible by %ld and dynamicScales's dim1 equal to H / %ld, "
+                                "H is %ld, dynamicScales's dim1 is %ld.",
+                                QUANT_GROUP_SIZE, QUANT_GROUP_SIZE, xDim1, dynamicScalesDim1),
+                        return ge::GRAPH_FAILED);
+    }
 
     // 校验assistInfo的维度
     const gert::StorageShape *assistInfoStorageShape = context->GetOutputShape(OUTPUT_ASSIST_INFO_INDEX);
@@ -994,6 +1063,138 @@ static ge::graphStatus CheckTensorShape(const gert::TilingContext *context, cons
     return ge::GRAPH_SUCCESS;
 }
 
+static ge::graphStatus CheckExpertRecvStats(const gert::TilingContext *context, const char *nodeName,
+                                            const MoeDistributeDispatchV2TilingData &tilingData,
+                                            const bool isSharedExpert, const bool hasElasticInfo,
+                                            const int64_t localMoeExpertNum)
+{
+    uint32_t expertRecvStatsMode = tilingData.moeDistributeDispatchV2Info.expertRecvStatsMode;
+    if (expertRecvStatsMode == RECV_STATS_NONE) {
+        return ge::GRAPH_SUCCESS;
+    }
+    // 弹性场景本卡专家数可变，tp域allgather的token不属于本卡专家接收量，均不支持统计
+    OP_TILING_CHECK(hasElasticInfo, OP_LOGE(nodeName, "expertRecvStats is not supported with elasticInfo."),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(tilingData.moeDistributeDispatchV2Info.tpWorldSize > 1,
+                    OP_LOGE(nodeName, "expertRecvStats is not supported when tpWorldSize > 1."),
+                    return ge::GRAPH_FAILED);
+
+    auto expertRecvStatsDesc = context->GetOutputDesc(OUTPUT_EXPERT_RECV_STATS_INDEX);
+    OP_TILING_CHECK(expertRecvStatsDesc == nullptr, OP_LOGE(nodeName, "expertRecvStatsDesc is null."),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(expertRecvStatsDesc->GetDataType() != ge::DT_INT32,
+                    OP_LOGE(nodeName, "expertRecvStats dataType is invalid, dataType should be int32, but is %d.",
+                            static_cast<ge::DataType>(expertRecvStatsDesc->GetDataType())),
+                    return ge::GRAPH_FAILED);
+
+    const gert::StorageShape *expertRecvStatsStorageShape = context->GetOutputShape(OUTPUT_EXPERT_RECV_STATS_INDEX);
+    const gert::Shape &expertRecvStatsShape = expertRecvStatsStorageShape->GetStorageShape();
+    const int64_t dimNum = static_cast<int64_t>(expertRecvStatsShape.GetDimNum());
+    OP_TILING_CHECK((dimNum != ONE_DIM) && (dimNum != TWO_DIMS),
+                    OP_LOGE(nodeName, "expertRecvStats dim must be 1 or 2, but current dim num is %ld.", dimNum),
+                    return ge::GRAPH_FAILED);
+    const int64_t expertNum = isSharedExpert ? 1 : localMoeExpertNum;
+    OP_TILING_CHECK(expertRecvStatsShape.GetDim(0) != expertNum,
+                    OP_LOGE(nodeName, "expertRecvStats's dim0 should be %ld, but got %ld.", expertNum,
+                            expertRecvStatsShape.GetDim(0)),
+                    return ge::GRAPH_FAILED);
+    const int64_t epWorldSize = static_cast<int64_t>(tilingData.moeDistributeDispatchV2Info.epWorldSize);
+    OP_TILING_CHECK((dimNum == TWO_DIMS) && (expertRecvStatsShape.GetDim(1) != epWorldSize),
+                    OP_LOGE(nodeName, "expertRecvStats's dim1 should be epWorldSize %ld, but got %ld.", epWorldSize,
+                            expertRecvStatsShape.GetDim(1)),
+                    return ge::GRAPH_FAILED);
+    return ge::GRAPH_SUCCESS;
+}
+
+static ge::graphStatus CheckReplicaTensor(const char *nodeName, const char *tensorName,
+                                          const gert::CompileTimeTensorDesc *desc, const gert::Shape &shape,
+                                          const std::vector<int64_t> &expectShape)
+{
+    OP_TILING_CHECK(desc == nullptr, OP_LOGE(nodeName, "%s desc is null.", tensorName), return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(desc->GetDataType() != ge::DT_INT32,
+                    OP_LOGE(nodeName, "%s dataType is invalid, dataType should be int32, but is %d.", tensorName,
+                            static_cast<ge::DataType>(desc->GetDataType())),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(shape.GetDimNum() != expectShape.size(),
+                    OP_LOGE(nodeName, "%s dim num should be %zu, but got %zu.", tensorName, expectShape.size(),
+                            shape.GetDimNum()),
+                    return ge::GRAPH_FAILED);
+    for (size_t i = 0; i < expectShape.size(); ++i) {
+        OP_TILING_CHECK(shape.GetDim(i) != expectShape[i],
+                        OP_LOGE(nodeName, "%s's dim%zu should be %ld, but got %ld.", tensorName, i, expectShape[i],
+                                shape.GetDim(i)),
+                        return ge::GRAPH_FAILED);
+    }
+    return ge::GRAPH_SUCCESS;
+}
+
+static ge::graphStatus CheckAndSetReplicaInfo(const gert::TilingContext *context, const char *nodeName,
+                                              MoeDistributeDispatchV2TilingData &tilingData, const bool hasElasticInfo,
+                                              const bool isSetCommAlg)
+{
+    auto replicaPolicyPtr = context->GetAttrs()->GetAttrPointer<int64_t>(static_cast<int>(ATTR_REPLICA_POLICY_INDEX));
+    OP_TILING_CHECK(replicaPolicyPtr == nullptr, OP_LOGE(nodeName, "replicaPolicyPtr is null."),
+                    return ge::GRAPH_FAILED);
+    const gert::StorageShape *log2PhyStorageShape = context->GetOptionalInputShape(EXPERT_LOG2PHY_INDEX);
+    const gert::StorageShape *logCntStorageShape = context->GetOptionalInputShape(EXPERT_LOGCNT_INDEX);
+    const gert::StorageShape *physicalIdsStorageShape = context->GetOutputShape(OUTPUT_PHYSICAL_EXPERT_IDS_INDEX);
+    bool hasLog2Phy = (log2PhyStorageShape != nullptr);
+    OP_TILING_CHECK((hasLog2Phy != (logCntStorageShape != nullptr)) ||
+                        (hasLog2Phy != (physicalIdsStorageShape != nullptr)),
+                    OP_LOGE(nodeName, "expertLog2Phy, expertLogCnt and physicalExpertIds must be passed together."),
+                    return ge::GRAPH_FAILED);
+    if (!hasLog2Phy) {
+        return ge::GRAPH_SUCCESS;
+    }
+
+    int64_t replicaPolicy = *replicaPolicyPtr;
+    OP_TILING_CHECK((replicaPolicy < 0) || (replicaPolicy > MAX_REPLICA_POLICY),
+                    OP_LOGE(nodeName, "replicaPolicy is invalid, only support [0, %ld], but got replicaPolicy=%ld.",
+                            MAX_REPLICA_POLICY, replicaPolicy),
+                    return ge::GRAPH_FAILED);
+    // 特殊专家id与逻辑专家id空间重叠，弹性场景物理专家数可变，fullmesh_v2模板不经过副本选择，均不支持
+    OP_TILING_CHECK(tilingData.moeDistributeDispatchV2Info.zeroComputeExpertNum > 0,
+                    OP_LOGE(nodeName, "expertLog2Phy is not supported with zero computation experts."),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(hasElasticInfo, OP_LOGE(nodeName, "expertLog2Phy is not supported with elasticInfo."),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(isSetCommAlg, OP_LOGE(nodeName, "expertLog2Phy is not supported when comm_alg = fullmesh_v2."),
+                    return ge::GRAPH_FAILED);
+
+    const gert::Shape &log2PhyShape = log2PhyStorageShape->GetStorageShape();
+    OP_TILING_CHECK(log2PhyShape.GetDimNum() != TWO_DIMS,
+                    OP_LOGE(nodeName, "expertLog2Phy dim must be 2, but current dim num is %zu.",
+                            log2PhyShape.GetDimNum()),
+                    return ge::GRAPH_FAILED);
+    int64_t logicalExpertNum = log2PhyShape.GetDim(0);
+    int64_t maxReplicaNum = log2PhyShape.GetDim(1);
+    int64_t moeExpertNum = static_cast<int64_t>(tilingData.moeDistributeDispatchV2Info.moeExpertNum);
+    OP_TILING_CHECK((logicalExpertNum <= 0) || (logicalExpertNum > moeExpertNum) || (maxReplicaNum <= 0) ||
+                        (logicalExpertNum * maxReplicaNum > MAX_REPLICA_TABLE_SIZE),
+                    OP_LOGE(nodeName,
+                            "expertLog2Phy shape [%ld, %ld] is invalid, logical expert num should be in [1, "
+                            "moeExpertNum %ld] and the table size should be in [1, %ld].",
+                            logicalExpertNum, maxReplicaNum, moeExpertNum, MAX_REPLICA_TABLE_SIZE),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(CheckReplicaTensor(nodeName, "expertLog2Phy", context->GetOptionalInputDesc(EXPERT_LOG2PHY_INDEX),
+                                       log2PhyShape, {logicalExpertNum, maxReplicaNum}) != ge::GRAPH_SUCCESS,
+                    OP_LOGE(nodeName, "Check expertLog2Phy failed."), return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(CheckReplicaTensor(nodeName, "expertLogCnt", context->GetOptionalInputDesc(EXPERT_LOGCNT_INDEX),
+                                       logCntStorageShape->GetStorageShape(), {logicalExpertNum}) != ge::GRAPH_SUCCESS,
+                    OP_LOGE(nodeName, "Check expertLogCnt failed."), return ge::GRAPH_FAILED);
+    int64_t bs = static_cast<int64_t>(tilingData.moeDistributeDispatchV2Info.bs);
+    int64_t k = static_cast<int64_t>(tilingData.moeDistributeDispatchV2Info.k);
+    OP_TILING_CHECK(CheckReplicaTensor(nodeName, "physicalExpertIds",
+                                       context->GetOutputDesc(OUTPUT_PHYSICAL_EXPERT_IDS_INDEX),
+                                       physicalIdsStorageShape->GetStorageShape(), {bs, k}) != ge::GRAPH_SUCCESS,
+                    OP_LOGE(nodeName, "Check physicalExpertIds failed."), return ge::GRAPH_FAILED);
+
+    tilingData.moeDistributeDispatchV2Info.logicalExpertNum = static_cast<uint32_t>(logicalExpertNum);
+    tilingData.moeDistributeDispatchV2Info.maxReplicaNum = static_cast<uint32_t>(maxReplicaNum);
+    tilingData.moeDistributeDispatchV2Info.replicaPolicy = static_cast<uint32_t>(replicaPolicy);
+    return ge::GRAPH_SUCCESS;
+}
+
 static ge::graphStatus TilingCheckMoeDistributeDispatch(gert::TilingContext *context, const char *nodeName,
                                                         const bool isActiveMask, const bool isScales,
                                                         const bool hasElasticInfo, const uint32_t quantMode)
@@ -1011,7 +1212,8 @@ static ge::graphStatus TilingCheckMoeDistributeDispatch(gert::TilingContext *con
 static void CalTilingKey(uint64_t &tilingKey, const bool isScales, const uint32_t quantMode, const uint32_t tpWorldSize,
                          const bool isSetCommAlg)
 {
-    tilingKey += static_cast<uint64_t>(quantMode);
+    // 分组量化与按token量化共用动态量化模板，分组方式由tiling中的quantMode区分
+    tilingKey += static_cast<uint64_t>(IsDynamicQuant(quantMode) ? DYNAMIC_SCALES : quantMode);
     if (isScales) {
         tilingKey += static_cast<uint64_t>(TILINGKEY_SCALES);
     }
@@ -1137,6 +1339,16 @@ static ge::graphStatus GetParamsAndSetTilingData(const gert::TilingContext *cont
     const gert::StorageShape *elasticInfoStorageShape = context->GetOptionalInputShape(ELASTIC_INFO_INDEX);
     hasElasticInfo = (elasticInfoStorageShape != nullptr);
     tilingData->moeDistributeDispatchV2Info.hasElasticInfo = hasElasticInfo;
+
+    // 获取expertRecvStats，按维度区分是否按源卡统计
+    const gert::StorageShape *expertRecvStatsStorageShape = context->GetOutputShape(OUTPUT_EXPERT_RECV_STATS_INDEX);
+    uint32_t expertRecvStatsMode = RECV_STATS_NONE;
+    if (expertRecvStatsStorageShape != nullptr) {
+        expertRecvStatsMode = (expertRecvStatsStorageShape->GetStorageShape().GetDimNum() == TWO_DIMS)
+                                  ? RECV_STATS_PER_SRC_RANK
+                                  : RECV_STATS_PER_EXPERT;
+    }
+    tilingData->moeDistributeDispatchV2Info.expertRecvStatsMode = expertRecvStatsMode;
     uint32_t quantMode = tilingData->moeDistributeDispatchV2Info.quantMode;
 
     // 检查quantMode和scales是否匹配
@@ -1189,6 +1401,12 @@ static ge::graphStatus MoeDistributeDispatchA3TilingFuncImpl(gert::TilingContext
     OP_TILING_CHECK(CheckTensorShape(context, nodeName, *tilingData, quantMode, isScales, isSharedExpert,
                                      hasElasticInfo, static_cast<int64_t>(localMoeExpertNum)) != ge::GRAPH_SUCCESS,
                     OP_LOGE(nodeName, "Check tensor shape failed."), return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(CheckExpertRecvStats(context, nodeName, *tilingData, isSharedExpert, hasElasticInfo,
+                                         static_cast<int64_t>(localMoeExpertNum)) != ge::GRAPH_SUCCESS,
+                    OP_LOGE(nodeName, "Check expertRecvStats failed."), return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(
+        CheckAndSetReplicaInfo(context, nodeName, *tilingData, hasElasticInfo, isSetCommAlg) != ge::GRAPH_SUCCESS,
+        OP_LOGE(nodeName, "Check expert replica table failed."), return ge::GRAPH_FAILED);
 
     // 校验win区大小
     OP_TILING_CHECK(CheckWinSize(*tilingData, nodeName, isSetCommAlg, localMoeExpertNum) != ge::GRAPH_SUCCESS,
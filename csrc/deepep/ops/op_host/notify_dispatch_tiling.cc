@@ -44,6 +44,7 @@ constexpr uint32_t OUTPUT_R_IN_SRCRANK_OFFSET_INDEX = 6;
 constexpr uint32_t OUTPUT_TOTAL_RECV_TOKENS_INDEX = 7;
 constexpr uint32_t OUTPUT_MAX_BS_INDEX = 8;
 constexpr uint32_t OUTPUT_RECV_TOKENS_PER_EXPERT_INDEX = 9;
+constexpr uint32_t OUTPUT_EXPERT_RECV_STATS_INDEX = 10;
 
 constexpr uint32_t ATTR_SEND_COUNT_INDEX = 0;
 constexpr uint32_t ATTR_NUM_TOKENS_INDEX = 1;
@@ -55,6 +56,12 @@ constexpr uint32_t ATTR_LOCAL_RANK_ID_INDEX = 6;
 constexpr uint32_t ATTR_ROUND_INDEX = 7;
 constexpr uint32_t ATTR_PER_ROUND_TOKENS_INDEX = 8;
 
+constexpr uint32_t RECV_STATS_NONE = 0;
+constexpr uint32_t RECV_STATS_PER_EXPERT = 1;    // expertRecvStats为[本卡专家数]
+constexpr uint32_t RECV_STATS_PER_SRC_RANK = 2;  // expertRecvStats为[本卡专家数, rankSize]
+constexpr size_t ONE_DIM = 1;
+constexpr size_t TWO_DIMS = 2;
+
 const size_t MAX_GROUP_NAME_LENGTH = 128UL;
 const int64_t MAX_COMM_WORLD_SIZE = 384;
 
@@ -84,6 +91,7 @@ static void PrintTilingDataInfo(const char *nodeName, NotifyDispatchTilingData &
     OP_LOGD(nodeName, "numTokens is %u.", tilingData.notifyDispatchInfo.numTokens);
     OP_LOGD(nodeName, "round is %u.", tilingData.notifyDispatchInfo.round);
     OP_LOGD(nodeName, "perRoundTokens is %u.", tilingData.notifyDispatchInfo.perRoundTokens);
+    OP_LOGD(nodeName, "expertRecvStatsMode is %u.", tilingData.notifyDispatchInfo.expertRecvStatsMode);
     OP_LOGD(nodeName, "aivNum is %u.", tilingData.notifyDispatchInfo.aivNum);
     OP_LOGD(nodeName, "totalUbSize is %lu.", tilingData.notifyDispatchInfo.totalUbSize);
     OP_LOGD(nodeName, "totalWinSize is %lu.", tilingData.notifyDispatchInfo.totalWinSize);
@@ -286,6 +294,38 @@ static bool CheckTensorDataType(gert::TilingContext *context, const char *nodeNa
     return true;
 }
 
+// 获取expertRecvStats，按维度区分是否按源卡统计，传空时不统计
+static ge::graphStatus SetExpertRecvStatsMode(gert::TilingContext *context, const char *nodeName,
+                                              NotifyDispatchTilingData &tilingData)
+{
+    tilingData.notifyDispatchInfo.expertRecvStatsMode = RECV_STATS_NONE;
+    const gert::StorageShape *expertRecvStatsStorageShape = context->GetOutputShape(OUTPUT_EXPERT_RECV_STATS_INDEX);
+    if (expertRecvStatsStorageShape == nullptr) {
+        return ge::GRAPH_SUCCESS;
+    }
+    auto expertRecvStatsDesc = context->GetOutputDesc(OUTPUT_EXPERT_RECV_STATS_INDEX);
+    OP_TILING_CHECK(expertRecvStatsDesc == nullptr, OP_LOGE(nodeName, "expertRecvStatsDesc is null."),
+                    return ge::GRAPH_FAILED);
+    OP_TILING_CHECK((expertRecvStatsDesc->GetDataType() != ge::DT_INT32),
+                    OP_LOGE(nodeName, "expertRecvStats datatype is invalid, datatype should be int, but is %d.",
+                            static_cast<ge::DataType>(expertRecvStatsDesc->GetDataType())),
+                    return ge::GRAPH_FAILED);
+
+    const gert::Shape &expertRecvStatsShape = expertRecvStatsStorageShape->GetStorageShape();
+    const size_t dimNum = expertRecvStatsShape.GetDimNum();
+    OP_TILING_CHECK((dimNum != ONE_DIM) && (dimNum != TWO_DIMS),
+                    OP_LOGE(nodeName, "expertRecvStats dim must be 1 or 2, but current dim num is %zu.", dimNum),
+                    return ge::GRAPH_FAILED);
+    const int64_t rankSize = static_cast<int64_t>(tilingData.notifyDispatchInfo.rankSize);
+    OP_TILING_CHECK((dimNum == TWO_DIMS) && (expertRecvStatsShape.GetDim(1) != rankSize),
+                    OP_LOGE(nodeName, "expertRecvStats's dim1 should be rankSize %ld, but got %ld.", rankSize,
+                            expertRecvStatsShape.GetDim(1)),
+                    return ge::GRAPH_FAILED);
+    tilingData.notifyDispatchInfo.expertRecvStatsMode =
+        (dimNum == TWO_DIMS) ? RECV_STATS_PER_SRC_RANK : RECV_STATS_PER_EXPERT;
+    return ge::GRAPH_SUCCESS;
+}
+
 static ge::graphStatus TilingCheckTensor(gert::TilingContext *context, const char *nodeName)
 {
     OP_TILING_CHECK(!CheckTensorDataType(context, nodeName), OP_LOGE(nodeName, "params dataType is invalid."),
@@ -307,6 +347,8 @@ static ge::graphStatus NotifyDispatchTilingFuncImpl(gert::TilingContext *context
 
     OP_TILING_CHECK(TilingCheckTensor(context, nodeName) != ge::GRAPH_SUCCESS,
                     OP_LOGE(nodeName, "Tiling check param failed."), return ge::GRAPH_FAILED);
+    OP_TILING_CHECK(SetExpertRecvStatsMode(context, nodeName, *tilingData) != ge::GRAPH_SUCCESS,
+                    OP_LOGE(nodeName, "Check expertRecvStats failed."), return ge::GRAPH_FAILED);
 
     OP_TILING_CHECK(SetWorkSpace(context, nodeName) != ge::GRAPH_SUCCESS,
                     OP_LOGE(nodeName, "Tiling set workspace failed."), return ge::GRAPH_FAILED);
@@ -29,6 +29,7 @@ extern "C" {
  * 计算输入，Tensor，数据类型int64，必须为1维，数据格式支持ND。预留参数，暂未使用，传空即可。
  * @param [in] expandScalesOptional: 计算输入，Tensor，数据类型float32，必须为1维，数据格式支持ND。
  * @param [in] sharedExpertXOptional: 计算可选输入，Tensor，数据类型float16，bfloat16，必须为2维，数据格式支持ND。
+ * @param [in] elasticInfoOptional: 计算可选输入，Tensor，数据类型int32，必须为1维，数据格式支持ND。弹性缩容信息，不缩容时传空。
  * @param [in] groupEp: 计算输入，str。ep通信域名称，专家并行的通信域。不能和groupTp相同。
  * @param [in] epWorldSize: 计算输入，int。ep通信域size。
  * @param [in] epRankId: 计算输入，int。ep本卡Id。同一个EP通信域中各卡的epRankId不重复。
@@ -41,9 +42,10 @@ extern "C" {
  * @param [in] sharedExpertRankNum: 计算可选输入，int。共享专家卡数量。
  * @param [in] globalBs: 计算可选输入，int。
  * @param [in] outDtype: 计算可选输入，int。输出数据类型。预留参数，暂未使用，传0即可。
- * @param [in] commQuantMode: 计算可选输入，int。通信量化类型。
+ * @param [in] commQuantMode: 计算可选输入，int。通信量化类型，0不量化，2为int8且每8个通道一个scale，3为int8且每个token一个scale。
  * @param [in] groupListType: 计算可选输入，int。groupList格式。预留参数，暂未使用，传0即可。
  * @param [in] commAlg: 计算可选输入，str。 通信算法类型。预留参数，暂未使用。
+ * @param [in] commPhase: 计算可选输入，int。0: 发送与接收在同一次调用中完成，1: 仅发送，2: 仅接收最近一次发送，3: 仅接收之前一次发送。
  * @param [out] xOut: 计算输出，Tensor，必选输出，数据类型支持float16, bfloat16，仅支持2维，数据格式支持ND。
  * @param [out] workspaceSize: 出参，返回需要在npu device侧申请的workspace大小。
  * @param [out] executor: 出参，返回op执行器，包含了算子计算流程。
@@ -55,10 +57,11 @@ __attribute__((visibility("default"))) aclnnStatus aclnnMoeDistributeCombineV2Ge
     const aclTensor *epSendCounts, const aclTensor *expertScales, const aclTensor *tpSendCountsOptional,
     const aclTensor *xActiveMaskOptional, const aclTensor *activationScaleOptional,
     const aclTensor *weightScaleOptional, const aclTensor *groupListOptional, const aclTensor *expandScalesOptional,
-    const aclTensor *sharedExpertXOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
-    char *groupTp, int64_t tpWorldSize, int64_t tpRankId, int64_t expertShardType, int64_t sharedExpertNum,
-    int64_t sharedExpertRankNum, int64_t globalBs, int64_t outDtype, int64_t commQuantMode, int64_t groupListType,
-    char *commAlg, const aclTensor *xOut, uint64_t *workspaceSize, aclOpExecutor **executor);
+    const aclTensor *sharedExpertXOptional, const aclTensor *elasticInfoOptional, char *groupEp, int64_t epWorldSize,
+    int64_t epRankId, int64_t moeExpertNum, char *groupTp, int64_t tpWorldSize, int64_t tpRankId,
+    int64_t expertShardType, int64_t sharedExpertNum, int64_t sharedExpertRankNum, int64_t globalBs, int64_t outDtype,
+    int64_t commQuantMode, int64_t groupListType, char *commAlg, int64_t commPhase, const aclTensor *xOut,
+    uint64_t *workspaceSize, aclOpExecutor **executor);
 
 /**
  * @brief aclnnMoeDistributeCombineV2的第二段接口，用于执行计算。
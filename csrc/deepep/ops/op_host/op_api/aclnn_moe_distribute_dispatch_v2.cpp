@@ -16,12 +16,14 @@ enum NnopbaseHcclServerType {
 
 extern aclnnStatus aclnnInnerMoeDistributeDispatchV2GetWorkspaceSize(
     const aclTensor *x, const aclTensor *expertIds, const aclTensor *scales, const aclTensor *xActiveMask,
-    const aclTensor *elasticInfo, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
-    char *groupTp, int64_t tpWorldSize, int64_t tpRankId, int64_t expertShardType, int64_t sharedExpertNum,
-    int64_t shareExpertRankNum, int64_t quantMode, int64_t globalBs, int64_t expertTokenNumsType, char *commAlg,
-    int64_t zeroExpertNum, int64_t copyExpertNum, int64_t constExpertNum, const aclTensor *expandX,
-    const aclTensor *dynamicScales, const aclTensor *assist_info_for_combine, const aclTensor *expertTokensNums,
-    const aclTensor *epRecvCounts, const aclTensor *tpRecvCounts, uint64_t *workspaceSize, aclOpExecutor **executor);
+    const aclTensor *elasticInfo, const aclTensor *expertLog2Phy, const aclTensor *expertLogCnt, char *groupEp,
+    int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum, char *groupTp, int64_t tpWorldSize, int64_t tpRankId,
+    int64_t expertShardType, int64_t sharedExpertNum, int64_t shareExpertRankNum, int64_t quantMode, int64_t globalBs,
+    int64_t expertTokenNumsType, char *commAlg, int64_t zeroExpertNum, int64_t copyExpertNum, int64_t constExpertNum,
+    int64_t commPhase, int64_t replicaPolicy, const aclTensor *expandX, const aclTensor *dynamicScales,
+    const aclTensor *assist_info_for_combine, const aclTensor *expertTokensNums, const aclTensor *epRecvCounts,
+    const aclTensor *tpRecvCounts, const aclTensor *expertRecvStats, const aclTensor *physicalExpertIds,
+    uint64_t *workspaceSize, aclOpExecutor **executor);
 extern aclnnStatus aclnnInnerMoeDistributeDispatchV2(void *workspace, uint64_t workspaceSize, aclOpExecutor *executor,
                                                      aclrtStream stream);
 
@@ -29,18 +31,21 @@ extern "C" void __attribute__((weak)) NnopbaseSetHcclServerType(void *executor,
 
 aclnnStatus aclnnMoeDistributeDispatchV2GetWorkspaceSize(
     const aclTensor *x, const aclTensor *expertIds, const aclTensor *scalesOptional,
-    const aclTensor *xActiveMaskOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
+    const aclTensor *xActiveMaskOptional, const aclTensor *elasticInfoOptional, const aclTensor *expertLog2PhyOptional,
+    const aclTensor *expertLogCntOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
     char *groupTp, int64_t tpWorldSize, int64_t tpRankId, int64_t expertShardType, int64_t sharedExpertNum,
     int64_t sharedExpertRankNum, int64_t quantMode, int64_t globalBs, int64_t expertTokenNumsType, char *commAlg,
-    const aclTensor *expandXOut, const aclTensor *dynamicScalesOut, const aclTensor *assistInfoForCombineOut,
-    const aclTensor *expertTokenNumsOut, const aclTensor *epRecvCountsOut, const aclTensor *tpRecvCountsOut,
-    uint64_t *workspaceSize, aclOpExecutor **executor)
+    int64_t commPhase, int64_t replicaPolicy, const aclTensor *expandXOut, const aclTensor *dynamicScalesOut,
+    const aclTensor *assistInfoForCombineOut, const aclTensor *expertTokenNumsOut, const aclTensor *epRecvCountsOut,
+    const aclTensor *tpRecvCountsOut, const aclTensor *expertRecvStatsOptional,
+    const aclTensor *physicalExpertIdsOptional, uint64_t *workspaceSize, aclOpExecutor **executor)
 {
     return aclnnInnerMoeDistributeDispatchV2GetWorkspaceSize(
-        x, expertIds, scalesOptional, xActiveMaskOptional, nullptr, groupEp, epWorldSize, epRankId, moeExpertNum,
-        groupTp, tpWorldSize, tpRankId, expertShardType, sharedExpertNum, sharedExpertRankNum, quantMode, globalBs,
-        expertTokenNumsType, commAlg, 0, 0, 0, expandXOut, dynamicScalesOut, assistInfoForCombineOut,
-        expertTokenNumsOut, epRecvCountsOut, tpRecvCountsOut, workspaceSize, executor);
+        x, expertIds, scalesOptional, xActiveMaskOptional, elasticInfoOptional, expertLog2PhyOptional,
+        expertLogCntOptional, groupEp, epWorldSize, epRankId, moeExpertNum, groupTp, tpWorldSize, tpRankId,
+        expertShardType, sharedExpertNum, sharedExpertRankNum, quantMode, globalBs, expertTokenNumsType, commAlg, 0, 0,
+        0, commPhase, replicaPolicy, expandXOut, dynamicScalesOut, assistInfoForCombineOut, expertTokenNumsOut,
+        epRecvCountsOut, tpRecvCountsOut, expertRecvStatsOptional, physicalExpertIdsOptional, workspaceSize, executor);
 }
 
 aclnnStatus aclnnMoeDistributeDispatchV2(void *workspace, uint64_t workspaceSize, aclOpExecutor *executor,
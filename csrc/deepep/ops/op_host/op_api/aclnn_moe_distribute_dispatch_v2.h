@@ -17,6 +17,12 @@ extern "C" {
  * @param [in] expertIds: 计算输入，Tensor，数据类型int32，必须为2维，数据格式支持ND。每个token的topK个专家索引。
  * @param [in] scalesOptional: 计算可选输入，Tensor，数据类型float32，必须为2维，数据格式支持ND。每个专家的smooth权重。
  * @param [in] xActiveMaskOptional: 计算输入，Tensor，数据类型Bool，必须为1维，数据格式支持ND。
+ * @param [in] elasticInfoOptional: 计算可选输入，Tensor，数据类型int32，必须为1维[4 + 2 * epWorldSize]，数据格式支持ND。
+ * 弹性缩容信息：是否缩容、存活卡数、共享专家卡数、MOE专家数，随后为各卡的紧凑id与各紧凑id对应的卡号。传入时expertIds为紧凑后的专家id。
+ * @param [in] expertLog2PhyOptional: 计算可选输入，Tensor，数据类型int32，必须为2维[逻辑专家数, 最大副本数]，数据格式支持ND。
+ * 传入时expertIds为逻辑专家id，由算子为每个token选择一个物理副本。
+ * @param [in] expertLogCntOptional: 计算可选输入，Tensor，数据类型int32，必须为1维[逻辑专家数]，每个逻辑专家的副本数，
+ * 取值[1, 最大副本数]。与expertLog2PhyOptional同时传入。
  * @param [in] groupEp: 计算输入，str。ep通信域名称，专家并行的通信域。不能和groupTp相同。
  * @param [in] epWorldSize: 计算输入，int。ep通信域size。
  * @param [in] epRankId: 计算输入，int。ep本卡Id。同一个EP通信域中各卡的epRankId不能重复。
@@ -27,14 +33,17 @@ extern "C" {
  * @param [in] expertShardType: 计算可选输入，int。专家共享类型。
  * @param [in] sharedExpertNum: 计算可选输入，int。共享专家数量。
  * @param [in] sharedExpertRankNum: 计算可选输入，int。共享专家卡数量。
- * @param [in] quantMode: 计算可选输入，int，量化模式。
+ * @param [in] quantMode: 计算可选输入，int，量化模式。0: 不量化，2: 每个token一个动态scale，3: 每128个通道一个动态scale，
+ * 4: 同3，scale向上取整到2的幂。
  * @param [in] globalBs: 计算可选输入，int。EP域全局的batch size大小。
  * @param [in] expertTokenNumsType: 计算可选输入，int。输出expertTokenNums中的值语义类型。
  * @param [in] commAlg: 计算可选输入，str。 通信算法类型。预留参数，暂未使用。
+ * @param [in] commPhase: 计算可选输入，int。0: 发送与接收在同一次调用中完成，1: 仅发送，2: 仅接收最近一次发送，3: 仅接收之前一次发送。
+ * @param [in] replicaPolicy: 计算可选输入，int。副本选择策略，0: 按token轮询，1: 选本卡已发送token最少的副本。
  * @param [out] expandXOut: 计算输出，Tensor，必选输出，数据类型支持float16, bfloat16,
  int8，仅支持2维，数据格式支持ND。根据 expertIdx进行扩展过的token特征。
  * @param [out] dynamicScalesOut:
- 计算输出，Tensor，必选输出，数据类型float32，仅支持1维，数据格式支持ND。quantMode为0时输出为空。
+ 计算输出，Tensor，必选输出，数据类型float32，quantMode为2时为1维，为3或4时为2维(第二维为H/128)，数据格式支持ND。quantMode为0时输出为空。
  * @param [out] assistInfoForCombineOut:
  计算输出，Tensor，必选输出，数据类型int32，仅支持1维，数据格式支持ND,传输给combine算子的辅助信息。
  * @param [out] expertTokenNumsOut:
@@ -43,6 +52,11 @@ extern "C" {
  计算输出，Tensor，必选输出，数据类型int32，仅支持1维，数据格式支持ND。表示从各卡接收的token数。
  * @param [out] tpRecvCountsOut:
  计算输出，Tensor，必选输出，数据类型int32，仅支持1维，数据格式支持ND。无tp通信域时输出为空。
+ * @param [out] expertRecvStatsOptional:
+ 计算可选输出，Tensor，数据类型int32，数据格式支持ND。在原值上原子累加本卡各专家接收的token数，用于在线负载均衡统计；
+ 1维时为[本卡专家数]，2维时为[本卡专家数, epWorldSize]，按源卡区分。传空时不统计。
+ * @param [out] physicalExpertIdsOptional:
+ 计算可选输出，Tensor，数据类型int32，shape同expertIds。传入副本表时必选，输出为每个token选中的物理专家id，供combine使用。
  * @param [out] workspaceSize: 出参，返回需要在npu device侧申请的workspace大小。
  * @param [out] executor: 出参，返回op执行器，包含了算子计算流程。
  * @return aclnnStatus: 返回值，返回状态码
@@ -50,12 +64,14 @@ extern "C" {
  */
 __attribute__((visibility("default"))) aclnnStatus aclnnMoeDistributeDispatchV2GetWorkspaceSize(
     const aclTensor *x, const aclTensor *expertIds, const aclTensor *scalesOptional,
-    const aclTensor *xActiveMaskOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
+    const aclTensor *xActiveMaskOptional, const aclTensor *elasticInfoOptional, const aclTensor *expertLog2PhyOptional,
+    const aclTensor *expertLogCntOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
     char *groupTp, int64_t tpWorldSize, int64_t tpRankId, int64_t expertShardType, int64_t sharedExpertNum,
     int64_t sharedExpertRankNum, int64_t quantMode, int64_t globalBs, int64_t expertTokenNumsType, char *commAlg,
-    const aclTensor *expandXOut, const aclTensor *dynamicScalesOut, const aclTensor *assistInfoForCombineOut,
-    const aclTensor *expertTokenNumsOut, const aclTensor *epRecvCountsOut, const aclTensor *tpRecvCountsOut,
-    uint64_t *workspaceSize, aclOpExecutor **executor);
+    int64_t commPhase, int64_t replicaPolicy, const aclTensor *expandXOut, const aclTensor *dynamicScalesOut,
+    const aclTensor *assistInfoForCombineOut, const aclTensor *expertTokenNumsOut, const aclTensor *epRecvCountsOut,
+    const aclTensor *tpRecvCountsOut, const aclTensor *expertRecvStatsOptional,
+    const aclTensor *physicalExpertIdsOptional, uint64_t *workspaceSize, aclOpExecutor **executor);
 
 /**
  * @brief aclnnMoeDistributeDispatchV2的第二段接口，用于执行计算。
@@ -22,12 +22,14 @@ aclnnStatus aclnnNotifyDispatchGetWorkspaceSize(
     int32_t perRoundTokens, const aclTensor *sendDataOffset, const aclTensor *recvData, const aclTensor *recvCount,
     const aclTensor *recvOffset, const aclTensor *expertGlobalOffset, const aclTensor *srcrankInExpertOffset,
     const aclTensor *rInSrcrankOffset, const aclTensor *totalRecvTokens, const aclTensor *maxBs,
-    const aclTensor *recvTokensPerExpert, uint64_t *workspaceSize, aclOpExecutor **executor)
+    const aclTensor *recvTokensPerExpert, const aclTensor *expertRecvStatsOptional, uint64_t *workspaceSize,
+    aclOpExecutor **executor)
 {
     return aclnnInnerNotifyDispatchGetWorkspaceSize(
         sendData, tokenPerExpertData, sendCount, numTokens, commGroup, rankSize, rankId, localRankSize, localRankId,
         round, perRoundTokens, sendDataOffset, recvData, recvCount, recvOffset, expertGlobalOffset,
-        srcrankInExpertOffset, rInSrcrankOffset, totalRecvTokens, maxBs, recvTokensPerExpert, workspaceSize, executor);
+        srcrankInExpertOffset, rInSrcrankOffset, totalRecvTokens, maxBs, recvTokensPerExpert, expertRecvStatsOptional,
+        workspaceSize, executor);
 }
 
 aclnnStatus aclnnNotifyDispatch(void *workspace, uint64_t workspaceSize, aclOpExecutor *executor, aclrtStream stream)
@@ -31,6 +31,7 @@ extern "C" {
  * totalRecvTokens : required
  * maxBs : required
  * recvTokensPerExpert : required
+ * expertRecvStatsOptional : optional, per local expert received tokens are atomically added to it
  * workspaceSize : size of workspace(output).
  * executor : executor context(output).
  */
@@ -40,7 +41,8 @@ __attribute__((visibility("default"))) aclnnStatus aclnnNotifyDispatchGetWorkspa
     int32_t perRoundTokens, const aclTensor *sendDataOffset, const aclTensor *recvData, const aclTensor *recvCount,
     const aclTensor *recvOffset, const aclTensor *expertGlobalOffset, const aclTensor *srcrankInExpertOffset,
     const aclTensor *rInSrcrankOffset, const aclTensor *totalRecvTokens, const aclTensor *maxBs,
-    const aclTensor *recvTokensPerExpert, uint64_t *workspaceSize, aclOpExecutor **executor);
+    const aclTensor *recvTokensPerExpert, const aclTensor *expertRecvStatsOptional, uint64_t *workspaceSize,
+    aclOpExecutor **executor);
 
 /* function: aclnnNotifyDispatch
  * parameters :
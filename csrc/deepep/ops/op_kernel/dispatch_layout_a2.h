@@ -42,6 +42,8 @@ public:
         numTopk_ = tilingData->dispatchLayoutInfo.numTopk;
         localRankSize_ = tilingData->dispatchLayoutInfo.localRankSize;
         serverNum_ = (numRanks_ + localRankSize_ - 1) / localRankSize_;
+        // 多机时单轮即整批，perRoundTokens 为各卡的最大 batch；单机时它是每轮 token 数，仍按 MAX_BATCH_SIZE 排布
+        maxBatchSize_ = serverNum_ > 1 ? tilingData->dispatchLayoutInfo.perRoundTokens : MAX_BATCH_SIZE;
         tpipe_ = pipe;
 
         coreIdx_ = GetBlockIdx();
@@ -96,17 +98,17 @@ public:
             localTokenServerTotalCountGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + serverOffsetOffset) +
                                                           numExperts_ + serverNum_);
             localTokenServerNumGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + serverNumOffset) + numExperts_ +
-                                                   serverNum_ * (MAX_BATCH_SIZE + 1));
+                                                   serverNum_ * (maxBatchSize_ + 1));
             localTokenServerOffsetGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + serverOffsetOffset) + numExperts_ +
-                                                      serverNum_ + MAX_BATCH_SIZE * (serverNum_ + 1));
+                                                      serverNum_ + maxBatchSize_ * (serverNum_ + 1));
             sendTokenIdxGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + sendTokenIdxOffset) + numExperts_ +
-                                            serverNum_ + MAX_BATCH_SIZE * (1 + 2 * serverNum_));
+                                            serverNum_ + maxBatchSize_ * (1 + 2 * serverNum_));
             expertRankTokenIdxGM_.SetGlobalBuffer((__gm__ T *)notifySendData + numExperts_ + serverNum_ +
-                                                  MAX_BATCH_SIZE * (1 + 2 * serverNum_ + numExperts_));
+                                                  maxBatchSize_ * (1 + 2 * serverNum_ + numExperts_));
             tempExpertGM_.SetGlobalBuffer((__gm__ T *)notifySendData + numExperts_ + serverNum_ +
-                                          MAX_BATCH_SIZE * (1 + 2 * serverNum_));
+                                          maxBatchSize_ * (1 + 2 * serverNum_));
             tempServerGM_.SetGlobalBuffer((__gm__ T *)notifySendData + numExperts_ * (1 + aivNum_) + serverNum_ +
-                                          MAX_BATCH_SIZE * (1 + 2 * serverNum_));
+                                          maxBatchSize_ * (1 + 2 * serverNum_));
             sendTokenIdxSmallGM_.SetGlobalBuffer((__gm__ T *)(sendTokenIdxSmall + topkIdxOffset / 2));
         }
     }
@@ -305,7 +307,7 @@ private:
                     int32_t preCount = numTokensPerExpertTensor.GetValue(expert_idx);
                     SyncFunc<AscendC::HardEvent::S_MTE3>();
                     const DataCopyExtParams expertRankTokendataCopyParams{1U, TEMP_BATCH_SIZE * sizeof(T), 0U, 0U, 0U};
-                    DataCopyPad(expertRankTokenIdxGM_[expert_idx * MAX_BATCH_SIZE + preCount + count - TEMP_BATCH_SIZE],
+                    DataCopyPad(expertRankTokenIdxGM_[expert_idx * maxBatchSize_ + preCount + count - TEMP_BATCH_SIZE],
                                 expertRankTokenIdxTensor[expert_idx * TEMP_BATCH_SIZE], expertRankTokendataCopyParams);
                     SyncFunc<AscendC::HardEvent::MTE3_S>();
                 }
@@ -320,7 +322,7 @@ private:
                 int32_t preCount = numTokensPerExpertTensor.GetValue(i);
                 SyncFunc<AscendC::HardEvent::S_MTE3>();
                 const DataCopyExtParams expertRankTokendataCopyParams{1U, uint32_t(rest * sizeof(T)), 0U, 0U, 0U};
-                DataCopyPad(expertRankTokenIdxGM_[i * MAX_BATCH_SIZE + preCount + count - rest],
+                DataCopyPad(expertRankTokenIdxGM_[i * maxBatchSize_ + preCount + count - rest],
                             expertRankTokenIdxTensor[i * TEMP_BATCH_SIZE], expertRankTokendataCopyParams);
             }
         }
@@ -372,6 +374,7 @@ private:
     uint32_t coreIdx_{0};
     uint32_t aivNum_{0};
     uint32_t tempTokens_{0};
+    uint32_t maxBatchSize_{0};
     uint32_t rank_{0};
 
     uint32_t topkIdx32AlignIntLen_{0};
@@ -26,6 +26,7 @@ constexpr uint64_t TIMEOUT_DETECTION_TX_UNITS = 8UL;
 constexpr uint32_t EXPAND_IDX_INFO = 3U;  // expand_idx是按3元组保存信息，分别为rank_id token_id topk_id
 constexpr uint32_t ALIGNED_LEN = 256U;    // blockReduceMax中，最多支持连续256字节数据参与计算
 constexpr float SCALE_PARAM = 127.0;      // 计算量化参数所需的缩放倍数
+constexpr uint32_t INT8_TOKEN_COMM_QUANT = 3U;  // 每个token一个scale的int8通信量化
 constexpr uint64_t ALIGNED_LEN_256 = 256UL;
 constexpr uint64_t WIN_ADDR_ALIGN = 512UL;
 constexpr uint32_t REDUCE_NUM = 8U;
@@ -80,6 +81,7 @@ private:
     __aicore__ inline void ExpertAlltoAllDispatchCopyAdd();
     __aicore__ inline void Int8QuantProcess();
     __aicore__ inline void Int8DequantProcess(LocalTensor<XType> &src);
+    __aicore__ inline float Int8TokenDequantProcess(LocalTensor<XType> &src);
     __aicore__ inline void ProcessConstantExpert(uint32_t tokenIndex, uint32_t const_expert_idx, float scaleVal);
     __aicore__ inline void ProcessCopyExpert(uint32_t tokenIndex, float scaleVal);
     __aicore__ inline void ProcessMoeExpert(uint32_t tokenIndexOffset, uint32_t topkId, float scaleVal);
@@ -192,6 +194,8 @@ private:
     uint32_t sendCntNum_{0};
     uint32_t ubSize_{0};
     uint32_t dataState_{0};
+    uint32_t commPhase_{0};
+    bool perTokenQuant_{false};  // int8通信量化时整个token共用一个scale
     uint32_t stateOffset_{0};
     uint64_t activeMaskBsCnt_{0};
     uint64_t winDataSizeOffset_{0};
@@ -374,6 +378,8 @@ MoeDistributeCombineV2<TemplateMC2TypeFunc>::InitTilingAttrs(const MoeDistribute
     aivNum_ = tilingData->moeDistributeCombineV2Info.aivNum;
     ubSize_ = tilingData->moeDistributeCombineV2Info.totalUbSize;
     globalBS_ = tilingData->moeDistributeCombineV2Info.globalBs;
+    commPhase_ = tilingData->moeDistributeCombineV2Info.commPhase;
+    perTokenQuant_ = (tilingData->moeDistributeCombineV2Info.commQuantMode == INT8_TOKEN_COMM_QUANT);
     hasElasticInfoFlag_ = tilingData->moeDistributeCombineV2Info.hasElasticInfo;
     epWorldSizeOriginal_ = tilingData->moeDistributeCombineV2Info.epWorldSize;
     epRankId_ = tilingData->moeDistributeCombineV2Info.epRankId;
@@ -407,7 +413,7 @@ MoeDistributeCombineV2<TemplateMC2TypeFunc>::InitAttrs(const MoeDistributeCombin
     TBuf<> dataStateBuf;
     tpipe_->InitBuffer(dataStateBuf, UB_ALIGN);
     dataState_ = InitWinState(selfDataStatusGMTensor_, epWinContext_, epRankIdOriginal_, moeExpertNum_,
-                              epWorldSizeOriginal_, globalBS_, dataStateBuf);
+                              epWorldSizeOriginal_, globalBS_, dataStateBuf, commPhase_);
     if (hasElasticInfoFlag_) {
         InitElasticInfo(sharedExpertRankNum);
     }
@@ -435,6 +441,9 @@ __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::InitInt8Quan
     scaleValFloat_ = static_cast<float>(1.0f / SCALE_PARAM);
     uint32_t scaleGranu = static_cast<uint32_t>(UB_ALIGN / sizeof(float));  // 计算每个block得到的reducemax结果数量
     scaleNum_ = (hExpandXAlign32Size_ / sizeof(ExpandXType)) / scaleGranu;  // 得到有效scale的个数
+    if (perTokenQuant_) {
+        scaleNum_ = 1U;  // int8数据后只跟一个scale
+    }
     repeatNum_ = static_cast<uint32_t>(hFloatAlign256Size_ /
                                        ALIGNED_LEN);  // BlockReduceMax 与 Brcb的重复迭代次数，每次256b参与计算
     mask_ = static_cast<uint32_t>(ALIGNED_LEN / sizeof(float));
@@ -874,16 +883,30 @@ __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::Int8QuantPro
     PipeBarrier<PIPE_V>();
     Abs(absFloatTensor_, winTpSendCountFloatTensor_, axisH_);  // absFloatTensor_ align到256并写0，支持ReduceMax与Brcb
     PipeBarrier<PIPE_V>();
-    BlockReduceMax(reduceMaxFloatTensor_, absFloatTensor_, repeatNum_, mask_, 1, 1, BLOCK_NUM);  // 32->1 256->8
-    PipeBarrier<PIPE_V>();
-    Muls(reduceMaxFloatTensor_, reduceMaxFloatTensor_, scaleValFloat_, scaleNum_);  // 有效个数
-    PipeBarrier<PIPE_V>();
-    Cast(scaleDivTensor_, reduceMaxFloatTensor_, RoundMode::CAST_RINT, scaleNum_);  // 有效个数
-    PipeBarrier<PIPE_V>();
-    Brcb(scaleDupLocalTensor_, reduceMaxFloatTensor_, repeatNum_, {1, BLOCK_NUM});  // 一次256
-    PipeBarrier<PIPE_V>();
-    Div(winTpSendCountFloatTensor_, winTpSendCountFloatTensor_, scaleDupLocalTensor_, axisH_);  // 有效个数
-    PipeBarrier<PIPE_V>();
+    if (perTokenQuant_) {
+        // scale = max(|x|) / 127，整个token共用
+        ReduceMax(reduceMaxFloatTensor_, absFloatTensor_, scaleDupLocalTensor_, axisH_, false);
+        SyncFunc<AscendC::HardEvent::V_S>();
+        float tokenMax = reduceMaxFloatTensor_.GetValue(0);
+        float quantScale = (tokenMax > 0.0f) ? (SCALE_PARAM / tokenMax) : 0.0f;
+        SyncFunc<AscendC::HardEvent::S_V>();
+        Muls(reduceMaxFloatTensor_, reduceMaxFloatTensor_, scaleValFloat_, scaleNum_);
+        PipeBarrier<PIPE_V>();
+        Cast(scaleDivTensor_, reduceMaxFloatTensor_, RoundMode::CAST_RINT, scaleNum_);
+        Muls(winTpSendCountFloatTensor_, winTpSendCountFloatTensor_, quantScale, axisH_);
+        PipeBarrier<PIPE_V>();
+    } else {
+        BlockReduceMax(reduceMaxFloatTensor_, absFloatTensor_, repeatNum_, mask_, 1, 1, BLOCK_NUM);  // 32->1 256->8
+        PipeBarrier<PIPE_V>();
+        Muls(reduceMaxFloatTensor_, reduceMaxFloatTensor_, scaleValFloat_, scaleNum_);  // 有效个数
+        PipeBarrier<PIPE_V>();
+        Cast(scaleDivTensor_, reduceMaxFloatTensor_, RoundMode::CAST_RINT, scaleNum_);  // 有效个数
+        PipeBarrier<PIPE_V>();
+        Brcb(scaleDupLocalTensor_, reduceMaxFloatTensor_, repeatNum_, {1, BLOCK_NUM});  // 一次256
+        PipeBarrier<PIPE_V>();
+        Div(winTpSendCountFloatTensor_, winTpSendCountFloatTensor_, scaleDupLocalTensor_, axisH_);  // 有效个数
+        PipeBarrier<PIPE_V>();
+    }
     Cast(fp16CastTensor_, winTpSendCountFloatTensor_, RoundMode::CAST_RINT, axisH_);
     PipeBarrier<PIPE_V>();
     Cast(castLocalTensor_, fp16CastTensor_, RoundMode::CAST_RINT, axisH_);
@@ -1035,6 +1058,25 @@ __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::Int8DequantP
     PipeBarrier<PIPE_V>();
 }
 
+// 每个token一个scale时，int8数据只转换到rowTmpFloatLocal_，scale留给调用方与topk权重合并成一次乘法
+template <TemplateMC2TypeClass>
+__aicore__ inline float MoeDistributeCombineV2<TemplateMC2TypeFunc>::Int8TokenDequantProcess(LocalTensor<XType> &src)
+{
+    SyncFunc<AscendC::HardEvent::MTE2_V>();
+    castLocalTensor_ = src.template ReinterpretCast<int8_t>();
+    scaleDivTensor_ = src[hAlign32Size_ / 2];
+
+    SyncFunc<AscendC::HardEvent::S_V>();
+    Cast(scaleDivFloatTensor_, scaleDivTensor_, RoundMode::CAST_NONE, scaleNum_);
+    Cast(fp16CastTensor_, castLocalTensor_, RoundMode::CAST_NONE, axisH_);
+    PipeBarrier<PIPE_V>();
+    Cast(rowTmpFloatLocal_, fp16CastTensor_, RoundMode::CAST_NONE, axisH_);
+    SyncFunc<AscendC::HardEvent::V_S>();
+    float tokenScale = scaleDivFloatTensor_.GetValue(0);
+    SyncFunc<AscendC::HardEvent::S_V>();
+    return tokenScale;
+}
+
 // 处理常量专家
 template <TemplateMC2TypeClass>
 __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::ProcessConstantExpert(uint32_t tokenIndex,
@@ -1132,9 +1174,16 @@ __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::ProcessMoeEx
     moeSumQueue_.EnQue(tmpUb);
     tmpUb = moeSumQueue_.DeQue<XType>();
     if constexpr (IsInt8Quant) {
-        Int8DequantProcess(tmpUb);
+        if (perTokenQuant_) {
+            // 反量化与topk加权合并为一次乘法
+            scaleVal *= Int8TokenDequantProcess(tmpUb);
+        } else {
+            Int8DequantProcess(tmpUb);
+        }
+    }
+    if (!IsInt8Quant || !perTokenQuant_) {
+        Cast(rowTmpFloatLocal_, tmpUb, AscendC::RoundMode::CAST_NONE, processLen);
     }
-    Cast(rowTmpFloatLocal_, tmpUb, AscendC::RoundMode::CAST_NONE, processLen);
     PipeBarrier<PIPE_V>();
     AscendC::Muls(mulBufLocal_, rowTmpFloatLocal_, scaleVal, processLen);
     PipeBarrier<PIPE_V>();
@@ -1241,9 +1290,17 @@ __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::LocalWindowC
             moeSumQueue_.EnQue(tmpUb);
             tmpUb = moeSumQueue_.DeQue<XType>();
             if constexpr (IsInt8Quant) {
-                Int8DequantProcess(tmpUb);
+                if (perTokenQuant_) {
+                    float tokenScale = Int8TokenDequantProcess(tmpUb);
+                    PipeBarrier<PIPE_V>();
+                    AscendC::Muls(rowTmpFloatLocal_, rowTmpFloatLocal_, tokenScale, processLen);
+                } else {
+                    Int8DequantProcess(tmpUb);
+                }
+            }
+            if (!IsInt8Quant || !perTokenQuant_) {
+                Cast(rowTmpFloatLocal_, tmpUb, AscendC::RoundMode::CAST_NONE, processLen);
             }
-            Cast(rowTmpFloatLocal_, tmpUb, AscendC::RoundMode::CAST_NONE, processLen);
             PipeBarrier<PIPE_V>();
             AscendC::Add(sumFloatBufLocal_, sumFloatBufLocal_, rowTmpFloatLocal_, processLen);
             PipeBarrier<PIPE_V>();
@@ -1272,11 +1329,16 @@ template <TemplateMC2TypeClass>
 __aicore__ inline void MoeDistributeCombineV2<TemplateMC2TypeFunc>::Process()
 {
     if ASCEND_IS_AIV {  // 全aiv处理
-        if constexpr (IsNeedReduceScatter) {
-            ReduceScatterTrans();
+        if (commPhase_ < COMM_PHASE_RECV) {
+            if constexpr (IsNeedReduceScatter) {
+                ReduceScatterTrans();
+            }
+            BuffInit();
+            SetWaitTpStatusAndDisPatch();
+        }
+        if (commPhase_ == COMM_PHASE_SEND) {  // 接收阶段由后续commPhase=2或3的调用完成
+            return;
         }
-        BuffInit();
-        SetWaitTpStatusAndDisPatch();
         AlltoAllBuffInitAndMaskCal();
         LocalWindowCopy();
     }
@@ -31,6 +31,8 @@ struct MoeDistributeCombineV2Info {
     uint64_t totalWinSize;
     float armAvgFactor;
     float epsilon;
+    uint32_t commPhase;      // 0: send and receive, 1: send only, 2/3: receive only
+    uint32_t commQuantMode;  // 0: none, 2: int8 with a scale per 8 channels, 3: int8 with a scale per token
 };
 struct MoeDistributeCombineV2TilingData {
     Mc2InitTiling mc2InitTiling;
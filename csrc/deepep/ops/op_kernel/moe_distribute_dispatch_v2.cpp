@@ -22,10 +22,13 @@ using namespace MoeDistributeDispatchV2Impl;
 
 extern "C" __global__ __aicore__ void moe_distribute_dispatch_v2(GM_ADDR x, GM_ADDR expertIds, GM_ADDR scales,
                                                                  GM_ADDR xActiveMask, GM_ADDR elasticInfo,
+                                                                 GM_ADDR expertLog2Phy, GM_ADDR expertLogCnt,
                                                                  GM_ADDR expandXOut, GM_ADDR dynamicScalesOut,
                                                                  GM_ADDR assistInfoOut, GM_ADDR expertTokenNumsOut,
                                                                  GM_ADDR epSendCountsOut, GM_ADDR tpSendCountsOut,
-                                                                 GM_ADDR workspaceGM, GM_ADDR tilingGM)
+                                                                 GM_ADDR expertRecvStatsOut,
+                                                                 GM_ADDR physicalExpertIdsOut, GM_ADDR workspaceGM,
+                                                                 GM_ADDR tilingGM)
 {
     REGISTER_TILING_DEFAULT(MoeDistributeDispatchV2TilingData);
     TPipe pipe;
@@ -33,16 +36,18 @@ extern "C" __global__ __aicore__ void moe_distribute_dispatch_v2(GM_ADDR x, GM_A
     if (TILING_KEY_IS(10000)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, false, false, false, false> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
     if (TILING_KEY_IS(10100)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, false, false, false, true> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
@@ -50,48 +55,54 @@ extern "C" __global__ __aicore__ void moe_distribute_dispatch_v2(GM_ADDR x, GM_A
     if (TILING_KEY_IS(10011)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, true, false, false, false> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
     if (TILING_KEY_IS(10002)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, false, true, false, false> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
     if (TILING_KEY_IS(10012)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, false, true, true, false> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
     if (TILING_KEY_IS(10111)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, true, false, false, true> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
     if (TILING_KEY_IS(10102)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, false, true, false, true> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
     if (TILING_KEY_IS(10112)) {
         GET_TILING_DATA_WITH_STRUCT(MoeDistributeDispatchV2TilingData, tilingData, tilingGM);
         MoeDistributeDispatchV2<DTYPE_X, DTYPE_EXPAND_X, false, true, true, true> op;
-        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expandXOut, dynamicScalesOut, assistInfoOut,
-                expertTokenNumsOut, epSendCountsOut, tpSendCountsOut, workspaceGM, &pipe, &tilingData);
+        op.Init(x, expertIds, scales, xActiveMask, elasticInfo, expertLog2Phy, expertLogCnt, expandXOut,
+                dynamicScalesOut, assistInfoOut, expertTokenNumsOut, epSendCountsOut, tpSendCountsOut,
+                expertRecvStatsOut, physicalExpertIdsOut, workspaceGM, &pipe, &tilingData);
         op.Process();
         return;
     }
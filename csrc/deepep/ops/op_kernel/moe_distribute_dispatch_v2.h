@@ -37,6 +37,15 @@ constexpr uint8_t SHARE_RANK_NUM_IDX = 2;
 constexpr uint8_t MOE_NUM_IDX = 3;
 constexpr int32_t BITS_PER_BYTE = 8;
 constexpr uint32_t MAX_UB_SIZE = 170U * 1024U;
+constexpr uint32_t DYNAMIC_GROUP_QUANT = 3U;       // 每QUANT_GROUP_SIZE个通道一个动态scale
+constexpr uint32_t DYNAMIC_GROUP_POW2_QUANT = 4U;  // 同上，scale向上取整到2的幂
+constexpr uint32_t QUANT_GROUP_SIZE = 128U;
+constexpr uint32_t FLOAT_PER_REPEAT = 64U;  // 一次vector repeat处理的float个数
+constexpr uint32_t FLOAT_PER_BLOCK = 8U;    // 32B block内的float个数
+constexpr float MIN_GROUP_AMAX = 1e-4f;     // 全0分组的scale下限，避免除0
+constexpr uint32_t RECV_STATS_NONE = 0U;
+constexpr uint32_t RECV_STATS_PER_SRC_RANK = 2U;  // 按[本卡专家数, epWorldSize]统计，否则按[本卡专家数]统计
+constexpr uint32_t REPLICA_LEAST_LOADED = 1U;     // 选本卡已发送token最少的副本，否则按token轮询
 
 #define TemplateMC2TypeClass                                                                               \
     typename XType, typename ExpandXOutType, bool StaticQuant, bool DynamicQuant, bool IsSmoothScaleExist, \
@@ -51,16 +60,20 @@ class MoeDistributeDispatchV2
 public:
     __aicore__ inline MoeDistributeDispatchV2(){};
     __aicore__ inline void Init(GM_ADDR x, GM_ADDR expertIds, GM_ADDR scales, GM_ADDR xActiveMask, GM_ADDR elasticInfo,
-                                GM_ADDR expandXOut, GM_ADDR dynamicScalesOut, GM_ADDR expandIdxOut,
-                                GM_ADDR expertTokenNumsOut, GM_ADDR sendCountsOut, GM_ADDR tpSendCountsOut,
-                                GM_ADDR workspaceGM, TPipe *pipe, const MoeDistributeDispatchV2TilingData *tilingData);
+                                GM_ADDR expertLog2Phy, GM_ADDR expertLogCnt, GM_ADDR expandXOut,
+                                GM_ADDR dynamicScalesOut, GM_ADDR expandIdxOut, GM_ADDR expertTokenNumsOut,
+                                GM_ADDR sendCountsOut, GM_ADDR tpSendCountsOut, GM_ADDR expertRecvStatsOut,
+                                GM_ADDR physicalExpertIdsOut, GM_ADDR workspaceGM, TPipe *pipe,
+                                const MoeDistributeDispatchV2TilingData *tilingData);
     __aicore__ inline void Process();
 
 private:
     __aicore__ inline void SendToSharedExpert();
     __aicore__ inline void SendToMoeExpert();
     __aicore__ inline void AlltoAllDispatch();
+    __aicore__ inline void MapLogicalExperts(LocalTensor<int32_t> &idsTensor);
     __aicore__ inline void LocalWindowCopy();
+    __aicore__ inline void AccumulateRecvStats();
     __aicore__ inline void TokenActiveMaskCal();
     __aicore__ inline void ExpertActiveMaskCal();
     __aicore__ inline void TimeOutDetection();
@@ -72,6 +85,7 @@ private:
     __aicore__ inline void ZeroComputeExpertMaskCal();
     __aicore__ inline void ReduceMaxInplace(const LocalTensor<float> &srcLocal, uint32_t count);
     __aicore__ inline void QuantProcess(uint32_t expertIndex);
+    __aicore__ inline void GroupQuantProcess(LocalTensor<float> &floatLocalTemp);
     __aicore__ inline void SetStatus();
     __aicore__ inline void BufferInit();
     __aicore__ inline void InitElasticInfo(bool isWaitDispatch = false);
@@ -136,6 +150,10 @@ private:
     GlobalTensor<int32_t> winTpEpCntGMTensor_;
     GlobalTensor<int32_t> expandIdxGMTensor_;
     GlobalTensor<int32_t> elasticInfoGMTensor_;
+    GlobalTensor<int32_t> expertRecvStatsGMTensor_;
+    GlobalTensor<int32_t> expertLog2PhyGMTensor_;
+    GlobalTensor<int32_t> expertLogCntGMTensor_;
+    GlobalTensor<int32_t> physicalExpertIdsGMTensor_;
     GlobalTensor<uint32_t> selfDataStatusGMTensor_;
     GlobalTensor<uint32_t> selfhcclDataStatusTensor_;
 
@@ -160,6 +178,8 @@ private:
 
     TBuf<> expertIdsBuf_;
     TBuf<> statusBuf_;
+    TBuf<> recvStatsBuf_;  // 本核负责区间的专家接收token数
+    TBuf<> replicaBuf_;    // 副本表、各逻辑专家副本数、本卡发往各物理专家的token数
     TBuf<> gatherMaskOutBuf_;  // gather mask输出buf
     TBuf<> sumCoreBuf_;
     TBuf<> sumLocalBuf_;
@@ -230,6 +250,16 @@ private:
     uint32_t totalCnt_;
     uint32_t lastCore_{0};
     uint32_t dataState_{0};
+    uint32_t commPhase_{0};
+    uint32_t recvStatsMode_{RECV_STATS_NONE};  // 专家接收统计方式，0为不统计
+    uint32_t logicalExpertNum_{0};  // 副本表行数，0表示expertIds已是物理专家id
+    uint32_t maxReplicaNum_{0};
+    uint32_t replicaPolicy_{0};
+    uint32_t replicaCntOffset_{0};   // replicaBuf_中副本数的起始元素偏移
+    uint32_t replicaLoadOffset_{0};  // replicaBuf_中负载计数的起始元素偏移
+    uint32_t scaleNum_{1};        // 每个token的scale个数，按token量化为1
+    bool groupQuant_{false};      // 每QUANT_GROUP_SIZE个通道一个scale
+    bool roundScale_{false};      // scale向上取整到2的幂
     uint32_t axisBsAlignSize_{0};
     uint32_t totalUsedUB_{0};
     uint64_t activeMaskBsCnt_{0};
@@ -293,9 +323,10 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::InitElastic
 
 template <TemplateMC2TypeClass>
 __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Init(
-    GM_ADDR x, GM_ADDR expertIds, GM_ADDR scales, GM_ADDR xActiveMask, GM_ADDR elasticInfo, GM_ADDR expandXOut,
-    GM_ADDR dynamicScalesOut, GM_ADDR expandIdxOut, GM_ADDR expertTokenNumsOut, GM_ADDR sendCountsOut,
-    GM_ADDR tpSendCountsOut, GM_ADDR workspaceGM, TPipe *pipe, const MoeDistributeDispatchV2TilingData *tilingData)
+    GM_ADDR x, GM_ADDR expertIds, GM_ADDR scales, GM_ADDR xActiveMask, GM_ADDR elasticInfo, GM_ADDR expertLog2Phy,
+    GM_ADDR expertLogCnt, GM_ADDR expandXOut, GM_ADDR dynamicScalesOut, GM_ADDR expandIdxOut,
+    GM_ADDR expertTokenNumsOut, GM_ADDR sendCountsOut, GM_ADDR tpSendCountsOut, GM_ADDR expertRecvStatsOut,
+    GM_ADDR physicalExpertIdsOut, GM_ADDR workspaceGM, TPipe *pipe, const MoeDistributeDispatchV2TilingData *tilingData)
 {
     tpipe_ = pipe;
     aivId_ = GetBlockIdx();
@@ -318,13 +349,18 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Init(
     sharedExpertRankNum_ = tilingData->moeDistributeDispatchV2Info.sharedExpertRankNum;
     moeExpertNum_ = tilingData->moeDistributeDispatchV2Info.moeExpertNum;
     globalBS_ = tilingData->moeDistributeDispatchV2Info.globalBs;
+    commPhase_ = tilingData->moeDistributeDispatchV2Info.commPhase;
+    recvStatsMode_ = tilingData->moeDistributeDispatchV2Info.expertRecvStatsMode;
+    logicalExpertNum_ = tilingData->moeDistributeDispatchV2Info.logicalExpertNum;
+    maxReplicaNum_ = tilingData->moeDistributeDispatchV2Info.maxReplicaNum;
+    replicaPolicy_ = tilingData->moeDistributeDispatchV2Info.replicaPolicy;
     statusDataSpaceGm_ = (GM_ADDR)(winContext_[0]->localWindowsExp);
     selfDataStatusGMTensor_.SetGlobalBuffer(
         (__gm__ uint32_t *)(statusDataSpaceGm_ + STATE_WIN_OFFSET + aivId_ * WIN_ADDR_ALIGN));
     TBuf<> dataStateBuf;
     tpipe_->InitBuffer(dataStateBuf, UB_ALIGN);
     dataState_ = InitWinState(selfDataStatusGMTensor_, winContext_[0], epRankIdOriginal_, moeExpertNum_,
-                              epWorldSizeOriginal_, globalBS_, dataStateBuf);
+                              epWorldSizeOriginal_, globalBS_, dataStateBuf, commPhase_);
     elasticInfoGMTensor_.SetGlobalBuffer((__gm__ int32_t *)(elasticInfo));
     if (hasElasticInfoFlag_) {
         InitElasticInfo(false);
@@ -351,6 +387,12 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Init(
     axisK_ = tilingData->moeDistributeDispatchV2Info.k;
     aivNum_ = tilingData->moeDistributeDispatchV2Info.aivNum;
     tpWorldSize_ = tilingData->moeDistributeDispatchV2Info.tpWorldSize;
+    uint32_t quantMode = tilingData->moeDistributeDispatchV2Info.quantMode;
+    groupQuant_ = (quantMode == DYNAMIC_GROUP_QUANT) || (quantMode == DYNAMIC_GROUP_POW2_QUANT);
+    roundScale_ = (quantMode == DYNAMIC_GROUP_POW2_QUANT);
+    if (groupQuant_) {
+        scaleNum_ = axisH_ / QUANT_GROUP_SIZE;
+    }
     xGMTensor_.SetGlobalBuffer((__gm__ XType *)x);
     xActiveMaskGMTensor_.SetGlobalBuffer((__gm__ bool *)xActiveMask);
     expertIdsGMTensor_.SetGlobalBuffer((__gm__ int32_t *)expertIds);
@@ -360,13 +402,17 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Init(
     expandXOutGM_ = expandXOut;
     sendCountsOutGM_ = sendCountsOut;  // 无GlobalTensor
     sendTpCountOutGM_ = tpSendCountsOut;
+    expertRecvStatsGMTensor_.SetGlobalBuffer((__gm__ int32_t *)expertRecvStatsOut);
+    expertLog2PhyGMTensor_.SetGlobalBuffer((__gm__ int32_t *)expertLog2Phy);
+    expertLogCntGMTensor_.SetGlobalBuffer((__gm__ int32_t *)expertLogCnt);
+    physicalExpertIdsGMTensor_.SetGlobalBuffer((__gm__ int32_t *)physicalExpertIdsOut);
     recvCntWorkspaceGM_ = workspaceGM;
 
     hOutSize_ = axisH_ * sizeof(ExpandXOutType);
     hOutSizeAlign_ = Ceil(hOutSize_, UB_ALIGN) * UB_ALIGN;  // scale起始放置偏移
-    uint32_t hScaleSizeAlign = hOutSizeAlign_ + UB_ALIGN;   // 填充三元组起始偏移
+    uint32_t hScaleSizeAlign = hOutSizeAlign_ + Ceil(scaleNum_ * sizeof(float), UB_ALIGN) * UB_ALIGN;  // 三元组起始偏移
     tokenQuantAlign_ = hScaleSizeAlign / sizeof(int32_t);
-    // 实际搬运大小，搬运token_align32B + 32B(float) + 3*4B(三元组)
+    // 实际搬运大小，搬运token_align32B + scale_align32B(float) + 3*4B(三元组)
     uint32_t hScaleIdxSize = hScaleSizeAlign + EXPAND_IDX_INFO * sizeof(int32_t);
     hAlignWinSize_ = Ceil(hScaleIdxSize, WIN_ADDR_ALIGN) * WIN_ADDR_ALIGN;  // win区token起始地址对齐512
     hAlignWinCnt_ = hAlignWinSize_ / sizeof(ExpandXOutType);
@@ -479,6 +525,15 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Init(
         validExpertIndexTensor_ = validExpertIndexBuf_.Get<int32_t>();
         validBsIndexTensor_ = validBsIndexTBuf_.Get<int32_t>();
     }
+    if (logicalExpertNum_ != 0U) {
+        uint32_t intPerBlock = UB_ALIGN / sizeof(int32_t);
+        replicaCntOffset_ = Ceil(logicalExpertNum_ * maxReplicaNum_, intPerBlock) * intPerBlock;
+        replicaLoadOffset_ = replicaCntOffset_ + Ceil(logicalExpertNum_, intPerBlock) * intPerBlock;
+        uint32_t replicaBufCnt = replicaLoadOffset_ + Ceil(moeExpertNum_, intPerBlock) * intPerBlock;
+        uint32_t replicaBufSize = replicaBufCnt * sizeof(int32_t);
+        tpipe_->InitBuffer(replicaBuf_, replicaBufSize);
+        totalUsedUB_ += replicaBufSize;
+    }
 
     if constexpr (DynamicQuant || StaticQuant) {
         QuantInit(scales);
@@ -498,7 +553,7 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Init(
     subExpIdTensor_ = subExpBuf_.Get<int32_t>();
 
     uint32_t axisHCommu = hScaleIdxSize / sizeof(ExpandXOutType);  // 有效搬运长度
-    floatDataCopyParams_ = {1U, sizeof(float), 0U, 0U, 0U};
+    floatDataCopyParams_ = {1U, static_cast<uint32_t>(scaleNum_ * sizeof(float)), 0U, 0U, 0U};
     xCopyParams_ = {1U, static_cast<uint32_t>(axisH_ * sizeof(XType)), 0U, 0U, 0U};
     hCommuCopyOutParams_ = {1U, static_cast<uint32_t>(axisHCommu * sizeof(ExpandXOutType)), 0U, 0U, 0U};
     expandXCopyParams_ = {1U, static_cast<uint32_t>(axisH_ * sizeof(ExpandXOutType)), 0U, 0U, 0U};
@@ -515,7 +570,16 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::QuantInit(G
     smoothScalesTensor_ = smoothScalesBuf_.Get<float>();
     scalesGMTensor_.SetGlobalBuffer((__gm__ float *)scales);
     if constexpr (DynamicQuant) {
-        tpipe_->InitBuffer(rowMaxBuf_, UB_ALIGN);  // 32B
+        if (groupQuant_) {
+            // 先放每32B的最大值(H/8个)，再放每个scale广播成的32B(scaleNum个)
+            uint32_t blockMaxSize = Ceil(axisH_ / FLOAT_PER_BLOCK * sizeof(float), UB_ALIGN) * UB_ALIGN;
+            uint32_t scaleBrcbSize = Ceil(scaleNum_, FLOAT_PER_BLOCK) * UB_ALIGN * FLOAT_PER_BLOCK;
+            uint32_t rowMaxSize = blockMaxSize > scaleBrcbSize ? blockMaxSize : scaleBrcbSize;
+            tpipe_->InitBuffer(rowMaxBuf_, rowMaxSize);
+            totalUsedUB_ += rowMaxSize;
+        } else {
+            tpipe_->InitBuffer(rowMaxBuf_, UB_ALIGN);  // 32B
+        }
     }
     uint32_t tmpTotalUB = totalUsedUB_ + BUFFER_NUM * hAlignSize + hOutAlignUbSize_ * BUFFER_NUM;
     bufferNum_ = tmpTotalUB > MAX_UB_SIZE ? BUFFER_SINGLE : BUFFER_NUM;
@@ -872,6 +936,61 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::ZeroCompute
     MaskZeroComputeExpert(maskCnt);
 }
 
+/*
+将逻辑专家id原地替换为物理副本id，各核对全部bs*k个id做相同计算，结果一致：
+轮询：第tokenId个token选 (tokenId + epRankId) % 副本数 号副本；
+最少负载：从轮询位置起选本卡本次已发往token数最少的副本。
+负数等不在[0, 逻辑专家数)内的id保持不变，0核将结果写出供combine使用。
+*/
+template <TemplateMC2TypeClass>
+__aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::MapLogicalExperts(LocalTensor<int32_t> &idsTensor)
+{
+    LocalTensor<int32_t> log2PhyTensor = replicaBuf_.Get<int32_t>();
+    LocalTensor<int32_t> logCntTensor = log2PhyTensor[replicaCntOffset_];
+    LocalTensor<int32_t> loadTensor = log2PhyTensor[replicaLoadOffset_];
+    DataCopyPadExtParams<int32_t> copyPadParams{false, 0U, 0U, 0U};
+    DataCopyExtParams log2PhyParams{
+        1U, static_cast<uint32_t>(logicalExpertNum_ * maxReplicaNum_ * sizeof(int32_t)), 0U, 0U, 0U};
+    DataCopyExtParams logCntParams{1U, static_cast<uint32_t>(logicalExpertNum_ * sizeof(int32_t)), 0U, 0U, 0U};
+    DataCopyPad(log2PhyTensor, expertLog2PhyGMTensor_, log2PhyParams, copyPadParams);
+    DataCopyPad(logCntTensor, expertLogCntGMTensor_, logCntParams, copyPadParams);
+    bool leastLoaded = (replicaPolicy_ == REPLICA_LEAST_LOADED);
+    if (leastLoaded) {
+        Duplicate<int32_t>(loadTensor, 0, moeExpertNum_);
+        SyncFunc<AscendC::HardEvent::V_S>();
+    }
+    SyncFunc<AscendC::HardEvent::MTE2_S>();
+
+    for (uint32_t index = 0; index < expertIdsCnt_; ++index) {
+        int32_t logicalId = idsTensor.GetValue(index);
+        if ((logicalId < 0) || (logicalId >= static_cast<int32_t>(logicalExpertNum_))) {
+            continue;
+        }
+        uint32_t replicaCnt = static_cast<uint32_t>(logCntTensor.GetValue(logicalId));
+        uint32_t rowOffset = static_cast<uint32_t>(logicalId) * maxReplicaNum_;
+        uint32_t slot = (index / axisK_ + static_cast<uint32_t>(epRankIdOriginal_)) % replicaCnt;
+        int32_t physicalId = log2PhyTensor.GetValue(rowOffset + slot);
+        if (leastLoaded) {
+            for (uint32_t step = 1U; step < replicaCnt; ++step) {
+                int32_t candidate = log2PhyTensor.GetValue(rowOffset + (slot + step) % replicaCnt);
+                if (loadTensor.GetValue(candidate) < loadTensor.GetValue(physicalId)) {
+                    physicalId = candidate;
+                }
+            }
+            loadTensor.SetValue(physicalId, loadTensor.GetValue(physicalId) + 1);
+        }
+        idsTensor.SetValue(index, physicalId);
+    }
+
+    if (aivId_ == 0) {
+        SyncFunc<AscendC::HardEvent::S_MTE3>();
+        DataCopyExtParams idsOutParams{1U, static_cast<uint32_t>(expertIdsCnt_ * sizeof(int32_t)), 0U, 0U, 0U};
+        DataCopyPad(physicalExpertIdsGMTensor_, idsTensor, idsOutParams);
+        SyncFunc<AscendC::HardEvent::MTE3_V>();
+    }
+    SyncFunc<AscendC::HardEvent::S_V>();
+}
+
 /*
 共享专家卡：所有核用于给moe专家发送数据
 moe专家卡：部分核用于给共享专家发送数据，部分核用于给moe专家发送数据
@@ -911,11 +1030,18 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::AlltoAllDis
         uint32_t mask = expertIdsCnt_;
         LocalTensor<int32_t> tmpExpertIdsTensor = subExpBuf_.Get<int32_t>();
         DataCopyPad(tmpExpertIdsTensor, expertIdsGMTensor_, expertIdsCntParams, expertIdsCntCopyPadParams);
+        if (logicalExpertNum_ != 0U) {  // 按原始位置选副本，再压缩
+            SyncFunc<AscendC::HardEvent::MTE2_S>();
+            MapLogicalExperts(tmpExpertIdsTensor);
+        }
         SyncFunc<AscendC::HardEvent::MTE2_V>();
         GatherMask(expertIdsTensor_, tmpExpertIdsTensor, gatherMaskTensor_, true, mask, {1, 1, 1, 0}, rsvdCnt);
     } else {
         DataCopyPad(expertIdsTensor_, expertIdsGMTensor_, expertIdsCntParams, expertIdsCntCopyPadParams);
         SyncFunc<AscendC::HardEvent::MTE2_S>();
+        if (logicalExpertNum_ != 0U) {
+            MapLogicalExperts(expertIdsTensor_);
+        }
     }
     if (isSendShared) {  // 用于send共享专家数据的核，也需要搬运expertIds，后续会重新分核写状态位置，该核可能用于写moe专家flag
         return;
@@ -1013,18 +1139,22 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::QuantProces
     }
 
     if constexpr (DynamicQuant) {
-        LocalTensor<float> floatLocalAbsTemp = smoothScalesBuf_.Get<float>();
-        rowMaxTensor_ = rowMaxBuf_.Get<float>();
-
-        Abs(floatLocalAbsTemp, floatLocalTemp, axisH_);
-        PipeBarrier<PIPE_V>();
-        ReduceMaxInplace(floatLocalAbsTemp, axisH_);
-
-        SyncFunc<AscendC::HardEvent::V_S>();
-        dynamicScale = float(127.0) / floatLocalAbsTemp.GetValue(0);
-        SyncFunc<AscendC::HardEvent::S_V>();
-        Muls(floatLocalTemp, floatLocalTemp, dynamicScale, axisH_);
-        PipeBarrier<PIPE_V>();
+        if (groupQuant_) {
+            GroupQuantProcess(floatLocalTemp);
+        } else {
+            LocalTensor<float> floatLocalAbsTemp = smoothScalesBuf_.Get<float>();
+            rowMaxTensor_ = rowMaxBuf_.Get<float>();
+
+            Abs(floatLocalAbsTemp, floatLocalTemp, axisH_);
+            PipeBarrier<PIPE_V>();
+            ReduceMaxInplace(floatLocalAbsTemp, axisH_);
+
+            SyncFunc<AscendC::HardEvent::V_S>();
+            dynamicScale = float(127.0) / floatLocalAbsTemp.GetValue(0);
+            SyncFunc<AscendC::HardEvent::S_V>();
+            Muls(floatLocalTemp, floatLocalTemp, dynamicScale, axisH_);
+            PipeBarrier<PIPE_V>();
+        }
     }
     LocalTensor<half> halfLocalTemp = floatLocalTemp.ReinterpretCast<half>();
     LocalTensor<int32_t> int32LocalTemp = floatLocalTemp.ReinterpretCast<int32_t>();
@@ -1038,8 +1168,53 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::QuantProces
     PipeBarrier<PIPE_V>();
     Cast(xOutTensor_, halfLocalTemp, RoundMode::CAST_TRUNC, axisH_);
 
-    floatLocalTemp = xOutTensor_.template ReinterpretCast<float>();
-    floatLocalTemp.SetValue(hOutSizeAlign_ / sizeof(float), float(1.0) / dynamicScale);  // int8->float32
+    if (!groupQuant_) {
+        floatLocalTemp = xOutTensor_.template ReinterpretCast<float>();
+        floatLocalTemp.SetValue(hOutSizeAlign_ / sizeof(float), float(1.0) / dynamicScale);  // int8->float32
+    }
+}
+
+// 每QUANT_GROUP_SIZE个通道求一个scale = amax / 127，直接写到xOutTensor_的scale区，并将floatLocalTemp除以对应scale
+template <TemplateMC2TypeClass>
+__aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::GroupQuantProcess(
+    LocalTensor<float> &floatLocalTemp)
+{
+    LocalTensor<float> floatLocalAbsTemp = smoothScalesBuf_.Get<float>();
+    LocalTensor<float> scaleOutTensor = xOutTensor_.template ReinterpretCast<float>()[hOutSizeAlign_ / sizeof(float)];
+    rowMaxTensor_ = rowMaxBuf_.Get<float>();
+    uint32_t repeatNum = axisH_ / FLOAT_PER_REPEAT;
+
+    Abs(floatLocalAbsTemp, floatLocalTemp, axisH_);
+    PipeBarrier<PIPE_V>();
+    // 每32B(8个float)求最大值，再每16个最大值(128通道)求一次
+    BlockReduceMax(rowMaxTensor_, floatLocalAbsTemp, repeatNum, FLOAT_PER_REPEAT, 1, 1, FLOAT_PER_BLOCK);
+    PipeBarrier<PIPE_V>();
+    WholeReduceMax(floatLocalAbsTemp, rowMaxTensor_, QUANT_GROUP_SIZE / FLOAT_PER_BLOCK, scaleNum_, 1, 1,
+                   QUANT_GROUP_SIZE / FLOAT_PER_BLOCK / FLOAT_PER_BLOCK, ReduceOrder::ORDER_ONLY_VALUE);
+    PipeBarrier<PIPE_V>();
+    Maxs(floatLocalAbsTemp, floatLocalAbsTemp, MIN_GROUP_AMAX, scaleNum_);
+    PipeBarrier<PIPE_V>();
+    Muls(scaleOutTensor, floatLocalAbsTemp, float(1.0) / float(127.0), scaleNum_);
+    PipeBarrier<PIPE_V>();
+    if (roundScale_) {
+        // 正数float加上尾数全1再清零尾数，即向上取整到2的幂，可直接用UE8M0表示
+        LocalTensor<int32_t> scaleBitsTensor = scaleOutTensor.template ReinterpretCast<int32_t>();
+        Adds(scaleBitsTensor, scaleBitsTensor, static_cast<int32_t>(0x007FFFFF), scaleNum_);
+        PipeBarrier<PIPE_V>();
+        ShiftRight(scaleBitsTensor, scaleBitsTensor, static_cast<int32_t>(23), scaleNum_);
+        PipeBarrier<PIPE_V>();
+        ShiftLeft(scaleBitsTensor, scaleBitsTensor, static_cast<int32_t>(23), scaleNum_);
+        PipeBarrier<PIPE_V>();
+    }
+    // 每个scale广播成一个32B，前后半个分组各用一次repeat跨16个block的Div
+    Brcb(rowMaxTensor_, scaleOutTensor, Ceil(scaleNum_, FLOAT_PER_BLOCK), {1, FLOAT_PER_BLOCK});
+    PipeBarrier<PIPE_V>();
+    uint8_t groupRepStride = static_cast<uint8_t>(QUANT_GROUP_SIZE / FLOAT_PER_BLOCK);
+    BinaryRepeatParams divParams = {1, 1, 0, groupRepStride, groupRepStride, 1};
+    Div(floatLocalTemp, floatLocalTemp, rowMaxTensor_, FLOAT_PER_REPEAT, scaleNum_, divParams);
+    Div(floatLocalTemp[FLOAT_PER_REPEAT], floatLocalTemp[FLOAT_PER_REPEAT], rowMaxTensor_, FLOAT_PER_REPEAT,
+        scaleNum_, divParams);
+    PipeBarrier<PIPE_V>();
 }
 
 template <TemplateMC2TypeClass>
@@ -1104,6 +1279,9 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::BufferInit(
     tpipe_->InitBuffer(sumContinueBuf_, aivNum_ * sizeof(float));  // 48 * 4B
     tpipe_->InitBuffer(scalarBuf_, UB_ALIGN * 3);                  // 96B
     tpipe_->InitBuffer(xQueue_, BUFFER_NUM, hOutAlignUbSize_);     // 7k*2 + 32 + 12
+    if (recvStatsMode_ != RECV_STATS_NONE) {
+        tpipe_->InitBuffer(recvStatsBuf_, Ceil(recStatusNumPerCore_ * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);
+    }
 }
 
 template <TemplateMC2TypeClass>
@@ -1289,8 +1467,8 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::LocalWindow
                         dataCopyExpandIdxParams);
             if constexpr (DynamicQuant || StaticQuant) {
                 xOutFp32Tensor_ = xTmpTensor_.template ReinterpretCast<float>();
-                DataCopyPad(dynamicScalesOutGMTensor_[beginIdx + j], xOutFp32Tensor_[hOutSizeAlign_ / sizeof(float)],
-                            floatDataCopyParams_);
+                DataCopyPad(dynamicScalesOutGMTensor_[(beginIdx + j) * scaleNum_],
+                            xOutFp32Tensor_[hOutSizeAlign_ / sizeof(float)], floatDataCopyParams_);
             }
             if constexpr (IsNeedAllgather) {
                 DataCopyPad(winTpGatherOutGMTensor_[(beginIdx + j) * hAlignWinCnt_], xTmpTensor_, hCommuCopyOutParams_);
@@ -1315,6 +1493,37 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::LocalWindow
     sendCountsGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ int32_t *>(sendCountsOutGM_));
     DataCopyPad(sendCountsGlobal[startExpertId_], outCountLocal, dataCopyOutParams);
     PipeBarrier<PIPE_MTE3>();
+    if (recvStatsMode_ != RECV_STATS_NONE) {
+        AccumulateRecvStats();
+    }
+}
+
+// 在线负载均衡统计：本核负责的状态区间在统计tensor中连续，汇总后一次原子累加到GM，不额外起核
+template <TemplateMC2TypeClass>
+__aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::AccumulateRecvStats()
+{
+    if (endExpertId_ <= startExpertId_) {
+        return;
+    }
+    // 状态index = 本卡专家id * epWorldSize + 源卡id，共享专家卡只有一个专家
+    uint32_t statDivisor = (recvStatsMode_ == RECV_STATS_PER_SRC_RANK) ? 1U : epWorldSize_;
+    uint32_t statBegin = startExpertId_ / statDivisor;
+    uint32_t statNum = (endExpertId_ - 1U) / statDivisor - statBegin + 1U;
+    LocalTensor<int32_t> recvStatsTensor = recvStatsBuf_.Get<int32_t>();
+    for (uint32_t i = 0; i < statNum; i++) {
+        recvStatsTensor.SetValue(i, 0);
+    }
+    for (uint32_t index = startExpertId_; index < endExpertId_; index++) {
+        uint32_t slot = index / statDivisor - statBegin;
+        int32_t count = statusTensor_.GetValue((index - startExpertId_) * 8 + 1);
+        recvStatsTensor.SetValue(slot, recvStatsTensor.GetValue(slot) + count);
+    }
+    SyncFunc<AscendC::HardEvent::S_MTE3>();
+    DataCopyExtParams statsCopyOutParams{1U, static_cast<uint32_t>(statNum * sizeof(int32_t)), 0U, 0U, 0U};
+    AscendC::SetAtomicAdd<int32_t>();
+    DataCopyPad(expertRecvStatsGMTensor_[statBegin], recvStatsTensor, statsCopyOutParams);
+    AscendC::SetAtomicNone();
+    PipeBarrier<PIPE_MTE3>();
 }
 
 template <TemplateMC2TypeClass>
@@ -1403,7 +1612,7 @@ __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::AllgatherPr
         DataCopyPad(expandXOutGlobal, xTmpTensor_, expandXCopyParams_);
         if constexpr (StaticQuant || DynamicQuant) {
             xOutFp32Tensor_ = xTmpTensor_.template ReinterpretCast<float>();
-            DataCopyPad(dynamicScalesOutGMTensor_[preCount + totalCnt_ + i],
+            DataCopyPad(dynamicScalesOutGMTensor_[(preCount + totalCnt_ + i) * scaleNum_],
                         xOutFp32Tensor_[hOutSizeAlign_ / sizeof(float)], floatDataCopyParams_);
         }
         xQueue_.FreeTensor(xTmpTensor_);
@@ -1486,8 +1695,13 @@ template <TemplateMC2TypeClass>
 __aicore__ inline void MoeDistributeDispatchV2<TemplateMC2TypeFunc>::Process()
 {
     if ASCEND_IS_AIV {  // 全aiv处理
-        AlltoAllDispatch();
-        SetStatus();
+        if (commPhase_ < COMM_PHASE_RECV) {
+            AlltoAllDispatch();
+            SetStatus();
+        }
+        if (commPhase_ == COMM_PHASE_SEND) {  // 接收阶段由后续commPhase=2或3的调用完成
+            return;
+        }
         WaitDispatch();
         LocalWindowCopy();
         if constexpr (IsNeedAllgather) {
@@ -25,6 +25,11 @@ struct MoeDistributeDispatchV2Info {
     uint32_t expertTokenNumsType;  // expert token nums type, support 0: cumsum mode, 1: count mode
     int32_t zeroComputeExpertNum;  // sum of zero、copy and const expert nums
     uint32_t cumSumUBMinValue;     // Minimum value for CumSum remainder（in UB）
+    uint32_t commPhase;            // 0: send and receive, 1: send only, 2/3: receive only
+    uint32_t expertRecvStatsMode;  // 0: no stats, 1: per local expert, 2: per local expert and source rank
+    uint32_t logicalExpertNum;     // rows of the replica table, 0: expertIds are physical ids
+    uint32_t maxReplicaNum;        // columns of the replica table
+    uint32_t replicaPolicy;        // 0: round-robin over tokens, 1: least-loaded replica on this rank
 };
 
 struct MoeDistributeDispatchV2TilingData {
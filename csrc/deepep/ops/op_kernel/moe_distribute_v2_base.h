@@ -15,6 +15,13 @@ constexpr uint32_t HCCL_EPRANKId_POS = 0U;
 constexpr uint32_t HCCL_WORLDSIZE_POS = 1U;
 constexpr uint32_t UB_ALIGN = 32U;
 
+// commPhase: 0 = send and receive in one launch, 1 = send only, 2 = receive of the latest send,
+// 3 = receive of the send before it, whose half was left by one more send
+constexpr uint32_t COMM_PHASE_ALL = 0U;
+constexpr uint32_t COMM_PHASE_SEND = 1U;
+constexpr uint32_t COMM_PHASE_RECV = 2U;
+constexpr uint32_t COMM_PHASE_RECV_PREV = 3U;
+
 template <AscendC::HardEvent event>
 __aicore__ inline void SyncFunc()
 {
@@ -27,7 +34,7 @@ using namespace AscendC;
 __aicore__ inline uint32_t InitWinState(GlobalTensor<uint32_t> selfDataStatusGMTensor,
                                         __gm__ HcclOpResParam *winContext, uint32_t epRankIdOriginal,
                                         uint32_t moeExpertNum, uint32_t epWorldSizeOriginal, uint32_t globalBS,
-                                        TBuf<> dataStateBuf)
+                                        TBuf<> dataStateBuf, uint32_t commPhase = COMM_PHASE_ALL)
 {
     LocalTensor<uint64_t> dataStateLocalTensor64 = dataStateBuf.Get<uint64_t>();
     LocalTensor<uint32_t> dataStateLocalTensor = dataStateBuf.Get<uint32_t>();
@@ -36,6 +43,13 @@ __aicore__ inline uint32_t InitWinState(GlobalTensor<uint32_t> selfDataStatusGMT
     uint32_t epRankIdHccl = winContext->localUsrRankId;
     uint32_t epWorldSizeHccl = winContext->rankSize;
     uint32_t dataState = dataStateLocalTensor.GetValue(ZERONE_STATE_POS);
+    // 仅接收阶段复用发送阶段已切换的半区，不再翻转状态；其后又有一次发送时，状态已翻回该半区
+    if (commPhase == COMM_PHASE_RECV) {
+        return dataState == 0 ? 1 : 0;
+    }
+    if (commPhase == COMM_PHASE_RECV_PREV) {
+        return dataState;
+    }
     dataStateLocalTensor.SetValue(ZERONE_STATE_POS, dataState == 0 ? 1 : 0);
     dataStateLocalTensor.SetValue(OPOSITION_POS, 1);
     dataStateLocalTensor.SetValue(TILING_EPRANKID_POS, epRankIdOriginal);
@@ -11,7 +11,8 @@ extern "C" __global__ __aicore__ void notify_dispatch(GM_ADDR sendData, GM_ADDR
                                                       GM_ADDR recvOffset, GM_ADDR expertGlobalOffset,
                                                       GM_ADDR srcrankInExpertOffset, GM_ADDR rInSrcrankOffset,
                                                       GM_ADDR totalRecvTokens, GM_ADDR maxBs,
-                                                      GM_ADDR recvTokensPerExpert, GM_ADDR workspace, GM_ADDR tiling)
+                                                      GM_ADDR recvTokensPerExpert, GM_ADDR expertRecvStats,
+                                                      GM_ADDR workspace, GM_ADDR tiling)
 {
     REGISTER_TILING_DEFAULT(NotifyDispatchTilingData);
     GET_TILING_DATA_WITH_STRUCT(NotifyDispatchTilingData, tilingData, tiling);
@@ -25,6 +26,7 @@ extern "C" __global__ __aicore__ void notify_dispatch(GM_ADDR sendData, GM_ADDR
     int round = tilingData.notifyDispatchInfo.round;
     int perRoundTokens = tilingData.notifyDispatchInfo.perRoundTokens;
     uint64_t totalWinSize = tilingData.notifyDispatchInfo.totalWinSize;
+    uint32_t expertRecvStatsMode = tilingData.notifyDispatchInfo.expertRecvStatsMode;
 
     GM_ADDR sendDataInput = sendData;
     GM_ADDR tokenPerExpertDataInput = tokenPerExpertData;
@@ -22,15 +22,16 @@ __aicore__ inline void SyncFunc()
 #define KERNELS_ARGS_FUN_ALL2ALL()                                                                                  \
     GM_ADDR sendDataInput, GM_ADDR tokenPerExpertDataInput, GM_ADDR sendDataOffsetOutput, GM_ADDR recvDataOutput,   \
         GM_ADDR recvCount, GM_ADDR recvOffset, GM_ADDR expertGlobalOffset, GM_ADDR srcrankInExpertOffset,           \
-        GM_ADDR rInSrcrankOffset, GM_ADDR totalRecvTokens, GM_ADDR maxBs, GM_ADDR recvTokensPerExpert, int64_t len, \
-        int32_t round, int32_t perRoundTokens, int32_t numTokens, int op, int root, int cycleCount, GM_ADDR scale,  \
-        int32_t scaleCount, GM_ADDR offset, int localRank, int localRankSize, uint64_t totalWinSize
+        GM_ADDR rInSrcrankOffset, GM_ADDR totalRecvTokens, GM_ADDR maxBs, GM_ADDR recvTokensPerExpert,              \
+        GM_ADDR expertRecvStats, uint32_t expertRecvStatsMode, int64_t len, int32_t round, int32_t perRoundTokens,  \
+        int32_t numTokens, int op, int root, int cycleCount, GM_ADDR scale, int32_t scaleCount, GM_ADDR offset,     \
+        int localRank, int localRankSize, uint64_t totalWinSize
 
-#define KERNELS_ARGS_CALL_ALL2ALL()                                                                                    \
-    sendDataInput, tokenPerExpertDataInput, sendDataOffsetOutput, recvDataOutput, recvCount, recvOffset,               \
-        expertGlobalOffset, srcrankInExpertOffset, rInSrcrankOffset, totalRecvTokens, maxBs, recvTokensPerExpert, len, \
-        round, perRoundTokens, numTokens, op, root, cycleCount, scale, scaleCount, offset, localRank, localRankSize,   \
-        totalWinSize
+#define KERNELS_ARGS_CALL_ALL2ALL()                                                                                  \
+    sendDataInput, tokenPerExpertDataInput, sendDataOffsetOutput, recvDataOutput, recvCount, recvOffset,             \
+        expertGlobalOffset, srcrankInExpertOffset, rInSrcrankOffset, totalRecvTokens, maxBs, recvTokensPerExpert,    \
+        expertRecvStats, expertRecvStatsMode, len, round, perRoundTokens, numTokens, op, root, cycleCount, scale,    \
+        scaleCount, offset, localRank, localRankSize, totalWinSize
 
 template <typename T>
 class NotifyDispatch
@@ -48,6 +49,8 @@ class NotifyDispatch
     constexpr static int32_t EXP_GLOBAL_OFFSET_CORE = 5;
     constexpr static int32_t SRC_RANK_EXP_OFFSET_CORE = 6;
     constexpr static int32_t R_IN_SRCRANK_OFFSET_CORE = 7;
+    constexpr static uint32_t RECV_STATS_NONE = 0U;
+    constexpr static uint32_t RECV_STATS_PER_SRC_RANK = 2U;  // 按[本卡专家数, rankSize]统计，否则按[本卡专家数]统计
     // Synchronization flag occupies length
     constexpr static int64_t FLAG_UNIT_INT_NUM = 4;
     constexpr static int64_t MAGIC_MASK = ~((1LL << 32) - 1);
@@ -89,6 +92,8 @@ public:
         recvOffset_ = recvOffset;
         maxBs_ = maxBs;
         recvTokensPerExpert_ = recvTokensPerExpert;
+        expertRecvStats_ = expertRecvStats;
+        expertRecvStatsMode_ = expertRecvStatsMode;
         expertGlobalOffset_ = expertGlobalOffset;
         srcrankInExpertOffset_ = srcrankInExpertOffset;
         rInSrcrankOffset_ = rInSrcrankOffset;
@@ -519,6 +524,35 @@ private:
         DataCopyExtParams copyParams{1, static_cast<uint32_t>(round * numLocalExperts * sizeof(int32_t)), 0, 0, 0};
         SyncFunc<AscendC::HardEvent::S_MTE3>();
         DataCopyPad(recvTokenPerExpGt, tmpTensor, copyParams);
+        if (expertRecvStatsMode_ != RECV_STATS_NONE) {
+            AccumulateRecvStats(tmpTensor);
+        }
+    }
+
+    // 在线负载均衡统计：各轮接收数在本核汇总后一次原子累加到GM，不额外起核
+    __aicore__ inline void AccumulateRecvStats(const LocalTensor<int32_t> &recvTokenPerExpTensor)
+    {
+        bool perSrcRank = (expertRecvStatsMode_ == RECV_STATS_PER_SRC_RANK);
+        uint32_t statsNum = perSrcRank ? numExperts : numLocalExperts;
+        pipe.InitBuffer(recvStatsBuf_, Ceil(statsNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE);
+        LocalTensor<int32_t> statsTensor = recvStatsBuf_.Get<int32_t>();
+        for (uint32_t i = 0; i < statsNum; ++i) {
+            int32_t recvCount = 0;
+            for (uint32_t r = 0; r < round; r++) {
+                // 按源卡统计时index = 本卡专家id * rankSize + 源卡id
+                recvCount += perSrcRank ? sendCountTensor(r * numExperts + i)
+                                        : recvTokenPerExpTensor(r * numLocalExperts + i);
+            }
+            statsTensor(i) = recvCount;
+        }
+        GlobalTensor<int32_t> expertRecvStatsGt;
+        expertRecvStatsGt.SetGlobalBuffer((__gm__ int32_t *)expertRecvStats_);
+        DataCopyExtParams copyParams{1, static_cast<uint32_t>(statsNum * sizeof(int32_t)), 0, 0, 0};
+        SyncFunc<AscendC::HardEvent::S_MTE3>();
+        PipeBarrier<PIPE_MTE3>();
+        SetAtomicAdd<int32_t>();
+        DataCopyPad(expertRecvStatsGt, statsTensor, copyParams);
+        SetAtomicNone();
     }
 
     __aicore__ inline void BuildExpGlobalOffset()
@@ -700,6 +734,8 @@ private:
     GM_ADDR rInSrcrankOffset_;
     GM_ADDR maxBs_;
     GM_ADDR recvTokensPerExpert_;
+    GM_ADDR expertRecvStats_;
+    uint32_t expertRecvStatsMode_{RECV_STATS_NONE};  // 专家接收统计方式，0为不统计
     __gm__ HcclOpResParam *winContext_[COMM_NUM]{nullptr, nullptr};
     Hccl<HCCL_SERVER_TYPE_AICPU> hccl_;
     TPipe pipe;
@@ -713,6 +749,7 @@ private:
     TBuf<> recvDataBuf;
     TBuf<> sendTokensPerRankBuf;
     TBuf<> seenRoundBuf;
+    TBuf<> recvStatsBuf_;
 
     LocalTensor<int32_t> tokenPerExpertTensor;
     LocalTensor<T> sendDataTensor;
@@ -992,6 +992,13 @@ static ge::graphStatus MoeDistributeDispatchA2CheckAttrAndSetTiling(const gert::
     OP_TILING_CHECK(quantModePtr == nullptr || (*quantModePtr != UNQUANT_MODE && *quantModePtr != DYNAMIC_QUANT_MODE),
                     OP_LOGE(K_INNER_DEBUG, "quantMode is invalid."), return GRAPH_FAILED);
     OP_TILING_CHECK(globalBsPtr == nullptr, OP_LOGE(K_INNER_DEBUG, "globalBs is null."), return GRAPH_FAILED);
+    // globalBs gives the per-rank batch the notify laid the token offsets out for, 0 takes this batch
+    OP_TILING_CHECK((*globalBsPtr != 0) && ((*globalBsPtr % *epWorldSizePtr != 0) ||
+                                            (*globalBsPtr / *epWorldSizePtr < bs) ||
+                                            (*globalBsPtr / *epWorldSizePtr > BS_UPPER_BOUND)),
+                    OP_LOGE(K_INNER_DEBUG, "globalBs=%d is invalid for bs=%d and epWorldSize=%d.", *globalBsPtr, bs,
+                            *epWorldSizePtr),
+                    return GRAPH_FAILED);
     OP_TILING_CHECK(expertTokenNumsTypePtr == nullptr || *expertTokenNumsTypePtr < 0 || *expertTokenNumsTypePtr > 1,
                     OP_LOGE(K_INNER_DEBUG, "expertTokenNumsType is invalid. Must be 0 or 1. "), return GRAPH_FAILED);
 
@@ -1003,7 +1010,7 @@ static ge::graphStatus MoeDistributeDispatchA2CheckAttrAndSetTiling(const gert::
     info.sharedExpertRankNum = static_cast<uint32_t>(0);
     info.moeExpertNum = *moeExpertNumPtr;
     info.quantMode = *quantModePtr;
-    info.globalBs = static_cast<uint32_t>(*epWorldSizePtr * bs);
+    info.globalBs = static_cast<uint32_t>(*globalBsPtr == 0 ? *epWorldSizePtr * bs : *globalBsPtr);
     info.expertTokenNumsType = *expertTokenNumsTypePtr;
 
     OP_LOGD(K_INNER_DEBUG, "quantMode=%d", info.quantMode);
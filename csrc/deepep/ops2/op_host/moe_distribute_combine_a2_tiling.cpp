@@ -123,6 +123,11 @@ static ge::graphStatus MoeDistributeCombineA2CheckAttrAndSetTiling(gert::TilingC
     const gert::StorageShape *expertIdStorageShape = context->GetInputShape(EXPERT_IDS_INDEX);
     OPS_CHECK(expertIdStorageShape == nullptr, OPS_LOG_E(K_INNER_DEBUG, "xShape is null."), return false);
     int32_t globalBs = *epWorldSizePtr * expertIdStorageShape->GetStorageShape().GetDim(0);
+    // A nonzero globalBs gives the per-rank batch offsetInner is laid out for, the kernel reduces that many rows
+    OPS_CHECK((*globalBsPtr != 0) && ((*globalBsPtr % *epWorldSizePtr != 0) || (*globalBsPtr < globalBs) ||
+                                      (*globalBsPtr / *epWorldSizePtr > static_cast<int>(MAX_BATCH_SIZE_LAYERED_A2))),
+              OPS_LOG_E(K_INNER_DEBUG, "globalBs=%d is invalid for epWorldSize=%d.", *globalBsPtr, *epWorldSizePtr),
+              return GRAPH_FAILED);
 
     info.epWorldSize = *epWorldSizePtr;
     info.tpWorldSize = static_cast<uint32_t>(0);
@@ -154,6 +154,7 @@ public:
         this->Attr("zero_expert_num").AttrType(OPTIONAL).Int(0);
         this->Attr("copy_expert_num").AttrType(OPTIONAL).Int(0);
         this->Attr("const_expert_num").AttrType(OPTIONAL).Int(0);
+        this->Attr("comm_phase").AttrType(OPTIONAL).Int(0);
 
         OpAICoreConfig aicore_config_A2;
         aicore_config_A2.DynamicCompileStaticFlag(true)
@@ -88,6 +88,7 @@ constexpr uint32_t ATTR_COMM_ALG_INDEX = 14;
 constexpr uint32_t ATTR_ZERO_EXPERT_NUM_INDEX = 15;
 constexpr uint32_t ATTR_COPY_EXPERT_NUM_INDEX = 16;
 constexpr uint32_t ATTR_CONST_EXPERT_NUM_INDEX = 17;
+constexpr uint32_t ATTR_COMM_PHASE_INDEX = 18;
 
 constexpr uint32_t INT8_COMM_QUANT = 2U;
 constexpr uint64_t INIT_TILINGKEY = 10000;
@@ -1337,11 +1338,28 @@ static uint64_t MoeDistributeCombineA2CalcTilingKey(gert::TilingContext *context
     return tilingKey;
 }
 
+// A2的分层与单机模板未拆分发送与接收，仅支持commPhase为0
+static ge::graphStatus MoeDistributeCombineA2CheckCommPhase(gert::TilingContext *context)
+{
+    auto attrs = context->GetAttrs();
+    auto commPhasePtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_COMM_PHASE_INDEX));
+    if (commPhasePtr != nullptr && *commPhasePtr != 0) {
+        OP_LOGE(K_INNER_DEBUG, "commPhase only support 0 on A2, but got commPhase=%ld.", *commPhasePtr);
+        return GRAPH_FAILED;
+    }
+    return ge::GRAPH_SUCCESS;
+}
+
 static ge::graphStatus MoeDistributeCombineA2TilingFuncImpl(gert::TilingContext *context)
 {
     const char *nodeName = context->GetNodeName();
     OP_LOGI(nodeName, "Enter MoeDistributeCombineV2 tiling func.");
 
+    OP_TILING_CHECK(
+        MoeDistributeCombineA2CheckCommPhase(context) != ge::GRAPH_SUCCESS,
+        VECTOR_INNER_ERR_REPORT_TILIING(context->GetNodeName(), "MoeDistributeCombineV2 CheckCommPhase Failed"),
+        return ge::GRAPH_FAILED);
+
     bool isSingleServer = false;
     OP_TILING_CHECK(
         MoeDistributeCombineA2GetIsSingle(context, isSingleServer) != ge::GRAPH_SUCCESS,
@@ -79,6 +79,7 @@ constexpr uint32_t ATTR_COMM_ALG_INDEX = 13;
 constexpr uint32_t ATTR_ZERO_EXPERT_NUM_INDEX = 14;
 constexpr uint32_t ATTR_COPY_EXPERT_NUM_INDEX = 15;
 constexpr uint32_t ATTR_CONST_EXPERT_NUM_INDEX = 16;
+constexpr uint32_t ATTR_COMM_PHASE_INDEX = 17;
 
 constexpr uint32_t TWO_DIMS = 2;
 constexpr uint32_t ONE_DIM = 1;
@@ -1274,11 +1275,28 @@ static uint64_t MoeDistributeDispatchA2CalcTilingKey(gert::TilingContext *contex
     return tilingKey;
 }
 
+// A2的分层与单机模板未拆分发送与接收，仅支持commPhase为0
+static ge::graphStatus MoeDistributeDispatchA2CheckCommPhase(gert::TilingContext *context)
+{
+    auto attrs = context->GetAttrs();
+    auto commPhasePtr = attrs->GetAttrPointer<int64_t>(static_cast<int>(ATTR_COMM_PHASE_INDEX));
+    if (commPhasePtr != nullptr && *commPhasePtr != 0) {
+        OP_LOGE(K_INNER_DEBUG, "commPhase only support 0 on A2, but got commPhase=%ld.", *commPhasePtr);
+        return GRAPH_FAILED;
+    }
+    return ge::GRAPH_SUCCESS;
+}
+
 static ge::graphStatus MoeDistributeDispatchA2TilingFuncImpl(gert::TilingContext *context)
 {
     const char *nodeName = context->GetNodeName();
     OP_LOGI(nodeName, "Enter MoeDistributeDispatchV2 tiling func.");
 
+    OP_TILING_CHECK(
+        MoeDistributeDispatchA2CheckCommPhase(context) != ge::GRAPH_SUCCESS,
+        VECTOR_INNER_ERR_REPORT_TILIING(context->GetNodeName(), "MoeDistributeDispatchV2 CheckCommPhase Failed"),
+        return ge::GRAPH_FAILED);
+
     bool isSingleServer = false;
     OP_TILING_CHECK(
         MoeDistributeDispatchA2GetIsSingle(context, isSingleServer) != ge::GRAPH_SUCCESS,
@@ -85,6 +85,7 @@ constexpr int64_t MAX_COMM_WORLD_SIZE = 384;
 constexpr int64_t MAX_A2_WORLD_SIZE = 64;
 constexpr int64_t MAX_COMM_LOCAL_SIZE = 16;
 constexpr int64_t MAX_A2_LOCAL_SIZE = 8;
+constexpr int64_t MAX_A2_BATCH_SIZE = 4096;
 
 constexpr uint32_t SYSTEM_NEED_WORKSPACE = 16 * 1024 * 1024;
 constexpr uint32_t KERNEL_USE_WORKSPACE = 1 * 1024 * 1024;
@@ -110,6 +111,7 @@ static void PrintTilingDataInfo(const char *nodeName, NotifyDispatchA2TilingData
     OP_LOGD(nodeName, "numTokens is %u.", tilingData.notifyDispatchInfoA2.numTokens);
     OP_LOGD(nodeName, "topkNum is %u.", tilingData.notifyDispatchInfoA2.topkNum);
     OP_LOGD(nodeName, "numExperts is %u.", tilingData.notifyDispatchInfoA2.numExperts);
+    OP_LOGD(nodeName, "maxBs is %u.", tilingData.notifyDispatchInfoA2.maxBs);
     OP_LOGD(nodeName, "aivNum is %u.", tilingData.notifyDispatchInfoA2.aivNum);
     OP_LOGD(nodeName, "totalUbSize is %lu.", tilingData.notifyDispatchInfoA2.totalUbSize);
 }
@@ -168,6 +170,17 @@ static ge::graphStatus GetAttrAndSetTilingData(gert::TilingContext *context, con
         OP_LOGE(nodeName, "numTokenPtr is invalid, only support > 0, but got numTokenPtr=%ld.", *numTokenPtr),
         return ge::GRAPH_FAILED);
 
+    // The layout lays sendCount out as numExperts + serverNum + maxBs * (1 + 2 * serverNum + 2 * numExperts)
+    int64_t serverNum = *rankSizePtr / *localRankSizePtr;
+    int64_t maxBsStride = 1 + 2 * serverNum + 2 * *numExpertsPtr;
+    int64_t maxBsCount = *sendCountPtr - *numExpertsPtr - serverNum;
+    int64_t maxBs = maxBsCount / maxBsStride;
+    OP_TILING_CHECK((maxBsCount <= 0) || (maxBsCount % maxBsStride != 0) || (maxBs < *numTokenPtr) ||
+                        (maxBs > MAX_A2_BATCH_SIZE),
+                    OP_LOGE(nodeName, "sendCount=%ld doesn't match a layout for batch in [%ld, %ld].", *sendCountPtr,
+                            *numTokenPtr, MAX_A2_BATCH_SIZE),
+                    return ge::GRAPH_FAILED);
+
     commGroup = std::string(commGroupPtr);
     tilingData.notifyDispatchInfoA2.rankSize = static_cast<uint32_t>(*rankSizePtr);
     tilingData.notifyDispatchInfoA2.rankId = static_cast<uint32_t>(*rankIdPtr);
@@ -177,6 +190,7 @@ static ge::graphStatus GetAttrAndSetTilingData(gert::TilingContext *context, con
     tilingData.notifyDispatchInfoA2.numTokens = static_cast<uint32_t>(*numTokenPtr);
     tilingData.notifyDispatchInfoA2.topkNum = static_cast<uint32_t>(*topkNumPtr);
     tilingData.notifyDispatchInfoA2.numExperts = static_cast<uint32_t>(*numExpertsPtr);
+    tilingData.notifyDispatchInfoA2.maxBs = static_cast<uint32_t>(maxBs);
 
     return ge::GRAPH_SUCCESS;
 }
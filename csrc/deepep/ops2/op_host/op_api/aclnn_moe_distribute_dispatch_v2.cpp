@@ -35,17 +35,28 @@ extern "C" void __attribute__((weak)) NnopbaseSetHcclServerType(void *executor,
 
 aclnnStatus aclnnMoeDistributeDispatchV2GetWorkspaceSize(
     const aclTensor *x, const aclTensor *expertIds, const aclTensor *scalesOptional,
-    const aclTensor *xActiveMaskOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
+    const aclTensor *xActiveMaskOptional, const aclTensor *elasticInfoOptional, const aclTensor *expertLog2PhyOptional,
+    const aclTensor *expertLogCntOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
     char *groupTp, int64_t tpWorldSize, int64_t tpRankId, int64_t expertShardType, int64_t sharedExpertNum,
     int64_t sharedExpertRankNum, int64_t quantMode, int64_t globalBs, int64_t expertTokenNumsType, char *commAlg,
-    aclTensor *expandXOut, aclTensor *dynamicScalesOut, aclTensor *assistInfoForCombineOut,
-    aclTensor *expertTokenNumsOut, aclTensor *epRecvCountsOut, aclTensor *tpRecvCountsOut, uint64_t *workspaceSize,
-    aclOpExecutor **executor)
+    int64_t commPhase, int64_t replicaPolicy, aclTensor *expandXOut, aclTensor *dynamicScalesOut,
+    aclTensor *assistInfoForCombineOut, aclTensor *expertTokenNumsOut, aclTensor *epRecvCountsOut,
+    aclTensor *tpRecvCountsOut, aclTensor *expertRecvStatsOptional, aclTensor *physicalExpertIdsOptional,
+    uint64_t *workspaceSize, aclOpExecutor **executor)
 {
+    // A2算子不输出专家接收统计，由调用方按expertTokenNums累加
+    (void)expertRecvStatsOptional;
+    // A2算子不支持副本表，由调用方在下发前将逻辑专家id映射为物理专家id
+    (void)expertLog2PhyOptional;
+    (void)expertLogCntOptional;
+    (void)replicaPolicy;
+    (void)physicalExpertIdsOptional;
+    // A2算子不支持弹性缩容
+    (void)elasticInfoOptional;
     return aclnnInnerMoeDistributeDispatchV2GetWorkspaceSize(
         x, expertIds, scalesOptional, xActiveMaskOptional, nullptr, groupEp, epWorldSize, epRankId, moeExpertNum, "",
         tpWorldSize, tpRankId, expertShardType, sharedExpertNum, sharedExpertRankNum, quantMode, globalBs,
-        expertTokenNumsType, commAlg, 0, 0, 0, expandXOut, dynamicScalesOut, assistInfoForCombineOut,
+        expertTokenNumsType, commAlg, 0, 0, 0, commPhase, expandXOut, dynamicScalesOut, assistInfoForCombineOut,
         expertTokenNumsOut, epRecvCountsOut, tpRecvCountsOut, workspaceSize, executor);
 }
 
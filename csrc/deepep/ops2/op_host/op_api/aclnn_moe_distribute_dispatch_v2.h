@@ -32,6 +32,9 @@ extern "C" {
  * @param [in] expertIds: 计算输入，Tensor，数据类型int32，必须为2维，数据格式支持ND。每个token的topK个专家索引。
  * @param [in] scalesOptional: 计算可选输入，Tensor，数据类型float32，必须为2维，数据格式支持ND。每个专家的smooth权重。
  * @param [in] xActiveMaskOptional: 计算输入，Tensor，数据类型Bool，必须为1维，数据格式支持ND。
+ * @param [in] elasticInfoOptional: 计算可选输入，Tensor，数据类型int32。A2暂不支持，需传空。
+ * @param [in] expertLog2PhyOptional: 计算可选输入，Tensor，数据类型int32。A2暂不支持，需传空。
+ * @param [in] expertLogCntOptional: 计算可选输入，Tensor，数据类型int32。A2暂不支持，需传空。
  * @param [in] groupEp: 计算输入，str。ep通信域名称，专家并行的通信域。不能和groupTp相同。
  * @param [in] epWorldSize: 计算输入，int。ep通信域size。
  * @param [in] epRankId: 计算输入，int。ep本卡Id。同一个EP通信域中各卡的epRankId不能重复。
@@ -46,6 +49,8 @@ extern "C" {
  * @param [in] globalBs: 计算可选输入，int。EP域全局的batch size大小。
  * @param [in] expertTokenNumsType: 计算可选输入，int。输出expertTokenNums中的值语义类型。
  * @param [in] commAlg: 计算可选输入，str。 通信算法类型。预留参数，暂未使用。
+ * @param [in] commPhase: 计算可选输入，int。0: 发送与接收在同一次调用中完成，1: 仅发送，2: 仅接收。
+ * @param [in] replicaPolicy: 计算可选输入，int。副本选择策略，A2暂不支持，传0。
  * @param [out] expandXOut: 计算输出，Tensor，必选输出，数据类型支持float16, bfloat16,
  int8，仅支持2维，数据格式支持ND。根据 expertIdx进行扩展过的token特征。
  * @param [out] dynamicScalesOut:
@@ -58,6 +63,8 @@ extern "C" {
  计算输出，Tensor，必选输出，数据类型int32，仅支持1维，数据格式支持ND。表示从各卡接收的token数。
  * @param [out] tpRecvCountsOut:
  计算输出，Tensor，必选输出，数据类型int32，仅支持1维，数据格式支持ND。无tp通信域时输出为空。
+ * @param [out] expertRecvStatsOptional: 计算可选输出，Tensor，数据类型int32。A2暂不支持，需传空。
+ * @param [out] physicalExpertIdsOptional: 计算可选输出，Tensor，数据类型int32。A2暂不支持，需传空。
  * @param [out] workspaceSize: 出参，返回需要在npu device侧申请的workspace大小。
  * @param [out] executor: 出参，返回op执行器，包含了算子计算流程。
  * @return aclnnStatus: 返回值，返回状态码
@@ -65,12 +72,14 @@ extern "C" {
  */
 __attribute__((visibility("default"))) aclnnStatus aclnnMoeDistributeDispatchV2GetWorkspaceSize(
     const aclTensor *x, const aclTensor *expertIds, const aclTensor *scalesOptional,
-    const aclTensor *xActiveMaskOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
+    const aclTensor *xActiveMaskOptional, const aclTensor *elasticInfoOptional, const aclTensor *expertLog2PhyOptional,
+    const aclTensor *expertLogCntOptional, char *groupEp, int64_t epWorldSize, int64_t epRankId, int64_t moeExpertNum,
     char *groupTp, int64_t tpWorldSize, int64_t tpRankId, int64_t expertShardType, int64_t sharedExpertNum,
     int64_t sharedExpertRankNum, int64_t quantMode, int64_t globalBs, int64_t expertTokenNumsType, char *commAlg,
-    aclTensor *expandXOut, aclTensor *dynamicScalesOut, aclTensor *assistInfoForCombineOut,
-    aclTensor *expertTokenNumsOut, aclTensor *epRecvCountsOut, aclTensor *tpRecvCountsOut, uint64_t *workspaceSize,
-    aclOpExecutor **executor);
+    int64_t commPhase, int64_t replicaPolicy, aclTensor *expandXOut, aclTensor *dynamicScalesOut,
+    aclTensor *assistInfoForCombineOut, aclTensor *expertTokenNumsOut, aclTensor *epRecvCountsOut,
+    aclTensor *tpRecvCountsOut, aclTensor *expertRecvStatsOptional, aclTensor *physicalExpertIdsOptional,
+    uint64_t *workspaceSize, aclOpExecutor **executor);
 
 /**
  * @brief aclnnMoeDistributeDispatch的第二段接口，用于执行计算。
@@ -36,7 +36,6 @@ constexpr uint32_t EXTRA_TOKEN_INFO_NUM = 4U;              // 专家信息 权
 constexpr uint32_t BITS32_PER_BLOCK = 8U;
 constexpr static uint32_t BW_ITEM_SIZE = 32;
 constexpr uint32_t FLAG_VALUE = 0xFFFFFFFF;
-constexpr uint32_t BS_UPPER = 4096;
 
 #define TemplateMC2TypeA2layeredClass \
     typename XType, typename ExpandXOutType, bool StaticQuant, bool DynamicQuant, bool IsSmoothScaleExist
@@ -149,6 +148,7 @@ private:
     // tiling侧已确保数据上限，相乘不会越界，因此统一采用uint32_t进行处理
     uint32_t axisBS_{0};
     uint32_t globalBs_{0};
+    uint32_t maxBs_{0};  // notify 按各卡最大 bs 排布 token 偏移
     uint32_t axisH_{0};
     uint32_t axisK_{0};
     uint32_t kAlign_{0};
@@ -225,6 +225,7 @@ __aicore__ inline void CamMoeDistributeDispatchA2Layered<TemplateMC2TypeA2layere
     worldSize_ = tilingData.moeDistributeDispatchInfo.epWorldSize;
     moeExpertNum_ = tilingData.moeDistributeDispatchInfo.moeExpertNum;
     localMoeExpertNum_ = moeExpertNum_ / worldSize_;
+    maxBs_ = globalBs_ / worldSize_;
     kAlign_ = RoundUp(axisK_, (uint32_t)8);
     totalSize_ = winContext_->winSize;
     totalWinSize_ = RDMA_DATA_SIZE;  // RDMA 800 MB空间, 与low_latency一致
@@ -778,9 +779,9 @@ __aicore__ inline void CamMoeDistributeDispatchA2Layered<TemplateMC2TypeA2layere
             for (int i = beginIndex; i < endIndex; ++i) {
                 // 假设当前shape为[expertNum, rank, maxBs]，专家recvExpId从srcRank读取第i个token的src与dst
                 int32_t srcOffset =
-                    srcOffsetRankTokenIdxGMTensor_.GetValue(recvExpId * worldSize_ * BS_UPPER + srcRank * BS_UPPER + i);
+                    srcOffsetRankTokenIdxGMTensor_.GetValue(recvExpId * worldSize_ * maxBs_ + srcRank * maxBs_ + i);
                 int32_t dstOffset =
-                    dstOffsetRankTokenIdxGMTensor_.GetValue(recvExpId * worldSize_ * BS_UPPER + srcRank * BS_UPPER + i);
+                    dstOffsetRankTokenIdxGMTensor_.GetValue(recvExpId * worldSize_ * maxBs_ + srcRank * maxBs_ + i);
 
                 uint32_t tokenOffset =
                     (tokenStructLen_ * srcOffset);  // 包含token, 以及token后的信息:expIds, weights, tokenIdx, scales
@@ -13,7 +13,6 @@
 namespace MoeDispatchLayoutA2 {
 
 constexpr uint32_t UB_32_ALIGN = 32U;
-constexpr uint32_t MAX_BATCH_SIZE = 4096U;
 constexpr uint32_t TEMP_BATCH_SIZE = 32U;
 
 template <AscendC::HardEvent event>
@@ -42,6 +41,8 @@ public:
         numTopk_ = tilingData->dispatchLayoutInfo.numTopk;
         localRankSize_ = tilingData->dispatchLayoutInfo.localRankSize;
         rankId_ = tilingData->dispatchLayoutInfo.rankId;
+        // 多机时单轮即整批，perRoundTokens 为各卡的最大 batch，notifySendData 各段按它排布
+        maxBatchSize_ = tilingData->dispatchLayoutInfo.perRoundTokens;
         serverNum_ = (numRanks_ + localRankSize_ - 1) / localRankSize_;
         tpipe_ = pipe;
 
@@ -97,17 +98,17 @@ public:
             localTokenServerTotalCountGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + serverOffsetOffset) +
                                                           numExperts_ + serverNum_);
             localTokenServerNumGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + serverNumOffset) + numExperts_ +
-                                                   serverNum_ * (MAX_BATCH_SIZE + 1));
+                                                   serverNum_ * (maxBatchSize_ + 1));
             localTokenServerOffsetGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + serverOffsetOffset) + numExperts_ +
-                                                      serverNum_ + MAX_BATCH_SIZE * (serverNum_ + 1));
+                                                      serverNum_ + maxBatchSize_ * (serverNum_ + 1));
             sendTokenIdxGM_.SetGlobalBuffer((__gm__ T *)(notifySendData + sendTokenIdxOffset) + numExperts_ +
-                                            serverNum_ + MAX_BATCH_SIZE * (1 + 2 * serverNum_));
+                                            serverNum_ + maxBatchSize_ * (1 + 2 * serverNum_));
             expertRankTokenIdxGM_.SetGlobalBuffer((__gm__ T *)notifySendData + numExperts_ + serverNum_ +
-                                                  MAX_BATCH_SIZE * (1 + 2 * serverNum_ + numExperts_));
+                                                  maxBatchSize_ * (1 + 2 * serverNum_ + numExperts_));
             tempExpertGM_.SetGlobalBuffer((__gm__ T *)notifySendData + numExperts_ + serverNum_ +
-                                          MAX_BATCH_SIZE * (1 + 2 * serverNum_));
+                                          maxBatchSize_ * (1 + 2 * serverNum_));
             tempServerGM_.SetGlobalBuffer((__gm__ T *)notifySendData + numExperts_ * (1 + aivNum_) + serverNum_ +
-                                          MAX_BATCH_SIZE * (1 + 2 * serverNum_));
+                                          maxBatchSize_ * (1 + 2 * serverNum_));
             sendTokenIdxSmallGM_.SetGlobalBuffer((__gm__ T *)(sendTokenIdxSmall + topkIdxOffset / 2));
         }
     }
@@ -312,7 +313,7 @@ private:
                     int32_t preCount = numTokensPerExpertTensor.GetValue(expert_idx);
                     SyncFunc<AscendC::HardEvent::S_MTE3>();
                     const DataCopyExtParams expertRankTokendataCopyParams{1U, TEMP_BATCH_SIZE * sizeof(T), 0U, 0U, 0U};
-                    DataCopyPad(expertRankTokenIdxGM_[expert_idx * MAX_BATCH_SIZE + preCount + count - TEMP_BATCH_SIZE],
+                    DataCopyPad(expertRankTokenIdxGM_[expert_idx * maxBatchSize_ + preCount + count - TEMP_BATCH_SIZE],
                                 expertRankTokenIdxTensor[expert_idx * TEMP_BATCH_SIZE], expertRankTokendataCopyParams);
                     SyncFunc<AscendC::HardEvent::MTE3_S>();
                 }
@@ -327,7 +328,7 @@ private:
                 int32_t preCount = numTokensPerExpertTensor.GetValue(i);
                 SyncFunc<AscendC::HardEvent::S_MTE3>();
                 const DataCopyExtParams expertRankTokendataCopyParams{1U, uint32_t(rest * sizeof(T)), 0U, 0U, 0U};
-                DataCopyPad(expertRankTokenIdxGM_[i * MAX_BATCH_SIZE + preCount + count - rest],
+                DataCopyPad(expertRankTokenIdxGM_[i * maxBatchSize_ + preCount + count - rest],
                             expertRankTokenIdxTensor[i * TEMP_BATCH_SIZE], expertRankTokendataCopyParams);
             }
         }
@@ -380,6 +381,7 @@ private:
     uint32_t aivNum_{0};
     uint32_t tempTokens_{0};
     uint32_t rankId_{0};
+    uint32_t maxBatchSize_{0};
 
     uint32_t topkIdx32AlignIntLen_{0};
     uint32_t numTokensPerRank32AlignIntLen_{0};
@@ -133,6 +133,7 @@ private:
     uint32_t countReL{0};
     uint32_t axisBS_{0};
     uint32_t globalBs{0};
+    uint32_t maxBs_{0};  // notify 按各卡最大 bs 排布 offsetInner，不超过 MAX_BS
     uint32_t axisH_{0};
     uint32_t axisK_{0};  // topK
     uint32_t aivNum_{0};
@@ -214,6 +215,7 @@ __aicore__ inline void MoeDistributeCombineA2Layered<TemplateMC2TypeA2layeredFun
     aivNum_ = tilingData->moeDistributeCombineInfo.aivNum;
     moeExpertNum_ = tilingData->moeDistributeCombineInfo.moeExpertNum;
     worldSize_ = tilingData->moeDistributeCombineInfo.epWorldSize;
+    maxBs_ = globalBs / worldSize_;
 
     auto contextGM = AscendC::GetHcclContext<HCCL_GROUP_ID_0>();
     winContext_ = (__gm__ HcclOpResParam *)contextGM;
@@ -446,8 +448,8 @@ __aicore__ inline void MoeDistributeCombineA2Layered<TemplateMC2TypeA2layeredFun
         SyncAll<true>();
         return;
     }
-    uint32_t BSPerCore = MAX_BS / corePerServer;
-    uint32_t remainBS = MAX_BS % corePerServer;
+    uint32_t BSPerCore = maxBs_ / corePerServer;
+    uint32_t remainBS = maxBs_ % corePerServer;
     uint32_t localBlockIdx = coreIdx_ / serverNum;
     uint32_t currentServerIdx = coreIdx_ % serverNum;
 
@@ -462,7 +464,7 @@ __aicore__ inline void MoeDistributeCombineA2Layered<TemplateMC2TypeA2layeredFun
     uint32_t endTokenId = startTokenId + BSPerCore;
 
     int32_t targetRankId = currentServerIdx * SERVER_RANK_SIZE + rankId_ % SERVER_RANK_SIZE;
-    GlobalTensor<int32_t> offsetReduceGt = offsetInnerGlobal_[MAX_BS * moeExpertNum_ * currentServerIdx];
+    GlobalTensor<int32_t> offsetReduceGt = offsetInnerGlobal_[maxBs_ * moeExpertNum_ * currentServerIdx];
     SyncFunc<AscendC::HardEvent::MTE2_S>();
 
     uint64_t copyAddr = shareAddreRank[rankId_ % SERVER_RANK_SIZE] +
@@ -475,11 +477,11 @@ __aicore__ inline void MoeDistributeCombineA2Layered<TemplateMC2TypeA2layeredFun
     countReL = 0;
 #ifdef COMBINE_2SERVER_VERSION
     if (coreIdx_ < serverNum) {
-        countReL = MAX_BS;
+        countReL = maxBs_;
     }
 #else
     int32_t countRels[MAX_BS] = {0};
-    for (uint32_t i = 0U; i < MAX_BS; i++) {
+    for (uint32_t i = 0U; i < maxBs_; i++) {
         bool isTokenInServer = false;
         DataCopy(offsetReduceLt,
                  offsetReduceGt[i * moeExpertNum_ + rankId_ / SERVER_RANK_SIZE * SERVER_RANK_SIZE * localMoeExpertNum_],
@@ -492,7 +494,7 @@ __aicore__ inline void MoeDistributeCombineA2Layered<TemplateMC2TypeA2layeredFun
             isTokenInServer = true;
             break;
         }
-        if (i == MAX_BS - 1) {
+        if (i == maxBs_ - 1) {
             if (coreIdx_ < serverNum) {
                 countReL = isTokenInServer ? countRels[i] + 1 : countRels[i];
             }
@@ -14,7 +14,8 @@ extern "C" __global__ __aicore__ void notify_dispatch(GM_ADDR sendData, GM_ADDR
                                                       GM_ADDR recvOffset, GM_ADDR expertGlobalOffset,
                                                       GM_ADDR srcrankInExpertOffset, GM_ADDR rInSrcrankOffset,
                                                       GM_ADDR totalRecvTokens, GM_ADDR maxBs,
-                                                      GM_ADDR recvTokensPerExpert, GM_ADDR workspace, GM_ADDR tilingGM)
+                                                      GM_ADDR recvTokensPerExpert, GM_ADDR expertRecvStats,
+                                                      GM_ADDR workspace, GM_ADDR tilingGM)
 {
     REGISTER_TILING_DEFAULT(NotifyDispatchTilingData);
     GET_TILING_DATA_WITH_STRUCT(NotifyDispatchTilingData, tilingData, tilingGM);
@@ -25,6 +26,7 @@ extern "C" __global__ __aicore__ void notify_dispatch(GM_ADDR sendData, GM_ADDR
     int rankSize = tilingData.notifyDispatchInfo.rankSize;
     int64_t len = tilingData.notifyDispatchInfo.sendCount;
     int64_t numTokens = tilingData.notifyDispatchInfo.numTokens;
+    uint32_t expertRecvStatsMode = tilingData.notifyDispatchInfo.expertRecvStatsMode;
 
     GM_ADDR sendDataInput = sendData;
     GM_ADDR tokenPerExpertDataInput = tokenPerExpertData;
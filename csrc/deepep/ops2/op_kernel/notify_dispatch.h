@@ -24,13 +24,14 @@ __aicore__ inline void SyncFunc()
 #define KERNELS_ARGS_FUN_ALL2ALL()                                                                                  \
     GM_ADDR sendDataInput, GM_ADDR tokenPerExpertDataInput, GM_ADDR sendDataOffsetOutput, GM_ADDR recvDataOutput,   \
         GM_ADDR totalRecvTokens, GM_ADDR recvCount, GM_ADDR recvOffset, GM_ADDR maxBs, GM_ADDR recvTokensPerExpert, \
-        int64_t len, int64_t numTokens, int op, int root, int cycleCount, GM_ADDR scale, int64_t scaleCount,        \
-        GM_ADDR offset, int localRank, int localRankSize, GM_ADDR tilingGM
+        GM_ADDR expertRecvStats, uint32_t expertRecvStatsMode, int64_t len, int64_t numTokens, int op, int root,    \
+        int cycleCount, GM_ADDR scale, int64_t scaleCount, GM_ADDR offset, int localRank, int localRankSize,        \
+        GM_ADDR tilingGM
 
-#define KERNELS_ARGS_CALL_ALL2ALL()                                                                              \
-    sendDataInput, tokenPerExpertDataInput, sendDataOffsetOutput, recvDataOutput, totalRecvTokens, recvCount,    \
-        recvOffset, maxBs, recvTokensPerExpert, len, numTokens, op, root, cycleCount, scale, scaleCount, offset, \
-        localRank, localRankSize, tilingGM
+#define KERNELS_ARGS_CALL_ALL2ALL()                                                                                \
+    sendDataInput, tokenPerExpertDataInput, sendDataOffsetOutput, recvDataOutput, totalRecvTokens, recvCount,      \
+        recvOffset, maxBs, recvTokensPerExpert, expertRecvStats, expertRecvStatsMode, len, numTokens, op, root,    \
+        cycleCount, scale, scaleCount, offset, localRank, localRankSize, tilingGM
 
 template <typename T>
 class NotifyDispatch
@@ -42,6 +43,8 @@ class NotifyDispatch
     // Synchronization flag occupies length
     constexpr static int64_t FLAG_UNIT_INT_NUM = 4;
     constexpr static int64_t MAGIC_MASK = ~((1LL << 32) - 1);
+    constexpr static uint32_t RECV_STATS_NONE = 0U;
+    constexpr static uint32_t RECV_STATS_PER_SRC_RANK = 2U;  // 按[本卡专家数, rankSize]统计，否则按[本卡专家数]统计
 
 public:
     __aicore__ inline NotifyDispatch(int rank, int rankSize, uint32_t extraFlag)
@@ -61,6 +64,8 @@ public:
         recvOffset_ = recvOffset;
         maxBs_ = maxBs;
         recvTokensPerExpert_ = recvTokensPerExpert;
+        expertRecvStats_ = expertRecvStats;
+        expertRecvStatsMode_ = expertRecvStatsMode;
         recvDataAlignLen = Ceil(numExperts * sendPerGroup * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
         tokenPerExpertDataAlignLen = Ceil(numExperts * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
         sendDataOffsetAlignLen = Ceil(numExperts * sizeof(T), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
@@ -405,6 +410,24 @@ private:
         DataCopyExtParams copyParams{1, static_cast<uint32_t>(numExperts / rankSize * sizeof(int32_t)), 0, 0, 0};
         SyncFunc<AscendC::HardEvent::S_MTE3>();
         DataCopyPad(recvTokenPerExpGt, tmpTensor, copyParams);
+        if (expertRecvStatsMode_ != RECV_STATS_NONE) {
+            AccumulateRecvStats(tmpTensor);
+        }
+    }
+
+    // 在线负载均衡统计：本核已有的接收数一次原子累加到GM，不额外起核
+    __aicore__ inline void AccumulateRecvStats(const LocalTensor<int32_t> &recvTokenPerExpTensor)
+    {
+        // 按源卡统计时sendCountTensor的index = 本卡专家id * rankSize + 源卡id，与统计tensor一致
+        bool perSrcRank = (expertRecvStatsMode_ == RECV_STATS_PER_SRC_RANK);
+        uint32_t statsNum = perSrcRank ? numExperts : numExperts / rankSize;
+        GlobalTensor<int32_t> expertRecvStatsGt;
+        expertRecvStatsGt.SetGlobalBuffer((__gm__ int32_t *)expertRecvStats_);
+        DataCopyExtParams copyParams{1, static_cast<uint32_t>(statsNum * sizeof(int32_t)), 0, 0, 0};
+        PipeBarrier<PIPE_MTE3>();
+        SetAtomicAdd<int32_t>();
+        DataCopyPad(expertRecvStatsGt, perSrcRank ? sendCountTensor : recvTokenPerExpTensor, copyParams);
+        SetAtomicNone();
     }
 
     __aicore__ inline int64_t GetDataCount(const int64_t dataLen, const int64_t useBlockNum);
@@ -480,6 +503,8 @@ private:
     GM_ADDR recvOffset_;
     GM_ADDR maxBs_;
     GM_ADDR recvTokensPerExpert_;
+    GM_ADDR expertRecvStats_;
+    uint32_t expertRecvStatsMode_{RECV_STATS_NONE};  // 专家接收统计方式，0为不统计
     GM_ADDR scale;
     GM_ADDR shareAddrs[CAM_MAX_RANK_SIZE];  // List of shared memory addresses
     __gm__ HcclOpResParam *winContext_[COMM_NUM]{nullptr, nullptr};
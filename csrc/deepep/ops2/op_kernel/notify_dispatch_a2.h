@@ -80,7 +80,6 @@ class NotifyDispatchA2
     constexpr static uint64_t EXP_TOKEN_COUNT_FLAG_CNT = UB_ALIGN / sizeof(uint64_t);  // 4
     constexpr static uint32_t GM_ALIGN = 64;                                           // GM按64字节对齐
 
-    constexpr static uint32_t MAX_BS = 4096;  // 每卡支持的最大bs
     // Synchronization flag occupies length
     constexpr static int64_t FLAG_UNIT_INT_NUM = 4;
     constexpr static int64_t MAGIC_MASK = ~((1LL << 32) - 1);
@@ -204,6 +203,7 @@ private:
 
         // 初始化RDMA相关变量
         auto tilingData = (__gm__ NotifyDispatchA2TilingData *)tiling;
+        this->maxBs = tilingData->notifyDispatchInfoA2.maxBs;
         __gm__ void *mc2InitTiling = (__gm__ void *)(&(tilingData->mc2InitTiling));
         __gm__ void *mc2CcTiling = (__gm__ void *)(&(tilingData->mc2CcTiling1));
 
@@ -254,26 +254,26 @@ private:
         numTokensUniquePerServerAlignLen = Ceil(serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
         gNumTokensUniquePerServerAlignLen = Ceil(rankSize * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
 
-        numTokensPerServerAlignLen = Ceil(MAX_BS * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        numTokensPerServerAlignLen = Ceil(maxBs * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
         gNumTokensPerServerAlignLen =
-            Ceil(rankSize * MAX_BS * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+            Ceil(rankSize * maxBs * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
 
-        tokenServerCntAlignLen = Ceil(MAX_BS * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
-        gTokenServerCntAlignLen = Ceil(rankSize * MAX_BS * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        tokenServerCntAlignLen = Ceil(maxBs * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        gTokenServerCntAlignLen = Ceil(rankSize * maxBs * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
 
-        tokenServerIdxAlignLen = Ceil(MAX_BS * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
-        gTokenServerIdxAlignLen = Ceil(rankSize * MAX_BS * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        tokenServerIdxAlignLen = Ceil(maxBs * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        gTokenServerIdxAlignLen = Ceil(rankSize * maxBs * serverNum * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
 
-        tokenExpertIdxAlignLen = Ceil(MAX_BS * numExperts * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
-        gTokenExpertIdxAlignLen = Ceil(rankSize * MAX_BS * numExperts * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        tokenExpertIdxAlignLen = Ceil(maxBs * numExperts * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        gTokenExpertIdxAlignLen = Ceil(rankSize * maxBs * numExperts * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
 
-        expertMaxBsSrcOffsetAlignLen = Ceil(numExperts * MAX_BS * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        expertMaxBsSrcOffsetAlignLen = Ceil(numExperts * maxBs * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
         gExpertMaxBsSrcOffsetAlignLen =
-            Ceil(rankSize * numExperts * MAX_BS * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+            Ceil(rankSize * numExperts * maxBs * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
 
-        expertMaxBsOriOffsetAlignLen = Ceil(numExperts * MAX_BS * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+        expertMaxBsOriOffsetAlignLen = Ceil(numExperts * maxBs * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
         gExpertMaxBsOriOffsetAlignLen =
-            Ceil(rankSize * numExperts * MAX_BS * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
+            Ceil(rankSize * numExperts * maxBs * sizeof(int32_t), UB_ALIGN_SIZE) * UB_ALIGN_SIZE;
     }
 
     __aicore__ inline void InitShare()
@@ -609,13 +609,13 @@ private:
         pipe.Reset();
         pipe.InitBuffer(tempBuf_, UB_ALIGN);  // 存放临时的立即数
         pipe.InitBuffer(tempBuf2_,
-                        Ceil(MAX_BS * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // MAX_BS <= 4096, 要能放下一个bs的数据
+                        Ceil(maxBs * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // maxBs <= 4096, 要能放下一个bs的数据
         pipe.InitBuffer(tempBuf3_, Ceil(numExperts * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // 要能放numExpert个数据
         pipe.InitBuffer(tempBuf7_, Ceil(numExperts * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // 要能放numExpert个数据
         pipe.InitBuffer(tempBuf8_,
-                        Ceil(MAX_BS * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // MAX_BS <= 4096, 要能放下一个bs的数据
+                        Ceil(maxBs * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // maxBs <= 4096, 要能放下一个bs的数据
         pipe.InitBuffer(tempBuf9_,
-                        Ceil(MAX_BS * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // MAX_BS <= 4096, 要能放下一个bs的数据
+                        Ceil(maxBs * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // maxBs <= 4096, 要能放下一个bs的数据
         pipe.InitBuffer(tempBuf10_, Ceil(numExperts * sizeof(int32_t), UB_ALIGN) * UB_ALIGN);  // 要能放numExpert个数据
 
         pipe.InitBuffer(tempBuf4_, 1000 * sizeof(float));  // 要能放localExp从所有rank接收token的数据
@@ -663,19 +663,19 @@ private:
         // 计算 tokenServerIdxOutputGT_
         LocalTensor<int32_t> tmpLt = tempBuf2_.Get<int32_t>();
         LocalTensor<int32_t> dstLt = tempBuf9_.Get<int32_t>();
-        DataCopyExtParams copyParams{1, static_cast<uint32_t>(MAX_BS * sizeof(int32_t)), 0, 0, 0};
+        DataCopyExtParams copyParams{1, static_cast<uint32_t>(maxBs * sizeof(int32_t)), 0, 0, 0};
         DataCopyPadExtParams<int32_t> padParams{false, 0, 0, 0};
 
         LocalTensor<int32_t> fullOneLt = tempBuf8_.Get<int32_t>();
-        Duplicate<int32_t>(fullOneLt, 1, MAX_BS);
+        Duplicate<int32_t>(fullOneLt, 1, maxBs);
         PipeBarrier<PIPE_V>();
 
         // offset + numTokensPerExpertLen + numTokensUniquePerServerLen + numTokensPerServerLen + tokenServerCntLen
-        int32_t curRankDataOffset = rank * len + numExperts + serverNum + MAX_BS * serverNum + MAX_BS;
+        int32_t curRankDataOffset = rank * len + numExperts + serverNum + maxBs * serverNum + maxBs;
 
         AscendC::SetFlag<HardEvent::MTE3_MTE2>(EVENT_ID0);  // MTE2 waits for MTE3
         for (int i = 0; i < serverNum; ++i) {
-            int32_t recvOffset = curRankDataOffset + i * MAX_BS;  // 每次从recvdata中拷贝 MAX_BS 个数
+            int32_t recvOffset = curRankDataOffset + i * maxBs;  // 每次从recvdata中拷贝 maxBs 个数
 
             event_t eventId = EVENT_ID0;
             AscendC::WaitFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -683,12 +683,12 @@ private:
             DataCopyPad(tmpLt, recvDataOutputGt[recvOffset], copyParams, padParams);
             SyncFunc<AscendC::HardEvent::MTE2_V>();
 
-            Sub(dstLt, tmpLt, fullOneLt, MAX_BS);  // 所有偏移值-1，为-1的表示不发给该server
+            Sub(dstLt, tmpLt, fullOneLt, maxBs);  // 所有偏移值-1，为-1的表示不发给该server
             PipeBarrier<PIPE_V>();
 
             SyncFunc<AscendC::HardEvent::V_MTE3>();
 
-            int32_t tarOffset = i * MAX_BS;
+            int32_t tarOffset = i * maxBs;
             DataCopyPad(tokenServerIdxOutputGT_[tarOffset], dstLt, copyParams);
 
             AscendC::SetFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -701,21 +701,20 @@ private:
         // printflag("enter BuildExpandIdxData\n");
         LocalTensor<int32_t> tmpLt = tempBuf2_.Get<int32_t>();
         LocalTensor<int32_t> dstLt = tempBuf9_.Get<int32_t>();
-        DataCopyExtParams copyParams{1, static_cast<uint32_t>(MAX_BS * sizeof(int32_t)), 0, 0, 0};
+        DataCopyExtParams copyParams{1, static_cast<uint32_t>(maxBs * sizeof(int32_t)), 0, 0, 0};
         DataCopyPadExtParams<int32_t> padParams{false, 0, 0, 0};
 
         LocalTensor<int32_t> fullOneLt = tempBuf8_.Get<int32_t>();
-        Duplicate<int32_t>(fullOneLt, 1, MAX_BS);
+        Duplicate<int32_t>(fullOneLt, 1, maxBs);
         PipeBarrier<PIPE_V>();
 
         // 计算 expandIdxOutputGT_ , 对应于输入 tokenExpertIdx
         // offset + numTokensPerExpertLen + numTokensUniquePerServerLen + numTokensPerServerLen + tokenServerCntLen +
         // tokenServerIdxLen
-        int32_t curRankDataOffset =
-            rank * len + numExperts + serverNum + MAX_BS * serverNum + MAX_BS + MAX_BS * serverNum;
+        int32_t curRankDataOffset = rank * len + numExperts + serverNum + maxBs * serverNum + maxBs + maxBs * serverNum;
         AscendC::SetFlag<HardEvent::MTE3_MTE2>(EVENT_ID0);  // MTE2 waits for MTE3
         for (int i = 0; i < numExperts; ++i) {
-            int32_t recvOffset = curRankDataOffset + i * MAX_BS;  // 每次从recvdata中拷贝 MAX_BS 个数
+            int32_t recvOffset = curRankDataOffset + i * maxBs;  // 每次从recvdata中拷贝 maxBs 个数
 
             event_t eventId = EVENT_ID0;
             AscendC::WaitFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -724,11 +723,11 @@ private:
 
             SyncFunc<AscendC::HardEvent::MTE2_V>();
 
-            Sub(dstLt, tmpLt, fullOneLt, MAX_BS);  // 所有偏移值-1，为-1的表示不发给该server
+            Sub(dstLt, tmpLt, fullOneLt, maxBs);  // 所有偏移值-1，为-1的表示不发给该server
             PipeBarrier<PIPE_V>();
             SyncFunc<AscendC::HardEvent::V_MTE3>();
 
-            int32_t tarOffset = i * MAX_BS;
+            int32_t tarOffset = i * maxBs;
             DataCopyPad(expandIdxOutputGT_[tarOffset], dstLt, copyParams);
 
             AscendC::SetFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -785,7 +784,7 @@ private:
 
         AscendC::SetFlag<HardEvent::MTE3_MTE2>(EVENT_ID0);  // MTE2 waits for MTE3
         int32_t dataOffset =
-            targetRankId * len + numExperts + serverNum + MAX_BS * serverNum + MAX_BS + MAX_BS * serverNum;
+            targetRankId * len + numExperts + serverNum + maxBs * serverNum + maxBs + maxBs * serverNum;
         for (int tokId = startTokenId; tokId < endTokenId; ++tokId) {
             int32_t recvOffset = dataOffset + tokId * numExperts;  // 每次从recvdata中拷贝 numExperts 个数
 
@@ -813,7 +812,7 @@ private:
 
             SyncFunc<AscendC::HardEvent::V_MTE3>();
 
-            int32_t tarOffset = index * MAX_BS * numExperts + tokId * numExperts;
+            int32_t tarOffset = index * maxBs * numExperts + tokId * numExperts;
             DataCopyPad(offsetInnerOutputGT_[tarOffset], tmpSumLt, copyParams);
 
             AscendC::SetFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -825,8 +824,8 @@ private:
     {
         // 分核处理token，2 server
         int32_t vBlockIdx = blockIdx - beginCoreId;     // 相对当前函数处理的 blockIdx
-        uint32_t coreForToken = MAX_BS / validCoreNum;  // 4096 / 20 = 204
-        uint32_t remainToken = MAX_BS % validCoreNum;   // 4096 % 20 = 16
+        uint32_t coreForToken = maxBs / validCoreNum;  // 如 4096 / 20 = 204
+        uint32_t remainToken = maxBs % validCoreNum;   // 如 4096 % 20 = 16
         uint32_t startTokenId = coreForToken * vBlockIdx;
         if (vBlockIdx < remainToken) {
             startTokenId += vBlockIdx;
@@ -855,11 +854,11 @@ private:
     {
         // 计算 countOuterOutputGT_
         LocalTensor<int32_t> tmpLt = tempBuf2_.Get<int32_t>();
-        DataCopyExtParams copyParams{1, static_cast<uint32_t>(MAX_BS * sizeof(int32_t)), 0, 0, 0};
+        DataCopyExtParams copyParams{1, static_cast<uint32_t>(maxBs * sizeof(int32_t)), 0, 0, 0};
         DataCopyPadExtParams<int32_t> padParams{false, 0, 0, 0};
 
         // offset + numTokensPerExpertLen + numTokensUniquePerServerLen + numTokensPerServerLen
-        int32_t curRankDataOffset = rank * len + numExperts + serverNum + MAX_BS * serverNum;
+        int32_t curRankDataOffset = rank * len + numExperts + serverNum + maxBs * serverNum;
 
         DataCopyPad(tmpLt, recvDataOutputGt[curRankDataOffset], copyParams, padParams);
 
@@ -950,15 +949,15 @@ private:
         }
 
         LocalTensor<int32_t> tmpLt = tempBuf2_.Get<int32_t>();
-        DataCopyExtParams copyParams{1, static_cast<uint32_t>(MAX_BS * sizeof(int32_t)), 0, 0, 0};
+        DataCopyExtParams copyParams{1, static_cast<uint32_t>(maxBs * sizeof(int32_t)), 0, 0, 0};
         DataCopyPadExtParams<int32_t> padParams{false, 0, 0, 0};
 
         AscendC::SetFlag<HardEvent::MTE3_MTE2>(EVENT_ID0);  // MTE2 waits for MTE3
         for (int i = startRankId; i < endRankId; ++i) {
-            int32_t dataOffset = i * len + numExperts + serverNum + MAX_BS * serverNum + MAX_BS + MAX_BS * serverNum +
-                                 MAX_BS * numExperts;
+            int32_t dataOffset = i * len + numExperts + serverNum + maxBs * serverNum + maxBs + maxBs * serverNum +
+                                 maxBs * numExperts;
             for (int j = 0; j < numExperts; ++j) {
-                int32_t recvOffset = dataOffset + j * MAX_BS;  // 每次从recvdata中拷贝 MAX_BS 个数
+                int32_t recvOffset = dataOffset + j * maxBs;  // 每次从recvdata中拷贝 maxBs 个数
 
                 event_t eventId = EVENT_ID0;
                 AscendC::WaitFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -968,7 +967,7 @@ private:
                 AscendC::SetFlag<HardEvent::MTE2_MTE3>(eventId);
                 AscendC::WaitFlag<HardEvent::MTE2_MTE3>(eventId);
 
-                int32_t tarOffset = (i * numExperts * MAX_BS) + j * MAX_BS;
+                int32_t tarOffset = (i * numExperts * maxBs) + j * maxBs;
                 DataCopyPad(gExpertMaxBsSrcGT_[tarOffset], tmpLt, copyParams);
 
                 AscendC::SetFlag<HardEvent::MTE3_MTE2>(eventId);
@@ -1178,7 +1177,7 @@ private:
                     AscendC::WaitFlag<HardEvent::MTE3_MTE2>(eventId);
 
                     SyncFunc<AscendC::HardEvent::S_MTE2>();  // 复用tmpLt，加一个同步
-                    int32_t inIdx = srcRank * numExperts * MAX_BS + expId * MAX_BS + tokId;
+                    int32_t inIdx = srcRank * numExperts * maxBs + expId * maxBs + tokId;
                     DataCopyPad(tmpLt, gExpertMaxBsSrcGT_[inIdx], copyParams, padParams);  // 只拷贝一个数
                     SyncFunc<AscendC::HardEvent::MTE2_S>();
                     int32_t srcOffsetVal = tmpLt(0) - 1;  // 给srcOffset-1，将偏移值从0开始
@@ -1186,7 +1185,7 @@ private:
                     pipe_barrier(PIPE_ALL);
 
                     SyncFunc<AscendC::HardEvent::MTE2_MTE3>();
-                    int32_t outIdx = expId * rankSize * MAX_BS + srcRank * MAX_BS + tokId;
+                    int32_t outIdx = expId * rankSize * maxBs + srcRank * maxBs + tokId;
                     DataCopyPad(srcOffsetRankTokenIdxOutputGT_[outIdx], tmpLt, copyParams);
 
                     if (tokId < validTokenCnt) {
@@ -1254,6 +1253,7 @@ private:
     int topkNum;
     int64_t numExperts;
     int64_t numTokens;
+    uint32_t maxBs;  // 每卡的最大bs，notify数据各段按它排布
     int64_t len;
     uint64_t magic;
     int64_t blockIdx;  // 当前aicore序号
@@ -12,6 +12,7 @@ struct NotifyDispatchInfo {
     uint32_t numTokens;
     uint32_t round;
     uint32_t perRoundTokens;
+    uint32_t expertRecvStatsMode;
     uint32_t aivNum;
     uint64_t totalUbSize;
 };
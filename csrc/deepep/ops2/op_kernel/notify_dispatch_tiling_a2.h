@@ -12,6 +12,7 @@ struct NotifyDispatchInfoA2 {
     uint32_t numTokens;
     uint32_t topkNum;
     uint32_t numExperts;
+    uint32_t maxBs;
     uint32_t aivNum;
     uint64_t totalUbSize;
 };
@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "exception.hpp"
+
+namespace deep_ep {
+
+// The groups of tensors an `OutputArena` keeps, every region is reused by the next call taking it
+enum class ArenaRegion : int {
+    NOTIFY_SCRATCH = 0,      // Intermediate results of a notify kernel, only read within the same call
+    PLACEHOLDER = 1,         // Operator arguments the kernels never read back
+    LOW_LATENCY_RECV_0 = 2,  // Low-latency dispatch outputs, two copies so a dispatch can run before the
+    LOW_LATENCY_RECV_1 = 3,  // previous one is combined
+    LOW_LATENCY_SEND_0 = 4,  // Low-latency combine inputs the expert GEMM writes into, one per receive copy
+    LOW_LATENCY_SEND_1 = 5,
+    COUNT = 6,
+};
+
+/*
+Persistent device memory for the tensors a `Buffer` allocates on every call, so the hot path neither goes through
+the caching allocator nor launches memsets:
+1. `begin(region)` starts a call, every tensor taken from the returned cursor is a view into the region storage;
+2. a take that does not fit is served by a fresh allocation, and the region grows to the call's total size on the
+   next `begin`, so after the first call at the worst-case shape the region never allocates again;
+3. views taken from a region stay valid until the next `begin` of the same region, the launches of one `Buffer` are
+   ordered on its communication stream, so the device never sees two calls use a region at once.
+
+The tensor primitives come from `TensorOps`, so the reuse can be checked with a host-side fake:
+    using Tensor = ...;
+    using Options = ...;
+    static int64_t element_size(const Options &options);
+    static Tensor allocate(int64_t num_bytes, const Options &options);
+    static Tensor view(const Tensor &storage, int64_t byte_offset, const std::vector<int64_t> &sizes,
+                       const Options &options);
+*/
+template <typename TensorOps>
+class OutputArena
+{
+    struct Slot;
+
+public:
+    using Tensor = typename TensorOps::Tensor;
+    using Options = typename TensorOps::Options;
+
+    // Byte alignment of every view, matches the alignment the device allocator gives
+    static constexpr int64_t ALIGNMENT = 512;
+
+    class Cursor
+    {
+    public:
+        Tensor take(const std::vector<int64_t> &sizes, const Options &options)
+        {
+            int64_t num_bytes = TensorOps::element_size(options);
+            for (int64_t size : sizes) {
+                EP_HOST_ASSERT(size >= 0);
+                num_bytes *= size;
+            }
+            int64_t aligned_bytes = align(num_bytes);
+            int64_t offset = used;
+            used += aligned_bytes;
+            slot.high_water = std::max(slot.high_water, used);
+            if (used > slot.capacity) {
+                // Only the first call at a new shape gets here
+                return TensorOps::view(TensorOps::allocate(std::max<int64_t>(aligned_bytes, ALIGNMENT), options), 0,
+                                       sizes, options);
+            }
+            return TensorOps::view(slot.storage, offset, sizes, options);
+        }
+
+    private:
+        friend class OutputArena;
+
+        explicit Cursor(Slot &slot) : slot(slot) {}
+
+        Slot &slot;
+        int64_t used = 0;
+    };
+
+    Cursor begin(ArenaRegion region, const Options &options)
+    {
+        Slot &slot = slots.at(static_cast<int>(region));
+        if (slot.high_water > slot.capacity) {
+            slot.storage = TensorOps::allocate(slot.high_water, options);
+            slot.capacity = slot.high_water;
+        }
+        return Cursor(slot);
+    }
+
+    int64_t reserved_bytes() const
+    {
+        int64_t total = 0;
+        for (const Slot &slot : slots) {
+            total += slot.capacity;
+        }
+        return total;
+    }
+
+    static int64_t align(int64_t num_bytes)
+    {
+        return (num_bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+private:
+    struct Slot {
+        Tensor storage;
+        int64_t capacity = 0;
+        int64_t high_water = 0;
+    };
+
+    std::array<Slot, static_cast<int>(ArenaRegion::COUNT)> slots;
+};
+
+}  // namespace deep_ep
@@ -15,26 +15,51 @@ namespace py = pybind11;
 
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m)
 {
+    pybind11::enum_<deep_ep::SocType>(m, "SocType")
+        .value("A2", deep_ep::SocType::A2)
+        .value("A3", deep_ep::SocType::A3);
+
     pybind11::class_<deep_ep::Config>(m, "Config")
         .def(pybind11::init<int, int, int, int, int>(), py::arg("num_sms") = 20,
              py::arg("num_max_nvl_chunked_send_tokens") = 6, py::arg("num_max_nvl_chunked_recv_tokens") = 256,
              py::arg("num_max_rdma_chunked_send_tokens") = 6, py::arg("num_max_rdma_chunked_recv_tokens") = 256)
-        .def("get_nvl_buffer_size_hint", &deep_ep::Config::get_nvl_buffer_size_hint)
-        .def("get_rdma_buffer_size_hint", &deep_ep::Config::get_rdma_buffer_size_hint);
-    m.def("get_low_latency_rdma_size_hint", &deep_ep::get_low_latency_rdma_size_hint);
+        .def("get_nvl_buffer_size_hint", &deep_ep::Config::get_nvl_buffer_size_hint, py::arg("hidden_bytes"),
+             py::arg("num_ranks"), py::arg("num_topk") = deep_ep::MAX_NUM_TOPK,
+             py::arg("num_max_tokens_per_round") = 8192, py::arg("round") = 1, py::arg("soc") = deep_ep::SocType::A3)
+        .def("get_rdma_buffer_size_hint", &deep_ep::Config::get_rdma_buffer_size_hint, py::arg("hidden_bytes"),
+             py::arg("num_ranks"), py::arg("num_experts") = 256);
+    m.def("get_low_latency_rdma_size_hint", &deep_ep::get_low_latency_rdma_size_hint,
+          py::arg("num_max_dispatch_tokens_per_rank"), py::arg("hidden"), py::arg("num_ranks"), py::arg("num_experts"),
+          py::arg("num_topk") = deep_ep::MAX_NUM_TOPK, py::arg("num_shared_expert_ranks") = 0);
+    m.def("get_dispatch_config_preset", &deep_ep::get_dispatch_config_preset);
+    m.def("get_combine_config_preset", &deep_ep::get_combine_config_preset);
 
     pybind11::class_<deep_ep::EventHandle>(m, "EventHandle")
         .def(pybind11::init<>())
         .def("current_stream_wait", &deep_ep::EventHandle::current_stream_wait);
 
+    pybind11::class_<deep_ep::DispatchHandle>(m, "DispatchHandle")
+        .def_readonly("notify_send_data", &deep_ep::DispatchHandle::notify_send_data)
+        .def_readonly("new_topk_idx", &deep_ep::DispatchHandle::new_topk_idx)
+        .def_readonly("dropped_topk", &deep_ep::DispatchHandle::dropped_topk);
+
     pybind11::class_<deep_ep::Buffer>(m, "Buffer")
         .def(pybind11::init<int, int, int64_t, int64_t, bool, std::string>())
         .def("is_available", &deep_ep::Buffer::is_available)
+        .def("is_auto_round", &deep_ep::Buffer::is_auto_round)
+        .def("get_expert_token_nums_type", &deep_ep::Buffer::get_expert_token_nums_type)
         .def("get_num_rdma_ranks", &deep_ep::Buffer::get_num_rdma_ranks)
         .def("get_rdma_rank", &deep_ep::Buffer::get_rdma_rank)
+        .def("get_comm_stream", &deep_ep::Buffer::get_comm_stream)
+        .def("reconfigure", &deep_ep::Buffer::reconfigure)
+        .def("set_expert_replicas", &deep_ep::Buffer::set_expert_replicas)
+        .def("set_expert_capacity", &deep_ep::Buffer::set_expert_capacity)
+        .def("set_active_ranks", &deep_ep::Buffer::set_active_ranks)
+        .def("set_telemetry", &deep_ep::Buffer::set_telemetry)
+        .def("get_telemetry", &deep_ep::Buffer::get_telemetry)
         .def("get_dispatch_layout", &deep_ep::Buffer::get_dispatch_layout)
-        .def("get_notify_send_data", &deep_ep::Buffer::get_notify_send_data)
         .def("clean_low_latency_buffer", &deep_ep::Buffer::clean_low_latency_buffer)
+        .def("get_next_low_latency_combine_buffer", &deep_ep::Buffer::get_next_low_latency_combine_buffer)
         .def("intranode_dispatch", &deep_ep::Buffer::intranode_dispatch)
         .def("notify_verify", &deep_ep::Buffer::notify_verify)
         .def("intranode_combine", &deep_ep::Buffer::intranode_combine)
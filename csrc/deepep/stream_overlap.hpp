@@ -0,0 +1,108 @@
+#pragma once
+#include <optional>
+
+#include "exception.hpp"
+
+namespace deep_ep {
+
+/*
+Orders one communication launch against the compute stream, following the DeepEP
+`previous_event` / `async` / `allocate_on_comm_stream` contract:
+1. the communication stream waits for `previous_event`, or for all work already queued on the compute stream;
+2. the current stream is switched to the communication stream, so kernels and allocations land there;
+3. `finish()` either returns an event for the caller to wait on (`async`) or makes the compute stream wait;
+4. the original current stream is restored, also when the launch throws.
+
+The stream primitives come from `StreamOps`, so the ordering can be checked with a host-side fake:
+    using Stream = ...;
+    using Event = ...;
+    static Stream current();
+    static void set_current(const Stream &stream);
+    static Event record(const Stream &stream);
+    static void wait(const Stream &stream, const Event &event);
+    template <typename Tensor> static void record_tensor(const Tensor &tensor, const Stream &stream);
+*/
+template <typename StreamOps>
+class StreamOverlap
+{
+public:
+    using Stream = typename StreamOps::Stream;
+    using Event = typename StreamOps::Event;
+
+    StreamOverlap(const Stream &comm_stream, const std::optional<Event> &previous_event, bool async,
+                  bool allocate_on_comm_stream)
+        : compute_stream(StreamOps::current()), comm_stream(comm_stream), async(async)
+    {
+        // Tensors owned by the comm stream are only safe if the caller orders the launch explicitly
+        if (allocate_on_comm_stream) {
+            EP_HOST_ASSERT(previous_event.has_value() and async);
+        }
+
+        // Wait previous tasks to be finished
+        if (previous_event.has_value()) {
+            StreamOps::wait(comm_stream, previous_event.value());
+        } else {
+            StreamOps::wait(comm_stream, StreamOps::record(compute_stream));
+        }
+        StreamOps::set_current(comm_stream);
+        switched = true;
+    }
+
+    StreamOverlap(const StreamOverlap &) = delete;
+    StreamOverlap &operator=(const StreamOverlap &) = delete;
+
+    ~StreamOverlap()
+    {
+        restore();
+    }
+
+    const Stream &get_compute_stream() const
+    {
+        return compute_stream;
+    }
+
+    const Stream &get_comm_stream() const
+    {
+        return comm_stream;
+    }
+
+    // Outputs are allocated on the comm stream but consumed on the compute stream (also by a later receive hook),
+    // and async launches keep reading inputs after the compute stream moved on, so the caching allocator must not
+    // reuse either of them early
+    template <typename... Tensors>
+    void record_tensors(const Tensors &...tensors) const
+    {
+        if (async) {
+            (StreamOps::record_tensor(tensors, comm_stream), ...);
+        }
+        (StreamOps::record_tensor(tensors, compute_stream), ...);
+    }
+
+    std::optional<Event> finish()
+    {
+        std::optional<Event> event;
+        if (async) {
+            event = StreamOps::record(comm_stream);
+        } else {
+            StreamOps::wait(compute_stream, StreamOps::record(comm_stream));
+        }
+        restore();
+        return event;
+    }
+
+private:
+    void restore()
+    {
+        if (switched) {
+            StreamOps::set_current(compute_stream);
+            switched = false;
+        }
+    }
+
+    Stream compute_stream;
+    Stream comm_stream;
+    bool async;
+    bool switched = false;
+};
+
+}  // namespace deep_ep
@@ -10,6 +10,14 @@ from deep_ep_cpp import Config, EventHandle
 from .utils import EventOverlap, log_parameters
 
 
+def _get_soc_type() -> deep_ep_cpp.SocType:
+    return (
+        deep_ep_cpp.SocType.A2
+        if "910B" in torch.npu.get_device_name()
+        else deep_ep_cpp.SocType.A3
+    )
+
+
 class Buffer:
 
     num_sms: int = 20
@@ -40,7 +48,11 @@ class Buffer:
         """
 
         self.rank = group.rank()
+        self.group = group
         self.group_size = group.size()
+        self.expert_capacity_enabled = False
+        # The layout of the latest `get_dispatch_layout`, used by a dispatch that is not given one
+        self.last_layout = None
         self.num_nvl_bytes = num_nvl_bytes
         self.num_rdma_bytes = num_rdma_bytes
         self.low_latency_mode = low_latency_mode
@@ -59,6 +71,154 @@ class Buffer:
             moe_all_to_all_group_name,
         )
 
+    def get_comm_stream(self) -> torch.Stream:
+        """
+        Get the communication stream.
+
+        Returns:
+            stream: the communication stream.
+        """
+        ts: torch.Stream = self.runtime.get_comm_stream()
+        return torch.npu.Stream(
+            stream_id=ts.stream_id,
+            device_index=ts.device_index,
+            device_type=ts.device_type,
+        )
+
+    def reconfigure(self) -> None:
+        """
+        Re-read the environment switches of the dispatch and combine functions, e.g. `MOE_EXPERT_TOKEN_NUMS_TYPE`,
+        `MOE_ENABLE_TOPK_NEG_ONE`, `MOE_SHARED_EXPERT_RANK_NUM`, `DEEPEP_NORMAL_LONG_SEQ_*` and `HCCL_BUFFSIZE`. They
+        are read once when the buffer is created, so changes made later take effect only after this call. It must not
+        be called while a low-latency receive hook is pending.
+        """
+        self.runtime.reconfigure()
+
+    def set_expert_replicas(
+        self,
+        log2phy: Optional[torch.Tensor],
+        logcnt: Optional[torch.Tensor] = None,
+        policy: str = "round_robin",
+    ) -> None:
+        """
+        Register a logical-to-physical redundant expert table, after which every `topk_idx` passed to the layout,
+        dispatch and fused MoE functions holds logical expert ids and each token is sent to one replica of its
+        experts. The combines route the results back by the replicas the dispatch picked, so callers keep passing
+        the logical `topk_idx`. `num_experts` arguments stay the number of physical experts.
+
+        Arguments:
+            log2phy: `[num_logical_experts, max_replicas]`, the physical expert ids of every logical expert, padded
+                with `-1`. `None` drops the table.
+            logcnt: `[num_logical_experts]`, the number of replicas of every logical expert, inferred from the
+                non-negative entries of `log2phy` if not set.
+            policy: `round_robin` gives token `i` of rank `r` the replica `(i + r) % logcnt`; `least_loaded` picks
+                the replica this rank sent the fewest tokens to in the same call. `least_loaded` is only done by the
+                A3 low-latency dispatch, every other path falls back to `round_robin`.
+        """
+        if log2phy is None:
+            self.runtime.set_expert_replicas(None, None, 0)
+            return
+        policies = {"round_robin": 0, "least_loaded": 1}
+        assert policy in policies, f"unknown replica policy {policy}"
+        log2phy = log2phy.to(device="npu", dtype=torch.int32).contiguous()
+        if logcnt is None:
+            logcnt = (log2phy >= 0).sum(dim=1)
+        logcnt = logcnt.to(device="npu", dtype=torch.int32).contiguous()
+        self.runtime.set_expert_replicas(log2phy, logcnt, policies[policy])
+
+    def set_expert_capacity(
+        self, capacity: int = 0, capacity_factor: float = 0.0
+    ) -> None:
+        """
+        Cap the top-k entries every expert takes from the whole group in the normal and low-latency dispatch, so that
+        a hot expert cannot blow up the tokens one rank receives. Every rank gathers the entries each rank routes to
+        each expert, `[num_ranks, num_experts]` with one all-gather per layout or low-latency dispatch, and splits the
+        capacity of an expert over the ranks by water-filling: a rank routing fewer entries than its share keeps
+        them all, the rest share what is left. Each rank drops its entries over its share before the layout is
+        computed, those with the lowest `topk_weights` first, and the combine skips them, i.e. they add zero. The
+        dropped entries are reported by `get_dropped_topk`. With redundant experts the logical experts are capped.
+        `fused_deep_moe` is not supported. All the ranks must set the same capacity.
+
+        Arguments:
+            capacity: the entries every expert may take from the whole group, `0` to use `capacity_factor` instead.
+            capacity_factor: the capacity as a factor of the mean entries per expert over the group,
+                `ceil(capacity_factor * sum(num_tokens) * num_topk / num_experts)`. Both `0` turn the capacity off.
+        """
+        self.expert_capacity_enabled = capacity > 0 or capacity_factor > 0
+        self.runtime.set_expert_capacity(capacity, capacity_factor)
+
+    @staticmethod
+    def get_dropped_topk(handle: Tuple) -> Optional[torch.Tensor]:
+        """
+        Get the top-k entries a dispatch dropped over the expert capacity.
+
+        Arguments:
+            handle: the communication handle returned by a normal or low-latency dispatch.
+
+        Returns:
+            dropped_topk: `[num_tokens, num_topk]` with `torch.bool`, set for the dropped entries, `None` if no
+                capacity was set.
+        """
+        return handle[-1].dropped_topk
+
+    def set_active_ranks(self, active_mask: Optional[torch.Tensor]) -> None:
+        """
+        Keep serving the A3 low-latency dispatch and combine with the ranks set in `active_mask` after some have
+        failed, without re-creating the buffer. Only a `low_latency_mode` buffer on A3 accepts it. The low-latency
+        dispatch drops the top-k entries whose experts live on inactive ranks and sends the rest to the active ranks
+        only, the combine gives the dropped weights to the kept experts of every token so that its weights still add
+        up to the same sum. Inactive ranks must not call any dispatch or combine, and every active rank must set the
+        same mask before its next dispatch. While ranks are inactive, the normal kernels and `fused_deep_moe` fail
+        instead of running, even with a layout or handle from before the mask, since their notify and sync collectives
+        wait for every rank. Shared expert ranks and redundant experts are not supported.
+
+        Arguments:
+            active_mask: `[num_ranks]`, whether every rank takes part, it is read to the host once here. `None` or an
+                all-true mask returns to the full group.
+        """
+        self.runtime.set_active_ranks(active_mask)
+
+    def set_telemetry(self, enable: bool = True) -> None:
+        """
+        Accumulate the per-peer costs the normal intranode kernels measure on every call: how long the dispatch waited
+        for the tokens of every peer and how long the combine took to send to every peer, in microseconds. The
+        kernels measure on every call while this is on, and the costs are added up on the device without syncing the host.
+        Tensors passed as `dispatch_wait_recv_cost_stats` or `combine_send_cost_stats` keep getting the costs too.
+        The low-latency and internode kernels do not measure per-peer costs, so it can only be enabled on an intranode
+        buffer without `low_latency_mode`.
+
+        Arguments:
+            enable: whether to measure, turning it off keeps the costs gathered so far.
+        """
+        self.runtime.set_telemetry(enable)
+
+    def get_telemetry(self, reset: bool = False) -> dict:
+        """
+        Snapshot the costs gathered since `set_telemetry` or the last reset, the copies are taken on the communication
+        stream and the current stream waits for them. One slow peer shows up as the largest `total_us` entry on every
+        rank, e.g. after a `SUM` all-reduce of `total_us` over the group.
+
+        Arguments:
+            reset: whether to clear the costs after the snapshot.
+
+        Returns:
+            telemetry: `dispatch_wait_recv` and `combine_send` entries, each a dict of `calls`, the number of calls,
+                `total_us`, `[num_ranks]` with `torch.int64`, the microseconds summed over the calls for every peer,
+                and `histogram`, `[num_ranks, num_buckets]` with `torch.int64`, the calls of every peer per bucket.
+                `bucket_bounds_us` holds the lower bound of every bucket, bucket `i > 0` covers `[2^(i-1), 2^i)` and
+                the last one is open.
+        """
+        totals, histogram, calls = self.runtime.get_telemetry(reset)
+        num_buckets = histogram.size(-1)
+        telemetry = {"bucket_bounds_us": [0] + [1 << i for i in range(num_buckets - 1)]}
+        for kind, name in enumerate(("dispatch_wait_recv", "combine_send")):
+            telemetry[name] = {
+                "calls": calls[kind],
+                "total_us": totals[kind],
+                "histogram": histogram[kind],
+            }
+        return telemetry
+
     @staticmethod
     def get_dispatch_config(num_ranks: int) -> Config:
         """
@@ -70,22 +230,9 @@ class Buffer:
         Returns:
             config: the recommended config.
         """
-
-        # TODO: automatically tune
-        config_map = {
-            2: Config(Buffer.num_sms, 24, 256, 6, 128),
-            4: Config(Buffer.num_sms, 6, 256, 6, 128),
-            8: Config(Buffer.num_sms, 6, 256, 6, 128),
-            16: Config(Buffer.num_sms, 36, 288, 20, 128),
-            24: Config(Buffer.num_sms, 8, 288, 32, 128),
-            32: Config(Buffer.num_sms, 32, 288, 32, 128),
-            64: Config(Buffer.num_sms, 20, 288, 28, 128),
-            128: Config(Buffer.num_sms, 20, 560, 32, 128),
-            144: Config(Buffer.num_sms, 32, 720, 12, 128),
-            160: Config(Buffer.num_sms, 28, 720, 12, 128),
-        }
-        assert num_ranks in config_map, f"Unsupported number of EP ranks: {num_ranks}"
-        return config_map[num_ranks]
+        return deep_ep_cpp.get_dispatch_config_preset(
+            num_ranks, Buffer.num_sms, _get_soc_type()
+        )
 
     @staticmethod
     def get_combine_config(num_ranks: int) -> Config:
@@ -98,22 +245,9 @@ class Buffer:
         Returns:
             config: the recommended config.
         """
-
-        # TODO: automatically tune
-        config_map = {
-            2: Config(Buffer.num_sms, 10, 256, 6, 128),
-            4: Config(Buffer.num_sms, 9, 256, 6, 128),
-            8: Config(Buffer.num_sms, 4, 256, 6, 128),
-            16: Config(Buffer.num_sms, 4, 288, 12, 128),
-            24: Config(Buffer.num_sms, 1, 288, 8, 128),
-            32: Config(Buffer.num_sms, 1, 288, 8, 128),
-            64: Config(Buffer.num_sms, 1, 288, 20, 128),
-            128: Config(Buffer.num_sms, 1, 560, 12, 128),
-            144: Config(Buffer.num_sms, 2, 720, 8, 128),
-            160: Config(Buffer.num_sms, 2, 720, 8, 128),
-        }
-        assert num_ranks in config_map, f"Unsupported number of EP ranks: {num_ranks}"
-        return config_map[num_ranks]
+        return deep_ep_cpp.get_combine_config_preset(
+            num_ranks, Buffer.num_sms, _get_soc_type()
+        )
 
     @staticmethod
     def set_num_sms(new_num_sms: int) -> None:
@@ -130,7 +264,7 @@ class Buffer:
     @staticmethod
     def capture() -> EventOverlap:
         """
-        Capture a CUDA event on the current stream, i.e. `torch.cuda.current_stream()`.
+        Capture an NPU event on the current stream, i.e. `torch.npu.current_stream()`.
 
         Returns:
             event: the captured event.
@@ -143,9 +277,31 @@ class Buffer:
         hidden: int,
         num_ranks: int,
         num_experts: int,
+        num_topk: int = 16,
+        num_shared_expert_ranks: int = 0,
     ) -> int:
+        """
+        Get the HCCL window bytes the low-latency dispatch and combine (and `fused_deep_moe`) need, `HCCL_BUFFSIZE`
+        must be at least this many MB, rounded up.
+
+        Arguments:
+            num_max_dispatch_tokens_per_rank: the largest number of tokens a rank dispatches in one call.
+            hidden: the hidden dimension of the tokens.
+            num_ranks: the number of ranks.
+            num_experts: the number of routed experts.
+            num_topk: the number of experts each token selects, the largest one the kernels support by default.
+            num_shared_expert_ranks: the number of ranks that only run the shared expert.
+
+        Returns:
+            size: the window bytes per rank.
+        """
         return deep_ep_cpp.get_low_latency_rdma_size_hint(
-            num_max_dispatch_tokens_per_rank, hidden, num_ranks, num_experts
+            num_max_dispatch_tokens_per_rank,
+            hidden,
+            num_ranks,
+            num_experts,
+            num_topk,
+            num_shared_expert_ranks,
         )
 
     # noinspection PyTypeChecker
@@ -156,12 +312,21 @@ class Buffer:
         previous_event: Optional[EventOverlap] = None,
         async_finish: bool = False,
         allocate_on_comm_stream: bool = False,
-    ) -> Tuple[
-        torch.Tensor, Optional[torch.Tensor], torch.Tensor, torch.Tensor, EventOverlap
-    ]:
+        num_max_tokens_per_rank: Optional[int] = None,
+        hidden: int = 0,
+        topk_weights: Optional[torch.Tensor] = None,
+        return_layout: bool = False,
+    ) -> Tuple:
         """
         Calculate the layout required for later communication.
 
+        Unless `DEEPEP_NORMAL_LONG_SEQ_*` fix them, the rounds of the intranode dispatch are picked here when
+        `num_max_tokens_per_rank` is given: a single round while that batch fits in `HCCL_BUFFSIZE`, otherwise as few
+        rounds as fit, up to 131072 tokens per rank. Without it a single round of up to 8192 tokens is used. No
+        collective or host sync is added either way, besides the count all-gather of `set_expert_capacity`. The A2
+        two-level kernels always run a single round, their notify data and scratch are sized for
+        `num_max_tokens_per_rank`, or for 4096 tokens if it is not given.
+
         Arguments:
             topk_idx: `[num_tokens, num_topk]`, dtype must be `torch.int64`, the expert indices selected by each token,
                 `-1` means no selections.
@@ -169,6 +334,12 @@ class Buffer:
             previous_event: the event to wait before actually executing the kernel.
             async_finish: the current stream will not wait for the communication kernels to be finished if set.
             allocate_on_comm_stream: control whether all the allocated tensors' ownership to be on the communication stream.
+            num_max_tokens_per_rank: the largest `num_tokens` over the ranks, all the ranks must pass the same value.
+                Needed for batches over 8192 tokens per rank.
+            hidden: the hidden dimension of the tokens to dispatch, the rounds only respect the window size if set.
+            topk_weights: `[num_tokens, num_topk]` with `torch.float`, the weights that decide which entries an expert
+                keeps under `set_expert_capacity`, the earlier tokens are kept if not set.
+            return_layout: also return the per-call layout state, to be passed to `dispatch` as `layout`.
 
         Returns:
             num_tokens_per_rank: `[num_ranks]` with `torch.int`, the number of tokens to be sent to each rank.
@@ -177,38 +348,84 @@ class Buffer:
             num_tokens_per_expert: `[num_experts]` with `torch.int`, the number of tokens to be sent to each expert.
             is_token_in_rank: `[num_tokens, num_ranks]` with `torch.int`, whether a token be sent to a rank.
             event: the event after executing the kernel (valid only if `async_finish` is set).
+            layout: the padded and remapped `topk_idx`, the rounds and the internode notify input of this call
+                (only if `return_layout` is set).
         """
         (
             num_tokens_per_rank,
             num_tokens_per_rdma_rank,
             num_tokens_per_expert,
             is_token_in_rank,
+            layout,
             event,
         ) = self.runtime.get_dispatch_layout(
             topk_idx,
             num_experts,
+            self._get_num_max_tokens(topk_idx.size(0), num_max_tokens_per_rank),
+            hidden,
             getattr(previous_event, "event", None),
             async_finish,
             allocate_on_comm_stream,
+            topk_weights,
+            self._gather_expert_counts(topk_idx, num_experts),
         )
+        self.last_layout = layout
         return (
             num_tokens_per_rank,
             num_tokens_per_rdma_rank,
             num_tokens_per_expert,
             is_token_in_rank,
             EventOverlap(event),
+        ) + ((layout,) if return_layout else ())
+
+    def _get_num_max_tokens(
+        self, num_tokens: int, num_max_tokens_per_rank: Optional[int]
+    ) -> int:
+        if num_max_tokens_per_rank is not None:
+            assert num_max_tokens_per_rank >= num_tokens
+            return num_max_tokens_per_rank
+        # Unknown: a single round, the rounds must agree over the ranks and are not gathered here
+        return 0
+
+    def _gather_expert_counts(
+        self, topk_idx: torch.Tensor, num_experts: int
+    ) -> Optional[torch.Tensor]:
+        if not self.expert_capacity_enabled:
+            return None
+        # Every rank splits the capacity from the counts of all the ranks, so they all give the same quotas
+        counts = torch.bincount(topk_idx.flatten() + 1, minlength=num_experts + 1)
+        counts = counts[1 : num_experts + 1].to(torch.int32)
+        expert_counts = torch.empty(
+            (self.group_size, num_experts), dtype=torch.int32, device=counts.device
         )
+        dist.all_gather_into_tensor(expert_counts, counts, group=self.group)
+        return expert_counts
 
     # internal interface, Only use in test
-    def get_notify_send_data(self) -> torch.Tensor:
+    def get_notify_send_data(self, layout=None) -> torch.Tensor:
         """
         Internal interface, we only use it to check the output of get_dispatch_layout.
 
+        Arguments:
+            layout: the layout returned by the `get_dispatch_layout` call to inspect (with `return_layout=True`), the
+                latest one if not set.
+
         Returns:
-            notify_send_data: the member variable of buffer, which usually contains the output of get_dispatch_layout.
+            notify_send_data: the internode notify input computed by that `get_dispatch_layout` call.
         """
-        notify_send_data = self.runtime.get_notify_send_data()
-        return notify_send_data
+        return (self.last_layout if layout is None else layout).notify_send_data
+
+    def _get_layout(self, layout, topk_idx: torch.Tensor):
+        # Without an explicit layout the one of the latest `get_dispatch_layout` is reused, it is never computed again
+        layout = self.last_layout if layout is None else layout
+        assert (
+            layout is not None
+        ), "dispatch needs the layout of get_dispatch_layout, call it first or pass it as `layout`"
+        assert topk_idx.size(0) == 0 or layout.new_topk_idx.shape == topk_idx.shape, (
+            f"the layout was computed for a top-k of shape {tuple(layout.new_topk_idx.shape)}, not "
+            f"{tuple(topk_idx.shape)}, pass the layout of this batch as `layout`"
+        )
+        return layout
 
     def clean_low_latency_buffer(
         self, num_max_dispatch_tokens_per_rank: int, hidden: int, num_experts: int
@@ -247,11 +464,13 @@ class Buffer:
         async_finish: bool = False,
         allocate_on_comm_stream: bool = False,
         dispatch_wait_recv_cost_stats: Optional[torch.Tensor] = None,
+        cumulative_local_expert_recv_stats: Optional[torch.Tensor] = None,
+        layout=None,
     ) -> Tuple[
         Union[Tuple[torch.Tensor, torch.Tensor], torch.Tensor],
         Optional[torch.Tensor],
         Optional[torch.Tensor],
-        List[int],
+        Union[List[int], torch.Tensor],
         Tuple,
         EventOverlap,
     ]:
@@ -266,7 +485,9 @@ class Buffer:
                 and type must be `torch.bfloat16`; for the second type, the first element of the tuple must be shaped as
                 `[num_tokens, hidden]` with type `torch.float8_e4m3fn`, the second must be `[num_tokens, hidden // 128]`
                  (requiring divisible) with type `torch.float`.
-            handle: an optional communication handle, if set, the CPU will reuse the layout information to save some time.
+            handle: an optional communication handle returned by an earlier intranode dispatch with the same routing, if
+                set, the notify results are reused instead of exchanged again and only `recv_x` is returned, the
+                layout arguments (`num_tokens_per_rank`, `is_token_in_rank`, `topk_idx`, ...) are taken from it.
             num_tokens_per_rank: `[num_ranks]` with `torch.int`, the number of tokens to be sent to each rank.
             num_tokens_per_rdma_rank: `[num_rdma_ranks]` with `torch.int`, the number of tokens to be sent to each RDMA
                 rank (with the same GPU index), return `None` for intranode settings.
@@ -277,13 +498,23 @@ class Buffer:
             topk_weights: `[num_tokens, num_topk]` with `torch.float`, the expert weights of each token to dispatch.
             expert_alignment: align the number of tokens received by each local expert to this variable.
             num_worst_tokens: the worst number of tokens to receive, if specified, there will be no CPU sync, and it
-                will be CUDA-graph compatible. Please also notice that this flag is for intranode only.
+                will be CUDA-graph compatible. Please also notice that this flag is for intranode only. It must not be
+                smaller than the number of tokens this rank receives. The communication window is then reserved for the
+                `num_max_tokens_per_rank` given to `get_dispatch_layout`, or for all the tokens of the rounds if unknown.
             config: the performance tuning config.
             previous_event: the event to wait before actually executing the kernel.
             async_finish: the current stream will not wait for the communication kernels to be finished if set.
             allocate_on_comm_stream: control whether all the allocated tensors' ownership to be on the communication stream.
             dispatch_wait_recv_cost_stats: `[num_ranks]` with `torch.int`, record the time it takes for the dispatch phase
                 to receive all tokens from each slave rank in the current rank.
+            cumulative_local_expert_recv_stats: a cumulative expert count tensor for statistics, typed as `torch.int`
+                and shaped as `[num_local_experts]`, or `[num_local_experts, num_ranks]` to also break the counts down
+                by source rank. The received token counts are added to it on the device, without a CPU sync. This is
+                useful for online service EP load balance monitoring. Intranode only.
+            layout: the layout returned by `get_dispatch_layout(..., return_layout=True)` together with the counts
+                and `is_token_in_rank` passed here. If not set, the layout of the latest `get_dispatch_layout` call
+                of this buffer is used, so pass it whenever several layouts are interleaved with their dispatches.
+                Without any layout the dispatch fails, it is never computed again.
 
         Returns:
             recv_x: received tokens, the first element is a `torch.Tensor` shaped as `[received_token_count, hidden]` with
@@ -292,8 +523,9 @@ class Buffer:
             recv_topk_idx: received expert indices.
             recv_topk_weights: received expert weights.
             num_recv_tokens_per_expert_list: Python list shaped `[num_local_experts]`, the received token count by
-                each local expert, aligned to the input `expert_alignment`. If `num_worst_tokens` is specified, the list
-                will be empty.
+                each local expert, aligned to the input `expert_alignment`. If `num_worst_tokens` is specified, this is
+                a `torch.int` tensor on the device instead, and `recv_x` is shaped as `[num_worst_tokens, hidden]` with
+                only the leading rows valid.
             handle: the returned communication handle.
             event: the event after executing the kernel (valid only if `async_finish` is set).
         """
@@ -302,6 +534,9 @@ class Buffer:
 
         # Internode
         if self.runtime.get_num_rdma_ranks() > 1:
+            assert (
+                cumulative_local_expert_recv_stats is None
+            ), "Expert receive statistics are intranode only"
             return self.internode_dispatch(
                 x,
                 handle,
@@ -316,6 +551,7 @@ class Buffer:
                 previous_event,
                 async_finish,
                 allocate_on_comm_stream,
+                layout,
             )
 
         # Launch the kernel with cached or non-cached mode
@@ -325,8 +561,49 @@ class Buffer:
         use_quant = os.getenv("DEEP_NORMAL_MODE_USE_INT8_QUANT") == "1"
 
         if handle is not None:
-            raise NotImplementedError(
-                "Optional communication handle is not supported yet."
+            # The notify results are taken from the handle, only the tokens are sent
+            (
+                rank_prefix_matrix,
+                channel_prefix_matrix,
+                recv_channel_prefix_matrix,
+                recv_src_idx,
+                is_token_in_rank,
+                send_head,
+                topk_idx,
+                topk_weights,
+                dispatch_handle,
+            ) = handle
+            recv_x, recv_x_scales, _, _, _, _, _, _, _, _, _, _, event = (
+                self.runtime.intranode_dispatch(
+                    x,
+                    x_scales,
+                    topk_idx,
+                    topk_weights,
+                    None,
+                    is_token_in_rank,
+                    None,
+                    dispatch_handle,
+                    0,
+                    rank_prefix_matrix,
+                    channel_prefix_matrix,
+                    dispatch_wait_recv_cost_stats,
+                    cumulative_local_expert_recv_stats,
+                    expert_alignment,
+                    num_worst_tokens,
+                    config,
+                    getattr(previous_event, "event", None),
+                    async_finish,
+                    allocate_on_comm_stream,
+                    use_quant,
+                )
+            )
+            return (
+                (recv_x, recv_x_scales) if use_quant else recv_x,
+                None,
+                None,
+                None,
+                handle,
+                EventOverlap(event),
             )
         else:
             assert (
@@ -334,17 +611,20 @@ class Buffer:
                 and is_token_in_rank is not None
                 and num_tokens_per_expert is not None
             )
+            layout = self._get_layout(layout, topk_idx)
             (
                 recv_x,
                 recv_x_scales,
                 recv_topk_idx,
                 recv_topk_weights,
                 num_recv_tokens_per_expert_list,
+                num_recv_tokens_per_expert,
                 rank_prefix_matrix,
                 channel_prefix_matrix,
                 recv_channel_prefix_matrix,
                 recv_src_idx,
                 send_head,
+                dispatch_handle,
                 event,
             ) = self.runtime.intranode_dispatch(
                 x,
@@ -354,10 +634,12 @@ class Buffer:
                 num_tokens_per_rank,
                 is_token_in_rank,
                 num_tokens_per_expert,
+                layout,
                 0,
                 None,
                 None,
                 dispatch_wait_recv_cost_stats,
+                cumulative_local_expert_recv_stats,
                 expert_alignment,
                 num_worst_tokens,
                 config,
@@ -375,12 +657,17 @@ class Buffer:
                 send_head,
                 topk_idx,
                 topk_weights,
+                dispatch_handle,
             )
             return (
                 (recv_x, recv_x_scales) if use_quant else recv_x,
                 recv_topk_idx,
                 recv_topk_weights,
-                num_recv_tokens_per_expert_list,
+                (
+                    num_recv_tokens_per_expert_list
+                    if num_worst_tokens == 0
+                    else num_recv_tokens_per_expert
+                ),
                 handle,
                 EventOverlap(event),
             )
@@ -405,6 +692,7 @@ class Buffer:
         async_finish: bool = False,
         allocate_on_comm_stream: bool = False,
         dispatch_wait_recv_cost_stats: Optional[torch.Tensor] = None,
+        layout=None,
     ) -> Tuple[
         torch.Tensor,
         torch.Tensor,
@@ -434,6 +722,7 @@ class Buffer:
                 and is_token_in_rank is not None
                 and num_tokens_per_expert is not None
             )
+            layout = self._get_layout(layout, topk_idx)
             (
                 recv_data,
                 recv_count,
@@ -452,6 +741,7 @@ class Buffer:
                 num_tokens_per_rank,
                 is_token_in_rank,
                 num_tokens_per_expert,
+                layout,
                 0,
                 None,
                 None,
@@ -535,11 +825,21 @@ class Buffer:
             send_head,
             topk_idx,
             topk_weights_ori,
+            dispatch_handle,
         ) = handle
 
         # Launch the kernel
         recv_x, recv_topk_weights, event = self.runtime.intranode_combine(
-            x, topk_idx, topk_weights_ori, src_idx, send_head, combine_send_cost_stats
+            x,
+            topk_idx,
+            topk_weights_ori,
+            src_idx,
+            send_head,
+            dispatch_handle,
+            combine_send_cost_stats,
+            getattr(previous_event, "event", None),
+            async_finish,
+            allocate_on_comm_stream,
         )
         return recv_x, recv_topk_weights, EventOverlap(event)
 
@@ -558,6 +858,7 @@ class Buffer:
         previous_event: Optional[EventOverlap] = None,
         async_finish: bool = False,
         allocate_on_comm_stream: bool = False,
+        layout=None,
     ) -> Tuple[
         Union[Tuple[torch.Tensor, torch.Tensor], torch.Tensor],
         Optional[torch.Tensor],
@@ -582,6 +883,7 @@ class Buffer:
                 and is_token_in_rank is not None
                 and num_tokens_per_expert is not None
             )
+            layout = self._get_layout(layout, topk_idx)
             (
                 recv_x,
                 recv_x_scales,
@@ -594,6 +896,7 @@ class Buffer:
                 offset_outer,
                 count_outer,
                 expand_scales,
+                dispatch_handle,
                 event,
             ) = self.runtime.internode_dispatch(
                 x,
@@ -604,6 +907,7 @@ class Buffer:
                 num_tokens_per_rdma_rank,
                 is_token_in_rank,
                 num_tokens_per_expert,
+                layout,
                 config,
                 getattr(previous_event, "event", None),
                 async_finish,
@@ -620,6 +924,7 @@ class Buffer:
                 offset_outer,  # token_server_idx
                 count_outer,
                 expand_scales,
+                dispatch_handle,
             )
             return (
                 (recv_x, recv_x_scales) if use_quant else recv_x,
@@ -655,6 +960,7 @@ class Buffer:
             offset_outer,
             count_outer,
             expand_scales,
+            dispatch_handle,
         ) = handle
 
         # Launch the kernel
@@ -668,6 +974,10 @@ class Buffer:
             offset_outer,
             count_outer,
             expand_scales,
+            dispatch_handle,
+            getattr(previous_event, "event", None),
+            async_finish,
+            allocate_on_comm_stream,
         )
         return recv_x, recv_topk_weights, EventOverlap(event)
 
@@ -685,6 +995,8 @@ class Buffer:
         use_ue8m0: bool = False,
         async_finish: bool = False,
         return_recv_hook: bool = False,
+        use_block_scales: bool = False,
+        topk_weights: Optional[torch.Tensor] = None,
     ) -> Tuple[
         Tuple[torch.Tensor, torch.Tensor], torch.Tensor, Tuple, EventOverlap, Callable
     ]:
@@ -698,30 +1010,39 @@ class Buffer:
                 are supported. `-1` indices (not selecting any expert) are supported.
             num_max_dispatch_tokens_per_rank: the maximum number of tokens to dispatch, all the ranks must hold the same value.
             num_experts: the number of all experts.
-            cumulative_local_expert_recv_stats: a cumulative expert count tensor for statistics, which should have shape
-                `[num_local_experts]` and be typed as `torch.int`. This is useful for online service EP load balance
-                monitoring.
-            use_fp8: whether to enable FP8 casting, with this, the received data will be a tuple of FP8 tensor and scaling factors.
-            round_scale: whether round the scaling factors into power of 2.
+            cumulative_local_expert_recv_stats: a cumulative expert count tensor for statistics, typed as `torch.int`
+                and shaped as `[num_local_experts]`, or `[num_local_experts, num_ranks]` to also break the counts down
+                by source rank (A3 only). The receiving kernel adds the received token counts to it with an atomic
+                add. This is useful for online service EP load balance monitoring.
+            use_fp8: whether to enable FP8-style casting, with this, the received data will be a tuple of int8 tensor and
+                scaling factors.
+            round_scale: whether round the scaling factors into power of 2 (available only with `use_block_scales=True`).
             use_ue8m0: whether use UE8M0 as scaling factor format (available only with `round_scale=True`).
             async_finish: the current stream will not wait for the communication kernels to be finished if set.
             return_recv_hook: return a receiving hook if set. If set, the kernel will just do the RDMA request issues,
                 but **without actually receiving the data**. You must call the received hook to make sure the data's arrival.
-                If you do not set this flag, the kernel will ensure the data's arrival.
+                If you do not set this flag, the kernel will ensure the data's arrival. The dispatch sends alternate
+                between two window halves of their own, so the dispatch after next must wait until this hook has run.
+            use_block_scales: with `use_fp8`, quantize with one scale per 128 channels instead of one per token (A3
+                only), so a block-quantized grouped GEMM can consume the received tokens directly.
+            topk_weights: `[num_tokens, num_topk]` with `torch.float`, the weights that decide which entries an expert
+                keeps under `set_expert_capacity`, the earlier tokens are kept if not set.
 
         Returns:
             recv_x: a tensor or tuple with received tokens for each expert.
-                With `use_fp8=True`: the first element is a `torch.Tensor` shaped as
-                `[num_local_experts, num_max_dispatch_tokens_per_rank * num_ranks, hidden]` with `torch.float8_e4m3fn`.
-                The second tensor is the corresponding scales for the first element with shape
-                `[num_local_experts, num_max_dispatch_tokens_per_rank * num_ranks, hidden // 128]` with `torch.float`,
-                if `use_ue8m0=False`. With `use_ue8m0=True`, the second one is packed and shaped as
-                `[num_local_experts, num_max_dispatch_tokens_per_rank * num_ranks, hidden // 512]` with type `torch.int`.
-                Notice that, the last-two-dimension of the scaling tensors are in column-major for TMA compatibility.
-                With `use_fp8=False`, the result would be a tensor shaped as
-                `[num_local_experts, num_max_dispatch_tokens_per_rank * num_ranks, hidden]` with `torch.bfloat16`.
+                The tokens of all local experts are packed along the first dimension, `num_max_tokens` rows in total.
+                With `use_fp8=True`: the first element is a `torch.Tensor` shaped as `[num_max_tokens, hidden]` with
+                `torch.int8`. The second tensor is the corresponding scales for the first element, shaped as
+                `[num_max_tokens]` with `torch.float`. With `use_block_scales=True` it is shaped as
+                `[num_max_tokens, hidden // 128]` if `use_ue8m0=False`. With `use_ue8m0=True`, the second one is
+                packed and shaped as `[num_max_tokens, hidden // 512]` with type `torch.int`, four exponent bytes per
+                int. All scaling tensors are row-major.
+                With `use_fp8=False`, the result would be a tensor shaped as `[num_max_tokens, hidden]` with
+                `torch.bfloat16`.
                 Moreover, not all tokens are valid, only some of the `num_max_dispatch_tokens_per_rank * num_ranks` are,
                 as we do not synchronize CPU received count with GPU (also not incompatible with CUDA graph if synced).
+                The received tensors, `recv_count` and the handle tensors are views into two buffer-owned copies that
+                the dispatches use in turn, so they stay valid until the dispatch after the next one.
             recv_count: a tensor shaped `[num_local_experts]` with type `torch.int`, indicating how many tokens each
                 expert receives. As mentioned before, not all tokens are valid in `recv_x`.
             handle: the communication handle to be used in the `low_latency_combine` function.
@@ -735,6 +1056,7 @@ class Buffer:
             packed_recv_count,
             packed_recv_src_info,
             packed_recv_layout_range,
+            dispatch_handle,
             event,
             hook,
         ) = self.runtime.low_latency_dispatch(
@@ -746,8 +1068,11 @@ class Buffer:
             use_fp8,
             round_scale,
             use_ue8m0,
+            use_block_scales,
             async_finish,
             return_recv_hook,
+            topk_weights,
+            self._gather_expert_counts(topk_idx, num_experts),
         )
         handle = (
             packed_recv_src_info,
@@ -756,6 +1081,7 @@ class Buffer:
             x.size(1),
             num_experts,
             packed_recv_count,
+            dispatch_handle,
         )
         tensors_to_record = (
             x,
@@ -786,6 +1112,10 @@ class Buffer:
         async_finish: bool = False,
         return_recv_hook: bool = False,
         out: Optional[torch.Tensor] = None,
+        use_int8: bool = False,
+        int8_block_scaled: bool = False,
+        shared_expert_x: Optional[torch.Tensor] = None,
+        residual: Optional[torch.Tensor] = None,
     ) -> Tuple[torch.Tensor, EventOverlap, Callable]:
         """
         A low-latency implementation for combine.
@@ -799,13 +1129,25 @@ class Buffer:
             topk_weights: `[num_combined_tokens, num_topk]` with `torch.float`, the expert weights selected by the dispatched
                 tokens. The received tokens will be reduced with the weights in this tensor.
             handle: the communication handle given by the `dispatch` function.
-            zero_copy: whether the tensor is already copied into the RDMA buffer, should be cooperative
-                with `get_next_low_latency_combine_buffer`.
+            zero_copy: whether `x` is the tensor returned by `get_next_low_latency_combine_buffer` for this `handle`,
+                the kernel reads `x` in place either way, the flag checks that the expert outputs were written into
+                the buffer-owned memory.
             async_finish: the current stream will not wait for the communication kernels to be finished if set.
             return_recv_hook: return a receiving hook if set. If set, the kernel will just do the RDMA request issues,
                 but **without actually receiving the data**. You must call the received hook to make sure the data's arrival.
-                If you do not set this flag, the kernel will ensure the data's arrival.
+                If you do not set this flag, the kernel will ensure the data's arrival. The combine sends alternate
+                between two window halves of their own, so the combine after next must wait until this hook has run.
             out: the in-place output tensor, if set, the kernel will write the result to this tensor and return it directly.
+            use_int8: whether to send the tokens as int8 (A3 only), the receiver dequantizes them while reducing with
+                `topk_weights`. By default every token has one scale, which is folded into its top-k weight.
+            int8_block_scaled: with `use_int8`, send one scale per 8 channels instead of one per token, for tokens
+                whose channels differ a lot in magnitude.
+            shared_expert_x: `[num_combined_tokens, hidden]` with `torch.bfloat16`, the output of a shared expert
+                computed on this rank, added unweighted to every token in the final reduction pass. Not supported with
+                shared expert ranks or the A2 layered kernel.
+            residual: `[num_combined_tokens, hidden]` with `torch.bfloat16`, the residual stream, added like
+                `shared_expert_x`. With both set the result is `residual + shared_expert_x + sum_k(w_k * expert_k)`,
+                the two are summed into one addend before the kernel.
 
         Returns:
             combined_x: the reduced token tensor, with shape `[num_combined_tokens, hidden]` and type `torch.bfloat16`.
@@ -820,6 +1162,7 @@ class Buffer:
             hidden,
             num_experts,
             packed_recv_count,
+            dispatch_handle,
         ) = handle
         combined_x, event, hook = self.runtime.low_latency_combine(
             x,
@@ -830,10 +1173,15 @@ class Buffer:
             num_max_dispatch_tokens_per_rank,
             num_experts,
             packed_recv_count,
+            dispatch_handle,
+            use_int8,
+            int8_block_scaled,
             zero_copy,
             async_finish,
             return_recv_hook,
             out,
+            shared_expert_x,
+            residual,
         )
         tensors_to_record = (
             x,
@@ -841,6 +1189,8 @@ class Buffer:
             topk_weights,
             src_info,
             layout_range,
+            shared_expert_x,
+            residual,
             combined_x,
         )
         return (
@@ -849,6 +1199,30 @@ class Buffer:
             hook,
         )
 
+    def get_next_low_latency_combine_buffer(self, handle: object) -> torch.Tensor:
+        """
+        Get the buffer the expert outputs of a low-latency dispatch can be written into, so that the down-projection
+        writes straight into memory this buffer owns and no per-layer output tensor is allocated. Pass it to
+        `low_latency_combine` with `zero_copy=True`.
+
+        Arguments:
+            handle: the communication handle given by the `low_latency_dispatch` function.
+
+        Returns:
+            buffer: `[num_max_recv_tokens, hidden]` with `torch.bfloat16`, laid out like the packed `recv_x`. It stays
+                valid until the dispatch after the next one, like the dispatch outputs.
+        """
+        (
+            src_info,
+            layout_range,
+            num_max_dispatch_tokens_per_rank,
+            hidden,
+            num_experts,
+            packed_recv_count,
+            dispatch_handle,
+        ) = handle
+        return self.runtime.get_next_low_latency_combine_buffer(dispatch_handle, hidden)
+
     def fused_deep_moe(
         self,
         x: torch.Tensor,
@@ -886,6 +1260,10 @@ class Buffer:
 
         Notes:
             - The first dimension of `topk_idx` defines the batch size `bs`.
+            - One kernel launch takes at most 256 tokens of every rank. A larger `num_max_dispatch_tokens_per_rank` is
+              split evenly into rounds with the workspace of one round. The rounds are separate launches on one
+              stream and do not overlap each other, so this only lifts the 256-token limit: a round costs about as
+              much as a full call, and it is not a faster path for large batches.
             - The second dimension of `x` defines the hidden dimension `hidden`.
             - Exact shapes of weight/scale tensors depend on GMM permutation and sharding.
             - If optional scale tensors are empty, the kernel skips those transforms.
@@ -914,3 +1292,72 @@ class Buffer:
         )
 
         return output, ep_recv_count
+
+    def grouped_matmul_moe(
+        self,
+        x: torch.Tensor,
+        topk_idx: torch.Tensor,
+        topk_weights: torch.Tensor,
+        gmm1_weight: torch.Tensor,
+        gmm1_weight_scale: Optional[torch.Tensor],
+        gmm2_weight: torch.Tensor,
+        gmm2_weight_scale: Optional[torch.Tensor],
+        num_max_dispatch_tokens_per_rank: int,
+        num_experts: int,
+        use_int4_weights: bool = False,
+    ) -> Tuple[torch.Tensor, torch.Tensor]:
+        """
+        MoE expert forward and combination on bf16 activations, for the weights `fused_deep_moe` has no kernel for.
+        This is not fused: it launches a low-latency dispatch, two grouped matmuls around a SwiGLU and a low-latency
+        combine in turn, the same as a caller composing these APIs, and needs a low-latency buffer.
+
+        Arguments:
+            x: `[bs, hidden]` with `torch.bfloat16`, the token representations to be processed by selected experts.
+            topk_idx: `[bs, num_topk]` with `torch.int64`, the selected expert indices for each token, `-1` indices
+                are supported.
+            topk_weights: `[bs, num_topk]` with `torch.float`, the weights the combined tokens are reduced with.
+            gmm1_weight: `[num_local_experts, hidden, 2 * intermediate]` with the gate half first, not permuted.
+            gmm1_weight_scale: `[num_local_experts, hidden // group_size, 2 * intermediate]` bf16 antiquant scales
+                with `use_int4_weights`, ignored otherwise.
+            gmm2_weight: `[num_local_experts, intermediate, hidden]`.
+            gmm2_weight_scale: `[num_local_experts, intermediate // group_size, hidden]` bf16 antiquant scales with
+                `use_int4_weights`, ignored otherwise.
+            num_max_dispatch_tokens_per_rank: the maximum number of tokens to dispatch, all the ranks must hold the
+                same value.
+            num_experts: the number of experts.
+            use_int4_weights: the weights are int4 packed eight to an int32 along the last dimension (W4A16, the
+                activations are not quantized), bf16 weights otherwise.
+
+        Returns:
+            output: `[bs, hidden]` with `torch.bfloat16`, the combined expert output.
+            ep_recv_count: `torch.Tensor`, a 1D tensor of type `torch.int32`, owned by the caller, as the
+                low-latency dispatch returns it.
+        """
+        # Rows past the received tokens are never combined
+        recv_x, recv_count, handle, _, _ = self.low_latency_dispatch(
+            x, topk_idx, num_max_dispatch_tokens_per_rank, num_experts, use_fp8=False
+        )
+        gmm_args = {
+            "split_item": 2,
+            "group_type": 0,
+            "group_list": recv_count.to(torch.int64),
+            # 1: tokens per expert, 0: their prefix sums, as the dispatch returns them
+            "group_list_type": self.runtime.get_expert_token_nums_type(),
+            "output_dtype": torch.bfloat16,
+        }
+        gmm1_args, gmm2_args = {}, {}
+        if use_int4_weights:
+            gmm1_args["antiquant_scale"] = [gmm1_weight_scale]
+            gmm2_args["antiquant_scale"] = [gmm2_weight_scale]
+        hidden_states = torch_npu.npu_grouped_matmul(
+            x=[recv_x], weight=[gmm1_weight], **gmm1_args, **gmm_args
+        )[0]
+        hidden_states = torch_npu.npu_swiglu(hidden_states)
+        hidden_states = torch_npu.npu_grouped_matmul(
+            x=[hidden_states], weight=[gmm2_weight], **gmm2_args, **gmm_args
+        )[0]
+        output, _, _ = self.low_latency_combine(
+            hidden_states, topk_idx, topk_weights, handle
+        )
+        # handle[1] -> ep_recv_count, a view into the double-buffered dispatch outputs that a later dispatch reuses
+        return output, handle[1].clone()
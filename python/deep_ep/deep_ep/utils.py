@@ -2,7 +2,7 @@ import functools
 import inspect
 import logging
 import os
-from typing import Optional, Tuple
+from typing import Any, Optional, Tuple
 
 import torch
 import torch_npu
@@ -20,7 +20,7 @@ class EventOverlap:
         Initialize the class.
 
         Arguments:
-            event: the CUDA event captured.
+            event: the NPU event captured.
             extra_tensors: an easier way to simulate PyTorch tensor `record_stream`, may be useful with CUDA graph.
         """
         self.event = event
@@ -30,7 +30,35 @@ class EventOverlap:
         self.extra_tensors = extra_tensors
 
     def current_stream_wait(self) -> None:
-        pass
+        """
+        The current stream `torch.npu.current_stream()` waits for the event to be finished.
+        Synchronous launches carry no event, waiting on them is a no-op.
+        """
+        if self.event is not None:
+            self.event.current_stream_wait()
+
+    def __enter__(self) -> Any:
+        """
+        Utility for overlapping and Python `with` syntax.
+
+        You can overlap the kernels on the current stream with the following example:
+        ```python
+        event_overlap = event_after_all_to_all_kernels()
+        with event_overlap:
+            do_something_on_current_stream()
+        # After exiting the `with` scope, the current stream will wait the event to be finished.
+        ```
+        """
+        return self
+
+    def __exit__(self, exc_type: Any, exc_val: Any, exc_tb: Any) -> None:
+        """
+        Utility for overlapping and Python `with` syntax.
+
+        Please follow the example in the `__enter__` function.
+        """
+        if self.event is not None:
+            self.event.current_stream_wait()
 
 
 logger = logging.getLogger()
@@ -0,0 +1,474 @@
+#include "loopback_simulator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <thread>
+
+namespace deep_ep {
+namespace sim {
+namespace {
+
+constexpr int EXPAND_IDX_INFO = 3;
+// Fields every rank sends per (round, expert) in the notify: token count, first window slot, tokens of the round
+constexpr int SEND_PER_GROUP = 3;
+
+// A token in a send window, the hidden states followed by the triple the kernels write behind them
+struct WindowToken {
+    int32_t pair = 0;  // Receive pair on the destination rank, only used by the low-latency protocol
+    std::array<int32_t, EXPAND_IDX_INFO> triple{};
+    std::vector<float> x;
+};
+
+// A row the combine sends back to the slot `token * num_slots + topk` of its source rank
+struct CombineToken {
+    int32_t slot = 0;
+    std::vector<float> x;
+};
+
+bool is_valid_expert(int64_t expert, int num_experts)
+{
+    return expert >= 0 and expert < num_experts;
+}
+
+int real_round(int num_tokens, int per_round_tokens)
+{
+    return (num_tokens + per_round_tokens - 1) / per_round_tokens;
+}
+
+std::vector<float> row_of(const std::vector<float> &x, int index, int hidden)
+{
+    return std::vector<float>(x.begin() + static_cast<int64_t>(index) * hidden,
+                              x.begin() + static_cast<int64_t>(index + 1) * hidden);
+}
+
+// Weighted sum of the slots of one token in the order of the combine kernels, every product is rounded on its own
+void accumulate(std::vector<float> &sum, const std::vector<float> &x, float scale)
+{
+    for (size_t h = 0; h < sum.size(); ++h) {
+        float product = x[h] * scale;
+        sum[h] += product;
+    }
+}
+
+// Gathers the combined rows sent to `rank` into one slot table, every slot is written by at most one row
+std::vector<const std::vector<float> *> gather_slots(
+    const std::vector<std::vector<std::vector<CombineToken>>> &gathered, int rank, int num_slots)
+{
+    std::vector<const std::vector<float> *> slots(num_slots, nullptr);
+    for (const auto &per_dst : gathered) {
+        for (const CombineToken &token : per_dst[rank]) {
+            EP_HOST_ASSERT(token.slot >= 0 and token.slot < num_slots);
+            EP_HOST_ASSERT(slots[token.slot] == nullptr);
+            slots[token.slot] = &token.x;
+        }
+    }
+    return slots;
+}
+
+}  // namespace
+
+float round_to_bf16(float value)
+{
+    if (std::isnan(value)) {
+        return value;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    bits &= 0xFFFF0000U;
+    std::memcpy(&value, &bits, sizeof(bits));
+    return value;
+}
+
+LoopbackGroup::LoopbackGroup(int num_ranks) : size(num_ranks), slots(num_ranks)
+{
+    EP_HOST_ASSERT(num_ranks > 0);
+}
+
+void LoopbackGroup::run(const std::function<void(int)> &body)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        num_arrived = 0;
+        aborted = false;
+    }
+    std::vector<std::exception_ptr> errors(size);
+    std::vector<std::thread> threads;
+    threads.reserve(size);
+    for (int rank = 0; rank < size; ++rank) {
+        threads.emplace_back([this, &body, &errors, rank]() {
+            try {
+                body(rank);
+            } catch (const Aborted &) {
+                // Another rank failed first and reports
+            } catch (...) {
+                errors[rank] = std::current_exception();
+                std::lock_guard<std::mutex> lock(mutex);
+                aborted = true;
+                cv.notify_all();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void LoopbackGroup::barrier()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (aborted) {
+        throw Aborted();
+    }
+    uint64_t arrived_generation = generation;
+    if (++num_arrived == size) {
+        num_arrived = 0;
+        ++generation;
+        cv.notify_all();
+        return;
+    }
+    // `wait_for` instead of `wait`, whose newer libstdc++ symbol is missing from the runtime some gtest packages ship
+    while (not cv.wait_for(lock, std::chrono::milliseconds(100),
+                           [&]() { return generation != arrived_generation or aborted; })) {
+    }
+    if (generation == arrived_generation) {
+        throw Aborted();
+    }
+}
+
+DispatchLayout dispatch_layout(const std::vector<int64_t> &topk_idx, int num_tokens, int num_topk, int num_ranks,
+                               int num_experts, int per_round_tokens, int round)
+{
+    EP_HOST_ASSERT(static_cast<int64_t>(topk_idx.size()) == static_cast<int64_t>(num_tokens) * num_topk);
+    EP_HOST_ASSERT(num_experts % num_ranks == 0 and per_round_tokens > 0);
+    EP_HOST_ASSERT(real_round(num_tokens, per_round_tokens) <= round);
+    int experts_per_rank = num_experts / num_ranks;
+
+    DispatchLayout layout;
+    layout.num_tokens_per_rank.assign(num_ranks, 0);
+    layout.num_tokens_per_expert.assign(static_cast<size_t>(round) * num_experts, 0);
+    layout.is_token_in_rank.assign(static_cast<size_t>(num_tokens) * num_ranks, 0);
+    layout.send_token_idx_small.assign(static_cast<size_t>(num_tokens) * num_topk, 0);
+
+    for (int t = 0; t < num_tokens; ++t) {
+        int r = t / per_round_tokens;
+        int32_t *per_expert = &layout.num_tokens_per_expert[static_cast<size_t>(r) * num_experts];
+        for (int k = 0; k < num_topk; ++k) {
+            int64_t expert = topk_idx[static_cast<size_t>(t) * num_topk + k];
+            if (not is_valid_expert(expert, num_experts)) {
+                continue;
+            }
+            // The slot among the tokens of this round sent to the expert, in (token, top-k) order
+            layout.send_token_idx_small[static_cast<size_t>(t) * num_topk + k] = per_expert[expert]++;
+            int dst_rank = static_cast<int>(expert / experts_per_rank);
+            int32_t &in_rank = layout.is_token_in_rank[static_cast<size_t>(t) * num_ranks + dst_rank];
+            if (not in_rank) {
+                in_rank = 1;
+                ++layout.num_tokens_per_rank[dst_rank];
+            }
+        }
+    }
+    return layout;
+}
+
+NotifyLayout notify_dispatch(LoopbackGroup &group, int rank, const std::vector<int32_t> &num_tokens_per_expert,
+                             int num_tokens, int num_experts, int per_round_tokens, int round)
+{
+    int num_ranks = group.num_ranks();
+    EP_HOST_ASSERT(num_experts % num_ranks == 0);
+    EP_HOST_ASSERT(static_cast<int64_t>(num_tokens_per_expert.size()) == static_cast<int64_t>(round) * num_experts);
+    int num_local_experts = num_experts / num_ranks;
+    int num_pairs = num_local_experts * num_ranks;
+
+    NotifyLayout notify;
+    notify.send_data_offset.assign(static_cast<size_t>(round) * num_experts, 0);
+    std::vector<int32_t> send_data(static_cast<size_t>(round) * num_experts * SEND_PER_GROUP, 0);
+    int rounds = real_round(num_tokens, per_round_tokens);
+    for (int r = 0; r < rounds; ++r) {
+        int round_tokens = r == rounds - 1 ? num_tokens - r * per_round_tokens : per_round_tokens;
+        int32_t prefix_sum = 0;
+        for (int e = 0; e < num_experts; ++e) {
+            size_t index = static_cast<size_t>(r) * num_experts + e;
+            send_data[index * SEND_PER_GROUP] = num_tokens_per_expert[index];
+            send_data[index * SEND_PER_GROUP + 1] = prefix_sum;
+            send_data[index * SEND_PER_GROUP + 2] = round_tokens;
+            notify.send_data_offset[index] = prefix_sum;
+            prefix_sum += num_tokens_per_expert[index];
+        }
+    }
+
+    auto gathered = group.all_gather(rank, send_data);
+    auto field = [&](int src, int r, int le, int offset) {
+        size_t expert = static_cast<size_t>(rank) * num_local_experts + le;
+        return gathered[src][(static_cast<size_t>(r) * num_experts + expert) * SEND_PER_GROUP + offset];
+    };
+
+    notify.recv_count.assign(static_cast<size_t>(round) * num_pairs, 0);
+    notify.recv_offset.assign(static_cast<size_t>(round) * num_pairs, 0);
+    notify.recv_tokens_per_expert.assign(static_cast<size_t>(round) * num_local_experts, 0);
+    notify.expert_global_offset.assign(num_local_experts, 0);
+    notify.srcrank_in_expert_offset.assign(num_pairs, 0);
+    notify.r_in_srcrank_offset.assign(static_cast<size_t>(num_pairs) * round, 0);
+
+    std::vector<int32_t> pair_total(num_pairs, 0);
+    for (int r = 0; r < round; ++r) {
+        int32_t recv_count = 0;
+        for (int le = 0; le < num_local_experts; ++le) {
+            for (int src = 0; src < num_ranks; ++src) {
+                int pair = le * num_ranks + src;
+                int32_t count = field(src, r, le, 0);
+                size_t index = static_cast<size_t>(r) * num_pairs + pair;
+                recv_count += count;
+                notify.recv_count[index] = recv_count;
+                notify.recv_offset[index] = field(src, r, le, 1);
+                notify.recv_tokens_per_expert[static_cast<size_t>(r) * num_local_experts + le] += count;
+                notify.r_in_srcrank_offset[static_cast<size_t>(pair) * round + r] = pair_total[pair];
+                pair_total[pair] += count;
+            }
+        }
+        notify.total_recv_tokens += recv_count;
+    }
+
+    int32_t expert_offset = 0;
+    for (int le = 0; le < num_local_experts; ++le) {
+        notify.expert_global_offset[le] = expert_offset;
+        int32_t src_offset = 0;
+        for (int src = 0; src < num_ranks; ++src) {
+            notify.srcrank_in_expert_offset[le * num_ranks + src] = src_offset;
+            src_offset += pair_total[le * num_ranks + src];
+        }
+        expert_offset += src_offset;
+    }
+
+    // The largest batch of any source rank, every expert of a round carries the token count of that round
+    for (int src = 0; src < num_ranks; ++src) {
+        int32_t batch = 0;
+        for (int r = 0; r < round; ++r) {
+            batch += field(src, r, 0, 2);
+        }
+        notify.max_bs = std::max(notify.max_bs, batch);
+    }
+    return notify;
+}
+
+DispatchResult normal_dispatch(LoopbackGroup &group, int rank, const std::vector<float> &x, int hidden,
+                               const std::vector<int64_t> &topk_idx, int num_topk, int num_experts,
+                               const DispatchLayout &layout, const NotifyLayout &notify, int per_round_tokens,
+                               int round)
+{
+    int num_ranks = group.num_ranks();
+    int num_tokens = static_cast<int>(layout.is_token_in_rank.size() / num_ranks);
+    EP_HOST_ASSERT(static_cast<int64_t>(x.size()) == static_cast<int64_t>(num_tokens) * hidden);
+    int num_local_experts = num_experts / num_ranks;
+    int num_pairs = num_local_experts * num_ranks;
+
+    // Every round fills its own window, the tokens of an expert start at its `send_data_offset`
+    std::vector<std::vector<WindowToken>> window(round);
+    for (int r = 0; r < round; ++r) {
+        const int32_t *per_expert = &layout.num_tokens_per_expert[static_cast<size_t>(r) * num_experts];
+        int32_t num_slots = 0;
+        for (int e = 0; e < num_experts; ++e) {
+            num_slots += per_expert[e];
+        }
+        window[r].resize(num_slots);
+    }
+    for (int t = 0; t < num_tokens; ++t) {
+        int r = t / per_round_tokens;
+        for (int k = 0; k < num_topk; ++k) {
+            size_t index = static_cast<size_t>(t) * num_topk + k;
+            int64_t expert = topk_idx[index];
+            if (not is_valid_expert(expert, num_experts)) {
+                continue;
+            }
+            int32_t slot = notify.send_data_offset[static_cast<size_t>(r) * num_experts + expert] +
+                           layout.send_token_idx_small[index];
+            WindowToken &token = window[r].at(slot);
+            token.triple = {rank, t, k};
+            token.x = row_of(x, t, hidden);
+        }
+    }
+    auto gathered = group.all_gather(rank, window);
+
+    DispatchResult result;
+    result.num_recv_tokens = notify.total_recv_tokens;
+    result.recv_x.assign(static_cast<size_t>(result.num_recv_tokens) * hidden, 0.0f);
+    result.expand_idx.assign(static_cast<size_t>(result.num_recv_tokens) * EXPAND_IDX_INFO, -1);
+    for (int r = 0; r < real_round(notify.max_bs, per_round_tokens); ++r) {
+        for (int pair = 0; pair < num_pairs; ++pair) {
+            int le = pair / num_ranks;
+            int src = pair % num_ranks;
+            size_t index = static_cast<size_t>(r) * num_pairs + pair;
+            int32_t count = notify.recv_count[index] - (pair == 0 ? 0 : notify.recv_count[index - 1]);
+            // Expert start, then the source rank within the expert, then the round within the source rank
+            int32_t write_offset = notify.expert_global_offset[le] + notify.srcrank_in_expert_offset[pair] +
+                                   notify.r_in_srcrank_offset[static_cast<size_t>(pair) * round + r];
+            for (int32_t j = 0; j < count; ++j) {
+                const WindowToken &token = gathered[src][r].at(notify.recv_offset[index] + j);
+                size_t row = static_cast<size_t>(write_offset + j);
+                EP_HOST_ASSERT(row < static_cast<size_t>(result.num_recv_tokens));
+                std::copy(token.triple.begin(), token.triple.end(), result.expand_idx.begin() + row * EXPAND_IDX_INFO);
+                std::copy(token.x.begin(), token.x.end(), result.recv_x.begin() + row * hidden);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<float> normal_combine(LoopbackGroup &group, int rank, const std::vector<float> &recv_x, int hidden,
+                                  const DispatchResult &dispatched, const std::vector<int64_t> &topk_idx,
+                                  const std::vector<float> &topk_weights, int num_tokens, int num_topk,
+                                  int num_experts)
+{
+    int num_ranks = group.num_ranks();
+    std::vector<std::vector<CombineToken>> per_dst(num_ranks);
+    for (int i = 0; i < dispatched.num_recv_tokens; ++i) {
+        const int32_t *triple = &dispatched.expand_idx[static_cast<size_t>(i) * EXPAND_IDX_INFO];
+        EP_HOST_ASSERT(triple[0] >= 0 and triple[0] < num_ranks);
+        per_dst[triple[0]].push_back({triple[1] * num_topk + triple[2], row_of(recv_x, i, hidden)});
+    }
+    auto gathered = group.all_gather(rank, per_dst);
+    auto slots = gather_slots(gathered, rank, num_tokens * num_topk);
+
+    std::vector<float> combined(static_cast<size_t>(num_tokens) * hidden);
+    for (int t = 0; t < num_tokens; ++t) {
+        std::vector<float> sum(hidden, 0.0f);
+        for (int k = 0; k < num_topk; ++k) {
+            size_t index = static_cast<size_t>(t) * num_topk + k;
+            if (not is_valid_expert(topk_idx[index], num_experts)) {
+                continue;
+            }
+            EP_HOST_ASSERT(slots[index] != nullptr);
+            accumulate(sum, *slots[index], topk_weights[index]);
+        }
+        for (int h = 0; h < hidden; ++h) {
+            combined[static_cast<size_t>(t) * hidden + h] = round_to_bf16(sum[h]);
+        }
+    }
+    return combined;
+}
+
+LowLatencyDispatchResult low_latency_dispatch(LoopbackGroup &group, int rank, const std::vector<float> &x, int hidden,
+                                              const std::vector<int64_t> &topk_idx, int num_tokens, int num_topk,
+                                              int num_experts, int num_shared_expert_ranks,
+                                              int expert_token_nums_type)
+{
+    int num_ranks = group.num_ranks();
+    int num_moe_ranks = num_ranks - num_shared_expert_ranks;
+    EP_HOST_ASSERT(num_shared_expert_ranks >= 0 and num_moe_ranks > 0 and num_experts % num_moe_ranks == 0);
+    EP_HOST_ASSERT(expert_token_nums_type == 0 or expert_token_nums_type == 1);
+    EP_HOST_ASSERT(static_cast<int64_t>(x.size()) == static_cast<int64_t>(num_tokens) * hidden);
+    int num_local_experts = num_experts / num_moe_ranks;
+
+    // Tokens land in the window of their expert in (token, top-k) order, so the slot is the number sent before
+    std::vector<std::vector<WindowToken>> per_dst(num_ranks);
+    for (int t = 0; t < num_tokens; ++t) {
+        for (int k = 0; k < num_topk; ++k) {
+            int64_t expert = topk_idx[static_cast<size_t>(t) * num_topk + k];
+            if (not is_valid_expert(expert, num_experts)) {
+                continue;
+            }
+            int dst_rank = static_cast<int>(expert / num_local_experts) + num_shared_expert_ranks;
+            int pair = static_cast<int>(expert % num_local_experts) * num_ranks + rank;
+            per_dst[dst_rank].push_back({pair, {rank, t, k}, row_of(x, t, hidden)});
+        }
+    }
+    // Every token also goes to the shared expert rank of this rank's group, behind the top-k slots
+    if (num_shared_expert_ranks > 0) {
+        for (int t = 0; t < num_tokens; ++t) {
+            per_dst[rank % num_shared_expert_ranks].push_back({rank, {rank, t, num_topk}, row_of(x, t, hidden)});
+        }
+    }
+    auto gathered = group.all_gather(rank, per_dst);
+
+    bool is_shared_rank = rank < num_shared_expert_ranks;
+    int num_pairs = is_shared_rank ? num_ranks : num_local_experts * num_ranks;
+    std::vector<std::vector<const WindowToken *>> pairs(num_pairs);
+    for (int src = 0; src < num_ranks; ++src) {
+        for (const WindowToken &token : gathered[src][rank]) {
+            pairs.at(token.pair).push_back(&token);
+        }
+    }
+
+    LowLatencyDispatchResult result;
+    result.ep_recv_count.assign(num_pairs, 0);
+    result.expert_token_nums.assign(is_shared_rank ? 1 : num_local_experts, 0);
+    for (int pair = 0; pair < num_pairs; ++pair) {
+        for (const WindowToken *token : pairs[pair]) {
+            std::copy(token->triple.begin(), token->triple.end(), std::back_inserter(result.expand_idx));
+            std::copy(token->x.begin(), token->x.end(), std::back_inserter(result.recv_x));
+        }
+        result.num_recv_tokens += static_cast<int>(pairs[pair].size());
+        result.ep_recv_count[pair] = result.num_recv_tokens;
+        result.expert_token_nums[is_shared_rank ? 0 : pair / num_ranks] += static_cast<int64_t>(pairs[pair].size());
+    }
+    if (expert_token_nums_type == 0) {
+        for (size_t le = 1; le < result.expert_token_nums.size(); ++le) {
+            result.expert_token_nums[le] += result.expert_token_nums[le - 1];
+        }
+    }
+    return result;
+}
+
+std::vector<float> low_latency_combine(LoopbackGroup &group, int rank, const std::vector<float> &recv_x, int hidden,
+                                       const LowLatencyDispatchResult &dispatched,
+                                       const std::vector<int64_t> &topk_idx, const std::vector<float> &topk_weights,
+                                       int num_tokens, int num_topk, int num_experts, int num_shared_expert_ranks,
+                                       const std::vector<float> *shared_expert_x)
+{
+    int num_ranks = group.num_ranks();
+    int num_slots = num_topk + (num_shared_expert_ranks > 0 ? 1 : 0);
+    std::vector<std::vector<CombineToken>> per_dst(num_ranks);
+    for (int i = 0; i < dispatched.num_recv_tokens; ++i) {
+        const int32_t *triple = &dispatched.expand_idx[static_cast<size_t>(i) * EXPAND_IDX_INFO];
+        EP_HOST_ASSERT(triple[0] >= 0 and triple[0] < num_ranks);
+        per_dst[triple[0]].push_back({triple[1] * num_slots + triple[2], row_of(recv_x, i, hidden)});
+    }
+    auto gathered = group.all_gather(rank, per_dst);
+    auto slots = gather_slots(gathered, rank, num_tokens * num_slots);
+    EP_HOST_ASSERT(shared_expert_x == nullptr or
+                   static_cast<int64_t>(shared_expert_x->size()) == static_cast<int64_t>(num_tokens) * hidden);
+
+    std::vector<float> combined(static_cast<size_t>(num_tokens) * hidden);
+    for (int t = 0; t < num_tokens; ++t) {
+        std::vector<float> sum(hidden, 0.0f);
+        for (int k = 0; k < num_topk; ++k) {
+            size_t index = static_cast<size_t>(t) * num_topk + k;
+            if (not is_valid_expert(topk_idx[index], num_experts)) {
+                continue;
+            }
+            const auto *slot = slots[static_cast<size_t>(t) * num_slots + k];
+            EP_HOST_ASSERT(slot != nullptr);
+            accumulate(sum, *slot, topk_weights[index]);
+        }
+        // The shared expert slot and the fused shared expert output are added unweighted
+        for (int k = num_topk; k < num_slots; ++k) {
+            const auto *slot = slots[static_cast<size_t>(t) * num_slots + k];
+            EP_HOST_ASSERT(slot != nullptr);
+            for (int h = 0; h < hidden; ++h) {
+                sum[h] += (*slot)[h];
+            }
+        }
+        if (shared_expert_x != nullptr) {
+            for (int h = 0; h < hidden; ++h) {
+                sum[h] += (*shared_expert_x)[static_cast<size_t>(t) * hidden + h];
+            }
+        }
+        for (int h = 0; h < hidden; ++h) {
+            combined[static_cast<size_t>(t) * hidden + h] = round_to_bf16(sum[h]);
+        }
+    }
+    return combined;
+}
+
+}  // namespace sim
+}  // namespace deep_ep
@@ -0,0 +1,141 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "exception.hpp"
+
+namespace deep_ep {
+namespace sim {
+
+/*
+A CPU golden model of the dispatch and combine protocols, `N` simulated ranks run as threads of one process and
+exchange their windows through a `LoopbackGroup`. Every function mirrors one kernel and produces its metadata outputs
+bit for bit, with the same layout as the device tensors:
+1. `dispatch_layout` and `notify_dispatch` follow ops/op_kernel/dispatch_layout.h and notify_dispatch.h, including the
+   per round counts and offsets of multi-round dispatch;
+2. `normal_dispatch` and `normal_combine` follow cam_moe_dispatch_normal.h and cam_moe_combine_normal.h;
+3. `low_latency_dispatch` and `low_latency_combine` follow moe_distribute_dispatch_v2.h and moe_distribute_combine_v2.h
+   with at most one shared expert.
+
+Token data is float holding bf16 values, the combines accumulate in float in the kernel order and round the result to
+bf16, so the hidden states match the device exactly as well. `topk_idx` is taken as the kernels see it, i.e. after the
+host pads small batches and maps logical experts to replicas; entries outside `[0, num_experts)` are skipped.
+*/
+
+// Rounds to the nearest bf16 value, ties to even, as the `CAST_RINT` of the combine kernels
+float round_to_bf16(float value);
+
+class LoopbackGroup
+{
+public:
+    explicit LoopbackGroup(int num_ranks);
+
+    int num_ranks() const
+    {
+        return size;
+    }
+
+    // Runs `body(rank)` on one thread per rank, an exception on any rank aborts the others and is rethrown here
+    void run(const std::function<void(int)> &body);
+
+    // Every rank publishes `value` and gets the values of all ranks in rank order, the simulated window exchange
+    template <typename T>
+    std::vector<T> all_gather(int rank, const T &value)
+    {
+        EP_HOST_ASSERT(rank >= 0 and rank < size);
+        slots[rank] = std::make_shared<T>(value);
+        barrier();
+        std::vector<T> gathered;
+        gathered.reserve(size);
+        for (const auto &slot : slots) {
+            gathered.push_back(*static_cast<const T *>(slot.get()));
+        }
+        // No rank may publish the next exchange before every rank has read this one
+        barrier();
+        return gathered;
+    }
+
+private:
+    // Thrown on the ranks still waiting in a barrier once another rank has failed
+    struct Aborted {};
+
+    void barrier();
+
+    int size;
+    std::vector<std::shared_ptr<void>> slots;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int num_arrived = 0;
+    uint64_t generation = 0;
+    bool aborted = false;
+};
+
+// Outputs of the dispatch layout kernel, the counts are per round and restart at zero in every round
+struct DispatchLayout {
+    std::vector<int32_t> num_tokens_per_rank;   // [num_ranks], summed over the rounds
+    std::vector<int32_t> num_tokens_per_expert;  // [round, num_experts]
+    std::vector<int32_t> is_token_in_rank;       // [num_tokens, num_ranks]
+    std::vector<int32_t> send_token_idx_small;   // [num_tokens, num_topk], slot of the token among those of its expert
+};
+
+DispatchLayout dispatch_layout(const std::vector<int64_t> &topk_idx, int num_tokens, int num_topk, int num_ranks,
+                               int num_experts, int per_round_tokens, int round);
+
+// Outputs of the notify kernel on one rank, the (local expert, source rank) pairs are indexed `le * num_ranks + src`
+struct NotifyLayout {
+    std::vector<int32_t> send_data_offset;          // [round, num_experts], first slot of every expert in the window
+    std::vector<int32_t> recv_count;                // [round, num_local_experts * num_ranks], prefix sums per round
+    std::vector<int32_t> recv_offset;               // [round, num_local_experts * num_ranks], slot in the source window
+    std::vector<int32_t> recv_tokens_per_expert;    // [round, num_local_experts]
+    std::vector<int32_t> expert_global_offset;      // [num_local_experts], first output row of every local expert
+    std::vector<int32_t> srcrank_in_expert_offset;  // [num_local_experts * num_ranks], within the expert
+    std::vector<int32_t> r_in_srcrank_offset;       // [num_local_experts, num_ranks, round], within the source
+    int32_t total_recv_tokens = 0;
+    int32_t max_bs = 0;
+};
+
+NotifyLayout notify_dispatch(LoopbackGroup &group, int rank, const std::vector<int32_t> &num_tokens_per_expert,
+                             int num_tokens, int num_experts, int per_round_tokens, int round);
+
+// Received tokens of a dispatch, `expand_idx` holds the (source rank, token index, top-k slot) triple of every row
+struct DispatchResult {
+    int num_recv_tokens = 0;
+    std::vector<float> recv_x;         // [num_recv_tokens, hidden]
+    std::vector<int32_t> expand_idx;   // [num_recv_tokens, 3]
+};
+
+DispatchResult normal_dispatch(LoopbackGroup &group, int rank, const std::vector<float> &x, int hidden,
+                               const std::vector<int64_t> &topk_idx, int num_topk, int num_experts,
+                               const DispatchLayout &layout, const NotifyLayout &notify, int per_round_tokens,
+                               int round);
+
+// Weighted sum of the expert outputs `recv_x`, laid out as the rows of `dispatched`, back on their source ranks
+std::vector<float> normal_combine(LoopbackGroup &group, int rank, const std::vector<float> &recv_x, int hidden,
+                                  const DispatchResult &dispatched, const std::vector<int64_t> &topk_idx,
+                                  const std::vector<float> &topk_weights, int num_tokens, int num_topk,
+                                  int num_experts);
+
+// Low-latency dispatch outputs, receive pairs are `le * num_ranks + src` on MoE ranks and `src` on shared ranks
+struct LowLatencyDispatchResult : DispatchResult {
+    std::vector<int32_t> ep_recv_count;      // inclusive prefix sums of the tokens of every receive pair
+    std::vector<int64_t> expert_token_nums;  // [num_local_experts], counts or prefix sums by `expert_token_nums_type`
+};
+
+LowLatencyDispatchResult low_latency_dispatch(LoopbackGroup &group, int rank, const std::vector<float> &x, int hidden,
+                                              const std::vector<int64_t> &topk_idx, int num_tokens, int num_topk,
+                                              int num_experts, int num_shared_expert_ranks = 0,
+                                              int expert_token_nums_type = 1);
+
+// `shared_expert_x` is added to every token unweighted when given, as the fused shared expert output
+std::vector<float> low_latency_combine(LoopbackGroup &group, int rank, const std::vector<float> &recv_x, int hidden,
+                                       const LowLatencyDispatchResult &dispatched,
+                                       const std::vector<int64_t> &topk_idx, const std::vector<float> &topk_weights,
+                                       int num_tokens, int num_topk, int num_experts, int num_shared_expert_ranks = 0,
+                                       const std::vector<float> *shared_expert_x = nullptr);
+
+}  // namespace sim
+}  // namespace deep_ep
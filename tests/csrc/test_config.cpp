@@ -0,0 +1,196 @@
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "config.hpp"
+#include "exception.hpp"
+
+namespace {
+
+using deep_ep::Config;
+using deep_ep::SocType;
+
+constexpr size_t MB = 1024UL * 1024UL;
+// bf16 hidden 7168: 14336B of hidden states, a dispatched token adds 44B of metadata and rounds up to 512B
+constexpr size_t HIDDEN_BYTES = 7168 * 2;
+constexpr size_t COMBINE_TOKEN = 14336;
+constexpr size_t DISPATCH_TOKEN = 14848;
+
+const Config CONFIG(20, 6, 256, 6, 128);
+
+TEST(ConfigTest, LowLatencyHintMatchesKernelWindowCheck)
+{
+    // (maxBs * tokenNeedSizeDispatch * epWorldSize * localMoeExpertNum + maxBs * tokenNeedSizeCombine * k) * 2
+    size_t expected = (128 * DISPATCH_TOKEN * 16 * 16 + 128 * COMBINE_TOKEN * 8) * 2;
+    EXPECT_EQ(deep_ep::get_low_latency_rdma_size_hint(128, 7168, 16, 256, 8), expected);
+
+    // Shared expert ranks leave fewer MoE ranks for the experts and add the shared expert slot
+    expected = (128 * DISPATCH_TOKEN * 16 * 32 + 128 * COMBINE_TOKEN * 9) * 2;
+    EXPECT_EQ(deep_ep::get_low_latency_rdma_size_hint(128, 7168, 16, 256, 8, 8), expected);
+}
+
+TEST(ConfigTest, LowLatencyHintDefaultsToLargestTopk)
+{
+    EXPECT_EQ(deep_ep::get_low_latency_rdma_size_hint(128, 7168, 16, 256),
+              deep_ep::get_low_latency_rdma_size_hint(128, 7168, 16, 256, deep_ep::MAX_NUM_TOPK));
+    EXPECT_LT(deep_ep::get_low_latency_rdma_size_hint(128, 7168, 16, 256, 8),
+              deep_ep::get_low_latency_rdma_size_hint(128, 7168, 16, 256));
+}
+
+TEST(ConfigTest, NvlHintCountsRoundsAndReservedRegions)
+{
+    size_t a3_reserved = (4 + 102) * MB;
+    size_t a2_reserved = (3 + 204) * MB;
+    EXPECT_EQ(CONFIG.get_nvl_buffer_size_hint(HIDDEN_BYTES, 16, 8, 8192, 1, SocType::A3),
+              (8192 * 8 * (COMBINE_TOKEN + DISPATCH_TOKEN) + a3_reserved) * 2);
+    EXPECT_EQ(CONFIG.get_nvl_buffer_size_hint(HIDDEN_BYTES, 16, 8, 8192, 1, SocType::A2),
+              (8192 * 8 * (COMBINE_TOKEN + DISPATCH_TOKEN) + a2_reserved) * 2);
+
+    // Multi-round combine double-buffers its slots, but only for the tokens of one round
+    EXPECT_EQ(CONFIG.get_nvl_buffer_size_hint(HIDDEN_BYTES, 16, 8, 1024, 4, SocType::A3),
+              (1024 * 8 * (2 * COMBINE_TOKEN + DISPATCH_TOKEN) + a3_reserved) * 2);
+}
+
+TEST(ConfigTest, RdmaHintReservesTheLargestBatch)
+{
+    EXPECT_EQ(CONFIG.get_rdma_buffer_size_hint(HIDDEN_BYTES, 16, 256), 16UL * 4096 * HIDDEN_BYTES * 16 * 2);
+    EXPECT_THROW(CONFIG.get_rdma_buffer_size_hint(HIDDEN_BYTES, 16, 100), deep_ep::EPException);
+}
+
+TEST(ConfigTest, NotifySendDataFollowsTheBatchBoundOnA2)
+{
+    // 256 expert counts of 64 cores and one 32-byte copy past the last core, whatever the batch
+    EXPECT_EQ(deep_ep::get_notify_send_data_size(256, 16, SocType::A3, 256), 64 * 256 + 8);
+    EXPECT_EQ(deep_ep::get_notify_send_data_size(256, 16, SocType::A2, 4096),
+              256 * 4097 + 2 + 4096 * (1 + 2 * 2 + 256));
+    EXPECT_EQ(deep_ep::get_notify_send_data_size(256, 16, SocType::A2, 256), 256 * 257 + 2 + 256 * (1 + 2 * 2 + 256));
+    EXPECT_THROW(deep_ep::get_notify_send_data_size(256, 16, SocType::A2, 4104), deep_ep::EPException);
+    EXPECT_THROW(deep_ep::get_notify_send_data_size(0, 16, SocType::A3, 256), deep_ep::EPException);
+}
+
+TEST(ConfigTest, PresetsKeepTunedRankCounts)
+{
+    Config dispatch = deep_ep::get_dispatch_config_preset(16, 24, SocType::A3);
+    EXPECT_EQ(dispatch.num_sms, 24);
+    EXPECT_EQ(dispatch.num_max_nvl_chunked_send_tokens, 36);
+    EXPECT_EQ(dispatch.num_max_nvl_chunked_recv_tokens, 288);
+    EXPECT_EQ(dispatch.num_max_rdma_chunked_send_tokens, 20);
+    EXPECT_EQ(dispatch.num_max_rdma_chunked_recv_tokens, 128);
+
+    Config combine = deep_ep::get_combine_config_preset(128, 20, SocType::A2);
+    EXPECT_EQ(combine.num_max_nvl_chunked_send_tokens, 1);
+    EXPECT_EQ(combine.num_max_nvl_chunked_recv_tokens, 560);
+    EXPECT_EQ(combine.num_max_rdma_chunked_send_tokens, 12);
+}
+
+TEST(ConfigTest, PresetsCoverUntunedRankCounts)
+{
+    // Between tuned counts the next larger one is used, beyond the last one the last one
+    EXPECT_EQ(deep_ep::get_dispatch_config_preset(12, 20, SocType::A3).num_max_nvl_chunked_send_tokens, 36);
+    EXPECT_EQ(deep_ep::get_dispatch_config_preset(384, 20, SocType::A3).num_max_nvl_chunked_send_tokens, 28);
+
+    EXPECT_THROW(deep_ep::get_dispatch_config_preset(12, 20, SocType::A2), deep_ep::EPException);
+    EXPECT_THROW(deep_ep::get_dispatch_config_preset(16, 21, SocType::A3), deep_ep::EPException);
+    EXPECT_THROW(deep_ep::get_combine_config_preset(1, 20, SocType::A3), deep_ep::EPException);
+}
+
+TEST(ConfigTest, RoundsStaySingleWhileTheBatchFits)
+{
+    // Without a hidden size only the kernel limits apply
+    EXPECT_EQ(deep_ep::get_normal_round_config(4096, 0, 8, 0).round, 1);
+    EXPECT_EQ(deep_ep::get_normal_round_config(4096, 0, 8, 0).per_round_tokens, 8192);
+    EXPECT_EQ(deep_ep::get_normal_round_config(8193, 0, 8, 0).round, 2);
+    EXPECT_EQ(deep_ep::get_normal_round_config(131072, 0, 8, 0).round, 16);
+    EXPECT_THROW(deep_ep::get_normal_round_config(131073, 0, 8, 0), deep_ep::EPException);
+}
+
+TEST(ConfigTest, RoundsFollowTheWindow)
+{
+    // A window that holds multi-round slots for 1024 tokens holds a single round of up to 1527 tokens
+    size_t window = CONFIG.get_nvl_buffer_size_hint(HIDDEN_BYTES, 16, 8, 1024, 2, SocType::A3);
+    deep_ep::RoundConfig rounds = deep_ep::get_normal_round_config(1527, 7168, 8, window);
+    EXPECT_EQ(rounds.round, 1);
+    EXPECT_EQ(rounds.per_round_tokens, 8192);
+
+    rounds = deep_ep::get_normal_round_config(1528, 7168, 8, window);
+    EXPECT_EQ(rounds.round, 2);
+    EXPECT_EQ(rounds.per_round_tokens, 1024);
+    rounds = deep_ep::get_normal_round_config(5000, 7168, 8, window);
+    EXPECT_EQ(rounds.round, 5);
+    EXPECT_EQ(rounds.per_round_tokens, 1024);
+
+    // The A2 window reserves more for the notify, so fewer tokens fit in a round
+    EXPECT_LT(deep_ep::get_normal_round_config(5000, 7168, 8, window, SocType::A2).per_round_tokens, 1024);
+
+    // Not even the smallest round fits, or too many rounds would be needed
+    EXPECT_THROW(deep_ep::get_normal_round_config(4096, 7168, 8, 200 * MB), deep_ep::EPException);
+    size_t small_window = CONFIG.get_nvl_buffer_size_hint(HIDDEN_BYTES, 16, 8, 256, 2, SocType::A3);
+    EXPECT_EQ(deep_ep::get_normal_round_config(65536, 7168, 8, small_window).round, 256);
+    EXPECT_THROW(deep_ep::get_normal_round_config(65537, 7168, 8, small_window), deep_ep::EPException);
+}
+
+TEST(ConfigTest, FusedRoundsSplitTheLargestBatchEvenly)
+{
+    deep_ep::RoundConfig rounds = deep_ep::get_fused_deep_moe_round_config(200);
+    EXPECT_EQ(rounds.round, 1);
+    EXPECT_EQ(rounds.per_round_tokens, 200);
+    rounds = deep_ep::get_fused_deep_moe_round_config(deep_ep::FUSED_DEEP_MOE_MAX_TOKENS);
+    EXPECT_EQ(rounds.round, 1);
+    rounds = deep_ep::get_fused_deep_moe_round_config(257);
+    EXPECT_EQ(rounds.round, 2);
+    EXPECT_EQ(rounds.per_round_tokens, 129);
+    rounds = deep_ep::get_fused_deep_moe_round_config(1024);
+    EXPECT_EQ(rounds.round, 4);
+    EXPECT_EQ(rounds.per_round_tokens, 256);
+    EXPECT_THROW(deep_ep::get_fused_deep_moe_round_config(0), deep_ep::EPException);
+}
+
+TEST(ConfigTest, WindowBytesFollowTheTilingEnv)
+{
+    unsetenv("DEEPEP_HCCL_BUFFSIZE");
+    unsetenv("HCCL_BUFFSIZE");
+    EXPECT_EQ(deep_ep::get_hccl_window_bytes(), 200 * MB);
+    setenv("HCCL_BUFFSIZE", "1024", 1);
+    EXPECT_EQ(deep_ep::get_hccl_window_bytes(), 1024 * MB);
+    setenv("DEEPEP_HCCL_BUFFSIZE", "2048", 1);
+    EXPECT_EQ(deep_ep::get_hccl_window_bytes(), 2048 * MB);
+    unsetenv("DEEPEP_HCCL_BUFFSIZE");
+    unsetenv("HCCL_BUFFSIZE");
+}
+
+TEST(ConfigTest, ElasticInfoCompactsTheActiveRanks)
+{
+    const int off = deep_ep::ELASTIC_INFO_OFFSET;
+    std::vector<int32_t> info = deep_ep::get_elastic_info({true, false, true, true}, 32);
+    ASSERT_EQ(info.size(), static_cast<size_t>(off + 2 * 4));
+    EXPECT_EQ(info[0], 1);
+    EXPECT_EQ(info[1], 3);
+    EXPECT_EQ(info[2], 0);
+    EXPECT_EQ(info[3], 24);
+    EXPECT_EQ(std::vector<int32_t>(info.begin() + off, info.begin() + off + 4), (std::vector<int32_t>{0, -1, 1, 2}));
+    EXPECT_EQ(std::vector<int32_t>(info.begin() + off + 4, info.end()), (std::vector<int32_t>{0, 2, 3, -1}));
+
+    // The full group is not scaled down
+    info = deep_ep::get_elastic_info({true, true}, 16);
+    EXPECT_EQ(info[0], 0);
+    EXPECT_EQ(info[3], 16);
+
+    EXPECT_THROW(deep_ep::get_elastic_info({false, false}, 16), deep_ep::EPException);
+    EXPECT_THROW(deep_ep::get_elastic_info({true, true, true}, 16), deep_ep::EPException);
+}
+
+TEST(ConfigTest, CostBucketsDoubleUpToTheOpenBucket)
+{
+    EXPECT_EQ(deep_ep::get_cost_bucket(-5), 0);
+    EXPECT_EQ(deep_ep::get_cost_bucket(0), 0);
+    EXPECT_EQ(deep_ep::get_cost_bucket(1), 1);
+    EXPECT_EQ(deep_ep::get_cost_bucket(2), 2);
+    EXPECT_EQ(deep_ep::get_cost_bucket(3), 2);
+    EXPECT_EQ(deep_ep::get_cost_bucket(1023), 10);
+    EXPECT_EQ(deep_ep::get_cost_bucket(1024), 11);
+    EXPECT_EQ(deep_ep::get_cost_bucket(16383), deep_ep::NUM_COST_BUCKETS - 2);
+    EXPECT_EQ(deep_ep::get_cost_bucket(16384), deep_ep::NUM_COST_BUCKETS - 1);
+    EXPECT_EQ(deep_ep::get_cost_bucket(1L << 40), deep_ep::NUM_COST_BUCKETS - 1);
+}
+
+}  // namespace
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "loopback_simulator.hpp"
+
+namespace {
+
+using namespace deep_ep::sim;
+
+// One rank's input: `num_topk` distinct experts per token, some entries masked with -1
+struct RankInput {
+    int num_tokens;
+    std::vector<int64_t> topk_idx;
+    std::vector<float> topk_weights;
+};
+
+// Hidden states are multiples of 1/8 below 16, so they are exact in bf16 and tell the tokens apart
+float token_value(int rank, int token, int h)
+{
+    return static_cast<float>((rank * 131 + token * 17 + h * 7) % 127) / 8.0f;
+}
+
+std::vector<RankInput> make_inputs(int num_ranks, int max_tokens, int num_topk, int num_experts, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<int64_t> experts(num_experts);
+    std::vector<RankInput> inputs(num_ranks);
+    for (int rank = 0; rank < num_ranks; ++rank) {
+        RankInput &input = inputs[rank];
+        input.num_tokens = std::uniform_int_distribution<int>(1, max_tokens)(gen);
+        for (int t = 0; t < input.num_tokens; ++t) {
+            for (int e = 0; e < num_experts; ++e) {
+                experts[e] = e;
+            }
+            std::shuffle(experts.begin(), experts.end(), gen);
+            for (int k = 0; k < num_topk; ++k) {
+                bool masked = std::uniform_int_distribution<int>(0, 9)(gen) == 0;
+                input.topk_idx.push_back(masked ? -1 : experts[k]);
+                input.topk_weights.push_back(std::uniform_real_distribution<float>(0.0f, 1.0f)(gen));
+            }
+        }
+    }
+    return inputs;
+}
+
+std::vector<float> make_x(int rank, int num_tokens, int hidden)
+{
+    std::vector<float> x(static_cast<size_t>(num_tokens) * hidden);
+    for (int t = 0; t < num_tokens; ++t) {
+        for (int h = 0; h < hidden; ++h) {
+            x[static_cast<size_t>(t) * hidden + h] = token_value(rank, t, h);
+        }
+    }
+    return x;
+}
+
+// What an identity expert gives back after the combine, computed without any routing
+std::vector<float> expected_combine(const RankInput &input, int rank, int hidden, int num_topk, int num_experts,
+                                    int num_shared_slots)
+{
+    std::vector<float> out(static_cast<size_t>(input.num_tokens) * hidden);
+    for (int t = 0; t < input.num_tokens; ++t) {
+        for (int h = 0; h < hidden; ++h) {
+            float sum = 0.0f;
+            for (int k = 0; k < num_topk; ++k) {
+                int64_t expert = input.topk_idx[static_cast<size_t>(t) * num_topk + k];
+                if (expert >= 0 and expert < num_experts) {
+                    float product = token_value(rank, t, h) * input.topk_weights[static_cast<size_t>(t) * num_topk + k];
+                    sum += product;
+                }
+            }
+            for (int s = 0; s < num_shared_slots; ++s) {
+                sum += token_value(rank, t, h);
+            }
+            out[static_cast<size_t>(t) * hidden + h] = round_to_bf16(sum);
+        }
+    }
+    return out;
+}
+
+TEST(LoopbackSimulatorTest, RoundToBf16TiesToEven)
+{
+    EXPECT_EQ(round_to_bf16(1.0f + 1.0f / 256), 1.0f);
+    EXPECT_EQ(round_to_bf16(1.0f + 3.0f / 256), 1.0f + 1.0f / 64);
+    EXPECT_EQ(round_to_bf16(1.0f + 3.0f / 512), 1.0f + 1.0f / 128);
+    EXPECT_EQ(round_to_bf16(-2.5f), -2.5f);
+}
+
+TEST(LoopbackSimulatorTest, FailingRankAbortsTheGroup)
+{
+    LoopbackGroup group(4);
+    EXPECT_THROW(group.run([&](int rank) {
+        if (rank == 2) {
+            throw std::runtime_error("rank 2");
+        }
+        group.all_gather(rank, rank);
+    }),
+                 std::runtime_error);
+
+    // The group is usable again after an abort
+    std::vector<std::vector<int>> gathered(4);
+    group.run([&](int rank) { gathered[rank] = group.all_gather(rank, rank * 10); });
+    EXPECT_EQ(gathered[3], (std::vector<int>{0, 10, 20, 30}));
+}
+
+TEST(LoopbackSimulatorTest, NormalModeMatchesHandComputedLayout)
+{
+    // 2 ranks with 2 experts each, rank 1 sends fewer tokens than rank 0
+    std::vector<std::vector<int64_t>> topk_idx = {{0, 2, 1, 0, 3, -1}, {2, 3, 0, 1}};
+    std::vector<DispatchLayout> layouts(2);
+    std::vector<NotifyLayout> notifies(2);
+    std::vector<DispatchResult> results(2);
+    LoopbackGroup group(2);
+    group.run([&](int rank) {
+        int num_tokens = static_cast<int>(topk_idx[rank].size() / 2);
+        layouts[rank] = dispatch_layout(topk_idx[rank], num_tokens, 2, 2, 4, 8192, 1);
+        notifies[rank] = notify_dispatch(group, rank, layouts[rank].num_tokens_per_expert, num_tokens, 4, 8192, 1);
+        results[rank] = normal_dispatch(group, rank, make_x(rank, num_tokens, 1), 1, topk_idx[rank], 2, 4,
+                                        layouts[rank], notifies[rank], 8192, 1);
+    });
+
+    EXPECT_EQ(layouts[0].num_tokens_per_expert, (std::vector<int32_t>{2, 1, 1, 1}));
+    EXPECT_EQ(layouts[0].send_token_idx_small, (std::vector<int32_t>{0, 0, 0, 1, 0, 0}));
+    EXPECT_EQ(layouts[0].is_token_in_rank, (std::vector<int32_t>{1, 1, 1, 0, 0, 1}));
+    EXPECT_EQ(layouts[0].num_tokens_per_rank, (std::vector<int32_t>{2, 2}));
+
+    const NotifyLayout &notify = notifies[0];
+    EXPECT_EQ(notify.send_data_offset, (std::vector<int32_t>{0, 2, 3, 4}));
+    EXPECT_EQ(notify.recv_count, (std::vector<int32_t>{2, 3, 4, 5}));
+    EXPECT_EQ(notify.recv_offset, (std::vector<int32_t>{0, 0, 2, 1}));
+    EXPECT_EQ(notify.recv_tokens_per_expert, (std::vector<int32_t>{3, 2}));
+    EXPECT_EQ(notify.expert_global_offset, (std::vector<int32_t>{0, 3}));
+    EXPECT_EQ(notify.srcrank_in_expert_offset, (std::vector<int32_t>{0, 2, 0, 1}));
+    EXPECT_EQ(notify.r_in_srcrank_offset, (std::vector<int32_t>{0, 0, 0, 0}));
+    EXPECT_EQ(notify.total_recv_tokens, 5);
+    EXPECT_EQ(notify.max_bs, 3);
+
+    EXPECT_EQ(results[0].expand_idx, (std::vector<int32_t>{0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 1, 1, 1}));
+    EXPECT_EQ(results[1].expand_idx, (std::vector<int32_t>{0, 0, 1, 1, 0, 0, 0, 2, 0, 1, 0, 1}));
+}
+
+TEST(LoopbackSimulatorTest, MultiRoundOffsetsFollowTheRounds)
+{
+    // 5 tokens in rounds of 2, every token on expert 0 of rank 0
+    std::vector<int64_t> topk_idx(5, 0);
+    DispatchLayout layout = dispatch_layout(topk_idx, 5, 1, 2, 2, 2, 4);
+    EXPECT_EQ(layout.num_tokens_per_expert, (std::vector<int32_t>{2, 0, 2, 0, 1, 0, 0, 0}));
+    EXPECT_EQ(layout.send_token_idx_small, (std::vector<int32_t>{0, 1, 0, 1, 0}));
+    EXPECT_THROW(dispatch_layout(topk_idx, 5, 1, 2, 2, 2, 2), deep_ep::EPException);
+
+    NotifyLayout notify;
+    LoopbackGroup group(2);
+    group.run([&](int rank) {
+        std::vector<int32_t> counts(8, 0);
+        auto local = rank == 0 ? layout.num_tokens_per_expert : counts;
+        auto result = notify_dispatch(group, rank, local, rank == 0 ? 5 : 1, 2, 2, 4);
+        if (rank == 0) {
+            notify = result;
+        }
+    });
+    EXPECT_EQ(notify.recv_count, (std::vector<int32_t>{2, 2, 2, 2, 1, 1, 0, 0}));
+    EXPECT_EQ(notify.r_in_srcrank_offset, (std::vector<int32_t>{0, 2, 4, 5, 0, 0, 0, 0}));
+    EXPECT_EQ(notify.recv_tokens_per_expert, (std::vector<int32_t>{2, 2, 1, 0}));
+    EXPECT_EQ(notify.total_recv_tokens, 5);
+    EXPECT_EQ(notify.max_bs, 5);
+}
+
+class NormalModeSweep : public ::testing::TestWithParam<std::tuple<int, int, int, int>>
+{};
+
+TEST_P(NormalModeSweep, EveryTokenRoundTrips)
+{
+    auto [num_ranks, num_topk, num_local_experts, per_round_tokens] = GetParam();
+    const int num_experts = num_ranks * num_local_experts;
+    const int hidden = 4;
+    const int round = 4;
+    if (num_topk > num_experts) {
+        GTEST_SKIP();
+    }
+    auto inputs = make_inputs(num_ranks, round * per_round_tokens, num_topk, num_experts, 7 * num_ranks + num_topk);
+
+    std::vector<NotifyLayout> notifies(num_ranks);
+    std::vector<DispatchResult> results(num_ranks);
+    std::vector<std::vector<float>> combined(num_ranks);
+    LoopbackGroup group(num_ranks);
+    group.run([&](int rank) {
+        const RankInput &input = inputs[rank];
+        auto layout = dispatch_layout(input.topk_idx, input.num_tokens, num_topk, num_ranks, num_experts,
+                                      per_round_tokens, round);
+        notifies[rank] = notify_dispatch(group, rank, layout.num_tokens_per_expert, input.num_tokens, num_experts,
+                                         per_round_tokens, round);
+        results[rank] = normal_dispatch(group, rank, make_x(rank, input.num_tokens, hidden), hidden, input.topk_idx,
+                                        num_topk, num_experts, layout, notifies[rank], per_round_tokens, round);
+        // Identity experts send back what they received
+        combined[rank] = normal_combine(group, rank, results[rank].recv_x, hidden, results[rank], input.topk_idx,
+                                        input.topk_weights, input.num_tokens, num_topk, num_experts);
+    });
+
+    int max_bs = 0;
+    for (const RankInput &input : inputs) {
+        max_bs = std::max(max_bs, input.num_tokens);
+    }
+    for (int rank = 0; rank < num_ranks; ++rank) {
+        EXPECT_EQ(notifies[rank].max_bs, max_bs);
+
+        // Rows are grouped by local expert, then by source rank and token, each with the hidden states it names
+        std::vector<std::tuple<int, int, int, int>> expected;
+        for (int src = 0; src < num_ranks; ++src) {
+            for (int t = 0; t < inputs[src].num_tokens; ++t) {
+                for (int k = 0; k < num_topk; ++k) {
+                    int64_t expert = inputs[src].topk_idx[static_cast<size_t>(t) * num_topk + k];
+                    if (expert >= 0 and expert / num_local_experts == rank) {
+                        expected.emplace_back(static_cast<int>(expert % num_local_experts), src, t, k);
+                    }
+                }
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        const DispatchResult &result = results[rank];
+        ASSERT_EQ(result.num_recv_tokens, static_cast<int>(expected.size()));
+        for (int i = 0; i < result.num_recv_tokens; ++i) {
+            auto [le, src, t, k] = expected[i];
+            EXPECT_EQ(result.expand_idx[3 * i], src);
+            EXPECT_EQ(result.expand_idx[3 * i + 1], t);
+            EXPECT_EQ(result.expand_idx[3 * i + 2], k);
+            EXPECT_EQ(result.recv_x[static_cast<size_t>(i) * hidden + 1], token_value(src, t, 1));
+        }
+        for (int le = 0; le < num_local_experts; ++le) {
+            int32_t recv_tokens = 0;
+            for (int r = 0; r < round; ++r) {
+                recv_tokens += notifies[rank].recv_tokens_per_expert[r * num_local_experts + le];
+            }
+            int64_t expected_tokens = std::count_if(expected.begin(), expected.end(),
+                                                    [le](const auto &row) { return std::get<0>(row) == le; });
+            EXPECT_EQ(recv_tokens, expected_tokens);
+        }
+        EXPECT_EQ(combined[rank], expected_combine(inputs[rank], rank, hidden, num_topk, num_experts, 0));
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(RanksTopkRounds, NormalModeSweep,
+                         ::testing::Combine(::testing::Values(2, 3, 8, 16), ::testing::Values(1, 6, 8),
+                                            ::testing::Values(1, 4), ::testing::Values(3, 64)));
+
+class LowLatencySweep : public ::testing::TestWithParam<std::tuple<int, int, int>>
+{};
+
+TEST_P(LowLatencySweep, EveryTokenRoundTrips)
+{
+    auto [num_ranks, num_topk, num_shared_expert_ranks] = GetParam();
+    const int num_moe_ranks = num_ranks - num_shared_expert_ranks;
+    const int num_experts = num_moe_ranks * 2;
+    const int hidden = 4;
+    if (num_topk > num_experts) {
+        GTEST_SKIP();
+    }
+    auto inputs = make_inputs(num_ranks, 24, num_topk, num_experts, 11 * num_ranks + num_topk);
+
+    std::vector<LowLatencyDispatchResult> results(num_ranks);
+    std::vector<LowLatencyDispatchResult> prefix_results(num_ranks);
+    std::vector<std::vector<float>> combined(num_ranks);
+    LoopbackGroup group(num_ranks);
+    group.run([&](int rank) {
+        const RankInput &input = inputs[rank];
+        auto x = make_x(rank, input.num_tokens, hidden);
+        results[rank] = low_latency_dispatch(group, rank, x, hidden, input.topk_idx, input.num_tokens, num_topk,
+                                             num_experts, num_shared_expert_ranks);
+        prefix_results[rank] = low_latency_dispatch(group, rank, x, hidden, input.topk_idx, input.num_tokens,
+                                                    num_topk, num_experts, num_shared_expert_ranks, 0);
+        combined[rank] = low_latency_combine(group, rank, results[rank].recv_x, hidden, results[rank],
+                                             input.topk_idx, input.topk_weights, input.num_tokens, num_topk,
+                                             num_experts, num_shared_expert_ranks, &x);
+    });
+
+    for (int rank = 0; rank < num_ranks; ++rank) {
+        bool is_shared_rank = rank < num_shared_expert_ranks;
+        // (receive pair, source rank, token, top-k slot), a source sends its tokens in (token, top-k) order
+        std::vector<std::tuple<int, int, int, int>> expected;
+        for (int src = 0; src < num_ranks; ++src) {
+            for (int t = 0; t < inputs[src].num_tokens; ++t) {
+                if (is_shared_rank and src % num_shared_expert_ranks == rank) {
+                    expected.emplace_back(src, src, t, num_topk);
+                }
+                for (int k = 0; k < num_topk and not is_shared_rank; ++k) {
+                    int64_t expert = inputs[src].topk_idx[static_cast<size_t>(t) * num_topk + k];
+                    if (expert >= 0 and expert / 2 + num_shared_expert_ranks == rank) {
+                        expected.emplace_back(static_cast<int>(expert % 2) * num_ranks + src, src, t, k);
+                    }
+                }
+            }
+        }
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const auto &a, const auto &b) { return std::get<0>(a) < std::get<0>(b); });
+        const LowLatencyDispatchResult &result = results[rank];
+        ASSERT_EQ(result.num_recv_tokens, static_cast<int>(expected.size()));
+        for (int i = 0; i < result.num_recv_tokens; ++i) {
+            auto [pair, src, t, k] = expected[i];
+            EXPECT_EQ(result.expand_idx[3 * i], src);
+            EXPECT_EQ(result.expand_idx[3 * i + 1], t);
+            EXPECT_EQ(result.expand_idx[3 * i + 2], k);
+        }
+        ASSERT_EQ(result.ep_recv_count.size(), static_cast<size_t>(is_shared_rank ? num_ranks : 2 * num_ranks));
+        EXPECT_EQ(result.ep_recv_count.back(), result.num_recv_tokens);
+        std::vector<int64_t> expert_counts(is_shared_rank ? 1 : 2, 0);
+        for (const auto &row : expected) {
+            ++expert_counts[is_shared_rank ? 0 : std::get<0>(row) / num_ranks];
+        }
+        EXPECT_EQ(result.expert_token_nums, expert_counts);
+        EXPECT_EQ(prefix_results[rank].expert_token_nums.back(), result.num_recv_tokens);
+
+        auto expected_x = expected_combine(inputs[rank], rank, hidden, num_topk, num_experts,
+                                           num_shared_expert_ranks > 0 ? 2 : 1);
+        EXPECT_EQ(combined[rank], expected_x);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(RanksTopkSharedRanks, LowLatencySweep,
+                         ::testing::Combine(::testing::Values(2, 5, 16), ::testing::Values(1, 8, 9),
+                                            ::testing::Values(0, 1)));
+
+}  // namespace
@@ -0,0 +1,108 @@
+#include <array>
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "low_latency_recv.hpp"
+
+namespace {
+
+using deep_ep::LowLatencyKernel;
+using deep_ep::LowLatencyRecvState;
+
+// Models InitWinState of moe_distribute_v2_base.h: every kernel flips its own state word on a send, a receive-only
+// launch reads the half of the latest send, or with COMM_PHASE_RECV_PREV the half of the send before it
+struct FakeWindow {
+    std::array<uint32_t, 2> state = {0, 0};
+    // The half each launch of a kernel used, in launch order
+    std::array<std::vector<uint32_t>, 2> halves;
+
+    uint32_t launch(LowLatencyKernel kernel, int64_t comm_phase)
+    {
+        uint32_t &word = state[static_cast<int>(kernel)];
+        uint32_t half = word;
+        if (comm_phase == deep_ep::COMM_PHASE_RECV) {
+            half = word == 0 ? 1 : 0;
+        } else if (comm_phase != deep_ep::COMM_PHASE_RECV_PREV) {
+            word = word == 0 ? 1 : 0;
+        }
+        halves[static_cast<int>(kernel)].push_back(half);
+        return half;
+    }
+};
+
+class LowLatencyRecvTest : public ::testing::Test
+{
+protected:
+    std::shared_ptr<LowLatencyRecvState> state = std::make_shared<LowLatencyRecvState>();
+    FakeWindow window;
+
+    // Issues a split send and returns its receive hook, the half of the send is stored in `send_half`
+    std::function<void()> send(LowLatencyKernel kernel, uint32_t &send_half)
+    {
+        uint64_t send_idx = deep_ep::begin_low_latency_send(*state, kernel);
+        send_half = window.launch(kernel, deep_ep::COMM_PHASE_SEND);
+        auto launch = [this, kernel](int64_t comm_phase) { window.launch(kernel, comm_phase); };
+        return deep_ep::make_low_latency_recv_hook(true, state, kernel, send_idx, launch);
+    }
+
+    uint32_t last_half(LowLatencyKernel kernel) const
+    {
+        return window.halves[static_cast<int>(kernel)].back();
+    }
+};
+
+TEST_F(LowLatencyRecvTest, InterleavedDispatchAndCombineReceiveTheirOwnHalves)
+{
+    uint32_t dispatch_half, combine_half;
+    auto dispatch_hook = send(LowLatencyKernel::DISPATCH, dispatch_half);
+    auto combine_hook = send(LowLatencyKernel::COMBINE, combine_half);
+    EXPECT_TRUE(state->any_pending());
+
+    // The combine send must not make the dispatch receive look one send behind
+    dispatch_hook();
+    EXPECT_EQ(last_half(LowLatencyKernel::DISPATCH), dispatch_half);
+    combine_hook();
+    EXPECT_EQ(last_half(LowLatencyKernel::COMBINE), combine_half);
+    EXPECT_FALSE(state->any_pending());
+}
+
+TEST_F(LowLatencyRecvTest, TwoMicroBatchesOfEachKernel)
+{
+    uint32_t dispatch_a, dispatch_b, combine_a, combine_b;
+    auto dispatch_hook_a = send(LowLatencyKernel::DISPATCH, dispatch_a);
+    auto combine_hook_a = send(LowLatencyKernel::COMBINE, combine_a);
+    auto dispatch_hook_b = send(LowLatencyKernel::DISPATCH, dispatch_b);
+    auto combine_hook_b = send(LowLatencyKernel::COMBINE, combine_b);
+    EXPECT_NE(dispatch_a, dispatch_b);
+    EXPECT_NE(combine_a, combine_b);
+
+    dispatch_hook_a();
+    EXPECT_EQ(last_half(LowLatencyKernel::DISPATCH), dispatch_a);
+    combine_hook_a();
+    EXPECT_EQ(last_half(LowLatencyKernel::COMBINE), combine_a);
+    dispatch_hook_b();
+    EXPECT_EQ(last_half(LowLatencyKernel::DISPATCH), dispatch_b);
+    combine_hook_b();
+    EXPECT_EQ(last_half(LowLatencyKernel::COMBINE), combine_b);
+}
+
+TEST_F(LowLatencyRecvTest, ThirdSendOfAKernelWaitsForTheFirstHook)
+{
+    uint32_t half;
+    auto first_hook = send(LowLatencyKernel::DISPATCH, half);
+    auto second_hook = send(LowLatencyKernel::DISPATCH, half);
+    // The other kernel has halves of its own
+    auto combine_hook = send(LowLatencyKernel::COMBINE, half);
+    EXPECT_THROW(deep_ep::begin_low_latency_send(*state, LowLatencyKernel::DISPATCH), deep_ep::EPException);
+}
+
+TEST_F(LowLatencyRecvTest, HookFailsAfterTheStateIsFreed)
+{
+    uint32_t half;
+    auto hook = send(LowLatencyKernel::COMBINE, half);
+    state.reset();
+    EXPECT_THROW(hook(), deep_ep::EPException);
+}
+
+}  // namespace
@@ -0,0 +1,137 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "output_arena.hpp"
+
+namespace {
+
+// Storage is a shared byte count, a view remembers which storage it points into and where
+struct FakeTensorOps {
+    struct Storage {
+        int id;
+        int64_t num_bytes;
+    };
+    struct Tensor {
+        std::shared_ptr<Storage> storage;
+        int64_t byte_offset = 0;
+        std::vector<int64_t> sizes;
+        std::string dtype;
+    };
+    struct Options {
+        std::string dtype;
+        int64_t element_size;
+    };
+
+    static inline int num_allocations = 0;
+
+    static int64_t element_size(const Options &options)
+    {
+        return options.element_size;
+    }
+
+    static Tensor allocate(int64_t num_bytes, const Options &)
+    {
+        return Tensor{std::make_shared<Storage>(Storage{num_allocations++, num_bytes}), 0, {num_bytes}, "uint8"};
+    }
+
+    static Tensor view(const Tensor &storage, int64_t byte_offset, const std::vector<int64_t> &sizes,
+                       const Options &options)
+    {
+        return Tensor{storage.storage, byte_offset, sizes, options.dtype};
+    }
+};
+
+using FakeArena = deep_ep::OutputArena<FakeTensorOps>;
+using deep_ep::ArenaRegion;
+
+const FakeTensorOps::Options INT32{"int32", 4};
+const FakeTensorOps::Options BF16{"bfloat16", 2};
+
+class OutputArenaTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        FakeTensorOps::num_allocations = 0;
+    }
+};
+
+TEST_F(OutputArenaTest, SecondCallReusesOneStorage)
+{
+    FakeArena arena;
+    {
+        auto cursor = arena.begin(ArenaRegion::NOTIFY_SCRATCH, INT32);
+        cursor.take({16, 3}, INT32);
+        cursor.take({1}, INT32);
+    }
+    EXPECT_EQ(FakeTensorOps::num_allocations, 2);
+    EXPECT_EQ(arena.reserved_bytes(), 0);
+
+    auto cursor = arena.begin(ArenaRegion::NOTIFY_SCRATCH, INT32);
+    EXPECT_EQ(FakeTensorOps::num_allocations, 3);
+    EXPECT_EQ(arena.reserved_bytes(), 2 * FakeArena::ALIGNMENT);
+    auto a = cursor.take({16, 3}, INT32);
+    auto b = cursor.take({1}, INT32);
+    EXPECT_EQ(FakeTensorOps::num_allocations, 3);
+    EXPECT_EQ(a.storage, b.storage);
+    EXPECT_EQ(a.byte_offset, 0);
+    EXPECT_EQ(b.byte_offset, FakeArena::ALIGNMENT);
+    EXPECT_EQ(b.sizes, std::vector<int64_t>{1});
+}
+
+TEST_F(OutputArenaTest, SmallerCallsDoNotAllocate)
+{
+    FakeArena arena;
+    arena.begin(ArenaRegion::LOW_LATENCY_RECV_0, BF16).take({4096, 7168}, BF16);
+    arena.begin(ArenaRegion::LOW_LATENCY_RECV_0, BF16).take({4096, 7168}, BF16);
+    int num_allocations = FakeTensorOps::num_allocations;
+
+    auto view = arena.begin(ArenaRegion::LOW_LATENCY_RECV_0, INT32).take({128, 128}, INT32);
+    EXPECT_EQ(FakeTensorOps::num_allocations, num_allocations);
+    EXPECT_EQ(view.dtype, "int32");
+    EXPECT_EQ(view.storage->num_bytes, 4096 * 7168 * 2);
+}
+
+TEST_F(OutputArenaTest, GrowsToTheLargestCall)
+{
+    FakeArena arena;
+    arena.begin(ArenaRegion::PLACEHOLDER, INT32).take({1}, INT32);
+    arena.begin(ArenaRegion::PLACEHOLDER, INT32).take({1}, INT32);
+    {
+        // Overflowing takes fall back to their own storage, the earlier views stay in the region
+        auto cursor = arena.begin(ArenaRegion::PLACEHOLDER, INT32);
+        auto a = cursor.take({1}, INT32);
+        auto b = cursor.take({1000}, INT32);
+        EXPECT_NE(a.storage, b.storage);
+        EXPECT_EQ(b.byte_offset, 0);
+    }
+    auto cursor = arena.begin(ArenaRegion::PLACEHOLDER, INT32);
+    EXPECT_EQ(arena.reserved_bytes(), FakeArena::ALIGNMENT + FakeArena::align(4000));
+    auto a = cursor.take({1}, INT32);
+    auto b = cursor.take({1000}, INT32);
+    EXPECT_EQ(a.storage, b.storage);
+}
+
+TEST_F(OutputArenaTest, RegionsAreIndependent)
+{
+    FakeArena arena;
+    for (int i = 0; i < 2; ++i) {
+        arena.begin(ArenaRegion::LOW_LATENCY_RECV_0, INT32).take({8}, INT32);
+        arena.begin(ArenaRegion::LOW_LATENCY_RECV_1, INT32).take({8}, INT32);
+    }
+    auto a = arena.begin(ArenaRegion::LOW_LATENCY_RECV_0, INT32).take({8}, INT32);
+    auto b = arena.begin(ArenaRegion::LOW_LATENCY_RECV_1, INT32).take({8}, INT32);
+    EXPECT_NE(a.storage, b.storage);
+    EXPECT_EQ(arena.reserved_bytes(), 2 * FakeArena::ALIGNMENT);
+}
+
+TEST_F(OutputArenaTest, NegativeSizeThrows)
+{
+    FakeArena arena;
+    auto cursor = arena.begin(ArenaRegion::NOTIFY_SCRATCH, INT32);
+    EXPECT_THROW(cursor.take({-1}, INT32), deep_ep::EPException);
+}
+
+}  // namespace
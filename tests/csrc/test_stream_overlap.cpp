@@ -0,0 +1,132 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "stream_overlap.hpp"
+
+namespace {
+
+// Records every stream primitive as a string so the ordering can be compared exactly
+struct FakeStreamOps {
+    using Stream = std::string;
+    struct Event {
+        std::string stream;
+        int id;
+    };
+    struct Tensor {
+        std::string name;
+    };
+
+    static inline Stream current_stream = "compute";
+    static inline int next_event = 0;
+    static inline std::vector<std::string> log;
+
+    static void reset()
+    {
+        current_stream = "compute";
+        next_event = 0;
+        log.clear();
+    }
+
+    static Stream current()
+    {
+        return current_stream;
+    }
+
+    static void set_current(const Stream &stream)
+    {
+        log.push_back("set_current " + stream);
+        current_stream = stream;
+    }
+
+    static Event record(const Stream &stream)
+    {
+        Event event{stream, next_event++};
+        log.push_back("record " + stream + " e" + std::to_string(event.id));
+        return event;
+    }
+
+    static void wait(const Stream &stream, const Event &event)
+    {
+        log.push_back(stream + " wait e" + std::to_string(event.id));
+    }
+
+    static void record_tensor(const Tensor &tensor, const Stream &stream)
+    {
+        log.push_back("record_stream " + tensor.name + " " + stream);
+    }
+};
+
+using FakeOverlap = deep_ep::StreamOverlap<FakeStreamOps>;
+
+class StreamOverlapTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        FakeStreamOps::reset();
+    }
+};
+
+TEST_F(StreamOverlapTest, SyncLaunchWaitsBothWays)
+{
+    {
+        FakeOverlap overlap("comm", std::nullopt, false, false);
+        EXPECT_EQ(FakeStreamOps::current(), "comm");
+        overlap.record_tensors(FakeStreamOps::Tensor{"x"});
+        EXPECT_FALSE(overlap.finish().has_value());
+    }
+    std::vector<std::string> expected = {"record compute e0",       "comm wait e0",   "set_current comm",
+                                         "record_stream x compute", "record comm e1", "compute wait e1",
+                                         "set_current compute"};
+    EXPECT_EQ(FakeStreamOps::log, expected);
+    EXPECT_EQ(FakeStreamOps::current(), "compute");
+}
+
+TEST_F(StreamOverlapTest, AsyncLaunchReturnsEventAndRecordsTensors)
+{
+    std::optional<FakeStreamOps::Event> event;
+    {
+        FakeOverlap overlap("comm", std::nullopt, true, false);
+        overlap.record_tensors(FakeStreamOps::Tensor{"x"}, FakeStreamOps::Tensor{"y"});
+        event = overlap.finish();
+    }
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(event->stream, "comm");
+    std::vector<std::string> expected = {"record compute e0",       "comm wait e0",           "set_current comm",
+                                         "record_stream x comm",    "record_stream y comm",   "record_stream x compute",
+                                         "record_stream y compute", "record comm e1",         "set_current compute"};
+    EXPECT_EQ(FakeStreamOps::log, expected);
+}
+
+TEST_F(StreamOverlapTest, PreviousEventReplacesComputeStreamWait)
+{
+    FakeStreamOps::Event previous{"compute", 42};
+    {
+        FakeOverlap overlap("comm", previous, true, true);
+        overlap.finish();
+    }
+    std::vector<std::string> expected = {"comm wait e42", "set_current comm", "record comm e0", "set_current compute"};
+    EXPECT_EQ(FakeStreamOps::log, expected);
+}
+
+TEST_F(StreamOverlapTest, AllocateOnCommStreamRequiresPreviousEventAndAsync)
+{
+    EXPECT_THROW(FakeOverlap("comm", std::nullopt, true, true), deep_ep::EPException);
+    FakeStreamOps::Event previous{"compute", 0};
+    EXPECT_THROW(FakeOverlap("comm", previous, false, true), deep_ep::EPException);
+    EXPECT_EQ(FakeStreamOps::current(), "compute");
+}
+
+TEST_F(StreamOverlapTest, ExceptionDuringLaunchRestoresComputeStream)
+{
+    try {
+        FakeOverlap overlap("comm", std::nullopt, false, false);
+        throw std::runtime_error("launch failed");
+    } catch (const std::runtime_error &) {
+    }
+    EXPECT_EQ(FakeStreamOps::current(), "compute");
+    EXPECT_EQ(FakeStreamOps::log.back(), "set_current compute");
+}
+
+}  // namespace
@@ -26,7 +26,8 @@ def normal_test(
         num_tokens_per_expert,
         is_token_in_rank,
         _,
-    ) = buffer.get_dispatch_layout(topk_idx, num_experts)
+        layout,
+    ) = buffer.get_dispatch_layout(topk_idx, num_experts, return_layout=True)
 
     buffer_size = 256
     config = deep_ep.Config(24, 8, buffer_size)
@@ -36,6 +37,7 @@ def normal_test(
         "num_tokens_per_rank": num_tokens_per_rank,
         "is_token_in_rank": is_token_in_rank,
         "num_tokens_per_expert": num_tokens_per_expert,
+        "layout": layout,
         "config": config,
         "topk_idx": topk_idx,
         "topk_weights": topk_weights,
@@ -58,6 +60,7 @@ def normal_test(
         _,
         _,
         topk_weights_recv,
+        _,
     ) = handle
     recv_x = per_token_cast_back(*recv_x) if isinstance(recv_x, tuple) else recv_x
     combine_args = {
@@ -154,6 +154,12 @@ def test_main(
     dist.all_reduce(gbl_num_tokens_per_expert, group=group)
 
     def check_layout_a2_data(notify_send_data):
+        # The sections are laid out for the batch bound given to the layout, found again from the size
+        max_bs = (notify_send_data.numel() - num_experts - num_servers) // (
+            1 + 2 * num_servers + 2 * num_experts
+        )
+        assert num_tokens <= max_bs <= MAX_BATCH_SIZE
+
         # cpu calc data
         count_num_expert = [0] * num_experts
         num_tokens_per_server_uniq = torch.zeros(
@@ -172,7 +178,7 @@ def test_main(
             (num_tokens * num_experts,), dtype=torch.int, device="npu"
         )
         expert_rank_token_idx = torch.zeros(
-            (num_experts * MAX_BATCH_SIZE,), dtype=torch.int, device="npu"
+            (num_experts * max_bs,), dtype=torch.int, device="npu"
         )
 
         for i in range(num_tokens):
@@ -205,7 +211,7 @@ def test_main(
                 rank_id = expert_id // experts_per_rank
                 server_id = rank_id // num_local_ranks
                 expert_rank_token_idx[
-                    expert_id * MAX_BATCH_SIZE + count_num_expert[expert_id]
+                    expert_id * max_bs + count_num_expert[expert_id]
                 ] = each_token_offset_to_server[i * num_servers + server_id]
                 count_num_expert[expert_id] += 1
 
@@ -218,33 +224,33 @@ def test_main(
         ]
         ref_each_token_to_num_server = notify_send_data[
             num_experts
-            + num_servers * (1 + MAX_BATCH_SIZE) : num_experts
+            + num_servers * (1 + max_bs) : num_experts
             + num_servers
-            + MAX_BATCH_SIZE * num_servers
+            + max_bs * num_servers
             + num_tokens
         ]
         ref_each_token_offset_to_server = notify_send_data[
             num_experts
             + num_servers
-            + MAX_BATCH_SIZE * (num_servers + 1) : num_experts
+            + max_bs * (num_servers + 1) : num_experts
             + num_servers
-            + MAX_BATCH_SIZE * (num_servers + 1)
+            + max_bs * (num_servers + 1)
             + num_servers * num_tokens
         ]
         ref_send_token_idx = notify_send_data[
             num_experts
             + num_servers
-            + MAX_BATCH_SIZE * (num_servers * 2 + 1) : num_experts
+            + max_bs * (num_servers * 2 + 1) : num_experts
             + num_servers
-            + MAX_BATCH_SIZE * (num_servers * 2 + 1)
+            + max_bs * (num_servers * 2 + 1)
             + num_tokens * num_experts
         ]
         ref_expert_rank_token_idx = notify_send_data[
             num_experts
             + num_servers
-            + MAX_BATCH_SIZE * (num_servers * 2 + num_experts + 1) : num_experts
+            + max_bs * (num_servers * 2 + num_experts + 1) : num_experts
             + num_servers
-            + MAX_BATCH_SIZE * (num_servers * 2 + num_experts + num_experts + 1)
+            + max_bs * (num_servers * 2 + num_experts + num_experts + 1)
         ]
 
         # check data
@@ -303,7 +309,12 @@ def test_main(
 
     try:
         try:
-            return_values = buffer.get_dispatch_layout(topk_idx, num_experts)
+            return_values = buffer.get_dispatch_layout(
+                topk_idx,
+                num_experts,
+                num_max_tokens_per_rank=num_tokens,
+                return_layout=True,
+            )
         except Exception as e:
             print(f"Error occurred while calling get_dispatch_layout: {e}")
             raise
@@ -314,6 +325,7 @@ def test_main(
             ref_num_tokens_per_expert,
             ref_is_token_in_rank,
             _,
+            ref_layout,
         ) = return_values
         try:
             assert torch.allclose(
@@ -326,7 +338,7 @@ def test_main(
                 ref_is_token_in_rank, is_token_in_rank
             ), f"Assertion is_token_in_rank failed on rank {rank}: Expected {is_token_in_rank}, Actual {ref_is_token_in_rank}"
             if enable_a2_test:
-                notify_send_data = buffer.get_notify_send_data()
+                notify_send_data = buffer.get_notify_send_data(ref_layout)
                 check_layout_a2_data(notify_send_data)
         except AssertionError as e:
             print(e)
@@ -432,6 +444,8 @@ def test_main(
                 "topk_weights": (
                     topk_weights_pure_rand if current_x is x_pure_rand else topk_weights
                 ),
+                # The first pass reuses the latest layout of the buffer, the second passes it
+                "layout": ref_layout if current_x is x else None,
             }
 
             (
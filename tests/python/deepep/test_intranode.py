@@ -180,6 +180,12 @@ def test_main(
 
     gbl_num_tokens_per_expert = total_tokens_per_expert.clone()
     dist.all_reduce(gbl_num_tokens_per_expert, group=group)
+    all_tokens_per_expert = torch.empty(
+        (num_ranks, num_experts), dtype=torch.int, device="npu"
+    )
+    dist.all_gather_into_tensor(
+        all_tokens_per_expert, total_tokens_per_expert, group=group
+    )
 
     # Rank layout meta
     num_tokens_per_rank = torch.empty((num_ranks,), dtype=torch.int, device="npu")
@@ -206,13 +212,16 @@ def test_main(
     dist.barrier()
     time.sleep(1)
 
-    return_values = buffer.get_dispatch_layout(topk_idx, num_experts)
+    return_values = buffer.get_dispatch_layout(
+        topk_idx, num_experts, return_layout=True
+    )
     (
         ref_num_tokens_per_rank,
         _,
         ref_num_tokens_per_expert,
         ref_is_token_in_rank,
         _,
+        ref_layout,
     ) = return_values
 
     assert torch.allclose(
@@ -239,6 +248,72 @@ def test_main(
         (num_tokens, num_topk), dtype=torch.float32, device="npu"
     )
 
+    # Expert capacity: every expert keeps at most `capacity` entries of the whole group, each rank drops its lowest
+    # weights over its share and the dropped entries add zero to the combine
+    capacity = 2
+    capacity_weights = torch.rand(
+        (num_tokens, num_topk), dtype=torch.float32, device="npu"
+    )
+    # The lowest priority, so the first token loses every entry whose expert has more local entries than `capacity`
+    capacity_weights[:1] = 0
+    buffer.set_expert_capacity(capacity=capacity)
+    (
+        cap_num_tokens_per_rank,
+        _,
+        cap_num_tokens_per_expert,
+        cap_is_token_in_rank,
+        _,
+        cap_layout,
+    ) = buffer.get_dispatch_layout(
+        topk_idx, num_experts, topk_weights=capacity_weights, return_layout=True
+    )
+    buffer.set_expert_capacity()
+    cap_recv_x, _, _, _, cap_handle, _ = buffer.dispatch(
+        x=x_pure_rand,
+        num_tokens_per_rank=cap_num_tokens_per_rank,
+        is_token_in_rank=cap_is_token_in_rank,
+        num_tokens_per_expert=cap_num_tokens_per_expert,
+        layout=cap_layout,
+        config=config,
+        topk_idx=topk_idx,
+        topk_weights=capacity_weights,
+    )
+    dropped = buffer.get_dropped_topk(cap_handle)
+    assert dropped is not None and dropped.any(), f"No entry dropped on rank {rank}"
+    kept_idx = topk_idx.masked_fill(dropped, -1)
+    local_per_expert = torch.bincount(topk_idx.flatten() + 1, minlength=num_experts + 1)
+    first_routed = topk_idx[:1] >= 0
+    if (local_per_expert[topk_idx[:1][first_routed] + 1] > capacity).all():
+        assert dropped[:1][first_routed].all(), f"Token 0 kept on rank {rank}"
+    kept_per_expert = torch.bincount(kept_idx.flatten() + 1, minlength=num_experts + 1)
+    gbl_kept_per_expert = kept_per_expert[1:].int()
+    dist.all_reduce(gbl_kept_per_expert, group=group)
+    assert torch.equal(
+        gbl_kept_per_expert, gbl_num_tokens_per_expert.clamp(max=capacity)
+    ), f"Assertion expert capacity failed on rank {rank}"
+    dropped_max = torch.full((num_experts,), -1.0, device="npu").scatter_reduce(
+        0, topk_idx[dropped], capacity_weights[dropped], "amax"
+    )
+    kept_min = torch.full((num_experts,), 2.0, device="npu").scatter_reduce(
+        0, kept_idx[kept_idx >= 0], capacity_weights[kept_idx >= 0], "amin"
+    )
+    assert (
+        dropped_max <= kept_min
+    ).all(), f"Assertion expert capacity priority failed on rank {rank}"
+    cap_combined_x, _, _ = buffer.combine(
+        x=cap_recv_x, handle=cap_handle, config=config, topk_weights=capacity_weights
+    )
+    kept_weights = capacity_weights.masked_fill(kept_idx == -1, 0)
+    diff = calc_diff(
+        cap_combined_x.float(), x_pure_rand * kept_weights.sum(dim=1, keepdim=True)
+    )
+    assert diff < 5e-5, f"Assertion expert capacity combine failed on rank {rank}"
+    # Tokens that lost every entry reach the combine kernel with only -1 ids and come back as zeros
+    all_dropped = (kept_idx < 0).all(dim=1)
+    assert (
+        cap_combined_x[all_dropped] == 0
+    ).all(), f"Assertion dropped token combine failed on rank {rank}"
+
     # Test dispatch
     # noinspection PyShadowingNames
     def check_data(check_x, rank_prefix_matrix):
@@ -328,6 +403,7 @@ def test_main(
             "num_tokens_per_rank": ref_num_tokens_per_rank,
             "is_token_in_rank": ref_is_token_in_rank,
             "num_tokens_per_expert": ref_num_tokens_per_expert,
+            "layout": ref_layout,
             "config": config,
             "topk_idx": topk_idx,
             "topk_weights": (
@@ -335,6 +411,9 @@ def test_main(
             ),
         }
 
+        cumulative_local_expert_recv_stats = torch.zeros(
+            (num_experts // num_ranks, num_ranks), dtype=torch.int, device="npu"
+        )
         (
             recv_x,
             recv_topk_idx,
@@ -342,7 +421,10 @@ def test_main(
             recv_num_tokens_per_expert_list,
             handle,
             event,
-        ) = buffer.dispatch(**dispatch_args)
+        ) = buffer.dispatch(
+            **dispatch_args,
+            cumulative_local_expert_recv_stats=cumulative_local_expert_recv_stats,
+        )
         recv_x = per_token_cast_back(*recv_x) if isinstance(recv_x, tuple) else recv_x
 
         # Checks
@@ -358,6 +440,10 @@ def test_main(
         assert (
             local_expert_token_list == recv_num_tokens_per_expert_list
         ), f"Assertion num_tokens_per_rank failed on rank {rank}: Expected {local_expert_token_list}, Actual {recv_num_tokens_per_expert_list}"
+        assert torch.equal(
+            cumulative_local_expert_recv_stats,
+            all_tokens_per_expert.view(num_ranks, num_ranks, -1)[:, rank].t(),
+        ), f"Assertion expert receive statistics failed on rank {rank}"
         # todo 1. Duplicate tansmission to experts of the same rank.
         # assert gbl_num_tokens_per_rank[rank].item() == recv_x.size(0), f'{gbl_num_tokens_per_rank[rank].item()} != {recv_x.size(0)}'
         # todo 2. recv_num_tokens_per_expert_list is the prefix sum of the actual data.
@@ -384,6 +470,68 @@ def test_main(
         )
         assert diff < 5e-5
 
+        # Sync-free dispatch: outputs sized by `num_worst_tokens`, counts stay on device. The window is reserved for
+        # the largest batch given to the layout, so it fits the default `HCCL_BUFFSIZE`
+        num_worst_tokens = num_tokens * num_ranks * num_topk
+        (
+            worst_num_tokens_per_rank,
+            _,
+            worst_num_tokens_per_expert,
+            worst_is_token_in_rank,
+            _,
+            worst_layout,
+        ) = buffer.get_dispatch_layout(
+            topk_idx,
+            num_experts,
+            num_max_tokens_per_rank=num_tokens,
+            hidden=hidden,
+            return_layout=True,
+        )
+        (
+            worst_recv_x,
+            _,
+            _,
+            worst_recv_num_tokens_per_expert,
+            worst_handle,
+            _,
+        ) = buffer.dispatch(
+            **dict(
+                dispatch_args,
+                num_tokens_per_rank=worst_num_tokens_per_rank,
+                is_token_in_rank=worst_is_token_in_rank,
+                num_tokens_per_expert=worst_num_tokens_per_expert,
+                layout=worst_layout,
+            ),
+            num_worst_tokens=num_worst_tokens,
+        )
+        worst_recv_x = (
+            per_token_cast_back(*worst_recv_x)
+            if isinstance(worst_recv_x, tuple)
+            else worst_recv_x
+        )
+        assert worst_recv_x.size(0) == num_worst_tokens
+        assert worst_recv_num_tokens_per_expert.device.type == "npu"
+        assert worst_recv_num_tokens_per_expert.tolist() == local_expert_token_list
+        worst_combined_x, _, _ = buffer.combine(
+            **dict(combine_args, x=worst_recv_x, handle=worst_handle)
+        )
+        diff = calc_diff(
+            worst_combined_x.float(),
+            ref_x * handle[7].masked_fill(topk_idx == -1, 0).sum(dim=1).view(-1, 1),
+        )
+        assert diff < 5e-5
+
+        # Cached dispatch: the notify results of the first dispatch are reused, only the tokens are sent
+        cached_recv_x, _, _, _, _, _ = buffer.dispatch(
+            x=current_x, handle=handle, config=config
+        )
+        cached_recv_x = (
+            per_token_cast_back(*cached_recv_x)
+            if isinstance(cached_recv_x, tuple)
+            else cached_recv_x
+        )
+        assert torch.equal(cached_recv_x, recv_x)
+
         # For later tuning
         dispatch_bf16_recv_bytes = recv_x.numel() * 2
         combine_bf16_send_bytes = dispatch_bf16_recv_bytes
@@ -456,10 +604,23 @@ def test_main(
         combine_send_cost_stats = torch.zeros(
             (num_ranks,), dtype=torch.int32, device="npu"
         )
+        # The telemetry sees the same per-call costs as the caller's tensors
+        buffer.set_telemetry(True)
+        buffer.get_telemetry(reset=True)
         test_diagnose(
             dispatch_wait_recv_cost_stats=dispatch_wait_recv_cost_stats,
             combine_send_cost_stats=combine_send_cost_stats,
         )
+        telemetry = buffer.get_telemetry(reset=True)
+        buffer.set_telemetry(False)
+        for stats, name in (
+            (dispatch_wait_recv_cost_stats, "dispatch_wait_recv"),
+            (combine_send_cost_stats, "combine_send"),
+        ):
+            assert torch.equal(telemetry[name]["total_us"], stats.long())
+            histogram = telemetry[name]["histogram"]
+            assert telemetry[name]["calls"] > 0
+            assert (histogram.sum(dim=1) == telemetry[name]["calls"]).all()
 
 
 # noinspection PyUnboundLocalVariable,PyShadowingNames
@@ -1,4 +1,5 @@
 import argparse
+import itertools
 import os
 import random
 import time
@@ -66,15 +67,37 @@ def test(
         (num_tokens, num_topk), dtype=torch.float32, device="npu"
     ).abs()
 
+    # The A2 kernels neither split sending and receiving nor quantize the combine
+    split_recv = "910B" not in torch.npu.get_device_name()
+    # The combine adds a shared expert output unless shared expert ranks or the A2 layered kernel are used
+    a2_layered = (
+        not split_recv
+        and os.getenv("HCCL_INTRA_PCIE_ENABLE") == "1"
+        and os.getenv("HCCL_INTRA_ROCE_ENABLE") == "0"
+    )
+    fuse_addends = (
+        int(os.getenv("MOE_SHARED_EXPERT_RANK_NUM", 0)) == 0 and not a2_layered
+    )
+
     # Check dispatch correctness
     do_check = True
-    return_recv_hook = False
     hash_value, num_times = 0, 0
 
+    # The A3 kernels also break the statistics down by source rank
     cumulative_local_expert_recv_stats = torch.zeros(
-        (num_local_experts,), dtype=torch.int, device="npu"
+        (num_local_experts, num_ranks) if split_recv else (num_local_experts,),
+        dtype=torch.int,
+        device="npu",
+    )
+    expected_recv_stats = torch.zeros(
+        (num_local_experts, num_ranks), dtype=torch.int, device="npu"
     )
-    for dispatch_use_fp8 in (True, False):
+    for dispatch_use_fp8, block_scales, return_recv_hook in itertools.product(
+        (True, False), (False, True), (False, True)
+    ):
+        # Per-128-channel scales are only produced by the A3 kernels, check them with UE8M0 packing
+        if block_scales and not (dispatch_use_fp8 and split_recv):
+            continue
         packed_recv_x, packed_recv_count, handle, event, hook = (
             buffer.low_latency_dispatch(
                 x,
@@ -82,13 +105,15 @@ def test(
                 num_tokens,
                 num_experts,
                 use_fp8=dispatch_use_fp8,
-                round_scale=False,
-                use_ue8m0=False,
+                round_scale=block_scales,
+                use_ue8m0=block_scales,
                 cumulative_local_expert_recv_stats=cumulative_local_expert_recv_stats,
                 async_finish=not return_recv_hook,
                 return_recv_hook=return_recv_hook,
+                use_block_scales=block_scales,
             )
         )
+        hook() if return_recv_hook else event.current_stream_wait()
         simulated_gemm_x = (
             per_token_cast_back(*packed_recv_x) if dispatch_use_fp8 else packed_recv_x
         )
@@ -97,6 +122,23 @@ def test(
             (num_ranks, num_tokens, num_topk), dtype=topk_idx.dtype, device="npu"
         )
         dist.all_gather_into_tensor(all_topk_idx, topk_idx, group=group)
+        local_expert_ids = rank * num_local_experts + torch.arange(
+            num_local_experts, device="npu"
+        )
+        expected_recv_stats += (
+            (all_topk_idx.view(num_ranks, 1, -1) == local_expert_ids.view(1, -1, 1))
+            .sum(dim=-1)
+            .t()
+            .int()
+        )
+        assert torch.equal(
+            cumulative_local_expert_recv_stats,
+            (
+                expected_recv_stats
+                if split_recv
+                else expected_recv_stats.sum(dim=1, dtype=torch.int)
+            ),
+        ), f"expert receive statistics mismatch on rank {rank}"
 
         for i in range(num_local_experts if do_check else 0):
             expert_id = rank * num_local_experts + i
@@ -153,6 +195,7 @@ def test(
             hidden,
             num_experts,
             packed_recv_count,
+            _,
         ) = handle
 
         out = torch.empty((num_tokens, hidden), dtype=torch.bfloat16, device="npu")
@@ -166,6 +209,7 @@ def test(
             return_recv_hook=return_recv_hook,
             out=out,
         )
+        hook() if return_recv_hook else event.current_stream_wait()
 
         if do_check:
             diff = calc_diff(
@@ -179,8 +223,124 @@ def test(
                 assert diff < 1e-5, f"Error: {diff=}"
             hash_value ^= hash_tensor(combined_x)
 
+            # Zero-copy combine reads the expert outputs from the buffer they were written into
+            combine_buffer = buffer.get_next_low_latency_combine_buffer(handle)
+            combine_buffer.copy_(simulated_gemm_x)
+            zero_copy_x, event, hook = buffer.low_latency_combine(
+                combine_buffer,
+                topk_idx,
+                topk_weights,
+                handle,
+                async_finish=not return_recv_hook,
+                zero_copy=True,
+                return_recv_hook=return_recv_hook,
+            )
+            hook() if return_recv_hook else event.current_stream_wait()
+            assert torch.equal(zero_copy_x, combined_x)
+
+            # Int8 combine
+            for int8_block_scaled in (False, True) if split_recv else ():
+                int8_combined_x, event, hook = buffer.low_latency_combine(
+                    simulated_gemm_x,
+                    topk_idx,
+                    topk_weights,
+                    handle,
+                    async_finish=not return_recv_hook,
+                    return_recv_hook=return_recv_hook,
+                    use_int8=True,
+                    int8_block_scaled=int8_block_scaled,
+                )
+                hook() if return_recv_hook else event.current_stream_wait()
+                diff = calc_diff(
+                    x * topk_weights.masked_fill(topk_idx == -1, 0).sum(dim=1).view(-1, 1),
+                    int8_combined_x,
+                )
+                assert torch.isnan(int8_combined_x).sum().item() == 0
+                assert diff < 1e-3, f"Error: {diff=}, {int8_block_scaled=}"
+
+            # Shared expert output and residual added in the final reduction pass
+            if fuse_addends:
+                shared_expert_x = torch.randn_like(x)
+                residual = torch.randn_like(x)
+                fused_x, event, hook = buffer.low_latency_combine(
+                    simulated_gemm_x,
+                    topk_idx,
+                    topk_weights,
+                    handle,
+                    async_finish=not return_recv_hook,
+                    return_recv_hook=return_recv_hook,
+                    shared_expert_x=shared_expert_x,
+                    residual=residual,
+                )
+                hook() if return_recv_hook else event.current_stream_wait()
+                diff = calc_diff(
+                    combined_x.float() + shared_expert_x.float() + residual.float(),
+                    fused_x,
+                )
+                assert torch.isnan(fused_x).sum().item() == 0
+                assert diff < 1e-4, f"Error: {diff=}"
+
             print(f"rank {rank} PASSED")
 
+    # Two micro-batches in flight: the send of B is issued before the receive of A
+    if split_recv:
+        micro_x = (x, x * 2)
+        recvs = [
+            buffer.low_latency_dispatch(
+                mx,
+                topk_idx,
+                num_tokens,
+                num_experts,
+                use_fp8=False,
+                return_recv_hook=True,
+            )
+            for mx in micro_x
+        ]
+        for *_, hook in recvs:
+            hook()
+        combines = [
+            buffer.low_latency_combine(
+                packed_recv_x, topk_idx, topk_weights, handle, return_recv_hook=True
+            )
+            for packed_recv_x, _, handle, _, _ in recvs
+        ]
+        for _, _, hook in combines:
+            hook()
+        for mx, (micro_combined_x, _, _) in zip(micro_x, combines):
+            ref_x = mx * topk_weights.masked_fill(topk_idx == -1, 0).sum(dim=1).view(
+                -1, 1
+            )
+            diff = calc_diff(ref_x, micro_combined_x)
+            assert diff < 1e-5, f"Error: {diff=}"
+
+        # Interleaved kernels: the combine send of A lands between the dispatch send of B and its receive, each
+        # kernel keeps its own window halves
+        recv_a = buffer.low_latency_dispatch(
+            micro_x[0], topk_idx, num_tokens, num_experts, use_fp8=False
+        )
+        recv_b = buffer.low_latency_dispatch(
+            micro_x[1],
+            topk_idx,
+            num_tokens,
+            num_experts,
+            use_fp8=False,
+            return_recv_hook=True,
+        )
+        combine_a = buffer.low_latency_combine(
+            recv_a[0], topk_idx, topk_weights, recv_a[2], return_recv_hook=True
+        )
+        recv_b[-1]()
+        combine_a[-1]()
+        combine_b = buffer.low_latency_combine(
+            recv_b[0], topk_idx, topk_weights, recv_b[2]
+        )
+        for mx, (micro_combined_x, _, _) in zip(micro_x, (combine_a, combine_b)):
+            ref_x = mx * topk_weights.masked_fill(topk_idx == -1, 0).sum(dim=1).view(
+                -1, 1
+            )
+            diff = calc_diff(ref_x, micro_combined_x)
+            assert diff < 1e-5, f"Error: {diff=}"
+
     # noinspection PyShadowingNames
     def test_func(zero_copy: bool, return_recv_hook: bool):
         recv_x, recv_count, handle, event, hook = buffer.low_latency_dispatch(
@@ -193,14 +353,20 @@ def test(
             async_finish=False,
             return_recv_hook=return_recv_hook,
         )
+        hook() if return_recv_hook else None
+        combine_x = simulated_gemm_x
+        if zero_copy:
+            combine_x = buffer.get_next_low_latency_combine_buffer(handle)
+            combine_x.copy_(simulated_gemm_x)
         combined_x, event, hook = buffer.low_latency_combine(
-            simulated_gemm_x,
+            combine_x,
             topk_idx,
             topk_weights,
             handle,
             zero_copy=zero_copy,
             return_recv_hook=return_recv_hook,
         )
+        hook() if return_recv_hook else None
 
     # Calculate bandwidth
     num_fp8_bytes, num_bf16_bytes = (hidden + hidden // 128 * 4 + 16), hidden * 2
@@ -221,8 +387,8 @@ def test(
     )
 
     # Separate profiling
-    # return_recv_hook=True is not supported now
-    for return_recv_hook in (False,):
+    # The A2 kernels do not split sending and receiving, so there is no send/recv time to separate
+    for return_recv_hook in (False, True) if split_recv else (False,):
         enable_neg_one = int(os.getenv("MOE_ENABLE_TOPK_NEG_ONE", 0))
         dist.barrier()
         dispatch_t, combine_t = bench_kineto(
@@ -259,6 +425,73 @@ def test(
     return hash_value
 
 
+def test_expert_replicas(
+    num_tokens: int,
+    hidden: int,
+    num_experts: int,
+    num_topk: int,
+    rank: int,
+    num_ranks: int,
+    group: dist.ProcessGroup,
+    buffer: Buffer,
+):
+    # Every logical expert `e` has the two replicas `e` and `e + num_logical_experts`
+    num_logical_experts = num_experts // 2
+    assert num_topk <= num_logical_experts
+    num_local_experts = num_experts // num_ranks
+    log2phy = torch.arange(num_experts, dtype=torch.int32, device="npu").view(2, -1).t()
+    x = torch.ones((num_tokens, hidden), dtype=torch.bfloat16, device="npu") * (
+        rank + 1
+    )
+    scores = torch.randn((num_tokens, num_logical_experts), device="npu").abs() + 1
+    topk_idx = torch.topk(scores, num_topk, dim=-1)[1]
+    topk_weights = torch.rand((num_tokens, num_topk), device="npu")
+    tokens = torch.arange(num_tokens, device="npu").view(-1, 1)
+    all_physical = torch.empty(
+        (num_ranks, num_tokens, num_topk), dtype=topk_idx.dtype, device="npu"
+    )
+    local_expert_ids = rank * num_local_experts + torch.arange(
+        num_local_experts, device="npu"
+    )
+
+    policies = ["round_robin"]
+    if "910B" not in torch.npu.get_device_name():
+        policies.append("least_loaded")
+    for policy in policies:
+        buffer.set_expert_replicas(log2phy, policy=policy)
+        recv_stats = torch.zeros((num_local_experts,), dtype=torch.int, device="npu")
+        recv_x, _, handle, event, _ = buffer.low_latency_dispatch(
+            x,
+            topk_idx,
+            num_tokens,
+            num_experts,
+            use_fp8=False,
+            cumulative_local_expert_recv_stats=recv_stats,
+        )
+        event.current_stream_wait()
+
+        physical = handle[-1].new_topk_idx.to(topk_idx.dtype)
+        assert torch.equal(physical % num_logical_experts, topk_idx)
+        if policy == "round_robin":
+            replica = (tokens + rank) % 2
+            assert torch.equal(physical, topk_idx + replica * num_logical_experts)
+        dist.all_gather_into_tensor(all_physical, physical, group=group)
+        expected_stats = (
+            all_physical.view(-1, 1) == local_expert_ids.view(1, -1)
+        ).sum(dim=0, dtype=torch.int)
+        assert torch.equal(recv_stats, expected_stats), f"{policy=}"
+
+        # The combine gets the logical ids and routes back through the picked replicas
+        combined_x, event, _ = buffer.low_latency_combine(
+            recv_x, topk_idx, topk_weights, handle
+        )
+        event.current_stream_wait()
+        diff = calc_diff(x * topk_weights.sum(dim=1).view(-1, 1), combined_x)
+        assert diff < 1e-5, f"Error: {diff=}, {policy=}"
+    buffer.set_expert_replicas(None)
+    print(f"rank {rank} expert replicas PASSED", flush=True)
+
+
 def test_loop(local_rank: int, num_local_ranks: int, args: argparse.Namespace):
     rank, num_ranks, group = init_dist(local_rank, num_local_ranks)
     shared_expert_rank_num = int(os.getenv("MOE_SHARED_EXPERT_RANK_NUM", 0))
@@ -289,6 +522,10 @@ def test_loop(local_rank: int, num_local_ranks: int, args: argparse.Namespace):
         drop_percent,
         seed=1,
     )
+    if shared_expert_rank_num == 0:
+        test_expert_replicas(
+            num_tokens, hidden, use_experts, num_topk, rank, use_ranks, group, buffer
+        )
 
     do_pressure_test = args.pressure_test
     for seed in range(int(1e9) if do_pressure_test else 0):
@@ -196,24 +196,30 @@ def test_compare(local_rank: int, num_local_ranks: int, args: argparse.Namespace
 
     def deepep_dispatch_func():
 
-        layout = dep_buffer.get_dispatch_layout(topk_idx, args.num_experts)
+        layout = dep_buffer.get_dispatch_layout(
+            topk_idx, args.num_experts, return_layout=True
+        )
 
         dep_buffer.dispatch(
             x,
             num_tokens_per_rank=layout[0],
             is_token_in_rank=layout[3],
             num_tokens_per_expert=layout[2],
+            layout=layout[5],
             config=dep_conf,
             topk_idx=topk_idx,
             topk_weights=topk_weights,
         )
 
-    layout_cache = dep_buffer.get_dispatch_layout(topk_idx, args.num_experts)
+    layout_cache = dep_buffer.get_dispatch_layout(
+        topk_idx, args.num_experts, return_layout=True
+    )
     x_expert_de, _, _, _, de_handle, _ = dep_buffer.dispatch(
         x,
         num_tokens_per_rank=layout_cache[0],
         is_token_in_rank=layout_cache[3],
         num_tokens_per_expert=layout_cache[2],
+        layout=layout_cache[5],
         config=dep_conf,
         topk_idx=topk_idx,
         topk_weights=topk_weights,